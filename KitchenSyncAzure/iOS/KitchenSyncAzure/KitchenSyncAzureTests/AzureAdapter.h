@@ -0,0 +1,21 @@
+//
+//  AzureAdapter.h
+//  KitchenSyncAzureTests
+//
+//
+
+#import <Foundation/Foundation.h>
+#import <WindowsAzureMobileServices/WindowsAzureMobileServices.h>
+#import "KSProviderAdapter.h"
+
+/*!
+ * KSProviderAdapter over MSTable. Entities are table names; objects are item
+ * dictionaries with the numeric id Mobile Services assigns on insert.
+ */
+@interface AzureAdapter : NSObject <KSProviderAdapter>
+
+- (id)initWithClient:(MSClient *)client;
+
+@property (nonatomic, readonly, strong) MSClient *client;
+
+@end
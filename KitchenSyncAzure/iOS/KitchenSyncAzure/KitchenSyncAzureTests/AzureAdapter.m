@@ -0,0 +1,104 @@
+//
+//  AzureAdapter.m
+//  KitchenSyncAzureTests
+//
+//
+
+#import "AzureAdapter.h"
+
+@implementation AzureAdapter
+
+- (id)initWithClient:(MSClient *)client {
+
+  self = [super init];
+
+  if (self) {
+    _client = client;
+  }
+
+  return self;
+}
+
+- (NSString *)providerName {
+  return @"Azure";
+}
+
+- (void)createObjectInEntity:(NSString *)entity fields:(NSDictionary *)fields completion:(KSBenchmarkCompletion)done {
+  [[_client tableWithName:entity] insert:fields completion:^(NSDictionary *insertedItem, NSError *error) {
+    done(insertedItem, error);
+  }];
+}
+
+/*!
+ * Mobile Services has no batch insert, so every insert is issued at once and
+ * the SDK pipelines them.
+ */
+- (void)createObjectsInEntity:(NSString *)entity fieldsList:(NSArray *)fieldsList completion:(KSBenchmarkCompletion)done {
+
+  MSTable *table               = [_client tableWithName:entity];
+  NSMutableArray *saved        = [NSMutableArray arrayWithCapacity:[fieldsList count]];
+  __block NSUInteger remaining = [fieldsList count];
+
+  if (remaining == 0) {
+    done(saved, nil);
+    return;
+  }
+
+  for (NSDictionary *fields in fieldsList) {
+    [table insert:fields completion:^(NSDictionary *insertedItem, NSError *error) {
+
+      BOOL finished = NO;
+
+      @synchronized(saved) {
+
+        if (insertedItem) {
+          [saved addObject:insertedItem];
+        }
+
+        finished = --remaining == 0;
+      }
+
+      if (finished) {
+        done(saved, nil);
+      }
+    }];
+  }
+}
+
+- (void)getObject:(NSDictionary *)object inEntity:(NSString *)entity completion:(KSBenchmarkCompletion)done {
+  [[_client tableWithName:entity] readWithId:object[@"id"] completion:^(NSDictionary *readItem, NSError *error) {
+    done(readItem, error);
+  }];
+}
+
+- (void)queryEntity:(NSString *)entity whereField:(NSString *)field equals:(id)value completion:(KSBenchmarkCompletion)done {
+
+  NSPredicate *predicate = [NSPredicate predicateWithFormat:@"%K == %@", field, value];
+
+  [[_client tableWithName:entity] readWithPredicate:predicate completion:^(NSArray *items, NSInteger totalCount, NSError *error) {
+    done(items, error);
+  }];
+}
+
+- (void)updateObject:(NSDictionary *)object inEntity:(NSString *)entity fields:(NSDictionary *)fields completion:(KSBenchmarkCompletion)done {
+
+  NSMutableDictionary *updatedItem = [object mutableCopy];
+
+  [updatedItem addEntriesFromDictionary:fields];
+
+  [[_client tableWithName:entity] update:updatedItem completion:^(NSDictionary *savedItem, NSError *error) {
+    done(savedItem, error);
+  }];
+}
+
+- (void)deleteObject:(NSDictionary *)object inEntity:(NSString *)entity completion:(KSBenchmarkCompletion)done {
+  [[_client tableWithName:entity] delete:object completion:^(NSNumber *itemId, NSError *error) {
+    done(itemId, error);
+  }];
+}
+
+- (id)valueForField:(NSString *)field ofObject:(NSDictionary *)object {
+  return object[field];
+}
+
+@end
@@ -6,6 +6,7 @@
 //
 
 #import "AzureConfigurator.h"
+#import "KSStandIn.h"
 
 @implementation AzureConfigurator
 
@@ -32,6 +33,8 @@
                                                                           ofType:@"plist"];
     
     configurationDict = [NSDictionary dictionaryWithContentsOfFile:dataPath];
+
+    [KSStandIn startWithConfiguration:configurationDict name:@"Azure"];
   });
   
   return configurationDict;
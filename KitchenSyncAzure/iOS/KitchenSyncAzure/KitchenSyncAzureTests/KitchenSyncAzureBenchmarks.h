@@ -0,0 +1,17 @@
+//
+//  KitchenSyncAzureBenchmarks.h
+//  KitchenSyncAzureTests
+//
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+#import <WindowsAzureMobileServices/WindowsAzureMobileServices.h>
+
+/*!
+ * Performance benchmarks for Windows Azure Mobile Services. They only run
+ * when RunBenchmarks is set in AzureConfiguration.plist, and write a JSON
+ * report per run.
+ */
+@interface KitchenSyncAzureBenchmarks : SenTestCase
+
+@end
@@ -0,0 +1,904 @@
+//
+//  KitchenSyncAzureBenchmarks.m
+//  KitchenSyncAzureTests
+//
+//
+
+#import "KitchenSyncAzureBenchmarks.h"
+#import "AzureConfigurator.h"
+#import "AzureAdapter.h"
+#import "KSBenchmarkReport.h"
+#import "KSBenchmarkSettings.h"
+#import "KSAdapterWorkloads.h"
+#import "KSCRUDBenchmark.h"
+#import "KSWireTrace.h"
+#import "KSMonotonicClock.h"
+#import "KSLoadGenerator.h"
+#import "KSBulkDeleter.h"
+#import "KSBatchWriteBenchmark.h"
+#import "KSPayloadScalingBenchmark.h"
+#import "KSStartupBenchmark.h"
+#import "KSCoreDataBenchmark.h"
+#import "KSProjectionBenchmark.h"
+#import "KSAggregationBenchmark.h"
+#import "KSQueryShapeBenchmark.h"
+#import "KSQueryCacheBenchmark.h"
+#import "KSConnectionReuseBenchmark.h"
+#import "KSFaultInjectionBenchmark.h"
+
+/*!
+ * Times each request from the client's filter chain to its response, so wire
+ * traces show what the SDK's HTTP layer adds to the wire time.
+ */
+@interface AzureWireFilter : NSObject <MSFilter>
+
+@end
+
+@implementation AzureWireFilter
+
+- (void)handleRequest:(NSURLRequest *)request next:(MSFilterNextBlock)next response:(MSFilterResponseBlock)response {
+
+  NSTimeInterval startedAt = KSMonotonicTime();
+
+  next(request, ^(NSHTTPURLResponse *httpResponse, NSData *data, NSError *error) {
+    [KSWireTrace recordSDKRequestInLayer:@"msfilter" startedAt:startedAt finishedAt:KSMonotonicTime() error:error];
+    response(httpResponse, data, error);
+  });
+}
+
+@end
+
+/*!
+ * Resends requests that got a 503 or lost their connection, up to three
+ * times, 0.25, 0.5 and 1 seconds apart.
+ */
+@interface AzureRetryFilter : NSObject <MSFilter>
+
+- (void)sendRequest:(NSURLRequest *)request next:(MSFilterNextBlock)next response:(MSFilterResponseBlock)response attempt:(NSUInteger)attempt;
+
+@end
+
+@implementation AzureRetryFilter
+
+- (void)handleRequest:(NSURLRequest *)request next:(MSFilterNextBlock)next response:(MSFilterResponseBlock)response {
+  [self sendRequest:request next:next response:response attempt:0];
+}
+
+- (void)sendRequest:(NSURLRequest *)request next:(MSFilterNextBlock)next response:(MSFilterResponseBlock)response attempt:(NSUInteger)attempt {
+
+  next(request, ^(NSHTTPURLResponse *httpResponse, NSData *data, NSError *error) {
+
+    BOOL lost = [[error domain] isEqualToString:NSURLErrorDomain] && [error code] == NSURLErrorNetworkConnectionLost;
+
+    if (attempt >= 3 || ([httpResponse statusCode] != 503 && !lost)) {
+      response(httpResponse, data, error);
+      return;
+    }
+
+    NSTimeInterval delay = 0.25 * (1 << attempt);
+
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+      [self sendRequest:request next:next response:response attempt:attempt + 1];
+    });
+  });
+}
+
+@end
+
+@interface KitchenSyncAzureBenchmarks()
+
+@property (nonatomic, strong) KSBenchmarkSettings *settings;
+@property (nonatomic, strong) KSAdapterWorkloads *workloads;
+@property (nonatomic, strong) MSClient *azureClient;
+
+- (void)initializeAzure;
+- (void)configureWorkloadsWithAdapter:(id<KSProviderAdapter>)adapter;
+- (KSLoadGenerator *)runCreateLoadWithBenchmark:(KSCRUDBenchmark *)benchmark workers:(NSUInteger)workers;
+- (KSProjectionBenchmark *)projectionBenchmarkForTable:(NSString *)tableName field:(NSString *)field;
+- (KSAggregationBenchmark *)aggregationBenchmarkForTable:(NSString *)tableName field:(NSString *)field;
+- (KSQueryShapeBenchmark *)queryShapeBenchmarkForTable:(NSString *)tableName field:(NSString *)field;
+- (KSQueryCacheBenchmark *)queryCacheBenchmarkForTable:(NSString *)tableName field:(NSString *)field;
+- (KSConnectionReuseBenchmark *)connectionReuseBenchmarkForTable:(NSString *)tableName field:(NSString *)field;
+- (KSFaultInjectionBenchmark *)faultInjectionBenchmarkForTable:(NSString *)tableName field:(NSString *)field;
+- (KSStartupBenchmark *)startupBenchmark;
+- (void)runBenchmark:(NSString *)benchmark test:(SEL)test block:(KSBenchmarkBlock)block;
+
+@end
+
+@implementation KitchenSyncAzureBenchmarks
+
+#pragma mark - Setup and Init
+
+- (void)setUp {
+
+  [super setUp];
+
+  NSDictionary *azureAppConfiguration = [[AzureConfigurator sharedInstance] applicationConfiguration];
+
+  _settings = [KSBenchmarkSettings settingsWithConfiguration:azureAppConfiguration];
+}
+
+/*!
+ * Benchmarks run against the open service; the secure one only differs in
+ * table permissions. The client carries an AzureWireFilter, which only
+ * records while a wire trace is running.
+ */
+- (void)initializeAzure {
+
+  NSDictionary *azureAppConfiguration = [[AzureConfigurator sharedInstance] applicationConfiguration];
+
+  MSClient *client = [MSClient clientWithApplicationURLString:azureAppConfiguration[@"OpenURL"]
+                                               applicationKey:azureAppConfiguration[@"OpenApplicationId"]];
+
+  _azureClient = [client clientWithFilter:[[AzureWireFilter alloc] init]];
+
+  [self configureWorkloadsWithAdapter:[[AzureAdapter alloc] initWithClient:_azureClient]];
+}
+
+/*!
+ * The shared workloads, run through the adapter with this suite's settings.
+ */
+- (void)configureWorkloadsWithAdapter:(id<KSProviderAdapter>)adapter {
+
+  _workloads = [[KSAdapterWorkloads alloc] initWithAdapter:adapter];
+
+  _workloads.iterations         = _settings.iterations;
+  _workloads.timeout            = _settings.testTimeout;
+  _workloads.batchSizes         = _settings.batchSizes;
+  _workloads.cleanupConcurrency = _settings.teardownConcurrency;
+  _workloads.payloadIterations  = _settings.payloadIterations;
+  _workloads.payloadSizes       = _settings.payloadSizes;
+  _workloads.payloadFieldCounts = _settings.payloadFieldCounts;
+}
+
+#pragma mark - Teardown
+
+- (void)tearDown {
+  [super tearDown];
+}
+
+#pragma mark - Benchmark utilities
+
+/*!
+ * Runs the benchmark's create block with the given number of concurrent
+ * workers for LoadDuration seconds, then deletes what it created.
+ */
+- (KSLoadGenerator *)runCreateLoadWithBenchmark:(KSCRUDBenchmark *)benchmark workers:(NSUInteger)workers {
+
+  KSLoadGenerator *generator        = [KSLoadGenerator generatorWithName:[NSString stringWithFormat:@"%@.create", benchmark.entity] workers:workers];
+  KSBenchmarkIterationBlock create  = benchmark.createBlock;
+  KSBenchmarkObjectBlock remove     = benchmark.deleteBlock;
+  NSMutableArray *created           = [NSMutableArray array];
+
+  generator.targetRate       = _settings.loadTargetRate;
+  generator.duration         = _settings.loadDuration;
+  generator.operationTimeout = _settings.testTimeout;
+
+  BOOL drained = [generator runWithBlock:^(NSUInteger sequence, KSBenchmarkCompletion done) {
+    create(sequence, ^(id result, NSError *error) {
+
+      if (result && !error) {
+        @synchronized(created) {
+          [created addObject:result];
+        }
+      }
+
+      done(result, error);
+    });
+  }];
+
+  STAssertTrue(drained, @"%@ still had operations outstanding", generator.name);
+
+  NSArray *createdObjects = nil;
+
+  @synchronized(created) {
+    createdObjects = [created copy];
+  }
+
+  KSBulkDeleter *deleter = [KSBulkDeleter deleterWithConfiguration:[[AzureConfigurator sharedInstance] applicationConfiguration]];
+
+  [deleter deleteItems:createdObjects withBlock:^(id object, KSBulkDeleteCompletion done) {
+    remove(object, 0, ^(id result, NSError *error) {
+      done(error);
+    });
+  }];
+
+  // Everything the run created goes at once, so allow a timeout per round
+  // of deletes.
+  NSTimeInterval timeout = _settings.testTimeout * MAX(1, [createdObjects count] / deleter.maxConcurrentDeletes);
+  NSString *failure      = [deleter waitAndReportNamed:generator.name timeout:timeout];
+
+  if (failure) {
+    NSLog(@"%@; %lu objects left behind", failure, (unsigned long)(createdObjects.count - deleter.deletedCount));
+  }
+
+  return generator;
+}
+
+/*!
+ * Projects with MSQuery's selectFields on a query for the item's id. Tables
+ * hold no references, so there is no expanded read.
+ */
+- (KSProjectionBenchmark *)projectionBenchmarkForTable:(NSString *)tableName field:(NSString *)field {
+
+  KSProjectionBenchmark *benchmark = [[KSProjectionBenchmark alloc] initWithEntity:tableName field:field iterations:_settings.iterations];
+  KSCRUDBenchmark *crud            = [_workloads crudBenchmarkForEntity:tableName field:field];
+  id<KSProviderAdapter> adapter    = _workloads.adapter;
+  MSTable *table                   = [_azureClient tableWithName:tableName];
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.fieldCount         = _settings.projectionFieldCount;
+  benchmark.expandDepth        = 0;
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  benchmark.createBlock = ^(NSDictionary *fields, KSBenchmarkCompletion done) {
+    [adapter createObjectInEntity:tableName fields:fields completion:done];
+  };
+
+  benchmark.readBlock = ^(NSDictionary *item, NSArray *fields, NSUInteger depth, KSBenchmarkCompletion done) {
+
+    MSQuery *query = [[MSQuery alloc] initWithTable:table predicate:[NSPredicate predicateWithFormat:@"id == %@", item[@"id"]]];
+
+    if (fields) {
+      query.selectFields = fields;
+    }
+
+    [query readWithCompletion:^(NSArray *items, NSInteger totalCount, NSError *error) {
+      done([items lastObject], error);
+    }];
+  };
+
+  benchmark.fieldCountBlock = ^NSUInteger(NSDictionary *item) {
+    return [item count];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Mobile Services has no aggregates, but a read with includeTotalCount
+ * returns the number of matching items next to the page, so the server count
+ * reads one item and keeps the total. Sum, min, max and average only run as
+ * the client fold, which selects the value field and pages by fetchOffset,
+ * ordered by id.
+ */
+- (KSAggregationBenchmark *)aggregationBenchmarkForTable:(NSString *)tableName field:(NSString *)field {
+
+  KSAggregationBenchmark *benchmark = [[KSAggregationBenchmark alloc] initWithEntity:tableName field:field valueField:@"fooValue" iterations:_settings.aggregationIterations];
+  KSCRUDBenchmark *crud             = [_workloads crudBenchmarkForEntity:tableName field:field];
+  id<KSProviderAdapter> adapter     = _workloads.adapter;
+  MSTable *table                    = [_azureClient tableWithName:tableName];
+  NSString *valueField              = benchmark.valueField;
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.rowCount           = _settings.aggregationRowCount;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.serverFunctions    = @[KSAggregateCount];
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  benchmark.seedBlock = ^(NSArray *fieldsList, KSBenchmarkCompletion done) {
+    [adapter createObjectsInEntity:tableName fieldsList:fieldsList completion:done];
+  };
+
+  benchmark.valueBlock = ^NSNumber *(NSDictionary *item) {
+    return item[valueField];
+  };
+
+  benchmark.pageBlock = ^(NSString *tag, NSDictionary *lastItem, NSUInteger offset, NSUInteger limit, KSPageCompletion done) {
+
+    MSQuery *query = [[MSQuery alloc] initWithTable:table predicate:[NSPredicate predicateWithFormat:@"%K == %@", field, tag]];
+
+    query.selectFields = @[valueField];
+    query.fetchOffset  = offset;
+    query.fetchLimit   = limit;
+
+    [query orderByAscending:@"id"];
+
+    [query readWithCompletion:^(NSArray *items, NSInteger totalCount, NSError *error) {
+      done(items, error);
+    }];
+  };
+
+  benchmark.serverBlock = ^(NSString *tag, NSString *function, KSBenchmarkCompletion done) {
+
+    MSQuery *query = [[MSQuery alloc] initWithTable:table predicate:[NSPredicate predicateWithFormat:@"%K == %@", field, tag]];
+
+    query.selectFields      = @[@"id"];
+    query.fetchLimit        = 1;
+    query.includeTotalCount = YES;
+
+    [query readWithCompletion:^(NSArray *items, NSInteger totalCount, NSError *error) {
+      done(error ? nil : @(totalCount), error);
+    }];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Every shape is an MSQuery with an NSPredicate ANDed with the run's tag:
+ * ==, a >=/< pair, IN, OR, and -orderByAscending: with -orderByDescending:.
+ * OData has no regex, so the regex shape is BEGINSWITH '3-', which the SDK
+ * sends as startswith() and matches the same objects as ^3-.
+ */
+- (KSQueryShapeBenchmark *)queryShapeBenchmarkForTable:(NSString *)tableName field:(NSString *)field {
+
+  KSQueryShapeBenchmark *benchmark = [[KSQueryShapeBenchmark alloc] initWithEntity:tableName field:field iterations:_settings.queryIterations];
+  KSCRUDBenchmark *crud            = [_workloads crudBenchmarkForEntity:tableName field:field];
+  id<KSProviderAdapter> adapter    = _workloads.adapter;
+  MSTable *table                   = [_azureClient tableWithName:tableName];
+  NSString *categoryField          = benchmark.categoryField;
+  NSString *valueField             = benchmark.valueField;
+  NSString *nameField              = benchmark.nameField;
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  if ([_settings.queryRowCounts count] > 0) {
+    benchmark.rowCounts = _settings.queryRowCounts;
+  }
+
+  benchmark.seedBlock = ^(NSArray *fieldsList, KSBenchmarkCompletion done) {
+    [adapter createObjectsInEntity:tableName fieldsList:fieldsList completion:done];
+  };
+
+  benchmark.valueBlock = ^id(NSDictionary *item, NSString *valueName) {
+    return item[valueName];
+  };
+
+  MSQuery *(^tagged)(NSString *, NSPredicate *) = ^MSQuery *(NSString *tag, NSPredicate *predicate) {
+
+    NSPredicate *tagPredicate = [NSPredicate predicateWithFormat:@"%K == %@", field, tag];
+    NSPredicate *both         = [NSCompoundPredicate andPredicateWithSubpredicates:@[tagPredicate, predicate]];
+
+    return [[MSQuery alloc] initWithTable:table predicate:both];
+  };
+
+  void (^find)(MSQuery *, NSUInteger, KSBenchmarkCompletion) = ^(MSQuery *query, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    query.fetchLimit = limit;
+
+    [query readWithCompletion:^(NSArray *items, NSInteger totalCount, NSError *error) {
+      done(items, error);
+    }];
+  };
+
+  [benchmark addShape:KSQueryShapeEquality block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+    find(tagged(tag, [NSPredicate predicateWithFormat:@"%K == %@", categoryField, @"category-3"]), limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeRange block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+    find(tagged(tag, [NSPredicate predicateWithFormat:@"%K >= 100 AND %K < 200", valueField, valueField]), limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeContainedIn block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+    find(tagged(tag, [NSPredicate predicateWithFormat:@"%K IN %@", categoryField, @[@"category-1", @"category-5", @"category-7"]]), limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeRegex block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+    find(tagged(tag, [NSPredicate predicateWithFormat:@"%K BEGINSWITH %@", nameField, @"3-"]), limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeOr block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+    find(tagged(tag, [NSPredicate predicateWithFormat:@"%K == %@ OR %K < 50", categoryField, @"category-2", valueField]), limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeSort block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    MSQuery *query = [[MSQuery alloc] initWithTable:table predicate:[NSPredicate predicateWithFormat:@"%K == %@", field, tag]];
+
+    [query orderByAscending:categoryField];
+    [query orderByDescending:valueField];
+
+    find(query, limit, done);
+  }];
+
+  return benchmark;
+}
+
+/*!
+ * Reads are an MSQuery on the benchmark field, and the cache key is its
+ * -queryStringOrError:, the OData query the SDK sends. A query the SDK can't
+ * turn into a string goes straight to the table.
+ */
+- (KSQueryCacheBenchmark *)queryCacheBenchmarkForTable:(NSString *)tableName field:(NSString *)field {
+
+  KSQueryCacheBenchmark *benchmark = [[KSQueryCacheBenchmark alloc] initWithAdapter:_workloads.adapter entity:tableName field:field operations:_settings.queryCacheOperations];
+  MSTable *table                   = [_azureClient tableWithName:tableName];
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.readRatio          = _settings.queryCacheReadRatio;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+
+  benchmark.readBlock = ^(NSString *value, KSQueryCache *cache, KSBenchmarkCompletion done) {
+
+    MSQuery *query = [[MSQuery alloc] initWithTable:table predicate:[NSPredicate predicateWithFormat:@"%K == %@", field, value]];
+    NSError *error = nil;
+    NSString *key  = cache ? [query queryStringOrError:&error] : nil;
+
+    KSQueryCacheFetchBlock fetch = ^(KSBenchmarkCompletion fetched) {
+      [query readWithCompletion:^(NSArray *items, NSInteger totalCount, NSError *readError) {
+        fetched(items, readError);
+      }];
+    };
+
+    if (!key) {
+      fetch(done);
+      return;
+    }
+
+    [cache readEntity:tableName key:key fetch:fetch completion:done];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * -initializeAzure in the functional tests builds two MSClients. The secure
+ * service's tables need a user, so the second client here is another one
+ * for the open service, built the same way.
+ */
+- (KSConnectionReuseBenchmark *)connectionReuseBenchmarkForTable:(NSString *)tableName field:(NSString *)field {
+
+  KSConnectionReuseBenchmark *benchmark = [[KSConnectionReuseBenchmark alloc] initWithEntity:tableName field:field operations:_settings.connectionReuseOperations];
+
+  benchmark.timeout = _settings.testTimeout;
+  benchmark.idleGap = _settings.connectionReuseIdleGap;
+
+  NSDictionary *azureAppConfiguration = [[AzureConfigurator sharedInstance] applicationConfiguration];
+
+  MSClient *second = [MSClient clientWithApplicationURLString:azureAppConfiguration[@"OpenURL"]
+                                               applicationKey:azureAppConfiguration[@"OpenApplicationId"]];
+
+  [benchmark addClient:@"client_1" adapter:_workloads.adapter];
+  [benchmark addClient:@"client_2" adapter:[[AzureAdapter alloc] initWithClient:second]];
+
+  return benchmark;
+}
+
+/*!
+ * MSClient doesn't retry, so besides the benchmark client a second one runs
+ * with an AzureRetryFilter, the way retries are added to the Azure SDK.
+ *
+ * Fault rates missing from the configuration keep the benchmark's defaults.
+ */
+- (KSFaultInjectionBenchmark *)faultInjectionBenchmarkForTable:(NSString *)tableName field:(NSString *)field {
+
+  KSFaultInjectionBenchmark *benchmark = [[KSFaultInjectionBenchmark alloc] initWithEntity:tableName field:field operations:_settings.faultInjectionOperations];
+
+  benchmark.timeout = _settings.testTimeout;
+
+  if (_settings.faultServiceUnavailableRate) {
+    benchmark.serviceUnavailableRate = [_settings.faultServiceUnavailableRate doubleValue];
+  }
+
+  if (_settings.faultResetRate) {
+    benchmark.resetRate = [_settings.faultResetRate doubleValue];
+  }
+
+  if (_settings.faultLatencySpikeRate) {
+    benchmark.latencySpikeRate = [_settings.faultLatencySpikeRate doubleValue];
+  }
+
+  if (_settings.faultLatencySpike) {
+    benchmark.latencySpike = [_settings.faultLatencySpike doubleValue];
+  }
+
+  id<KSProviderAdapter> adapter  = _workloads.adapter;
+  id<KSProviderAdapter> retrying = [[AzureAdapter alloc] initWithClient:[_azureClient clientWithFilter:[[AzureRetryFilter alloc] init]]];
+
+  [benchmark addVariant:@"default" block:^(NSString *value, KSBenchmarkCompletion done) {
+    [adapter queryEntity:tableName whereField:field equals:value completion:done];
+  }];
+
+  [benchmark addVariant:@"retry_filter" block:^(NSString *value, KSBenchmarkCompletion done) {
+    [retrying queryEntity:tableName whereField:field equals:value completion:done];
+  }];
+
+  return benchmark;
+}
+
+/*!
+ * Loads AzureConfiguration.plist the way AzureConfigurator does, builds an
+ * MSClient for the open service and reads one Foo. Every pass builds a new
+ * client.
+ */
+- (KSStartupBenchmark *)startupBenchmark {
+
+  KSStartupBenchmark *benchmark       = [[KSStartupBenchmark alloc] initWithProvider:@"Azure" passes:_settings.startupPasses];
+  __block NSDictionary *configuration = nil;
+  __block MSClient *client            = nil;
+
+  benchmark.timeout = _settings.testTimeout;
+
+  [benchmark addPhase:@"configuration" block:^(NSUInteger pass, KSBenchmarkCompletion done) {
+
+    NSString *path = [[NSBundle bundleForClass:[AzureConfigurator class]] pathForResource:@"AzureConfiguration" ofType:@"plist"];
+
+    configuration = [NSDictionary dictionaryWithContentsOfFile:path];
+
+    done(configuration, nil);
+  }];
+
+  [benchmark addPhase:@"client" block:^(NSUInteger pass, KSBenchmarkCompletion done) {
+
+    client = [MSClient clientWithApplicationURLString:configuration[@"OpenURL"]
+                                       applicationKey:configuration[@"OpenApplicationId"]];
+
+    done(client, nil);
+  }];
+
+  [benchmark addPhase:@"first_request" block:^(NSUInteger pass, KSBenchmarkCompletion done) {
+
+    MSQuery *query = [[client tableWithName:@"Foo"] query];
+
+    query.fetchLimit = 1;
+
+    [query readWithCompletion:^(NSArray *items, NSInteger totalCount, NSError *error) {
+      done(items, error);
+    }];
+  }];
+
+  benchmark.resetBlock = ^{
+    client = nil;
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Runs one test's benchmark through the shared settings, which write the
+ * report where BenchmarkReportDirectory points, and fails the test if it
+ * raised or the report could not be written.
+ */
+- (void)runBenchmark:(NSString *)benchmark test:(SEL)test block:(KSBenchmarkBlock)block {
+
+  NSString *failure = [_settings runBenchmark:benchmark provider:@"Azure" test:test block:block];
+
+  STAssertNil(failure, @"%@", failure);
+}
+
+#pragma mark - Startup benchmarks
+
+/*!
+ * Times loading the configuration, building the client and the first request
+ * to Foo, StartupPasses times. The first pass is reported as cold, and the
+ * report records how long the test process had been up, since earlier tests
+ * may already have warmed the SDK.
+ */
+- (void)test_050_Cold_Start {
+
+  [self runBenchmark:@"startup" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    KSStartupBenchmark *benchmark = [self startupBenchmark];
+
+    [report setParameter:@(benchmark.passes) forKey:@"passes"];
+    [report setParameter:@([KSStartupBenchmark processUptime]) forKey:@"process_uptime_s"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Azure startup phases failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Latency benchmarks
+
+/*!
+ * Measures p50/p95/p99 latency and throughput of insert, read by id, query,
+ * update and delete for the Foo and Bar tables.
+ *
+ * Each entity also gets a wire trace: DNS, connect, time to first byte and
+ * transfer per request, and how much of the operation time was spent on the
+ * wire rather than in the SDK.
+ */
+- (void)test_100_CRUD_Latency {
+
+  [self runBenchmark:@"crud_latency" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeAzure];
+
+    [report setParameter:@(_settings.iterations) forKey:@"iterations"];
+
+    NSArray *benchmarks = @[[_workloads crudBenchmarkForEntity:@"Foo" field:@"fooParameter"],
+                            [_workloads crudBenchmarkForEntity:@"Bar" field:@"barParameter"]];
+
+    for (KSCRUDBenchmark *benchmark in benchmarks) {
+
+      [KSWireTrace start];
+      [benchmark runWithReport:report];
+      [KSWireTrace stop];
+
+      [KSWireTrace addToReport:report operations:benchmark.histograms attributes:@{@"entity" : benchmark.entity}];
+
+      STAssertTrue(benchmark.errorCount == 0, @"%lu %@ operations failed", (unsigned long)benchmark.errorCount, benchmark.entity);
+    }
+  }];
+}
+
+#pragma mark - Load benchmarks
+
+/*!
+ * Creates Foo objects as fast as LoadWorkers concurrent workers allow (or at
+ * LoadTargetRate) and reports achieved throughput, error rate and latency
+ * at each worker count.
+ */
+- (void)test_110_Create_Throughput_Under_Load {
+
+  [self runBenchmark:@"load" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeAzure];
+
+    [report setParameter:_settings.loadWorkers forKey:@"workers"];
+    [report setParameter:@(_settings.loadTargetRate) forKey:@"target_rate"];
+    [report setParameter:@(_settings.loadDuration) forKey:@"duration_s"];
+
+    KSCRUDBenchmark *benchmark = [_workloads crudBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    for (NSNumber *workers in _settings.loadWorkers) {
+
+      KSLoadGenerator *generator = [self runCreateLoadWithBenchmark:benchmark workers:[workers unsignedIntegerValue]];
+
+      if(_settings.showLogs) NSLog(@"%@", generator);
+
+      [generator addToReport:report];
+    }
+  }];
+}
+
+#pragma mark - Batch write benchmarks
+
+/*!
+ * Saves BatchSizes Foo objects one at a time, then again with every insert in
+ * flight at once.
+ * Reports objects/sec and bytes on the wire for both paths.
+ */
+- (void)test_120_Batch_Write {
+
+  [self runBenchmark:@"batch_write" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeAzure];
+
+    [report setParameter:_settings.batchSizes forKey:@"batch_sizes"];
+
+    KSBatchWriteBenchmark *benchmark = [_workloads batchWriteBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo saves failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Payload scaling benchmarks
+
+/*!
+ * Creates and reads Foo objects as the field grows from 100 B to 1 MB and as
+ * the field count grows from 1 to 500, and reports latency, JSON
+ * serialisation cost and wire time at each step.
+ */
+- (void)test_140_Payload_Scaling {
+
+  [self runBenchmark:@"payload_scaling" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeAzure];
+
+    KSPayloadScalingBenchmark *benchmark = [_workloads payloadScalingBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.payloadIterations) forKey:@"iterations"];
+    [report setParameter:benchmark.payloadSizes forKey:@"payload_sizes"];
+    [report setParameter:benchmark.fieldCounts forKey:@"field_counts"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo payload operations failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Core Data store benchmarks
+
+/*!
+ * Fills in-memory, SQLite and binary stores with 1,000 to 1,000,000 Bar rows
+ * and reports insert and save throughput, how long the store takes to open
+ * again and fetch latency at each size. Nothing goes to Azure.
+ */
+- (void)test_160_Core_Data_Store {
+
+  [self runBenchmark:@"core_data_store" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    KSCoreDataBenchmark *benchmark = [[KSCoreDataBenchmark alloc] initWithEntity:@"Bar" field:@"barParameter"];
+
+    benchmark.fetchIterations = _settings.iterations;
+
+    if ([_settings.coreDataRowCounts count] > 0) {
+      benchmark.rowCounts = _settings.coreDataRowCounts;
+    }
+
+    if ([_settings.coreDataStoreTypes count] > 0) {
+      benchmark.storeTypes = _settings.coreDataStoreTypes;
+    }
+
+    [report setParameter:benchmark.storeTypes forKey:@"store_types"];
+    [report setParameter:benchmark.rowCounts forKey:@"row_counts"];
+    [report setParameter:@(benchmark.saveBatchSize) forKey:@"save_batch_size"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Core Data store steps failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Projection benchmarks
+
+/*!
+ * Reads 200-field Foo items whole and with only fooParameter selected, and
+ * reports latency, bytes received and decode time for both. Mobile Services
+ * has no references to expand.
+ */
+- (void)test_180_Field_Projection {
+
+  [self runBenchmark:@"projection" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeAzure];
+
+    KSProjectionBenchmark *benchmark = [self projectionBenchmarkForTable:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.iterations) forKey:@"iterations"];
+    [report setParameter:@(benchmark.fieldCount) forKey:@"fields"];
+    [report setParameter:benchmark.projectedFields forKey:@"projected_fields"];
+    [report setParameter:@(benchmark.expandDepth) forKey:@"expand_depth"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo projection saves or reads failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Aggregation benchmarks
+
+/*!
+ * Counts a 100,000-item Foo table with a total count and by downloading
+ * every row, and folds sum, min, max and average on the client, reporting
+ * how much faster the server count is and what each way downloads.
+ */
+- (void)test_200_Aggregation {
+
+  [self runBenchmark:@"aggregation" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeAzure];
+
+    KSAggregationBenchmark *benchmark = [self aggregationBenchmarkForTable:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.aggregationIterations) forKey:@"iterations"];
+    [report setParameter:@(benchmark.rowCount) forKey:@"rows"];
+    [report setParameter:@(benchmark.pageSize) forKey:@"page_size"];
+    [report setParameter:benchmark.serverFunctions forKey:@"server_functions"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo aggregation saves or reads failed or came back wrong", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Query shape benchmarks
+
+/*!
+ * Runs equality, range, IN, startswith, OR and two-key sort queries over
+ * 1,000 to 100,000 Foo objects and reports how each one's latency grows with
+ * the table, to find the shapes Azure answers with a full scan.
+ */
+- (void)test_220_Query_Shapes {
+
+  [self runBenchmark:@"query_shapes" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeAzure];
+
+    KSQueryShapeBenchmark *benchmark = [self queryShapeBenchmarkForTable:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.queryIterations) forKey:@"iterations"];
+    [report setParameter:benchmark.rowCounts forKey:@"row_counts"];
+    [report setParameter:benchmark.shapes forKey:@"shapes"];
+    [report setParameter:@(benchmark.resultLimit) forKey:@"result_limit"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo query shape saves or queries failed or returned the wrong objects", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Query cache benchmarks
+
+/*!
+ * Replays a read-heavy mix of Foo list queries and saves straight against
+ * Azure and again through KSQueryCache, MSQuery having no client cache of
+ * its own, and reports the hit rate and the requests and read time the
+ * cache saved.
+ */
+- (void)test_230_Query_Cache {
+
+  [self runBenchmark:@"query_cache" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeAzure];
+
+    KSQueryCacheBenchmark *benchmark = [self queryCacheBenchmarkForTable:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(benchmark.operations) forKey:@"operations"];
+    [report setParameter:@(benchmark.readRatio) forKey:@"read_ratio"];
+    [report setParameter:@(benchmark.keyCount) forKey:@"key_count"];
+    [report setParameter:@(benchmark.objectsPerKey) forKey:@"objects_per_key"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo query cache operations failed or read stale lists", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Connection reuse benchmarks
+
+/*!
+ * Counts the TCP and TLS handshakes the Azure SDK makes per 1000 Foo
+ * queries, sequentially, concurrently and in bursts with idle gaps between
+ * them, through one MSClient and through two. Needs StandInMode Replay.
+ */
+- (void)test_240_Connection_Reuse {
+
+  [self runBenchmark:@"connection_reuse" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeAzure];
+
+    KSConnectionReuseBenchmark *benchmark = [self connectionReuseBenchmarkForTable:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(benchmark.operations) forKey:@"operations"];
+    [report setParameter:@(benchmark.concurrency) forKey:@"concurrency"];
+    [report setParameter:@(benchmark.burstSize) forKey:@"burst_size"];
+    [report setParameter:@(benchmark.idleBursts) forKey:@"idle_bursts"];
+    [report setParameter:@(benchmark.idleGap) forKey:@"idle_gap_s"];
+
+    [benchmark runWithReport:report];
+
+    if (benchmark.skipped) {
+      if(_settings.showLogs) NSLog(@"StandInMode isn't Replay, skipping %@", NSStringFromSelector(_cmd));
+      *discard = YES;
+      return;
+    }
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo queries failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Fault injection benchmarks
+
+/*!
+ * Runs Foo queries through the Azure SDK, without retries and with an
+ * AzureRetryFilter, while the stand-in answers some requests with 503s,
+ * resets others and holds others back, and reports tail latency, success
+ * rate and the requests the retries add. Needs StandInMode Record or Replay.
+ */
+- (void)test_250_Fault_Injection {
+
+  [self runBenchmark:@"fault_injection" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeAzure];
+
+    KSFaultInjectionBenchmark *benchmark = [self faultInjectionBenchmarkForTable:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(benchmark.operations) forKey:@"operations"];
+    [report setParameter:@(benchmark.concurrency) forKey:@"concurrency"];
+    [report setParameter:@(benchmark.serviceUnavailableRate) forKey:@"service_unavailable_rate"];
+    [report setParameter:@(benchmark.resetRate) forKey:@"reset_rate"];
+    [report setParameter:@(benchmark.latencySpikeRate) forKey:@"latency_spike_rate"];
+    [report setParameter:@(benchmark.latencySpike) forKey:@"latency_spike_s"];
+
+    [benchmark runWithReport:report];
+
+    if (benchmark.skipped) {
+      if(_settings.showLogs) NSLog(@"StandInMode is Off, skipping %@", NSStringFromSelector(_cmd));
+      *discard = YES;
+      return;
+    }
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo queries failed without faults", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+@end
@@ -8,20 +8,34 @@
 
 #import "KitchenSyncAzureTests.h"
 #import "AzureConfigurator.h"
+#import "KSCompletionWaiter.h"
+#import "KSBulkDeleter.h"
+#import "KSPagedQuery.h"
+#import "KSRandomString.h"
+#import "KSRunNamespace.h"
+#import "KSCoreDataStack.h"
 #import "Foo.h"
 #import "Bar.h"
 
 @interface KitchenSyncAzureTests()
 
 @property (nonatomic, assign) BOOL showLogs;
-@property (nonatomic, copy) void (^testForCompletionBlock)(BOOL *testCompleted);
+@property (nonatomic, assign) NSTimeInterval testTimeout;
+@property (nonatomic, strong) NSDictionary *configuration;
 @property (nonatomic, strong) MSClient *azureClientSecure;
 @property (nonatomic, strong) MSClient *azureClientOpen;
+@property (nonatomic, assign) BOOL deleteAllTestDataEnabled;
+@property (nonatomic, strong) KSRunNamespace *runNamespace;
+@property (nonatomic, copy) NSString *coreDataStoreType;
 
 - (void)deleteAllTestData;
+- (void)deleteRunTestData;
 - (void)deleteAllFoo;
 - (void)deleteAllBar;
+- (void)deleteAllItemsInTableNamed:(NSString *)tableName;
+- (void)deleteAllItemsInTableNamed:(NSString *)tableName taggedInColumn:(NSString *)column;
 - (NSString *)randomString:(int)numCharacters;
+- (void)waitForCompletion:(KSCompletionWaiter *)waiter;
 - (void)initializeAzure;
 - (void)setupCoreDataEnvironment;
 
@@ -45,23 +59,24 @@
 
   [super setUp];
   
-  _testForCompletionBlock = ^(BOOL *testCompleted) {
-    
-    while (!*testCompleted) {
-      
-      NSDate *cycle = [NSDate dateWithTimeIntervalSinceNow:0.01];
-      
-      [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode
-                               beforeDate:cycle];
-    }
-  };
-  
   NSDictionary *azureAppConfiguration = [[AzureConfigurator sharedInstance] applicationConfiguration];
   
   _showLogs = [azureAppConfiguration[@"ShowLogs"] boolValue];
 
+  _testTimeout         = [azureAppConfiguration[@"TestTimeout"] doubleValue];
+  _configuration       = azureAppConfiguration;
+
+  _deleteAllTestDataEnabled = [azureAppConfiguration[@"DeleteAllTestData"] boolValue];
+  _runNamespace             = [KSRunNamespace currentNamespace];
+  _coreDataStoreType        = [KSCoreDataStack storeTypeForName:azureAppConfiguration[@"CoreDataStoreType"]];
+
+  if (_testTimeout <= 0) {
+    _testTimeout = 30.0;
+  }
+
+  STAssertNotNil(_coreDataStoreType, @"unknown CoreDataStoreType %@, expected InMemory, SQLite or Binary", azureAppConfiguration[@"CoreDataStoreType"]);
+
   [self initializeAzure];
-  [self deleteAllTestData];
 }
 
 - (void)tearDown {  
@@ -84,6 +99,22 @@
   }
 }
 
+/*!
+ This method deletes the Foo and Bar objects this run tagged.
+ */
+- (void)deleteRunTestData {
+
+  @try {
+
+    [self deleteAllItemsInTableNamed:@"Foo" taggedInColumn:@"fooParameter"];
+    [self deleteAllItemsInTableNamed:@"Bar" taggedInColumn:@"barParameter"];
+
+  } @catch (NSException * e) {
+
+    NSLog(@"deleteRunTestData failed: %@", [e description]);
+  }
+}
+
 /*!
  This method deletes all Foo objects from the backend.
  */
@@ -91,6 +122,8 @@
 
   @try {
 
+    [self deleteAllItemsInTableNamed:@"Foo"];
+
   } @catch (NSException * e) {
     NSLog(@"deleteAllFoo failed: %@", [e description]);
   }
@@ -103,13 +136,110 @@
 
   @try {
 
+    [self deleteAllItemsInTableNamed:@"Bar"];
+
   } @catch (NSException * e) {
     NSLog(@"deleteAllBar failed: %@", [e description]);
   }
 }
 
+/*!
+ * Deletes every row of the table on both the open and secure services.
+ * Rows are read a page at a time with fetchLimit/fetchOffset until a page
+ * comes back empty; each page is deleted by id with TeardownConcurrency
+ * requests in flight.
+ */
+- (void)deleteAllItemsInTableNamed:(NSString *)tableName {
+  [self deleteAllItemsInTableNamed:tableName taggedInColumn:nil];
+}
+
+/*!
+ * Same as -deleteAllItemsInTableNamed:, limited to the rows whose column
+ * starts with this run's prefix when column is given. BEGINSWITH goes to
+ * the service as an OData startswith filter.
+ */
+- (void)deleteAllItemsInTableNamed:(NSString *)tableName taggedInColumn:(NSString *)column {
+
+  NSPredicate *predicate = column ? [NSPredicate predicateWithFormat:@"%K BEGINSWITH %@", column, _runNamespace.valuePrefix] : nil;
+
+  for (MSClient *client in @[_azureClientOpen, _azureClientSecure]) {
+
+    MSTable *table = [client tableWithName:tableName];
+
+    KSPagedQuery *pages = [KSPagedQuery queryWithPageSize:1000 fetchBlock:^(NSUInteger offset, NSUInteger limit, KSPageCompletion done) {
+
+      MSQuery *query = predicate ? [table queryWithPredicate:predicate] : [table query];
+
+      query.fetchLimit  = limit;
+      query.fetchOffset = offset;
+
+      [query readWithCompletion:^(NSArray *items, NSInteger totalCount, NSError *error) {
+        done(items, error);
+      }];
+    }];
+
+    pages.timeout       = _testTimeout;
+    pages.consumesPages = YES;
+
+    BOOL completed = [pages enumeratePagesUsingBlock:^(NSArray *page, NSUInteger offset, BOOL *stop) {
+
+      KSBulkDeleter *deleter = [KSBulkDeleter deleterWithConfiguration:_configuration];
+
+      [deleter deleteItems:page withBlock:^(NSDictionary *item, KSBulkDeleteCompletion done) {
+        [table deleteWithId:item[@"id"] completion:^(NSNumber *itemId, NSError *error) {
+          done(error);
+        }];
+      }];
+
+      NSString *failure = [deleter waitAndReportNamed:tableName timeout:_testTimeout];
+      STAssertNil(failure, @"%@", failure);
+
+      // Don't keep re-reading a page that can't be deleted.
+      if (deleter.failedCount > 0 || deleter.deletedCount < [page count]) {
+        *stop = YES;
+      }
+    }];
+
+    // A table that was never created comes back as an error; nothing to delete.
+    if (!completed && _showLogs) {
+      NSLog(@"reading %@ failed: %@", tableName, [pages.error description]);
+    }
+  }
+}
+
+#pragma mark - Async helpers
+
+/*!
+ * Waits for the waiter to be signalled by an SDK completion block, failing
+ * the test if it does not happen within the configured TestTimeout.
+ */
+- (void)waitForCompletion:(KSCompletionWaiter *)waiter {
+
+  BOOL completed = [waiter waitWithTimeout:_testTimeout];
+
+  STAssertTrue(completed, @"timed out after %.3fs waiting for completion", waiter.elapsed);
+
+  if(_showLogs) {
+    NSLog(@"completion wait took %.3f ms", waiter.elapsed * 1000.0);
+  }
+}
+
 #pragma mark - Setup and configuration tests
 
+/*!
+ * Empties Foo and Bar of every run's rows, including rows other runs are
+ * still using, so it only runs with DeleteAllTestData set.
+ */
+- (void)test_000_Delete_All_Test_Data {
+
+  if (!_deleteAllTestDataEnabled) {
+    NSLog(@"DeleteAllTestData is off, leaving other runs' data alone");
+    return;
+  }
+
+  [self deleteAllTestData];
+}
+
 /*!
  * Tests the ability to access data without authentication key if allowed.
  */
@@ -117,17 +247,17 @@
   
   @try {
 
-    __block BOOL testCompleted = NO;
+    KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
     __block NSDictionary *returnedFooDictionary = nil;
 
     // create a foo object
-    NSDictionary *item = @{@"fooParameter" : @"Testing public access"};
+    NSDictionary *item = @{@"fooParameter" : [_runNamespace tagValue:@"Testing public access"]};
 
     MSTable *fooTable = [_azureClientOpen tableWithName:@"Foo"];
     
     [fooTable insert:item completion:^(NSDictionary *insertedItem, NSError *error) {
 
-      testCompleted         = YES;
+      [waiter signal];
       returnedFooDictionary = insertedItem;
       
       STAssertNil(error, @"test failed: %@", [error description]);
@@ -137,20 +267,20 @@
       }
     }];
     
-    _testForCompletionBlock(&testCompleted);
+    [self waitForCompletion:waiter];
 
     // verify that the object can be accessed without authentication key
     NSString *fooId            = [NSString stringWithFormat:@"(id eq %@)", returnedFooDictionary[@"id"]];
     NSString *escapedUrlString = [fooId stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding];
     NSString *filterURL        = [NSString stringWithFormat:@"%@/tables/Foo?$filter=%@", _azureClientOpen.applicationURL, escapedUrlString];
 
-    __block BOOL readTestCompleted = NO;
+    KSCompletionWaiter *readWaiter = [KSCompletionWaiter waiter];
     
     [NSURLConnection sendAsynchronousRequest:[NSURLRequest requestWithURL:[NSURL URLWithString:filterURL]]
                                        queue:[NSOperationQueue mainQueue]
                            completionHandler:^(NSURLResponse *response, NSData *data, NSError *error) {
 
-                             readTestCompleted = YES;
+                             [readWaiter signal];
                              
                              STAssertNil(error, @"test failed: %@", [error description]);
                              
@@ -164,7 +294,7 @@
                              }
                            }];
 
-    _testForCompletionBlock(&readTestCompleted);
+    [self waitForCompletion:readWaiter];
 
   } @catch (NSException * e) {
    
@@ -211,7 +341,7 @@
   
   @try {
     
-    __block BOOL testCompleted = NO;
+    KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
     __block NSDictionary *returnedFooDictionary = nil;
     
     NSString *class = [self randomString:5];
@@ -225,13 +355,13 @@
     
     [randomTable insert:randomColumn completion:^(NSDictionary *result, NSError *error) {
       
-      testCompleted         = YES;
+      [waiter signal];
       returnedFooDictionary = result;
       
       STAssertNotNil(error, @"test failed: %@", [error description]);
     }];
     
-    _testForCompletionBlock(&testCompleted);
+    [self waitForCompletion:waiter];
     
     if (_showLogs) {
       NSLog(@"\r\n\t test_102_New_Class_Allowed random class before save = %@, \r\n\tMetadata isn't supported with Azure", [returnedFooDictionary description]);
@@ -278,14 +408,14 @@
  */
 - (void)test_201_Foo_Schemaless {
   
-  __block BOOL testCompleted = NO;
+  KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
   
   @try {
 
     if (_azureClientOpen) {
       
       // create a foo object
-      NSDictionary *item = @{@"fooParameter" : @"test_201_Foo_Schemaless foo string"};
+      NSDictionary *item = @{@"fooParameter" : [_runNamespace tagValue:@"test_201_Foo_Schemaless foo string"]};
       
       if (_showLogs) {
         NSLog(@"\r\n\t test_201_Foo_Schemaless f1 before save = %@", [item description]);
@@ -295,7 +425,7 @@
       
       [fooTable insert:item completion:^(NSDictionary *insertedItem, NSError *error) {
         
-        testCompleted = YES;
+        [waiter signal];
         
         STAssertNil(error, @"test failed: %@", [error description]);
         
@@ -304,7 +434,7 @@
         }
       }];
       
-      _testForCompletionBlock(&testCompleted);
+      [self waitForCompletion:waiter];
 
     } else {
       STAssertNotNil(_azureClientOpen, @"no _azureClientOpen backend");
@@ -353,57 +483,43 @@
   STFail(@"Azure doesn't support metadata about it's objects");
 }
 
+#pragma mark - Run cleanup
+
+/*!
+ * Runs last and removes what this run wrote, in one scoped query per table.
+ */
+- (void)test_999_Delete_Run_Data {
+  [self deleteRunTestData];
+}
+
 #pragma mark - Sample data utilities
 
 /*!
- Generates a random string of up to 1000 characters in length. Generates a random length up to 1000 if numCharacters is set to 0.
+ Generates a random string of numCharacters characters. Generates a random length up to 1000 if numCharacters is set to 0.
  */
 - (NSString *)randomString:(int)numCharacters {
-  
-  static char const possibleChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
-  int len;
-  
-  if (numCharacters > 1000 || numCharacters == 0) {
-    len = (int)rand() % (1000);
-  } else {
-    len = numCharacters;
-  }
-  
-  unichar characters[len];
-  
-  for( int i = 0; i < len; ++i) {
-    characters[i] = possibleChars[arc4random_uniform(sizeof(possibleChars) - 1)];
-  }
 
-  return [NSString stringWithCharacters:characters length:len] ;
+  int len = numCharacters > 0 ? numCharacters : (int)rand() % (1000);
+
+  return KSRandomString(len);
 }
 
+/*!
+ * Gives the test a new context on the run's Core Data stack, which is built
+ * once, on first use, with the store CoreDataStoreType names.
+ */
 - (void)setupCoreDataEnvironment {
 
-  // Destroy objects
-  _persistentStoreCoordinator = nil;
-  _managedObjectModel         = nil;
-  _managedObjectContext       = nil;
-  
-  // Setup Core Data
-  _managedObjectModel         = [NSManagedObjectModel mergedModelFromBundles:nil];
-  _persistentStoreCoordinator = [[NSPersistentStoreCoordinator alloc] initWithManagedObjectModel:_managedObjectModel];
-  
-  NSError *error;
-  
-  // Setup an in memory store
-  if(![_persistentStoreCoordinator addPersistentStoreWithType:NSInMemoryStoreType
-                                                configuration:nil
-                                                          URL:nil
-                                                      options:nil
-                                                        error:&error]) {
+  NSError *error         = nil;
+  KSCoreDataStack *stack = [KSCoreDataStack sharedStackWithStoreType:_coreDataStoreType error:&error];
+
+  if (!stack) {
     STFail(@"Could not create store coordinator: %@", [error localizedDescription]);
   }
-  
-  _managedObjectContext = [[NSManagedObjectContext alloc] init];
-  
-  [_managedObjectContext setPersistentStoreCoordinator:_persistentStoreCoordinator];
-  [_managedObjectContext setUndoManager:nil];
+
+  _managedObjectModel         = stack.managedObjectModel;
+  _persistentStoreCoordinator = stack.persistentStoreCoordinator;
+  _managedObjectContext       = [stack newContext];
 }
 
 @end
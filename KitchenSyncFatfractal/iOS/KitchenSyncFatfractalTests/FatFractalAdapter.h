@@ -0,0 +1,23 @@
+//
+//  FatFractalAdapter.h
+//  KitchenSyncFatfractalTests
+//
+//
+
+#import <Foundation/Foundation.h>
+#import <FFEF/FatFractal.h>
+#import "KSProviderAdapter.h"
+
+/*!
+ * KSProviderAdapter over FatFractal's asynchronous onComplete: calls. Entities
+ * are collections under /ff/resources; objects are NSMutableDictionary
+ * instances, whose URL the SDK keeps in its metadata for reads, updates and
+ * deletes. The FatFractal instance must already be logged in.
+ */
+@interface FatFractalAdapter : NSObject <KSProviderAdapter>
+
+- (id)initWithFatFractal:(FatFractal *)ff;
+
+@property (nonatomic, readonly, strong) FatFractal *ff;
+
+@end
@@ -0,0 +1,144 @@
+//
+//  FatFractalAdapter.m
+//  KitchenSyncFatfractalTests
+//
+//
+
+#import "FatFractalAdapter.h"
+
+@interface FatFractalAdapter() <FFQueueDelegate>
+
+@property (nonatomic, strong) NSArray *queuedObjects;
+@property (nonatomic, assign) NSUInteger queuedRemaining;
+@property (nonatomic, copy) KSBenchmarkCompletion queuedCompletion;
+
+- (NSString *)collectionUriForEntity:(NSString *)entity;
+
+@end
+
+@implementation FatFractalAdapter
+
+- (id)initWithFatFractal:(FatFractal *)ff {
+
+  self = [super init];
+
+  if (self) {
+    _ff = ff;
+  }
+
+  return self;
+}
+
+- (NSString *)providerName {
+  return @"FatFractal";
+}
+
+- (void)createObjectInEntity:(NSString *)entity fields:(NSDictionary *)fields completion:(KSBenchmarkCompletion)done {
+
+  NSMutableDictionary *object = [fields mutableCopy];
+
+  [_ff createObj:object atUri:[self collectionUriForEntity:entity] onComplete:^(NSError *theErr, id theObj, NSHTTPURLResponse *theResponse) {
+    done(theErr ? nil : (theObj ? theObj : object), theErr);
+  }];
+}
+
+/*!
+ * Goes through the offline queue (-queueCreateObj:atUri:), which the SDK
+ * drains on its own; the batch is done when the queue delegate has seen every
+ * object. Only one batch can be in flight per adapter.
+ */
+- (void)createObjectsInEntity:(NSString *)entity fieldsList:(NSArray *)fieldsList completion:(KSBenchmarkCompletion)done {
+
+  NSString *collectionUri = [self collectionUriForEntity:entity];
+  NSMutableArray *objects = [NSMutableArray arrayWithCapacity:[fieldsList count]];
+
+  for (NSDictionary *fields in fieldsList) {
+    [objects addObject:[fields mutableCopy]];
+  }
+
+  if ([objects count] == 0) {
+    done(objects, nil);
+    return;
+  }
+
+  _queuedObjects    = objects;
+  _queuedRemaining  = [objects count];
+  _queuedCompletion = done;
+
+  _ff.queueDelegate = self;
+
+  for (NSMutableDictionary *object in objects) {
+    [_ff queueCreateObj:object atUri:collectionUri];
+  }
+}
+
+- (void)getObject:(id)object inEntity:(NSString *)entity completion:(KSBenchmarkCompletion)done {
+  [_ff getObjFromUri:[[_ff metaDataForObj:object] ffUrl] onComplete:^(NSError *theErr, id theObj, NSHTTPURLResponse *theResponse) {
+    done(theObj, theErr);
+  }];
+}
+
+- (void)queryEntity:(NSString *)entity whereField:(NSString *)field equals:(id)value completion:(KSBenchmarkCompletion)done {
+
+  NSString *queryUri = [NSString stringWithFormat:@"%@/(%@ eq '%@')", [self collectionUriForEntity:entity], field, value];
+
+  [_ff getArrayFromUri:queryUri onComplete:^(NSError *theErr, id theObj, NSHTTPURLResponse *theResponse) {
+    done(theObj, theErr);
+  }];
+}
+
+/*!
+ * The SDK finds the object's URL from the instance it created, so fields are
+ * set on object itself rather than on a copy.
+ */
+- (void)updateObject:(id)object inEntity:(NSString *)entity fields:(NSDictionary *)fields completion:(KSBenchmarkCompletion)done {
+
+  [object setValuesForKeysWithDictionary:fields];
+
+  [_ff updateObj:object onComplete:^(NSError *theErr, id theObj, NSHTTPURLResponse *theResponse) {
+    done(object, theErr);
+  }];
+}
+
+- (void)deleteObject:(id)object inEntity:(NSString *)entity completion:(KSBenchmarkCompletion)done {
+  [_ff deleteObj:object onComplete:^(NSError *theErr, id theObj, NSHTTPURLResponse *theResponse) {
+    done(object, theErr);
+  }];
+}
+
+- (id)valueForField:(NSString *)field ofObject:(id)object {
+  return [object valueForKey:field];
+}
+
+- (NSString *)collectionUriForEntity:(NSString *)entity {
+  return [NSString stringWithFormat:@"/ff/resources/%@", entity];
+}
+
+#pragma mark - FFQueueDelegate
+
+/*!
+ * Called on the main thread for each queued create that reached the backend.
+ * Failed operations stay queued, so a short batch shows up as a timeout.
+ */
+- (void)operationCompleted:(FFQueuedOperation *)queuedOperation {
+
+  if (_queuedRemaining == 0) {
+    return;
+  }
+
+  if (--_queuedRemaining == 0) {
+
+    KSBenchmarkCompletion done = _queuedCompletion;
+    NSArray *objects           = _queuedObjects;
+
+    _queuedCompletion = nil;
+    _queuedObjects    = nil;
+    _ff.queueDelegate = nil;
+
+    if (done) {
+      done(objects, nil);
+    }
+  }
+}
+
+@end
@@ -6,6 +6,7 @@
 //
 
 #import "FatFractalConfigurator.h"
+#import "KSStandIn.h"
 
 @implementation FatFractalConfigurator
 
@@ -32,6 +33,8 @@
                                                                           ofType:@"plist"];
     
     configurationDict = [NSDictionary dictionaryWithContentsOfFile:dataPath];
+
+    [KSStandIn startWithConfiguration:configurationDict name:@"FatFractal"];
   });
   
   return configurationDict;
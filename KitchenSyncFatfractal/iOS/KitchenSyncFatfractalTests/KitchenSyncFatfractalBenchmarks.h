@@ -0,0 +1,19 @@
+//
+//  KitchenSyncFatfractalBenchmarks.h
+//  KitchenSyncFatfractalTests
+//
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+#import <FFEF/FatFractal.h>
+
+/*!
+ * Performance benchmarks for the FatFractal SDK. They only run when
+ * RunBenchmarks is set in FatFractalConfiguration.plist, and write a JSON
+ * report per run.
+ */
+@interface KitchenSyncFatfractalBenchmarks : SenTestCase
+
+@property(nonatomic, strong) FatFractal *ff;
+
+@end
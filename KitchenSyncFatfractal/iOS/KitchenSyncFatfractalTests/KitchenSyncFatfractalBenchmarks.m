@@ -0,0 +1,990 @@
+//
+//  KitchenSyncFatfractalBenchmarks.m
+//  KitchenSyncFatfractalTests
+//
+//
+
+#import "KitchenSyncFatfractalBenchmarks.h"
+#import "FatFractalConfigurator.h"
+#import "FatFractalAdapter.h"
+#import "KSBenchmarkReport.h"
+#import "KSBenchmarkSettings.h"
+#import "KSAdapterWorkloads.h"
+#import "KSCRUDBenchmark.h"
+#import "KSWireTrace.h"
+#import "KSLoadGenerator.h"
+#import "KSBulkDeleter.h"
+#import "KSBatchWriteBenchmark.h"
+#import "KSPayloadScalingBenchmark.h"
+#import "KSStartupBenchmark.h"
+#import "KSCoreDataBenchmark.h"
+#import "KSOfflineQueueBenchmark.h"
+#import "KSPagedQuery.h"
+#import "KSBlobTransferBenchmark.h"
+#import "KSAggregationBenchmark.h"
+#import "KSGeoQueryBenchmark.h"
+#import "KSQueryShapeBenchmark.h"
+#import "KSQueryCacheBenchmark.h"
+#import "KSConnectionReuseBenchmark.h"
+#import "KSFaultInjectionBenchmark.h"
+#import "KSRunNamespace.h"
+
+@interface KitchenSyncFatfractalBenchmarks()
+
+@property (nonatomic, strong) KSBenchmarkSettings *settings;
+@property (nonatomic, strong) KSAdapterWorkloads *workloads;
+
+- (void)configureBackend;
+- (void)configureWorkloadsWithAdapter:(id<KSProviderAdapter>)adapter;
+- (KSLoadGenerator *)runCreateLoadWithBenchmark:(KSCRUDBenchmark *)benchmark workers:(NSUInteger)workers;
+- (KSOfflineQueueBenchmark *)offlineQueueBenchmarkForCollection:(NSString *)collection field:(NSString *)field;
+- (KSBlobTransferBenchmark *)blobTransferBenchmarkForCollection:(NSString *)collection field:(NSString *)field;
+- (KSAggregationBenchmark *)aggregationBenchmarkForCollection:(NSString *)collection field:(NSString *)field;
+- (KSGeoQueryBenchmark *)geoQueryBenchmarkForCollection:(NSString *)collection field:(NSString *)field;
+- (KSQueryShapeBenchmark *)queryShapeBenchmarkForCollection:(NSString *)collection field:(NSString *)field;
+- (KSQueryCacheBenchmark *)queryCacheBenchmarkForCollection:(NSString *)collection field:(NSString *)field;
+- (KSConnectionReuseBenchmark *)connectionReuseBenchmarkForCollection:(NSString *)collection field:(NSString *)field;
+- (KSFaultInjectionBenchmark *)faultInjectionBenchmarkForCollection:(NSString *)collection field:(NSString *)field;
+- (KSStartupBenchmark *)startupBenchmark;
+- (void)runBenchmark:(NSString *)benchmark test:(SEL)test block:(KSBenchmarkBlock)block;
+
+@end
+
+@implementation KitchenSyncFatfractalBenchmarks
+
+#pragma mark - Setup and Init
+
+- (void)setUp {
+
+  [super setUp];
+
+  NSDictionary *fatfractalAppConfiguration = [[FatFractalConfigurator sharedInstance] applicationConfiguration];
+
+  _settings = [KSBenchmarkSettings settingsWithConfiguration:fatfractalAppConfiguration];
+}
+
+/*!
+ * Benchmarks run against the secure backend when UseSecure is set, otherwise
+ * the open one, logged in as the same test user as the functional tests.
+ */
+- (void)configureBackend {
+
+  NSDictionary *fatfractalAppConfiguration = [[FatFractalConfigurator sharedInstance] applicationConfiguration];
+
+  NSString *baseUrl = [fatfractalAppConfiguration[@"UseSecure"] boolValue] ? fatfractalAppConfiguration[@"SecureURL"] : fatfractalAppConfiguration[@"OpenURL"];
+
+  _ff = [[FatFractal alloc] initWithBaseUrl:baseUrl];
+  [_ff setDebug:NO];
+  [_ff loginWithUserName:@"test_user" andPassword:@"test_user"];
+
+  [self configureWorkloadsWithAdapter:[[FatFractalAdapter alloc] initWithFatFractal:_ff]];
+}
+
+/*!
+ * The shared workloads, run through the adapter with this suite's settings.
+ */
+- (void)configureWorkloadsWithAdapter:(id<KSProviderAdapter>)adapter {
+
+  _workloads = [[KSAdapterWorkloads alloc] initWithAdapter:adapter];
+
+  _workloads.iterations         = _settings.iterations;
+  _workloads.timeout            = _settings.testTimeout;
+  _workloads.batchSizes         = _settings.batchSizes;
+  _workloads.cleanupConcurrency = _settings.teardownConcurrency;
+  _workloads.payloadIterations  = _settings.payloadIterations;
+  _workloads.payloadSizes       = _settings.payloadSizes;
+  _workloads.payloadFieldCounts = _settings.payloadFieldCounts;
+}
+
+#pragma mark - Teardown
+
+- (void)tearDown {
+  [super tearDown];
+}
+
+#pragma mark - Benchmark utilities
+
+/*!
+ * Runs the benchmark's create block with the given number of concurrent
+ * workers for LoadDuration seconds, then deletes what it created.
+ */
+- (KSLoadGenerator *)runCreateLoadWithBenchmark:(KSCRUDBenchmark *)benchmark workers:(NSUInteger)workers {
+
+  KSLoadGenerator *generator        = [KSLoadGenerator generatorWithName:[NSString stringWithFormat:@"%@.create", benchmark.entity] workers:workers];
+  KSBenchmarkIterationBlock create  = benchmark.createBlock;
+  KSBenchmarkObjectBlock remove     = benchmark.deleteBlock;
+  NSMutableArray *created           = [NSMutableArray array];
+
+  generator.targetRate       = _settings.loadTargetRate;
+  generator.duration         = _settings.loadDuration;
+  generator.operationTimeout = _settings.testTimeout;
+
+  BOOL drained = [generator runWithBlock:^(NSUInteger sequence, KSBenchmarkCompletion done) {
+    create(sequence, ^(id result, NSError *error) {
+
+      if (result && !error) {
+        @synchronized(created) {
+          [created addObject:result];
+        }
+      }
+
+      done(result, error);
+    });
+  }];
+
+  STAssertTrue(drained, @"%@ still had operations outstanding", generator.name);
+
+  NSArray *createdObjects = nil;
+
+  @synchronized(created) {
+    createdObjects = [created copy];
+  }
+
+  KSBulkDeleter *deleter = [KSBulkDeleter deleterWithConfiguration:[[FatFractalConfigurator sharedInstance] applicationConfiguration]];
+
+  [deleter deleteItems:createdObjects withBlock:^(id object, KSBulkDeleteCompletion done) {
+    remove(object, 0, ^(id result, NSError *error) {
+      done(error);
+    });
+  }];
+
+  // Everything the run created goes at once, so allow a timeout per round
+  // of deletes.
+  NSTimeInterval timeout = _settings.testTimeout * MAX(1, [createdObjects count] / deleter.maxConcurrentDeletes);
+  NSString *failure      = [deleter waitAndReportNamed:generator.name timeout:timeout];
+
+  if (failure) {
+    NSLog(@"%@; %lu objects left behind", failure, (unsigned long)(createdObjects.count - deleter.deletedCount));
+  }
+
+  return generator;
+}
+
+/*!
+ * Queues Foo creates with -queueCreateObj:atUri: on a second FatFractal
+ * instance whose queue is kept in its FFLocalQueuedOperationStore, so the
+ * footprint is the SQLite database. FatFractal retries the queue on its own
+ * and -getQueuedOperations says how much is left. Delivered objects are read
+ * back through the benchmark instance with the same range query as the
+ * run cleanup and sorted by their createdAt metadata.
+ */
+- (KSOfflineQueueBenchmark *)offlineQueueBenchmarkForCollection:(NSString *)collection field:(NSString *)field {
+
+  KSOfflineQueueBenchmark *benchmark = [[KSOfflineQueueBenchmark alloc] initWithEntity:collection field:field];
+  KSCRUDBenchmark *crud              = [_workloads crudBenchmarkForEntity:collection field:field];
+  FatFractal *queueing               = [[FatFractal alloc] initWithBaseUrl:_ff.baseUrl localQueuedOpStoreKey:@"KitchenSyncOfflineQueue"];
+  FatFractal *ff                     = _ff;
+  NSString *uri                      = [NSString stringWithFormat:@"/ff/resources/%@", collection];
+  NSTimeInterval timeout             = _settings.testTimeout;
+
+  [queueing setDebug:NO];
+  [queueing loginWithUserName:@"test_user" andPassword:@"test_user"];
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  if ([_settings.offlineQueueSizes count] > 0) {
+    benchmark.queueSizes = _settings.offlineQueueSizes;
+  }
+
+  benchmark.enqueueBlock = ^(NSUInteger index, NSDictionary *fields) {
+    [queueing queueCreateObj:[fields mutableCopy] atUri:uri];
+  };
+
+  benchmark.pendingCountBlock = ^NSUInteger {
+    return [[queueing getQueuedOperations] count];
+  };
+
+  benchmark.fetchBlock = ^(NSString *prefix, KSBenchmarkCompletion done) {
+
+    // The prefix ends in '-', and '.' is the next character up.
+    NSMutableArray *objects = [NSMutableArray array];
+    NSString *upperBound    = [[prefix substringToIndex:[prefix length] - 1] stringByAppendingString:@"."];
+    NSString *query         = [NSString stringWithFormat:@"%@/(%@ gte '%@' and %@ lt '%@')", uri, field, prefix, field, upperBound];
+
+    KSPagedQuery *pages = [KSPagedQuery queryWithPageSize:1000 fetchBlock:^(NSUInteger offset, NSUInteger limit, KSPageCompletion pageDone) {
+
+      NSString *pageUri = [NSString stringWithFormat:@"%@?start=%lu&count=%lu", query, (unsigned long)offset, (unsigned long)limit];
+
+      [ff getArrayFromUri:pageUri onComplete:^(NSError *theErr, id theObj, NSHTTPURLResponse *theResponse) {
+        pageDone(theObj, theErr);
+      }];
+    }];
+
+    pages.timeout = timeout;
+
+    [pages enumeratePagesUsingBlock:^(NSArray *page, NSUInteger offset, BOOL *stop) {
+      [objects addObjectsFromArray:page];
+    }];
+
+    [objects sortUsingComparator:^NSComparisonResult(id a, id b) {
+      return [[[ff metaDataForObj:a] createdAt] compare:[[ff metaDataForObj:b] createdAt]];
+    }];
+
+    done(objects, pages.error);
+  };
+
+  benchmark.valueBlock = ^id(id object) {
+    return [object valueForKey:field];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * FatFractal blobs are members of an object, so each upload creates a
+ * collection object and then -updateBlob:withMimeType:forObj:memberName:s
+ * the payload into its "blob" member; each download reads the object back
+ * with autoLoadBlobs off and then calls -loadBlobsForObj:. Both directions
+ * pay one small request on top of the blob. The SDK only takes and hands
+ * back NSData, so there is no file path. Deleting the object deletes its
+ * blob.
+ */
+- (KSBlobTransferBenchmark *)blobTransferBenchmarkForCollection:(NSString *)collection field:(NSString *)field {
+
+  KSBlobTransferBenchmark *benchmark = [[KSBlobTransferBenchmark alloc] initWithEntity:[collection stringByAppendingString:@".blob"] iterations:_settings.blobIterations];
+  KSCRUDBenchmark *crud              = [_workloads crudBenchmarkForEntity:collection field:field];
+  id<KSProviderAdapter> adapter      = _workloads.adapter;
+  FatFractal *ff                     = _ff;
+  NSString *runTag                   = [[KSRunNamespace currentNamespace] tagValue:@"blob"];
+
+  ff.autoLoadBlobs = NO;
+
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+
+  if ([_settings.blobSizes count] > 0) {
+    benchmark.blobSizes = _settings.blobSizes;
+  }
+
+  benchmark.deleteBlock = crud.deleteBlock;
+
+  benchmark.uploadDataBlock = ^(NSData *data, NSUInteger iteration, KSBenchmarkCompletion done) {
+    [adapter createObjectInEntity:collection fields:@{field : runTag} completion:^(id object, NSError *error) {
+
+      if (!object) {
+        done(nil, error);
+        return;
+      }
+
+      [ff updateBlob:data withMimeType:@"application/octet-stream" forObj:object memberName:@"blob" onComplete:^(NSError *theErr, id theObj, NSHTTPURLResponse *theResponse) {
+        done(theErr ? nil : object, theErr);
+      }];
+    }];
+  };
+
+  benchmark.downloadDataBlock = ^(id object, NSString *path, KSBenchmarkCompletion done) {
+    [ff getObjFromUri:[[ff metaDataForObj:object] ffUrl] onComplete:^(NSError *theErr, id theObj, NSHTTPURLResponse *theResponse) {
+
+      if (!theObj) {
+        done(nil, theErr);
+        return;
+      }
+
+      [ff loadBlobsForObj:theObj onComplete:^(NSError *theErr, id theObj, NSHTTPURLResponse *theResponse) {
+        done(theErr ? nil : [theObj valueForKey:@"blob"], theErr);
+      }];
+    }];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * FatFractal has no count or aggregate queries, so every aggregate is the
+ * client fold: pages of the tagged objects by start and count, summed here.
+ */
+- (KSAggregationBenchmark *)aggregationBenchmarkForCollection:(NSString *)collection field:(NSString *)field {
+
+  KSAggregationBenchmark *benchmark = [[KSAggregationBenchmark alloc] initWithEntity:collection field:field valueField:@"fooValue" iterations:_settings.aggregationIterations];
+  KSCRUDBenchmark *crud             = [_workloads crudBenchmarkForEntity:collection field:field];
+  id<KSProviderAdapter> adapter     = _workloads.adapter;
+  FatFractal *ff                    = _ff;
+  NSString *uri                     = [NSString stringWithFormat:@"/ff/resources/%@", collection];
+  NSString *valueField              = benchmark.valueField;
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.rowCount           = _settings.aggregationRowCount;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  benchmark.seedBlock = ^(NSArray *fieldsList, KSBenchmarkCompletion done) {
+    [adapter createObjectsInEntity:collection fieldsList:fieldsList completion:done];
+  };
+
+  benchmark.valueBlock = ^NSNumber *(id object) {
+    return [adapter valueForField:valueField ofObject:object];
+  };
+
+  benchmark.pageBlock = ^(NSString *tag, id lastObject, NSUInteger offset, NSUInteger limit, KSPageCompletion done) {
+
+    NSString *pageUri = [NSString stringWithFormat:@"%@/(%@ eq '%@')?start=%lu&count=%lu", uri, field, tag, (unsigned long)offset, (unsigned long)limit];
+
+    [ff getArrayFromUri:pageUri onComplete:^(NSError *theErr, id theObj, NSHTTPURLResponse *theResponse) {
+      done(theObj, theErr);
+    }];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Foo objects keep an FFGeoLocation in location. Radius queries use the
+ * query language's distance() in meters; FatFractal has no bounding-box
+ * query, so only radius rows are reported.
+ */
+- (KSGeoQueryBenchmark *)geoQueryBenchmarkForCollection:(NSString *)collection field:(NSString *)field {
+
+  KSGeoQueryBenchmark *benchmark = [[KSGeoQueryBenchmark alloc] initWithEntity:collection field:field locationField:@"location" iterations:_settings.geoIterations];
+  KSCRUDBenchmark *crud          = [_workloads crudBenchmarkForEntity:collection field:field];
+  id<KSProviderAdapter> adapter  = _workloads.adapter;
+  FatFractal *ff                 = _ff;
+  NSString *uri                  = [NSString stringWithFormat:@"/ff/resources/%@", collection];
+  NSString *locationField        = benchmark.locationField;
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  if ([_settings.geoRowCounts count] > 0) {
+    benchmark.rowCounts = _settings.geoRowCounts;
+  }
+
+  benchmark.pointBlock = ^id(double latitude, double longitude) {
+    return [[FFGeoLocation alloc] initWithLatitude:latitude longitude:longitude];
+  };
+
+  benchmark.seedBlock = ^(NSArray *fieldsList, KSBenchmarkCompletion done) {
+    [adapter createObjectsInEntity:collection fieldsList:fieldsList completion:done];
+  };
+
+  benchmark.radiusBlock = ^(NSString *tag, double latitude, double longitude, double kilometers, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    NSString *queryUri = [NSString stringWithFormat:@"%@/(distance(%@, [%f, %f]) lte %f and %@ eq '%@')?start=0&count=%lu",
+                          uri, locationField, latitude, longitude, kilometers * 1000.0, field, tag, (unsigned long)limit];
+
+    [ff getArrayFromUri:queryUri onComplete:^(NSError *theErr, id theObj, NSHTTPURLResponse *theResponse) {
+      done(theObj, theErr);
+    }];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Every shape is a query-language URI on the run's tag: eq, a gte/lt pair,
+ * matches, and an or in parentheses. The query language has no "in"
+ * operator and no sort parameter, so contained_in and sort are left out.
+ */
+- (KSQueryShapeBenchmark *)queryShapeBenchmarkForCollection:(NSString *)collection field:(NSString *)field {
+
+  KSQueryShapeBenchmark *benchmark = [[KSQueryShapeBenchmark alloc] initWithEntity:collection field:field iterations:_settings.queryIterations];
+  KSCRUDBenchmark *crud            = [_workloads crudBenchmarkForEntity:collection field:field];
+  id<KSProviderAdapter> adapter    = _workloads.adapter;
+  FatFractal *ff                   = _ff;
+  NSString *uri                    = [NSString stringWithFormat:@"/ff/resources/%@", collection];
+  NSString *categoryField          = benchmark.categoryField;
+  NSString *valueField             = benchmark.valueField;
+  NSString *nameField              = benchmark.nameField;
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  if ([_settings.queryRowCounts count] > 0) {
+    benchmark.rowCounts = _settings.queryRowCounts;
+  }
+
+  benchmark.seedBlock = ^(NSArray *fieldsList, KSBenchmarkCompletion done) {
+    [adapter createObjectsInEntity:collection fieldsList:fieldsList completion:done];
+  };
+
+  benchmark.valueBlock = ^id(id object, NSString *valueName) {
+    return [adapter valueForField:valueName ofObject:object];
+  };
+
+  void (^find)(NSString *, NSString *, NSUInteger, KSBenchmarkCompletion) = ^(NSString *predicate, NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    NSString *queryUri = [NSString stringWithFormat:@"%@/(%@ and %@ eq '%@')?start=0&count=%lu", uri, predicate, field, tag, (unsigned long)limit];
+
+    [ff getArrayFromUri:queryUri onComplete:^(NSError *theErr, id theObj, NSHTTPURLResponse *theResponse) {
+      done(theObj, theErr);
+    }];
+  };
+
+  [benchmark addShape:KSQueryShapeEquality block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+    find([NSString stringWithFormat:@"%@ eq 'category-3'", categoryField], tag, limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeRange block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+    find([NSString stringWithFormat:@"%@ gte 100 and %@ lt 200", valueField, valueField], tag, limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeRegex block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+    find([NSString stringWithFormat:@"%@ matches '^3-'", nameField], tag, limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeOr block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+    find([NSString stringWithFormat:@"(%@ eq 'category-2' or %@ lt 50)", categoryField, valueField], tag, limit, done);
+  }];
+
+  return benchmark;
+}
+
+/*!
+ * Reads are a query-language GET on the benchmark field, and the URI is the
+ * cache key.
+ */
+- (KSQueryCacheBenchmark *)queryCacheBenchmarkForCollection:(NSString *)collection field:(NSString *)field {
+
+  KSQueryCacheBenchmark *benchmark = [[KSQueryCacheBenchmark alloc] initWithAdapter:_workloads.adapter entity:collection field:field operations:_settings.queryCacheOperations];
+  FatFractal *ff                   = _ff;
+  NSString *uri                    = [NSString stringWithFormat:@"/ff/resources/%@", collection];
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.readRatio          = _settings.queryCacheReadRatio;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+
+  benchmark.readBlock = ^(NSString *value, KSQueryCache *cache, KSBenchmarkCompletion done) {
+
+    NSString *queryUri = [NSString stringWithFormat:@"%@/(%@ eq '%@')", uri, field, value];
+
+    KSQueryCacheFetchBlock fetch = ^(KSBenchmarkCompletion fetched) {
+      [ff getArrayFromUri:queryUri onComplete:^(NSError *theErr, id theObj, NSHTTPURLResponse *theResponse) {
+        fetched(theObj, theErr);
+      }];
+    };
+
+    if (!cache) {
+      fetch(done);
+      return;
+    }
+
+    [cache readEntity:collection key:queryUri fetch:fetch completion:done];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * The functional tests keep three FatFractal instances. Their local one
+ * points at a development server, so the benchmark instance is joined by
+ * two more for its base URL, each logged in as the test user.
+ */
+- (KSConnectionReuseBenchmark *)connectionReuseBenchmarkForCollection:(NSString *)collection field:(NSString *)field {
+
+  KSConnectionReuseBenchmark *benchmark = [[KSConnectionReuseBenchmark alloc] initWithEntity:collection field:field operations:_settings.connectionReuseOperations];
+
+  benchmark.timeout = _settings.testTimeout;
+  benchmark.idleGap = _settings.connectionReuseIdleGap;
+
+  [benchmark addClient:@"client_1" adapter:_workloads.adapter];
+
+  for (NSUInteger i = 2; i <= 3; i++) {
+
+    FatFractal *ff = [[FatFractal alloc] initWithBaseUrl:_ff.baseUrl];
+
+    [ff setDebug:NO];
+    [ff loginWithUserName:@"test_user" andPassword:@"test_user"];
+
+    [benchmark addClient:[NSString stringWithFormat:@"client_%lu", (unsigned long)i] adapter:[[FatFractalAdapter alloc] initWithFatFractal:ff]];
+  }
+
+  return benchmark;
+}
+
+/*!
+ * FatFractal has no retry settings for direct requests (only queued
+ * operations are retried), so only its own behaviour runs, through the
+ * adapter's query.
+ *
+ * Fault rates missing from the configuration keep the benchmark's defaults.
+ */
+- (KSFaultInjectionBenchmark *)faultInjectionBenchmarkForCollection:(NSString *)collection field:(NSString *)field {
+
+  KSFaultInjectionBenchmark *benchmark = [[KSFaultInjectionBenchmark alloc] initWithEntity:collection field:field operations:_settings.faultInjectionOperations];
+
+  benchmark.timeout = _settings.testTimeout;
+
+  if (_settings.faultServiceUnavailableRate) {
+    benchmark.serviceUnavailableRate = [_settings.faultServiceUnavailableRate doubleValue];
+  }
+
+  if (_settings.faultResetRate) {
+    benchmark.resetRate = [_settings.faultResetRate doubleValue];
+  }
+
+  if (_settings.faultLatencySpikeRate) {
+    benchmark.latencySpikeRate = [_settings.faultLatencySpikeRate doubleValue];
+  }
+
+  if (_settings.faultLatencySpike) {
+    benchmark.latencySpike = [_settings.faultLatencySpike doubleValue];
+  }
+
+  id<KSProviderAdapter> adapter = _workloads.adapter;
+
+  [benchmark addVariant:@"default" block:^(NSString *value, KSBenchmarkCompletion done) {
+    [adapter queryEntity:collection whereField:field equals:value completion:done];
+  }];
+
+  return benchmark;
+}
+
+/*!
+ * Loads FatFractalConfiguration.plist the way FatFractalConfigurator does,
+ * builds a FatFractal instance for the secure or open backend, logs in as
+ * the test user and reads one Foo. Logging in is the first request here, so
+ * it is its own phase. Every pass builds a new instance and logs the old one
+ * out.
+ */
+- (KSStartupBenchmark *)startupBenchmark {
+
+  KSStartupBenchmark *benchmark       = [[KSStartupBenchmark alloc] initWithProvider:@"FatFractal" passes:_settings.startupPasses];
+  __block NSDictionary *configuration = nil;
+  __block FatFractal *ff              = nil;
+
+  benchmark.timeout = _settings.testTimeout;
+
+  [benchmark addPhase:@"configuration" block:^(NSUInteger pass, KSBenchmarkCompletion done) {
+
+    NSString *path = [[NSBundle bundleForClass:[FatFractalConfigurator class]] pathForResource:@"FatFractalConfiguration" ofType:@"plist"];
+
+    configuration = [NSDictionary dictionaryWithContentsOfFile:path];
+
+    done(configuration, nil);
+  }];
+
+  [benchmark addPhase:@"client" block:^(NSUInteger pass, KSBenchmarkCompletion done) {
+
+    ff = [[FatFractal alloc] initWithBaseUrl:[configuration[@"UseSecure"] boolValue] ? configuration[@"SecureURL"] : configuration[@"OpenURL"]];
+
+    [ff setDebug:NO];
+
+    done(ff, nil);
+  }];
+
+  [benchmark addPhase:@"login" block:^(NSUInteger pass, KSBenchmarkCompletion done) {
+    [ff loginWithUserName:@"test_user" andPassword:@"test_user" onComplete:^(NSError *theErr, id theObj, NSHTTPURLResponse *theResponse) {
+      done(theObj, theErr);
+    }];
+  }];
+
+  [benchmark addPhase:@"first_request" block:^(NSUInteger pass, KSBenchmarkCompletion done) {
+    [ff getArrayFromUri:@"/ff/resources/Foo?start=0&count=1" onComplete:^(NSError *theErr, id theObj, NSHTTPURLResponse *theResponse) {
+      done(theObj, theErr);
+    }];
+  }];
+
+  benchmark.resetBlock = ^{
+    [ff logout];
+    ff = nil;
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Runs one test's benchmark through the shared settings, which write the
+ * report where BenchmarkReportDirectory points, and fails the test if it
+ * raised or the report could not be written.
+ */
+- (void)runBenchmark:(NSString *)benchmark test:(SEL)test block:(KSBenchmarkBlock)block {
+
+  NSString *failure = [_settings runBenchmark:benchmark provider:@"FatFractal" test:test block:block];
+
+  STAssertNil(failure, @"%@", failure);
+}
+
+#pragma mark - Startup benchmarks
+
+/*!
+ * Times loading the configuration, building the client, logging in and the
+ * first request to Foo, StartupPasses times. The first pass is reported as
+ * cold, and the report records how long the test process had been up, since
+ * earlier tests may already have warmed the SDK.
+ */
+- (void)test_050_Cold_Start {
+
+  [self runBenchmark:@"startup" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    KSStartupBenchmark *benchmark = [self startupBenchmark];
+
+    [report setParameter:@(benchmark.passes) forKey:@"passes"];
+    [report setParameter:@([KSStartupBenchmark processUptime]) forKey:@"process_uptime_s"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu FatFractal startup phases failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Latency benchmarks
+
+/*!
+ * Measures p50/p95/p99 latency and throughput of create, read by id, query,
+ * update and delete for Foo and Bar.
+ *
+ * Each entity also gets a wire trace: DNS, connect, time to first byte and
+ * transfer per request, and how much of the operation time was spent on the
+ * wire rather than in the SDK.
+ */
+- (void)test_100_CRUD_Latency {
+
+  [self runBenchmark:@"crud_latency" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    [report setParameter:@(_settings.iterations) forKey:@"iterations"];
+
+    NSArray *benchmarks = @[[_workloads crudBenchmarkForEntity:@"Foo" field:@"fooParameter"],
+                            [_workloads crudBenchmarkForEntity:@"Bar" field:@"barParameter"]];
+
+    for (KSCRUDBenchmark *benchmark in benchmarks) {
+
+      [KSWireTrace start];
+      [benchmark runWithReport:report];
+      [KSWireTrace stop];
+
+      [KSWireTrace addToReport:report operations:benchmark.histograms attributes:@{@"entity" : benchmark.entity}];
+
+      STAssertTrue(benchmark.errorCount == 0, @"%lu %@ operations failed", (unsigned long)benchmark.errorCount, benchmark.entity);
+    }
+  }];
+}
+
+#pragma mark - Load benchmarks
+
+/*!
+ * Creates Foo objects as fast as LoadWorkers concurrent workers allow (or at
+ * LoadTargetRate) and reports achieved throughput, error rate and latency
+ * at each worker count.
+ */
+- (void)test_110_Create_Throughput_Under_Load {
+
+  [self runBenchmark:@"load" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    [report setParameter:_settings.loadWorkers forKey:@"workers"];
+    [report setParameter:@(_settings.loadTargetRate) forKey:@"target_rate"];
+    [report setParameter:@(_settings.loadDuration) forKey:@"duration_s"];
+
+    KSCRUDBenchmark *benchmark = [_workloads crudBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    for (NSNumber *workers in _settings.loadWorkers) {
+
+      KSLoadGenerator *generator = [self runCreateLoadWithBenchmark:benchmark workers:[workers unsignedIntegerValue]];
+
+      if(_settings.showLogs) NSLog(@"%@", generator);
+
+      [generator addToReport:report];
+    }
+  }];
+}
+
+#pragma mark - Batch write benchmarks
+
+/*!
+ * Saves BatchSizes Foo objects one at a time, then again through the offline
+ * operation queue.
+ * Reports objects/sec and bytes on the wire for both paths.
+ */
+- (void)test_120_Batch_Write {
+
+  [self runBenchmark:@"batch_write" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    [report setParameter:_settings.batchSizes forKey:@"batch_sizes"];
+
+    KSBatchWriteBenchmark *benchmark = [_workloads batchWriteBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo saves failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Payload scaling benchmarks
+
+/*!
+ * Creates and reads Foo objects as the field grows from 100 B to 1 MB and as
+ * the field count grows from 1 to 500, and reports latency, JSON
+ * serialisation cost and wire time at each step.
+ */
+- (void)test_140_Payload_Scaling {
+
+  [self runBenchmark:@"payload_scaling" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSPayloadScalingBenchmark *benchmark = [_workloads payloadScalingBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.payloadIterations) forKey:@"iterations"];
+    [report setParameter:benchmark.payloadSizes forKey:@"payload_sizes"];
+    [report setParameter:benchmark.fieldCounts forKey:@"field_counts"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo payload operations failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Offline queue benchmarks
+
+/*!
+ * Queues 10 to 10,000 Foo creates as FFQueuedOperations while the backend
+ * is away, then brings it back. Reports enqueue cost, the queue's size on
+ * disk, drain time and rate, and lost, duplicated and reordered writes.
+ */
+- (void)test_150_Offline_Queue {
+
+  [self runBenchmark:@"offline_queue" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSOfflineQueueBenchmark *benchmark = [self offlineQueueBenchmarkForCollection:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:benchmark.queueSizes forKey:@"queue_sizes"];
+    [report setParameter:@(benchmark.valueSize) forKey:@"value_size"];
+
+    [benchmark runWithReport:report];
+
+    if(_settings.showLogs && benchmark.lostCount > 0) {
+      NSLog(@"%lu queued Foo writes never arrived", (unsigned long)benchmark.lostCount);
+    }
+  }];
+}
+
+#pragma mark - Core Data store benchmarks
+
+/*!
+ * Fills in-memory, SQLite and binary stores with 1,000 to 1,000,000 Bar rows
+ * and reports insert and save throughput, how long the store takes to open
+ * again and fetch latency at each size. Nothing goes to FatFractal.
+ */
+- (void)test_160_Core_Data_Store {
+
+  [self runBenchmark:@"core_data_store" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    KSCoreDataBenchmark *benchmark = [[KSCoreDataBenchmark alloc] initWithEntity:@"Bar" field:@"barParameter"];
+
+    benchmark.fetchIterations = _settings.iterations;
+
+    if ([_settings.coreDataRowCounts count] > 0) {
+      benchmark.rowCounts = _settings.coreDataRowCounts;
+    }
+
+    if ([_settings.coreDataStoreTypes count] > 0) {
+      benchmark.storeTypes = _settings.coreDataStoreTypes;
+    }
+
+    [report setParameter:benchmark.storeTypes forKey:@"store_types"];
+    [report setParameter:benchmark.rowCounts forKey:@"row_counts"];
+    [report setParameter:@(benchmark.saveBatchSize) forKey:@"save_batch_size"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Core Data store steps failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Blob transfer benchmarks
+
+/*!
+ * Uploads and downloads 1 KB to 100 MB blobs on Foo objects and reports
+ * MB/s, peak resident memory and, against the stand-in, what happens when
+ * the connection drops mid-transfer.
+ */
+- (void)test_190_Blob_Transfer {
+
+  [self runBenchmark:@"blob_transfer" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSBlobTransferBenchmark *benchmark = [self blobTransferBenchmarkForCollection:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.blobIterations) forKey:@"iterations"];
+    [report setParameter:benchmark.blobSizes forKey:@"blob_sizes"];
+    [report setParameter:@(benchmark.dropSize) forKey:@"drop_size"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo blob transfers failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Aggregation benchmarks
+
+/*!
+ * Computes count, sum, min, max and average over a 100,000-object Foo
+ * dataset by downloading every row, the only way FatFractal has, and reports
+ * what that costs next to the other providers' server-side aggregates.
+ */
+- (void)test_200_Aggregation {
+
+  [self runBenchmark:@"aggregation" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSAggregationBenchmark *benchmark = [self aggregationBenchmarkForCollection:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.aggregationIterations) forKey:@"iterations"];
+    [report setParameter:@(benchmark.rowCount) forKey:@"rows"];
+    [report setParameter:@(benchmark.pageSize) forKey:@"page_size"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo aggregation saves or reads failed or came back wrong", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Geo query benchmarks
+
+/*!
+ * Seeds 10,000 to 1,000,000 located Foo objects around San Francisco and
+ * reports radius query latency and result sizes at each density.
+ */
+- (void)test_210_Geo_Query {
+
+  [self runBenchmark:@"geo_query" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSGeoQueryBenchmark *benchmark = [self geoQueryBenchmarkForCollection:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.geoIterations) forKey:@"iterations"];
+    [report setParameter:benchmark.rowCounts forKey:@"row_counts"];
+    [report setParameter:benchmark.radii forKey:@"radii_km"];
+    [report setParameter:@(benchmark.regionSpan) forKey:@"region_span_degrees"];
+    [report setParameter:@(benchmark.resultLimit) forKey:@"result_limit"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo geo saves or queries failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Query shape benchmarks
+
+/*!
+ * Runs equality, range, regex and OR queries over 1,000 to 100,000 Foo
+ * objects and reports how each one's latency grows with the collection, to
+ * find the shapes FatFractal answers with a full scan.
+ */
+- (void)test_220_Query_Shapes {
+
+  [self runBenchmark:@"query_shapes" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSQueryShapeBenchmark *benchmark = [self queryShapeBenchmarkForCollection:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.queryIterations) forKey:@"iterations"];
+    [report setParameter:benchmark.rowCounts forKey:@"row_counts"];
+    [report setParameter:benchmark.shapes forKey:@"shapes"];
+    [report setParameter:@(benchmark.resultLimit) forKey:@"result_limit"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo query shape saves or queries failed or returned the wrong objects", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Query cache benchmarks
+
+/*!
+ * Replays a read-heavy mix of Foo list queries and saves straight against
+ * FatFractal and again through KSQueryCache, and reports the hit rate and
+ * from the backend.next to reading every list
+ * from the backend.
+ */
+- (void)test_230_Query_Cache {
+
+  [self runBenchmark:@"query_cache" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSQueryCacheBenchmark *benchmark = [self queryCacheBenchmarkForCollection:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(benchmark.operations) forKey:@"operations"];
+    [report setParameter:@(benchmark.readRatio) forKey:@"read_ratio"];
+    [report setParameter:@(benchmark.keyCount) forKey:@"key_count"];
+    [report setParameter:@(benchmark.objectsPerKey) forKey:@"objects_per_key"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo query cache operations failed or read stale lists", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Connection reuse benchmarks
+
+/*!
+ * Counts the TCP and TLS handshakes the FatFractal SDK makes per 1000 Foo
+ * queries, sequentially, concurrently and in bursts with idle gaps between
+ * them, through one instance and through three. Needs StandInMode Replay.
+ */
+- (void)test_240_Connection_Reuse {
+
+  [self runBenchmark:@"connection_reuse" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSConnectionReuseBenchmark *benchmark = [self connectionReuseBenchmarkForCollection:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(benchmark.operations) forKey:@"operations"];
+    [report setParameter:@(benchmark.concurrency) forKey:@"concurrency"];
+    [report setParameter:@(benchmark.burstSize) forKey:@"burst_size"];
+    [report setParameter:@(benchmark.idleBursts) forKey:@"idle_bursts"];
+    [report setParameter:@(benchmark.idleGap) forKey:@"idle_gap_s"];
+
+    [benchmark runWithReport:report];
+
+    if (benchmark.skipped) {
+      if(_settings.showLogs) NSLog(@"StandInMode isn't Replay, skipping %@", NSStringFromSelector(_cmd));
+      *discard = YES;
+      return;
+    }
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo queries failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Fault injection benchmarks
+
+/*!
+ * Runs Foo queries through the FatFractal SDK while the stand-in answers
+ * some requests with 503s, resets others and holds others back, and reports
+ * tail latency, success rate and the requests its retries add.
+ * Needs StandInMode Record or Replay.
+ */
+- (void)test_250_Fault_Injection {
+
+  [self runBenchmark:@"fault_injection" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSFaultInjectionBenchmark *benchmark = [self faultInjectionBenchmarkForCollection:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(benchmark.operations) forKey:@"operations"];
+    [report setParameter:@(benchmark.concurrency) forKey:@"concurrency"];
+    [report setParameter:@(benchmark.serviceUnavailableRate) forKey:@"service_unavailable_rate"];
+    [report setParameter:@(benchmark.resetRate) forKey:@"reset_rate"];
+    [report setParameter:@(benchmark.latencySpikeRate) forKey:@"latency_spike_rate"];
+    [report setParameter:@(benchmark.latencySpike) forKey:@"latency_spike_s"];
+
+    [benchmark runWithReport:report];
+
+    if (benchmark.skipped) {
+      if(_settings.showLogs) NSLog(@"StandInMode is Off, skipping %@", NSStringFromSelector(_cmd));
+      *discard = YES;
+      return;
+    }
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo queries failed without faults", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+@end
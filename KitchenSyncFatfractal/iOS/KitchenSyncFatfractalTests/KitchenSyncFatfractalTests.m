@@ -6,6 +6,13 @@
 
 #import "KitchenSyncFatfractalTests.h"
 #import "FatFractalConfigurator.h"
+#import "KSCompletionWaiter.h"
+#import "KSBulkDeleter.h"
+#import "KSPagedQuery.h"
+#import "KSParallelRunner.h"
+#import "KSRandomString.h"
+#import "KSRunNamespace.h"
+#import "KSCoreDataStack.h"
 #import "Foo.h"
 #import "Bar.h"
 
@@ -15,14 +22,24 @@
 
 @property (nonatomic, assign) BOOL showLogs;
 @property (nonatomic, assign) BOOL usingSecureBackend;
-@property (nonatomic, copy) void (^testForCompletionBlock)(BOOL *testCompleted);
+@property (nonatomic, assign) NSTimeInterval testTimeout;
+@property (nonatomic, strong) NSDictionary *configuration;
+@property (nonatomic, assign) BOOL runBackendsConcurrently;
+@property (nonatomic, assign) BOOL deleteAllTestDataEnabled;
+@property (nonatomic, strong) KSRunNamespace *runNamespace;
+@property (nonatomic, copy) NSString *coreDataStoreType;
 
 - (void)configureBackend;
 - (void)setupCoreDataEnvironment;
 - (void)authenticateLocal;
 - (void)authenticateOpen;
 - (void)authenticateSecure;
+- (void)deleteRunTestData;
+- (void)deleteAllObjectsAtUri:(NSString *)uri named:(NSString *)name;
+- (void)deleteAllObjectsAtUri:(NSString *)uri named:(NSString *)name taggedInMember:(NSString *)member;
+- (void)runBackendTasks:(KSParallelRunner *)runner named:(NSString *)name;
 - (NSString *)randomString:(int)numCharacters;
+- (void)waitForCompletion:(KSCompletionWaiter *)waiter;
 
 @end
 
@@ -34,21 +51,24 @@
 
     [super setUp];
   
-    _testForCompletionBlock = ^(BOOL *testCompleted) {
-      
-      while (!*testCompleted) {
-        
-        NSDate *cycle = [NSDate dateWithTimeIntervalSinceNow:0.01];
-        
-        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode
-                                 beforeDate:cycle];
-      }
-    };
-    
     NSDictionary *fatfractalAppConfiguration = [[FatFractalConfigurator sharedInstance] applicationConfiguration];
     
     _showLogs           = [fatfractalAppConfiguration[@"ShowLogs"] boolValue];
     _usingSecureBackend = [fatfractalAppConfiguration[@"UseSecure"] boolValue];
+
+    _testTimeout         = [fatfractalAppConfiguration[@"TestTimeout"] doubleValue];
+    _configuration       = fatfractalAppConfiguration;
+
+    _runBackendsConcurrently  = [fatfractalAppConfiguration[@"RunBackendsConcurrently"] boolValue];
+    _deleteAllTestDataEnabled = [fatfractalAppConfiguration[@"DeleteAllTestData"] boolValue];
+    _runNamespace             = [KSRunNamespace currentNamespace];
+    _coreDataStoreType        = [KSCoreDataStack storeTypeForName:fatfractalAppConfiguration[@"CoreDataStoreType"]];
+
+    if (_testTimeout <= 0) {
+      _testTimeout = 30.0;
+    }
+
+    STAssertNotNil(_coreDataStoreType, @"unknown CoreDataStoreType %@, expected InMemory, SQLite or Binary", fatfractalAppConfiguration[@"CoreDataStoreType"]);
   
     [self setupCoreDataEnvironment];
     [self configureBackend];
@@ -93,32 +113,22 @@
     }
 }
 
+/*!
+ * Gives the test a new context on the run's Core Data stack, which is built
+ * once, on first use, with the store CoreDataStoreType names.
+ */
 - (void)setupCoreDataEnvironment {
-    // Destroy objects
-    _persistentStoreCoordinator = nil;
-    _managedObjectModel         = nil;
-    _managedObjectContext       = nil;
-    
-    // Setup Core Data
-    _managedObjectModel         = [NSManagedObjectModel mergedModelFromBundles:nil];
-    _persistentStoreCoordinator = [[NSPersistentStoreCoordinator alloc] initWithManagedObjectModel:_managedObjectModel];
-    
-    NSError *error;
-    
-    // Setup an in memory store
-    if(![_persistentStoreCoordinator addPersistentStoreWithType:NSInMemoryStoreType
-                                                 configuration:nil
-                                                           URL:nil
-                                                       options:nil
-                                                         error:&error]) {
+
+    NSError *error         = nil;
+    KSCoreDataStack *stack = [KSCoreDataStack sharedStackWithStoreType:_coreDataStoreType error:&error];
+
+    if (!stack) {
         STFail(@"Could not create store coordinator: %@", [error localizedDescription]);
     }
-    
-    _managedObjectContext = [[NSManagedObjectContext alloc] init];
 
-    [_managedObjectContext setPersistentStoreCoordinator:_persistentStoreCoordinator];
-    [_managedObjectContext setUndoManager:nil];
-    
+    _managedObjectModel         = stack.managedObjectModel;
+    _persistentStoreCoordinator = stack.persistentStoreCoordinator;
+    _managedObjectContext       = [stack newContext];
 }
 
 - (void)authenticateLocal {
@@ -139,27 +149,24 @@
   [super tearDown];
 }
 
+/*!
+ This method deletes the Foo and Bar objects this run tagged.
+ */
+- (void)deleteRunTestData {
+    @try {
+        [self deleteAllObjectsAtUri:@"/ff/resources/Foo/" named:@"Foo" taggedInMember:@"fooParameter"];
+        [self deleteAllObjectsAtUri:@"/ff/resources/Bar/" named:@"Bar" taggedInMember:@"barParameter"];
+    } @catch (NSException * e) {
+        NSLog(@"deleteRunTestData failed: %@", [e description]);
+    }
+}
+
 /*!
  This method deletes all Foo objects from the backend.
  */
 - (void)deleteAllFoo {
     @try {
-        [self authenticateOpen];
-        NSArray *openFoos = [_ff_open getArrayFromUrl:[NSString stringWithFormat:@"/ff/resources/Foo/"]];
-        for (id obj in openFoos) {
-            [_ff_open deleteObj:obj];
-        }
-        [self authenticateSecure];
-        NSArray *secureFoos = [_ff_secure getArrayFromUrl:[NSString stringWithFormat:@"/ff/resources/Foo/"]];
-        for (id obj in secureFoos) {
-            [_ff_secure deleteObj:obj];
-        } if(_ff_local) {
-            [self authenticateLocal];
-            NSArray *localFoos = [_ff_local getArrayFromUrl:[NSString stringWithFormat:@"/ff/resources/Foo/"]];
-            for (id obj in localFoos) {
-                [_ff_local deleteObj:obj];
-            }
-        }
+        [self deleteAllObjectsAtUri:@"/ff/resources/Foo/" named:@"Foo"];
     } @catch (NSException * e) {
         NSLog(@"deleteAllFoo failed: %@", [e description]);
     }
@@ -170,34 +177,147 @@
  */
 - (void)deleteAllBar {
     @try {
-        [self authenticateOpen];
-        NSArray *openBars = [_ff_open getArrayFromUrl:[NSString stringWithFormat:@"/ff/resources/Bar/"]];
-        for (id obj in openBars) {
-            [_ff_open deleteObj:obj];
-        }
-        [self authenticateSecure];
-        NSArray *secureBars = [_ff_secure getArrayFromUrl:[NSString stringWithFormat:@"/ff/resources/Bar/"]];
-        for (id obj in secureBars) {
-            [_ff_secure deleteObj:obj];
-        } if(_ff_local) {
-            [self authenticateLocal];
-            NSArray *localBars = [_ff_local getArrayFromUrl:[NSString stringWithFormat:@"/ff/resources/Bar/"]];
-            for (id obj in localBars) {
-                [_ff_local deleteObj:obj];
-            }
-        }
+        [self deleteAllObjectsAtUri:@"/ff/resources/Bar/" named:@"Bar"];
     } @catch (NSException * e) {
         NSLog(@"deleteAllBar failed: %@", [e description]);
     }
 }
 
+/*!
+ * Deletes everything at uri on the open, secure and (if configured) local
+ * backends, a page at a time, with TeardownConcurrency asynchronous
+ * deleteObj: calls in flight. Pages are read with FatFractal's start and
+ * count query parameters, so only one page of objects is held at a time.
+ * With RunBackendsConcurrently set the backends are cleared at the same time.
+ */
+- (void)deleteAllObjectsAtUri:(NSString *)uri named:(NSString *)name {
+    [self deleteAllObjectsAtUri:uri named:name taggedInMember:nil];
+}
+
+/*!
+ * Same as -deleteAllObjectsAtUri:named:, limited to this run's objects when
+ * member is given. FatFractal queries have no prefix match, so the tag is
+ * matched as a range on member.
+ */
+- (void)deleteAllObjectsAtUri:(NSString *)uri named:(NSString *)name taggedInMember:(NSString *)member {
+
+    if (member) {
+        uri = [NSString stringWithFormat:@"%@(%@ gte '%@' and %@ lt '%@')", uri,
+               member, _runNamespace.valueLowerBound, member, _runNamespace.valueUpperBound];
+    }
+
+    KSParallelRunner *runner = [KSParallelRunner runner];
+    NSMutableArray *backends = [NSMutableArray array];
+    NSMutableArray *names    = [NSMutableArray array];
+
+    if(_ff_open) {
+        [backends addObject:_ff_open];
+        [names addObject:@"open"];
+    }
+    if(_ff_secure) {
+        [backends addObject:_ff_secure];
+        [names addObject:@"secure"];
+    }
+    if(_ff_local) {
+        [backends addObject:_ff_local];
+        [names addObject:@"local"];
+    }
+
+    [backends enumerateObjectsUsingBlock:^(FatFractal *ff, NSUInteger idx, BOOL *stop) {
+
+        NSString *backend = names[idx];
+
+        [runner addTaskNamed:backend block:^(NSString *dataNamespace) {
+
+            [ff loginWithUserName:@"test_user" andPassword:@"test_user"];
+
+            KSPagedQuery *pages = [KSPagedQuery queryWithPageSize:500 fetchBlock:^(NSUInteger offset, NSUInteger limit, KSPageCompletion done) {
+
+                NSString *pageUri = [NSString stringWithFormat:@"%@?start=%lu&count=%lu", uri, (unsigned long)offset, (unsigned long)limit];
+
+                [ff getArrayFromUri:pageUri onComplete:^(NSError *theErr, id theObj, NSHTTPURLResponse *theResponse) {
+                    done(theObj, theErr);
+                }];
+            }];
+
+            pages.timeout       = _testTimeout;
+            pages.consumesPages = YES;
+
+            [pages enumeratePagesUsingBlock:^(NSArray *page, NSUInteger offset, BOOL *stop) {
+
+                KSBulkDeleter *deleter = [KSBulkDeleter deleterWithConfiguration:_configuration];
+
+                [deleter deleteItems:page withBlock:^(id obj, KSBulkDeleteCompletion done) {
+                    [ff deleteObj:obj onComplete:^(NSError *theErr, id theObj, NSHTTPURLResponse *theResponse) {
+                        done(theErr);
+                    }];
+                }];
+
+                NSString *failure = [deleter waitAndReportNamed:[NSString stringWithFormat:@"%@ on %@", name, backend] timeout:_testTimeout];
+                STAssertNil(failure, @"%@", failure);
+
+                // Don't keep re-reading a page that can't be deleted.
+                if (deleter.failedCount > 0 || deleter.deletedCount < [page count]) {
+                    *stop = YES;
+                }
+            }];
+        }];
+    }];
+
+    [self runBackendTasks:runner named:[NSString stringWithFormat:@"deleting %@", name]];
+}
+
+#pragma mark - Async helpers
+
+/*!
+ * Runs one task per backend, at the same time when RunBackendsConcurrently
+ * is set, and reports each task's failures on the test's own thread.
+ */
+- (void)runBackendTasks:(KSParallelRunner *)runner named:(NSString *)name {
+
+  runner.concurrent = _runBackendsConcurrently;
+
+  BOOL completed = [runner runWithTimeout:_testTimeout * 10];
+
+  STAssertTrue(completed, @"%@ timed out on %@", name, runner.unfinishedTasks);
+
+  [runner.exceptions enumerateKeysAndObjectsUsingBlock:^(NSString *backend, NSException *exception, BOOL *stop) {
+    [self failWithException:exception];
+  }];
+
+  if(_showLogs) {
+    NSLog(@"%@ took %.3f ms (%@)", name, runner.elapsed * 1000.0, runner.durations);
+  }
+}
+
+/*!
+ * Waits for the waiter to be signalled by an SDK completion block, failing
+ * the test if it does not happen within the configured TestTimeout.
+ */
+- (void)waitForCompletion:(KSCompletionWaiter *)waiter {
+
+  BOOL completed = [waiter waitWithTimeout:_testTimeout];
+
+  STAssertTrue(completed, @"timed out after %.3fs waiting for completion", waiter.elapsed);
+
+  if(_showLogs) {
+    NSLog(@"completion wait took %.3f ms", waiter.elapsed * 1000.0);
+  }
+}
+
 #pragma mark - Setup and configuration tests
 
 /*!
- This method deletes all Test data from the backend.
+ * Empties Foo and Bar of every run's objects, including ones other runs are
+ * still using, so it only runs with DeleteAllTestData set.
  */
 - (void)test_000_Delete_All_Test_Data {
 
+  if (!_deleteAllTestDataEnabled) {
+    NSLog(@"DeleteAllTestData is off, leaving other runs' data alone");
+    return;
+  }
+
   @try {
     [self deleteAllFoo];
     [self deleteAllBar];
@@ -215,7 +335,7 @@
             [self authenticateOpen];
             // create a foo object
             Foo * foo = [[Foo alloc] init];
-            foo.fooParameter = @"Testing public access";
+            foo.fooParameter = [_runNamespace tagValue:@"Testing public access"];
             if(_showLogs) NSLog(@"\r\n\t test_100_Public_Access foo before save = %@",[foo description]);
             // create an object to make sure backend is really working
             NSError * crudError;
@@ -243,7 +363,7 @@
             [self authenticateSecure];
             // create a foo object
             Foo * foo = [[Foo alloc] init];
-            foo.fooParameter = @"Testing secure access";
+            foo.fooParameter = [_runNamespace tagValue:@"Testing secure access"];
             if(_showLogs)
                 NSLog(@"\r\n\t test_101_Secure_Access foo before save = %@",
                       [foo description]);
@@ -278,7 +398,7 @@
             NSDictionary * foo =
             [NSDictionary dictionaryWithObjectsAndKeys:
              @"Foo",@"clazz",
-             cs,@"fooParameter",
+             [_runNamespace tagValue:cs],@"fooParameter",
              nil];
             if(_showLogs) NSLog(@"\r\n\t test_102_New_Collection_Allowed foo before save = %@",[foo description]);
             NSError * crudError;
@@ -305,7 +425,7 @@
             NSDictionary * foo =
             [NSDictionary dictionaryWithObjectsAndKeys:
              @"Foo",@"clazz",
-             [NSString stringWithFormat:@"NSDictionary in coll %@",coll],@"fooParameter",
+             [_runNamespace tagValue:[NSString stringWithFormat:@"NSDictionary in coll %@",coll]],@"fooParameter",
              nil];
             if(_showLogs) NSLog(@"\r\n\t test_103_New_Collection_Disallowed foo before save = %@",[foo description]);
             NSError * crudError;
@@ -385,7 +505,7 @@
         if(_ff_open) {
             [self authenticateLocal];
             Foo * foo = [[Foo alloc] init];
-            foo.fooParameter = @"Some string in a Foo : NSObject object";
+            foo.fooParameter = [_runNamespace tagValue:@"Some string in a Foo : NSObject object"];
             if(_showLogs) NSLog(@"\r\n\t test_106_Local_Backend foo before save = %@",[foo description]);
             // create an object to make sure backend is really working
             NSError * crudError;
@@ -405,37 +525,43 @@
 }
 
 /*!
- * Tests the ability to access multiple backends from the client SDK.
+ * Tests the ability to access multiple backends from the client SDK. With
+ * RunBackendsConcurrently set both backends are used at the same time.
  */
 - (void)test_107_Multiple_Backends {
     @try {
-        NSError * crudError;
+        KSParallelRunner *runner = [KSParallelRunner runner];
         if(_ff_open) {
-            [self authenticateOpen];
-            Foo * f1 = [[Foo alloc] init];
-            f1.fooParameter = @"Some string in a Foo : NSObject object";
-            if(_showLogs) NSLog(@"\r\n\t test_107_Multiple_Backends f1 before save = %@",[f1 description]);
-            // create the object
-            [_ff_open createObj:f1 atUri:@"/Foos" error:&crudError];
-            STAssertNil(crudError, @"test failed: %@",
-                        [crudError localizedDescription]);
-            if(_showLogs) NSLog(@"\r\n\t test_107_Multiple_Backends f1 after save = %@, \r\n\tMetadata: %@",[f1 description],
-                               [[_ff_open metaDataForObj:f1] description]);
+            [runner addTaskNamed:@"open" block:^(NSString *dataNamespace) {
+                NSError * crudError;
+                [self authenticateOpen];
+                Foo * f1 = [[Foo alloc] init];
+                f1.fooParameter = [_runNamespace tagValue:[NSString stringWithFormat:@"Some string in a Foo : NSObject object (%@)", dataNamespace]];
+                if(_showLogs) NSLog(@"\r\n\t test_107_Multiple_Backends f1 before save = %@",[f1 description]);
+                // create the object
+                [_ff_open createObj:f1 atUri:@"/Foos" error:&crudError];
+                STAssertNil(crudError, @"test failed: %@",
+                            [crudError localizedDescription]);
+                if(_showLogs) NSLog(@"\r\n\t test_107_Multiple_Backends f1 after save = %@, \r\n\tMetadata: %@",[f1 description],
+                                   [[_ff_open metaDataForObj:f1] description]);
+            }];
         } else STAssertNotNil(_ff_open, @"no open backend");
         if(_ff_secure) {
-            crudError = nil;
-            [self authenticateSecure];
-            Foo * f2 = [[Foo alloc] init];
-            f2.fooParameter = @"Some string in a Foo : NSObject object";
-            if(_showLogs) NSLog(@"test_107_Multiple_Backends Foo : f2 before save = %@",[f2 description]);
-            // create the object
-            crudError = nil;
-            [_ff_secure createObj:f2 atUri:@"/Foos" error:&crudError];
-            STAssertNil(crudError, @"test failed: %@",
-                        [crudError localizedDescription]);
-            if(_showLogs) NSLog(@"\r\n\t test_107_Multiple_Backends f2 after save = %@, \r\n\tMetadata: %@",[f2 description],
-                               [[_ff_secure metaDataForObj:f2] description]);
+            [runner addTaskNamed:@"secure" block:^(NSString *dataNamespace) {
+                NSError * crudError;
+                [self authenticateSecure];
+                Foo * f2 = [[Foo alloc] init];
+                f2.fooParameter = [_runNamespace tagValue:[NSString stringWithFormat:@"Some string in a Foo : NSObject object (%@)", dataNamespace]];
+                if(_showLogs) NSLog(@"test_107_Multiple_Backends Foo : f2 before save = %@",[f2 description]);
+                // create the object
+                [_ff_secure createObj:f2 atUri:@"/Foos" error:&crudError];
+                STAssertNil(crudError, @"test failed: %@",
+                            [crudError localizedDescription]);
+                if(_showLogs) NSLog(@"\r\n\t test_107_Multiple_Backends f2 after save = %@, \r\n\tMetadata: %@",[f2 description],
+                                   [[_ff_secure metaDataForObj:f2] description]);
+            }];
         } else STAssertNotNil(_ff_secure, @"no secure backend");
+        [self runBackendTasks:runner named:@"test_107_Multiple_Backends"];
     } @catch (NSException * e) {
         STAssertNil(e, @"test failed: %@", [e description]);
     }
@@ -470,9 +596,9 @@
         if(_ff_open) {
             [self authenticateLocal];
             Foo * foo = [[Foo alloc] init];
-            foo.fooParameter = @"Some string in a Foo : NSObject object";
+            foo.fooParameter = [_runNamespace tagValue:@"Some string in a Foo : NSObject object"];
             // or, if you prefer
-            [foo setFooParameter:@"Foo : NSObject object"];
+            [foo setFooParameter:[_runNamespace tagValue:@"Foo : NSObject object"]];
             if(_showLogs) NSLog(@"\r\n\t test_200_Foo_ObjCClass f1 before save = %@",[foo description]);
             // create the object
             [_ff_open createObj:foo atUri:@"/Foo"];
@@ -493,7 +619,7 @@
             [self authenticateOpen];
             NSDictionary * foo = [NSDictionary dictionaryWithObjectsAndKeys:
                                   @"Foo",@"clazz",
-                                  @"NSDictionary with clazz Foo",@"fooParameter",
+                                  [_runNamespace tagValue:@"NSDictionary with clazz Foo"],@"fooParameter",
                                   nil];
             if(_showLogs) NSLog(@"test_201_Foo_Schemaless NSDictionary : foo before save = %@",
                                [foo description]);
@@ -512,14 +638,13 @@
 - (void)test_202_Bar_NSManagedObject_SubClass {
     @try {
         if(_ff_open) {
-            [self setupCoreDataEnvironment];
             [self authenticateLocal];
             Bar * b1 = [NSEntityDescription
                         insertNewObjectForEntityForName:@"Bar"
                         inManagedObjectContext:_managedObjectContext];
-            b1.barParameter = @"Some string in a Bar : NSObject object";
+            b1.barParameter = [_runNamespace tagValue:@"Some string in a Bar : NSObject object"];
             // or, if you prefer
-            [b1 setBarParameter:@"Bar : NSManagedObject object"];
+            [b1 setBarParameter:[_runNamespace tagValue:@"Bar : NSManagedObject object"]];
             if(_showLogs) NSLog(@"test_202_Bar_NSManagedObject_SubClass Bar:b1 before save = %@",
                                [b1 description]);
             NSError * crudError;
@@ -562,7 +687,6 @@
 - (void)test_203_NSManagedObject_Called_Bar {
     @try {
         if(_ff_open) {
-            [self setupCoreDataEnvironment];
             [self authenticateLocal];
             NSManagedObject *b1 = [NSEntityDescription
                                    insertNewObjectForEntityForName:@"Bar"
@@ -624,7 +748,7 @@
             NSString * memberName = [self randomString:5];
             NSDictionary * f1 = [NSDictionary dictionaryWithObjectsAndKeys:
                                  @"Foo",@"clazz",
-                                 @"NSDictionary with clazz Foo",@"fooParameter",
+                                 [_runNamespace tagValue:@"NSDictionary with clazz Foo"],@"fooParameter",
                                  @"a schemaless addition",memberName,
                                  nil];
             if(_showLogs) NSLog(@"test_204_New_Member_Allowed NSDictionary : foo before save = %@",
@@ -652,7 +776,7 @@
             NSString * memberName = [self randomString:5];
             NSDictionary * foo = [NSDictionary dictionaryWithObjectsAndKeys:
                                   @"Foo",@"clazz",
-                                  @"NSDictionary with clazz Foo",@"fooParameter",
+                                  [_runNamespace tagValue:@"NSDictionary with clazz Foo"],@"fooParameter",
                                   @"a schemaless addition",memberName,
                                   nil];
             if(_showLogs) NSLog(@"test_205_New_Member_Disallowed NSDictionary : foo before save = %@",
@@ -677,7 +801,7 @@
         if(_ff_open) {
             [self authenticateLocal];
             Foo * foo = [[Foo alloc] init];
-            foo.fooParameter = @"Some string in a Foo : NSObject object";
+            foo.fooParameter = [_runNamespace tagValue:@"Some string in a Foo : NSObject object"];
             if(_showLogs) NSLog(@"\r\n\t test_206_Metadata_Provided_ObjC_Class f1 before save = %@",[foo description]);
             // create the object
             [_ff_open createObj:foo atUri:@"/Foos"];
@@ -689,22 +813,24 @@
     }
 }
 
+#pragma mark - Run cleanup
+
+/*!
+ * Runs last and removes what this run wrote, in one scoped query per
+ * collection and backend.
+ */
+- (void)test_999_Delete_Run_Data {
+  [self deleteRunTestData];
+}
+
 #pragma mark - Sample data utilities
 
 /*!
- Generates a random string of up to 1000 characters in length. Generates a random length up to 1000 if numCharacters is set to 0.
+ Generates a random string of letters, numCharacters long. Generates a random length up to 1000 if numCharacters is set to 0.
  */
 - (NSString *)randomString:(int)numCharacters {
-    //static char const possibleChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
-    static char const possibleChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
-    int len;
-    if(numCharacters > 1000 || numCharacters == 0) len = (int)rand() % (1000);
-    else len = numCharacters;
-    unichar characters[len];
-    for( int i=0; i < len; ++i ) {
-        characters[i] = possibleChars[arc4random_uniform(sizeof(possibleChars)-1)];
-    }
-    return [NSString stringWithCharacters:characters length:len] ;
+    int len = numCharacters > 0 ? numCharacters : (int)rand() % (1000);
+    return KSRandomStringFromCharacters(len, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz");
 }
 
 @end
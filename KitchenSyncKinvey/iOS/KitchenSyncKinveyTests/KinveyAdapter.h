@@ -0,0 +1,18 @@
+//
+//  KinveyAdapter.h
+//  KitchenSyncKinveyTests
+//
+//
+
+#import <Foundation/Foundation.h>
+#import <KinveyKit/KinveyKit.h>
+#import "KSProviderAdapter.h"
+
+/*!
+ * KSProviderAdapter over KCSAppdataStore. Entities are collections; objects
+ * are NSMutableDictionary entities keyed by KCSEntityKeyId. The KCSClient
+ * must already be initialised.
+ */
+@interface KinveyAdapter : NSObject <KSProviderAdapter>
+
+@end
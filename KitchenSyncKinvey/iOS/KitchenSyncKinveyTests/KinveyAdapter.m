@@ -0,0 +1,109 @@
+//
+//  KinveyAdapter.m
+//  KitchenSyncKinveyTests
+//
+//
+
+#import "KinveyAdapter.h"
+
+@interface KinveyAdapter()
+
+- (KCSAppdataStore *)storeForCollection:(NSString *)collection;
+
+@end
+
+@implementation KinveyAdapter {
+
+  NSMutableDictionary *_stores;
+}
+
+- (id)init {
+
+  self = [super init];
+
+  if (self) {
+    _stores = [NSMutableDictionary dictionary];
+  }
+
+  return self;
+}
+
+- (NSString *)providerName {
+  return @"Kinvey";
+}
+
+- (KCSAppdataStore *)storeForCollection:(NSString *)collection {
+
+  @synchronized(_stores) {
+
+    KCSAppdataStore *store = _stores[collection];
+
+    if (!store) {
+
+      KCSCollection *kinveyCollection = [KCSCollection collectionFromString:collection ofClass:[NSMutableDictionary class]];
+
+      store               = [KCSAppdataStore storeWithCollection:kinveyCollection options:nil];
+      _stores[collection] = store;
+    }
+
+    return store;
+  }
+}
+
+- (void)createObjectInEntity:(NSString *)entity fields:(NSDictionary *)fields completion:(KSBenchmarkCompletion)done {
+  [[self storeForCollection:entity] saveObject:[fields mutableCopy] withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+    done([objectsOrNil lastObject], errorOrNil);
+  } withProgressBlock:nil];
+}
+
+/*!
+ * The store writes an array of entities in one call and reports the ones it
+ * saved, so a partial batch is not an error.
+ */
+- (void)createObjectsInEntity:(NSString *)entity fieldsList:(NSArray *)fieldsList completion:(KSBenchmarkCompletion)done {
+
+  NSMutableArray *objects = [NSMutableArray arrayWithCapacity:[fieldsList count]];
+
+  for (NSDictionary *fields in fieldsList) {
+    [objects addObject:[fields mutableCopy]];
+  }
+
+  [[self storeForCollection:entity] saveObject:objects withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+    done(objectsOrNil, [objectsOrNil count] > 0 ? nil : errorOrNil);
+  } withProgressBlock:nil];
+}
+
+- (void)getObject:(NSDictionary *)object inEntity:(NSString *)entity completion:(KSBenchmarkCompletion)done {
+  [[self storeForCollection:entity] loadObjectWithID:object[KCSEntityKeyId] withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+    done([objectsOrNil lastObject], errorOrNil);
+  } withProgressBlock:nil];
+}
+
+- (void)queryEntity:(NSString *)entity whereField:(NSString *)field equals:(id)value completion:(KSBenchmarkCompletion)done {
+  [[self storeForCollection:entity] queryWithQuery:[KCSQuery queryOnField:field withExactMatchForValue:value] withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+    done(objectsOrNil, errorOrNil);
+  } withProgressBlock:nil];
+}
+
+- (void)updateObject:(NSDictionary *)object inEntity:(NSString *)entity fields:(NSDictionary *)fields completion:(KSBenchmarkCompletion)done {
+
+  NSMutableDictionary *updated = [object mutableCopy];
+
+  [updated addEntriesFromDictionary:fields];
+
+  [[self storeForCollection:entity] saveObject:updated withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+    done([objectsOrNil lastObject], errorOrNil);
+  } withProgressBlock:nil];
+}
+
+- (void)deleteObject:(NSDictionary *)object inEntity:(NSString *)entity completion:(KSBenchmarkCompletion)done {
+  [[self storeForCollection:entity] removeObject:object withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+    done(object, errorOrNil);
+  } withProgressBlock:nil];
+}
+
+- (id)valueForField:(NSString *)field ofObject:(NSDictionary *)object {
+  return object[field];
+}
+
+@end
@@ -6,6 +6,7 @@
 //
 
 #import "KinveyConfigurator.h"
+#import "KSStandIn.h"
 
 @implementation KinveyConfigurator
 
@@ -32,6 +33,8 @@
                                                                           ofType:@"plist"];
     
     configurationDict = [NSDictionary dictionaryWithContentsOfFile:dataPath];
+
+    [KSStandIn startWithConfiguration:configurationDict name:@"Kinvey"];
   });
   
   return configurationDict;
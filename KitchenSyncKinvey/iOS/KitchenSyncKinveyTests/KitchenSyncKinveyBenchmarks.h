@@ -0,0 +1,16 @@
+//
+//  KitchenSyncKinveyBenchmarks.h
+//  KitchenSyncKinveyTests
+//
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+#import <KinveyKit/KinveyKit.h>
+
+/*!
+ * Performance benchmarks for KinveyKit. They only run when RunBenchmarks is
+ * set in KinveyConfiguration.plist, and write a JSON report per run.
+ */
+@interface KitchenSyncKinveyBenchmarks : SenTestCase
+
+@end
@@ -0,0 +1,1170 @@
+//
+//  KitchenSyncKinveyBenchmarks.m
+//  KitchenSyncKinveyTests
+//
+//
+
+#import "KitchenSyncKinveyBenchmarks.h"
+#import "KinveyConfigurator.h"
+#import "KinveyAdapter.h"
+#import "KSBenchmarkReport.h"
+#import "KSBenchmarkSettings.h"
+#import "KSAdapterWorkloads.h"
+#import "KSCRUDBenchmark.h"
+#import "KSWireTrace.h"
+#import "KSLoadGenerator.h"
+#import "KSBulkDeleter.h"
+#import "KSBatchWriteBenchmark.h"
+#import "KSPayloadScalingBenchmark.h"
+#import "KSStartupBenchmark.h"
+#import "KSCoreDataBenchmark.h"
+#import "KSCachePolicyBenchmark.h"
+#import "KSOfflineQueueBenchmark.h"
+#import "KSPagedQuery.h"
+#import "KSCompletionWaiter.h"
+#import "KSBlobTransferBenchmark.h"
+#import "KSAggregationBenchmark.h"
+#import "KSGeoQueryBenchmark.h"
+#import "KSQueryShapeBenchmark.h"
+#import "KSQueryCacheBenchmark.h"
+#import "KSConnectionReuseBenchmark.h"
+#import "KSFaultInjectionBenchmark.h"
+
+@interface KitchenSyncKinveyBenchmarks()
+
+@property (nonatomic, strong) KSBenchmarkSettings *settings;
+@property (nonatomic, strong) KSAdapterWorkloads *workloads;
+
+- (void)configureBackend;
+- (void)configureWorkloadsWithAdapter:(id<KSProviderAdapter>)adapter;
+- (KSLoadGenerator *)runCreateLoadWithBenchmark:(KSCRUDBenchmark *)benchmark workers:(NSUInteger)workers;
+- (KSCachePolicyBenchmark *)cachePolicyBenchmarkForCollection:(NSString *)collection field:(NSString *)field;
+- (KSOfflineQueueBenchmark *)offlineQueueBenchmarkForCollection:(NSString *)collection field:(NSString *)field;
+- (KSBlobTransferBenchmark *)blobTransferBenchmark;
+- (KSAggregationBenchmark *)aggregationBenchmarkForCollection:(NSString *)collection field:(NSString *)field;
+- (KSGeoQueryBenchmark *)geoQueryBenchmarkForCollection:(NSString *)collection field:(NSString *)field;
+- (KSQueryShapeBenchmark *)queryShapeBenchmarkForCollection:(NSString *)collection field:(NSString *)field;
+- (KSQueryCacheBenchmark *)queryCacheBenchmarkForCollection:(NSString *)collection field:(NSString *)field;
+- (KSConnectionReuseBenchmark *)connectionReuseBenchmarkForCollection:(NSString *)collection field:(NSString *)field;
+- (KSFaultInjectionBenchmark *)faultInjectionBenchmarkForCollection:(NSString *)collection field:(NSString *)field;
+- (KSStartupBenchmark *)startupBenchmark;
+- (void)runBenchmark:(NSString *)benchmark test:(SEL)test block:(KSBenchmarkBlock)block;
+
+@end
+
+@implementation KitchenSyncKinveyBenchmarks
+
+#pragma mark - Setup and Init
+
+- (void)setUp {
+
+  [super setUp];
+
+  NSDictionary *kinveyAppConfiguration = [[KinveyConfigurator sharedInstance] applicationConfiguration];
+
+  _settings = [KSBenchmarkSettings settingsWithConfiguration:kinveyAppConfiguration];
+}
+
+/*!
+ * Same backend selection as the functional tests.
+ */
+- (void)configureBackend {
+
+  NSDictionary *kinveyAppConfiguration = [[KinveyConfigurator sharedInstance] applicationConfiguration];
+
+  // KCSClient is a singleton, so have to use two configs...
+  if([kinveyAppConfiguration[@"UseSecure"] boolValue]) {
+    (void) [[KCSClient sharedClient] initializeKinveyServiceForAppKey:kinveyAppConfiguration[@"SecureAppKey"]
+                                                        withAppSecret:kinveyAppConfiguration[@"SecureAppSecrect"]
+                                                         usingOptions:nil];
+  } else {
+    (void) [[KCSClient sharedClient] initializeKinveyServiceForAppKey:kinveyAppConfiguration[@"OpenAppKey"]
+                                                        withAppSecret:kinveyAppConfiguration[@"OpenAppSecrect"]
+                                                         usingOptions:nil];
+  }
+
+  [self configureWorkloadsWithAdapter:[[KinveyAdapter alloc] init]];
+}
+
+/*!
+ * The shared workloads, run through the adapter with this suite's settings.
+ */
+- (void)configureWorkloadsWithAdapter:(id<KSProviderAdapter>)adapter {
+
+  _workloads = [[KSAdapterWorkloads alloc] initWithAdapter:adapter];
+
+  _workloads.iterations         = _settings.iterations;
+  _workloads.timeout            = _settings.testTimeout;
+  _workloads.batchSizes         = _settings.batchSizes;
+  _workloads.cleanupConcurrency = _settings.teardownConcurrency;
+  _workloads.payloadIterations  = _settings.payloadIterations;
+  _workloads.payloadSizes       = _settings.payloadSizes;
+  _workloads.payloadFieldCounts = _settings.payloadFieldCounts;
+}
+
+#pragma mark - Teardown
+
+- (void)tearDown {
+  [super tearDown];
+}
+
+#pragma mark - Benchmark utilities
+
+/*!
+ * Runs the benchmark's create block with the given number of concurrent
+ * workers for LoadDuration seconds, then deletes what it created.
+ */
+- (KSLoadGenerator *)runCreateLoadWithBenchmark:(KSCRUDBenchmark *)benchmark workers:(NSUInteger)workers {
+
+  KSLoadGenerator *generator        = [KSLoadGenerator generatorWithName:[NSString stringWithFormat:@"%@.create", benchmark.entity] workers:workers];
+  KSBenchmarkIterationBlock create  = benchmark.createBlock;
+  KSBenchmarkObjectBlock remove     = benchmark.deleteBlock;
+  NSMutableArray *created           = [NSMutableArray array];
+
+  generator.targetRate       = _settings.loadTargetRate;
+  generator.duration         = _settings.loadDuration;
+  generator.operationTimeout = _settings.testTimeout;
+
+  BOOL drained = [generator runWithBlock:^(NSUInteger sequence, KSBenchmarkCompletion done) {
+    create(sequence, ^(id result, NSError *error) {
+
+      if (result && !error) {
+        @synchronized(created) {
+          [created addObject:result];
+        }
+      }
+
+      done(result, error);
+    });
+  }];
+
+  STAssertTrue(drained, @"%@ still had operations outstanding", generator.name);
+
+  NSArray *createdObjects = nil;
+
+  @synchronized(created) {
+    createdObjects = [created copy];
+  }
+
+  KSBulkDeleter *deleter = [KSBulkDeleter deleterWithConfiguration:[[KinveyConfigurator sharedInstance] applicationConfiguration]];
+
+  [deleter deleteItems:createdObjects withBlock:^(id object, KSBulkDeleteCompletion done) {
+    remove(object, 0, ^(id result, NSError *error) {
+      done(error);
+    });
+  }];
+
+  // Everything the run created goes at once, so allow a timeout per round
+  // of deletes.
+  NSTimeInterval timeout = _settings.testTimeout * MAX(1, [createdObjects count] / deleter.maxConcurrentDeletes);
+  NSString *failure      = [deleter waitAndReportNamed:generator.name timeout:timeout];
+
+  if (failure) {
+    NSLog(@"%@; %lu objects left behind", failure, (unsigned long)(createdObjects.count - deleter.deletedCount));
+  }
+
+  return generator;
+}
+
+/*!
+ * Loads one entity by id through a KCSCachedStore under each KCSCachePolicy;
+ * writes go through an uncached store. KCSCachedStore has no call to empty
+ * its cache, so clearing it means starting over with a new store. If the
+ * cache outlives the store, the cold hit ratio shows it.
+ */
+- (KSCachePolicyBenchmark *)cachePolicyBenchmarkForCollection:(NSString *)collection field:(NSString *)field {
+
+  KSCachePolicyBenchmark *benchmark = [[KSCachePolicyBenchmark alloc] initWithEntity:collection iterations:_settings.iterations];
+  KSCRUDBenchmark *crud             = [_workloads crudBenchmarkForEntity:collection field:field];
+  KCSCollection *kinveyCollection   = [KCSCollection collectionFromString:collection ofClass:[NSMutableDictionary class]];
+  KCSAppdataStore *store            = [KCSAppdataStore storeWithCollection:kinveyCollection options:nil];
+
+  __block KCSCachedStore *cachedStore = nil;
+
+  benchmark.timeout     = _settings.testTimeout;
+  benchmark.createBlock = crud.createBlock;
+  benchmark.deleteBlock = crud.deleteBlock;
+
+  [benchmark addPolicy:KCSCachePolicyNone named:@"None"];
+  [benchmark addPolicy:KCSCachePolicyLocalOnly named:@"LocalOnly"];
+  [benchmark addPolicy:KCSCachePolicyLocalFirst named:@"LocalFirst"];
+  [benchmark addPolicy:KCSCachePolicyNetworkFirst named:@"NetworkFirst"];
+  [benchmark addPolicy:KCSCachePolicyBoth named:@"Both"];
+  [benchmark addPolicy:KCSCachePolicyReadOnceAndSaveLocal_Xperimental named:@"ReadOnceAndSaveLocal"];
+
+  benchmark.clearCacheBlock = ^(NSInteger policy) {
+    cachedStore = [KCSCachedStore storeWithCollection:kinveyCollection options:@{KCSStoreKeyCachePolicy : @(policy)}];
+  };
+
+  benchmark.readBlock = ^(NSInteger policy, NSDictionary *object, KSBenchmarkCompletion done) {
+    [cachedStore loadObjectWithID:object[KCSEntityKeyId] withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+      done([[objectsOrNil lastObject] objectForKey:field], errorOrNil);
+    } withProgressBlock:nil cachePolicy:(KCSCachePolicy)policy];
+  };
+
+  benchmark.writeBlock = ^(NSDictionary *object, NSString *value, KSBenchmarkCompletion done) {
+
+    NSMutableDictionary *updated = [object mutableCopy];
+
+    updated[field] = value;
+
+    [store saveObject:updated withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+      done([objectsOrNil lastObject], errorOrNil);
+    } withProgressBlock:nil];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Queues Foo saves through a KCSCachedStore with offline save turned on.
+ * Each save is attempted, fails with no network and lands in the store's
+ * queue; enqueue cost is the time until the store reports that. The queue
+ * is only retried when KCSReachability says the network is back, and the
+ * stand-in's outage never reaches reachability, so the benchmark posts the
+ * notification itself on reconnect. Stored entities are read back oldest
+ * first by their _kmd.ect creation time.
+ */
+- (KSOfflineQueueBenchmark *)offlineQueueBenchmarkForCollection:(NSString *)collection field:(NSString *)field {
+
+  KSOfflineQueueBenchmark *benchmark = [[KSOfflineQueueBenchmark alloc] initWithEntity:collection field:field];
+  KSCRUDBenchmark *crud              = [_workloads crudBenchmarkForEntity:collection field:field];
+  KCSCollection *kinveyCollection    = [KCSCollection collectionFromString:collection ofClass:[NSMutableDictionary class]];
+  NSString *identifier               = [NSString stringWithFormat:@"KitchenSync.%@.offline", collection];
+  KCSCachedStore *store              = [KCSCachedStore storeWithCollection:kinveyCollection
+                                                                   options:@{KCSStoreKeyUniqueOfflineSaveIdentifier : identifier}];
+  NSTimeInterval timeout             = _settings.testTimeout;
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  if ([_settings.offlineQueueSizes count] > 0) {
+    benchmark.queueSizes = _settings.offlineQueueSizes;
+  }
+
+  benchmark.enqueueBlock = ^(NSUInteger index, NSDictionary *fields) {
+
+    KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
+
+    [store saveObject:[fields mutableCopy] withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+      [waiter signal];
+    } withProgressBlock:nil];
+
+    [waiter waitWithTimeout:timeout];
+  };
+
+  benchmark.pendingCountBlock = ^NSUInteger {
+    return [store numberOfPendingSaves];
+  };
+
+  benchmark.reconnectBlock = ^{
+    [[NSNotificationCenter defaultCenter] postNotificationName:kKCSReachabilityChangedNotification
+                                                        object:[[KCSClient sharedClient] kinveyReachability]];
+  };
+
+  benchmark.fetchBlock = ^(NSString *prefix, KSBenchmarkCompletion done) {
+
+    NSMutableArray *objects = [NSMutableArray array];
+    NSString *pattern       = [@"^" stringByAppendingString:prefix];
+
+    KSPagedQuery *pages = [KSPagedQuery queryWithPageSize:1000 fetchBlock:^(NSUInteger offset, NSUInteger limit, KSPageCompletion pageDone) {
+
+      KCSQuery *query = [KCSQuery queryOnField:field usingConditional:kKCSRegex forValue:pattern];
+
+      [query addSortModifier:[[KCSQuerySortModifier alloc] initWithField:@"_kmd.ect" inDirection:kKCSAscending]];
+
+      query.limitModifer = [[KCSQueryLimitModifier alloc] initWithLimit:limit];
+      query.skipModifier = [[KCSQuerySkipModifier alloc] initWithcount:offset];
+
+      [store queryWithQuery:query withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+        pageDone(objectsOrNil, errorOrNil);
+      } withProgressBlock:nil];
+    }];
+
+    pages.timeout = timeout;
+
+    [pages enumeratePagesUsingBlock:^(NSArray *page, NSUInteger offset, BOOL *stop) {
+      [objects addObjectsFromArray:page];
+    }];
+
+    done(objects, pages.error);
+  };
+
+  benchmark.valueBlock = ^id(NSDictionary *object) {
+    return object[field];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * KCSResourceService both ways: -saveData:toResource: and
+ * -downloadResource:, which hands back the blob as NSData, on the memory
+ * path, -saveLocalResource:toResource: and -downloadResource:toFile: on the
+ * file path. Every upload gets a resource id of its own.
+ */
+- (KSBlobTransferBenchmark *)blobTransferBenchmark {
+
+  KSBlobTransferBenchmark *benchmark = [[KSBlobTransferBenchmark alloc] initWithEntity:@"Resource" iterations:_settings.blobIterations];
+
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+
+  if ([_settings.blobSizes count] > 0) {
+    benchmark.blobSizes = _settings.blobSizes;
+  }
+
+  NSString *(^newResourceId)(void) = ^NSString *(void) {
+    return [NSString stringWithFormat:@"kitchensync-%@.bin", [[NSProcessInfo processInfo] globallyUniqueString]];
+  };
+
+  benchmark.uploadDataBlock = ^(NSData *data, NSUInteger iteration, KSBenchmarkCompletion done) {
+
+    NSString *resourceId = newResourceId();
+
+    [KCSResourceService saveData:data toResource:resourceId completionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+      done(errorOrNil ? nil : resourceId, errorOrNil);
+    } progressBlock:nil];
+  };
+
+  benchmark.uploadFileBlock = ^(NSString *path, NSUInteger iteration, KSBenchmarkCompletion done) {
+
+    NSString *resourceId = newResourceId();
+
+    [KCSResourceService saveLocalResource:path toResource:resourceId completionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+      done(errorOrNil ? nil : resourceId, errorOrNil);
+    } progressBlock:nil];
+  };
+
+  benchmark.downloadDataBlock = ^(NSString *resourceId, NSString *path, KSBenchmarkCompletion done) {
+    [KCSResourceService downloadResource:resourceId completionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+      KCSResourceResponse *response = [objectsOrNil lastObject];
+      done(response.resource, errorOrNil);
+    } progressBlock:nil];
+  };
+
+  benchmark.downloadFileBlock = ^(NSString *resourceId, NSString *path, KSBenchmarkCompletion done) {
+    [KCSResourceService downloadResource:resourceId toFile:path completionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+      done(errorOrNil ? nil : path, errorOrNil);
+    } progressBlock:nil];
+  };
+
+  benchmark.deleteBlock = ^(NSString *resourceId, NSUInteger iteration, KSBenchmarkCompletion done) {
+    [KCSResourceService deleteResource:resourceId completionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+      done(resourceId, errorOrNil);
+    } progressBlock:nil];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Every aggregate runs on the server as -group:reduce:condition: over the
+ * benchmark field, so the tagged objects form one group, and again through a
+ * KCSCachedStore under KCSCachePolicyLocalFirst, which answers from its cache
+ * once the first call has filled it. The client fold pages by skip, sorted
+ * by _id.
+ */
+- (KSAggregationBenchmark *)aggregationBenchmarkForCollection:(NSString *)collection field:(NSString *)field {
+
+  KSAggregationBenchmark *benchmark = [[KSAggregationBenchmark alloc] initWithEntity:collection field:field valueField:@"fooValue" iterations:_settings.aggregationIterations];
+  KSCRUDBenchmark *crud             = [_workloads crudBenchmarkForEntity:collection field:field];
+  id<KSProviderAdapter> adapter     = _workloads.adapter;
+  KCSCollection *kinveyCollection   = [KCSCollection collectionFromString:collection ofClass:[NSMutableDictionary class]];
+  KCSAppdataStore *store            = [KCSAppdataStore storeWithCollection:kinveyCollection options:nil];
+  KCSCachedStore *cachedStore       = [KCSCachedStore storeWithCollection:kinveyCollection options:nil];
+  NSString *valueField              = benchmark.valueField;
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.rowCount           = _settings.aggregationRowCount;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.serverFunctions    = @[KSAggregateCount, KSAggregateSum, KSAggregateMin, KSAggregateMax, KSAggregateAverage];
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  benchmark.seedBlock = ^(NSArray *fieldsList, KSBenchmarkCompletion done) {
+    [adapter createObjectsInEntity:collection fieldsList:fieldsList completion:done];
+  };
+
+  benchmark.valueBlock = ^NSNumber *(NSDictionary *object) {
+    return object[valueField];
+  };
+
+  benchmark.pageBlock = ^(NSString *tag, NSDictionary *lastObject, NSUInteger offset, NSUInteger limit, KSPageCompletion done) {
+
+    KCSQuery *query = [KCSQuery queryOnField:field withExactMatchForValue:tag];
+
+    [query addSortModifier:[[KCSQuerySortModifier alloc] initWithField:KCSEntityKeyId inDirection:kKCSAscending]];
+
+    query.limitModifer = [[KCSQueryLimitModifier alloc] initWithLimit:limit];
+    query.skipModifier = [[KCSQuerySkipModifier alloc] initWithcount:offset];
+
+    [store queryWithQuery:query withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+      done(objectsOrNil, errorOrNil);
+    } withProgressBlock:nil];
+  };
+
+  KCSReduceFunction *(^reduceFunction)(NSString *) = ^KCSReduceFunction *(NSString *function) {
+
+    if ([function isEqualToString:KSAggregateSum]) {
+      return [KCSReduceFunction SUM:valueField];
+    }
+
+    if ([function isEqualToString:KSAggregateMin]) {
+      return [KCSReduceFunction MIN:valueField];
+    }
+
+    if ([function isEqualToString:KSAggregateMax]) {
+      return [KCSReduceFunction MAX:valueField];
+    }
+
+    if ([function isEqualToString:KSAggregateAverage]) {
+      return [KCSReduceFunction AVERAGE:valueField];
+    }
+
+    return [KCSReduceFunction COUNT];
+  };
+
+  // -reducedValueForFields: answers NSNotFound when the group is missing,
+  // which the benchmark then reports as a wrong value.
+  KCSGroupCompletionBlock (^groupCompletion)(NSString *, KSBenchmarkCompletion) = ^KCSGroupCompletionBlock(NSString *tag, KSBenchmarkCompletion done) {
+    return ^(KCSGroup *valuesOrNil, NSError *errorOrNil) {
+      done([valuesOrNil reducedValueForFields:@{field : tag}], errorOrNil);
+    };
+  };
+
+  benchmark.serverBlock = ^(NSString *tag, NSString *function, KSBenchmarkCompletion done) {
+    [store group:@[field]
+          reduce:reduceFunction(function)
+       condition:[KCSQuery queryOnField:field withExactMatchForValue:tag]
+ completionBlock:groupCompletion(tag, done)
+   progressBlock:nil];
+  };
+
+  benchmark.cachedServerBlock = ^(NSString *tag, NSString *function, KSBenchmarkCompletion done) {
+    [cachedStore group:@[field]
+                reduce:reduceFunction(function)
+             condition:[KCSQuery queryOnField:field withExactMatchForValue:tag]
+       completionBlock:groupCompletion(tag, done)
+         progressBlock:nil
+           cachePolicy:KCSCachePolicyLocalFirst];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Kinvey only indexes locations kept in _geoloc, as the [longitude,
+ * latitude] array CLLocation+Kinvey makes. Radius queries are kKCSNearSphere
+ * with kKCSMaxDistance, which KCSQuery takes in miles; box queries are
+ * kKCSWithinBox from the southwest to the northeast corner.
+ */
+- (KSGeoQueryBenchmark *)geoQueryBenchmarkForCollection:(NSString *)collection field:(NSString *)field {
+
+  KSGeoQueryBenchmark *benchmark  = [[KSGeoQueryBenchmark alloc] initWithEntity:collection field:field locationField:KCSEntityKeyGeolocation iterations:_settings.geoIterations];
+  KSCRUDBenchmark *crud           = [_workloads crudBenchmarkForEntity:collection field:field];
+  id<KSProviderAdapter> adapter   = _workloads.adapter;
+  KCSCollection *kinveyCollection = [KCSCollection collectionFromString:collection ofClass:[NSMutableDictionary class]];
+  KCSAppdataStore *store          = [KCSAppdataStore storeWithCollection:kinveyCollection options:nil];
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  if ([_settings.geoRowCounts count] > 0) {
+    benchmark.rowCounts = _settings.geoRowCounts;
+  }
+
+  NSArray *(^location)(double, double) = ^NSArray *(double latitude, double longitude) {
+    return [[[CLLocation alloc] initWithLatitude:latitude longitude:longitude] kinveyValue];
+  };
+
+  benchmark.pointBlock = ^id(double latitude, double longitude) {
+    return location(latitude, longitude);
+  };
+
+  benchmark.seedBlock = ^(NSArray *fieldsList, KSBenchmarkCompletion done) {
+    [adapter createObjectsInEntity:collection fieldsList:fieldsList completion:done];
+  };
+
+  void (^find)(KCSQuery *, NSString *, NSUInteger, KSBenchmarkCompletion) = ^(KCSQuery *query, NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    [query addQueryOnField:field withExactMatchForValue:tag];
+
+    query.limitModifer = [[KCSQueryLimitModifier alloc] initWithLimit:limit];
+
+    [store queryWithQuery:query withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+      done(objectsOrNil, errorOrNil);
+    } withProgressBlock:nil];
+  };
+
+  benchmark.radiusBlock = ^(NSString *tag, double latitude, double longitude, double kilometers, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    KCSQuery *query = [KCSQuery queryOnField:KCSEntityKeyGeolocation
+                  usingConditionalsForValues:kKCSNearSphere, location(latitude, longitude),
+                                             kKCSMaxDistance, @(kilometers / 1.609344), nil];
+
+    find(query, tag, limit, done);
+  };
+
+  benchmark.boxBlock = ^(NSString *tag, double southLatitude, double westLongitude, double northLatitude, double eastLongitude, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    KCSQuery *query = [KCSQuery queryOnField:KCSEntityKeyGeolocation
+                            usingConditional:kKCSWithinBox
+                                    forValue:@[location(southLatitude, westLongitude), location(northLatitude, eastLongitude)]];
+
+    find(query, tag, limit, done);
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Every shape is a KCSQuery with the run's tag added on: an exact match,
+ * kKCSGreaterThanOrEqual with kKCSLessThan, kKCSIn, +queryOnField:withRegex:
+ * (Kinvey only takes regexes anchored with ^), kKCSOr over two queries and
+ * two KCSQuerySortModifiers.
+ */
+- (KSQueryShapeBenchmark *)queryShapeBenchmarkForCollection:(NSString *)collection field:(NSString *)field {
+
+  KSQueryShapeBenchmark *benchmark = [[KSQueryShapeBenchmark alloc] initWithEntity:collection field:field iterations:_settings.queryIterations];
+  KSCRUDBenchmark *crud            = [_workloads crudBenchmarkForEntity:collection field:field];
+  id<KSProviderAdapter> adapter    = _workloads.adapter;
+  KCSCollection *kinveyCollection  = [KCSCollection collectionFromString:collection ofClass:[NSMutableDictionary class]];
+  KCSAppdataStore *store           = [KCSAppdataStore storeWithCollection:kinveyCollection options:nil];
+  NSString *categoryField          = benchmark.categoryField;
+  NSString *valueField             = benchmark.valueField;
+  NSString *nameField              = benchmark.nameField;
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  if ([_settings.queryRowCounts count] > 0) {
+    benchmark.rowCounts = _settings.queryRowCounts;
+  }
+
+  benchmark.seedBlock = ^(NSArray *fieldsList, KSBenchmarkCompletion done) {
+    [adapter createObjectsInEntity:collection fieldsList:fieldsList completion:done];
+  };
+
+  benchmark.valueBlock = ^id(NSDictionary *object, NSString *valueName) {
+    return object[valueName];
+  };
+
+  void (^find)(KCSQuery *, NSString *, NSUInteger, KSBenchmarkCompletion) = ^(KCSQuery *query, NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    [query addQueryOnField:field withExactMatchForValue:tag];
+
+    query.limitModifer = [[KCSQueryLimitModifier alloc] initWithLimit:limit];
+
+    [store queryWithQuery:query withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+      done(objectsOrNil, errorOrNil);
+    } withProgressBlock:nil];
+  };
+
+  [benchmark addShape:KSQueryShapeEquality block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+    find([KCSQuery queryOnField:categoryField withExactMatchForValue:@"category-3"], tag, limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeRange block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+    find([KCSQuery queryOnField:valueField usingConditionalsForValues:kKCSGreaterThanOrEqual, @100, kKCSLessThan, @200, nil], tag, limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeContainedIn block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+    find([KCSQuery queryOnField:categoryField usingConditional:kKCSIn forValue:@[@"category-1", @"category-5", @"category-7"]], tag, limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeRegex block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+    find([KCSQuery queryOnField:nameField withRegex:@"^3-"], tag, limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeOr block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    KCSQuery *category = [KCSQuery queryOnField:categoryField withExactMatchForValue:@"category-2"];
+    KCSQuery *value    = [KCSQuery queryOnField:valueField usingConditional:kKCSLessThan forValue:@50];
+
+    find([KCSQuery queryForJoiningOperator:kKCSOr onQueries:category, value, nil], tag, limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeSort block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    KCSQuery *query = [KCSQuery query];
+
+    [query addSortModifier:[[KCSQuerySortModifier alloc] initWithField:categoryField inDirection:kKCSAscending]];
+    [query addSortModifier:[[KCSQuerySortModifier alloc] initWithField:valueField inDirection:kKCSDescending]];
+
+    find(query, tag, limit, done);
+  }];
+
+  return benchmark;
+}
+
+/*!
+ * Reads are a KCSQuery on the benchmark field through a KCSAppdataStore with
+ * no cache policy of its own; the cache key is the query's
+ * -JSONStringRepresentation.
+ */
+- (KSQueryCacheBenchmark *)queryCacheBenchmarkForCollection:(NSString *)collection field:(NSString *)field {
+
+  KSQueryCacheBenchmark *benchmark = [[KSQueryCacheBenchmark alloc] initWithAdapter:_workloads.adapter entity:collection field:field operations:_settings.queryCacheOperations];
+  KCSCollection *kinveyCollection  = [KCSCollection collectionFromString:collection ofClass:[NSMutableDictionary class]];
+  KCSAppdataStore *store           = [KCSAppdataStore storeWithCollection:kinveyCollection options:nil];
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.readRatio          = _settings.queryCacheReadRatio;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+
+  benchmark.readBlock = ^(NSString *value, KSQueryCache *cache, KSBenchmarkCompletion done) {
+
+    KCSQuery *query = [KCSQuery queryOnField:field withExactMatchForValue:value];
+
+    KSQueryCacheFetchBlock fetch = ^(KSBenchmarkCompletion fetched) {
+      [store queryWithQuery:query withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+        fetched(objectsOrNil, errorOrNil);
+      } withProgressBlock:nil];
+    };
+
+    if (!cache) {
+      fetch(done);
+      return;
+    }
+
+    [cache readEntity:collection key:[query JSONStringRepresentation] fetch:fetch completion:done];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * KCSClient is a singleton, so every store shares the one client and there
+ * is only the one to run through.
+ */
+- (KSConnectionReuseBenchmark *)connectionReuseBenchmarkForCollection:(NSString *)collection field:(NSString *)field {
+
+  KSConnectionReuseBenchmark *benchmark = [[KSConnectionReuseBenchmark alloc] initWithEntity:collection field:field operations:_settings.connectionReuseOperations];
+
+  benchmark.timeout = _settings.testTimeout;
+  benchmark.idleGap = _settings.connectionReuseIdleGap;
+
+  [benchmark addClient:@"shared" adapter:_workloads.adapter];
+
+  return benchmark;
+}
+
+/*!
+ * KCSAppdataStore has no retry settings, so only its own behaviour runs,
+ * through the adapter's query.
+ *
+ * Fault rates missing from the configuration keep the benchmark's defaults.
+ */
+- (KSFaultInjectionBenchmark *)faultInjectionBenchmarkForCollection:(NSString *)collection field:(NSString *)field {
+
+  KSFaultInjectionBenchmark *benchmark = [[KSFaultInjectionBenchmark alloc] initWithEntity:collection field:field operations:_settings.faultInjectionOperations];
+
+  benchmark.timeout = _settings.testTimeout;
+
+  if (_settings.faultServiceUnavailableRate) {
+    benchmark.serviceUnavailableRate = [_settings.faultServiceUnavailableRate doubleValue];
+  }
+
+  if (_settings.faultResetRate) {
+    benchmark.resetRate = [_settings.faultResetRate doubleValue];
+  }
+
+  if (_settings.faultLatencySpikeRate) {
+    benchmark.latencySpikeRate = [_settings.faultLatencySpikeRate doubleValue];
+  }
+
+  if (_settings.faultLatencySpike) {
+    benchmark.latencySpike = [_settings.faultLatencySpike doubleValue];
+  }
+
+  id<KSProviderAdapter> adapter = _workloads.adapter;
+
+  [benchmark addVariant:@"default" block:^(NSString *value, KSBenchmarkCompletion done) {
+    [adapter queryEntity:collection whereField:field equals:value completion:done];
+  }];
+
+  return benchmark;
+}
+
+/*!
+ * Loads KinveyConfiguration.plist the way KinveyConfigurator does,
+ * initializes KCSClient with the secure or open app and finds one Foo.
+ * KCSClient is a singleton, so warm passes initialize it again in place. The
+ * first request also signs up the implicit user when there is no active one
+ * yet, which only the cold pass of a fresh install pays for.
+ */
+- (KSStartupBenchmark *)startupBenchmark {
+
+  KSStartupBenchmark *benchmark       = [[KSStartupBenchmark alloc] initWithProvider:@"Kinvey" passes:_settings.startupPasses];
+  __block NSDictionary *configuration = nil;
+
+  benchmark.timeout = _settings.testTimeout;
+
+  [benchmark addPhase:@"configuration" block:^(NSUInteger pass, KSBenchmarkCompletion done) {
+
+    NSString *path = [[NSBundle bundleForClass:[KinveyConfigurator class]] pathForResource:@"KinveyConfiguration" ofType:@"plist"];
+
+    configuration = [NSDictionary dictionaryWithContentsOfFile:path];
+
+    done(configuration, nil);
+  }];
+
+  [benchmark addPhase:@"client" block:^(NSUInteger pass, KSBenchmarkCompletion done) {
+
+    NSString *prefix = [configuration[@"UseSecure"] boolValue] ? @"Secure" : @"Open";
+
+    (void) [[KCSClient sharedClient] initializeKinveyServiceForAppKey:configuration[[prefix stringByAppendingString:@"AppKey"]]
+                                                        withAppSecret:configuration[[prefix stringByAppendingString:@"AppSecrect"]]
+                                                         usingOptions:nil];
+
+    done(nil, nil);
+  }];
+
+  [benchmark addPhase:@"first_request" block:^(NSUInteger pass, KSBenchmarkCompletion done) {
+
+    KCSCollection *collection = [KCSCollection collectionFromString:@"Foo" ofClass:[NSMutableDictionary class]];
+    KCSAppdataStore *store    = [KCSAppdataStore storeWithCollection:collection options:nil];
+    KCSQuery *query           = [KCSQuery query];
+
+    query.limitModifer = [[KCSQueryLimitModifier alloc] initWithLimit:1];
+
+    [store queryWithQuery:query withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+      done(objectsOrNil, errorOrNil);
+    } withProgressBlock:nil];
+  }];
+
+  return benchmark;
+}
+
+/*!
+ * Runs one test's benchmark through the shared settings, which write the
+ * report where BenchmarkReportDirectory points, and fails the test if it
+ * raised or the report could not be written.
+ */
+- (void)runBenchmark:(NSString *)benchmark test:(SEL)test block:(KSBenchmarkBlock)block {
+
+  NSString *failure = [_settings runBenchmark:benchmark provider:@"Kinvey" test:test block:block];
+
+  STAssertNil(failure, @"%@", failure);
+}
+
+#pragma mark - Startup benchmarks
+
+/*!
+ * Times loading the configuration, initializing KCSClient and the first
+ * request to Foo, StartupPasses times. The first pass is reported as cold,
+ * and the report records how long the test process had been up, since earlier
+ * tests may already have warmed the SDK.
+ */
+- (void)test_050_Cold_Start {
+
+  [self runBenchmark:@"startup" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    KSStartupBenchmark *benchmark = [self startupBenchmark];
+
+    [report setParameter:@(benchmark.passes) forKey:@"passes"];
+    [report setParameter:@([KSStartupBenchmark processUptime]) forKey:@"process_uptime_s"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Kinvey startup phases failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Latency benchmarks
+
+/*!
+ * Measures p50/p95/p99 latency and throughput of create, read by id, query,
+ * update and delete for Foo and Bar.
+ *
+ * Each entity also gets a wire trace: DNS, connect, time to first byte and
+ * transfer per request, and how much of the operation time was spent on the
+ * wire rather than in the SDK.
+ */
+- (void)test_100_CRUD_Latency {
+
+  [self runBenchmark:@"crud_latency" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    [report setParameter:@(_settings.iterations) forKey:@"iterations"];
+
+    NSDictionary *fields = @{@"Foo" : @"fooParameter", @"Bar" : @"barParameter"};
+
+    for (NSString *collection in @[@"Foo", @"Bar"]) {
+
+      KSCRUDBenchmark *benchmark = [_workloads crudBenchmarkForEntity:collection field:fields[collection]];
+
+      [KSWireTrace start];
+      [benchmark runWithReport:report];
+      [KSWireTrace stop];
+
+      [KSWireTrace addToReport:report operations:benchmark.histograms attributes:@{@"entity" : benchmark.entity}];
+
+      STAssertTrue(benchmark.errorCount == 0, @"%lu %@ operations failed", (unsigned long)benchmark.errorCount, collection);
+    }
+  }];
+}
+
+#pragma mark - Load benchmarks
+
+/*!
+ * Creates Foo objects as fast as LoadWorkers concurrent workers allow (or at
+ * LoadTargetRate) and reports achieved throughput, error rate and latency
+ * at each worker count.
+ */
+- (void)test_110_Create_Throughput_Under_Load {
+
+  [self runBenchmark:@"load" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    [report setParameter:_settings.loadWorkers forKey:@"workers"];
+    [report setParameter:@(_settings.loadTargetRate) forKey:@"target_rate"];
+    [report setParameter:@(_settings.loadDuration) forKey:@"duration_s"];
+
+    KSCRUDBenchmark *benchmark = [_workloads crudBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    for (NSNumber *workers in _settings.loadWorkers) {
+
+      KSLoadGenerator *generator = [self runCreateLoadWithBenchmark:benchmark workers:[workers unsignedIntegerValue]];
+
+      if(_settings.showLogs) NSLog(@"%@", generator);
+
+      [generator addToReport:report];
+    }
+  }];
+}
+
+#pragma mark - Batch write benchmarks
+
+/*!
+ * Saves BatchSizes Foo objects one at a time, then again as one array through
+ * KCSAppdataStore.
+ * Reports objects/sec and bytes on the wire for both paths.
+ */
+- (void)test_120_Batch_Write {
+
+  [self runBenchmark:@"batch_write" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    [report setParameter:_settings.batchSizes forKey:@"batch_sizes"];
+
+    KSBatchWriteBenchmark *benchmark = [_workloads batchWriteBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo saves failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Cache policy benchmarks
+
+/*!
+ * Reads a Foo under every KCSCachePolicy, reporting cold and warm latency, hit
+ * ratio and how stale the answers were after a write.
+ */
+- (void)test_130_Cache_Policy_Matrix {
+
+  [self runBenchmark:@"cache_policy" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    [report setParameter:@(_settings.iterations) forKey:@"iterations"];
+
+    KSCachePolicyBenchmark *benchmark = [self cachePolicyBenchmarkForCollection:@"Foo" field:@"fooParameter"];
+
+    BOOL completed = [benchmark runWithReport:report];
+
+    STAssertTrue(completed, @"%lu Foo creates or writes failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Payload scaling benchmarks
+
+/*!
+ * Creates and reads Foo objects as the field grows from 100 B to 1 MB and as
+ * the field count grows from 1 to 500, and reports latency, JSON
+ * serialisation cost and wire time at each step.
+ */
+- (void)test_140_Payload_Scaling {
+
+  [self runBenchmark:@"payload_scaling" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSPayloadScalingBenchmark *benchmark = [_workloads payloadScalingBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.payloadIterations) forKey:@"iterations"];
+    [report setParameter:benchmark.payloadSizes forKey:@"payload_sizes"];
+    [report setParameter:benchmark.fieldCounts forKey:@"field_counts"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo payload operations failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Offline queue benchmarks
+
+/*!
+ * Queues 10 to 10,000 Foo saves in a KCSOfflineSaveStore while the backend
+ * is away, then brings it back. Reports enqueue cost, the queue's size on
+ * disk, drain time and rate, and lost, duplicated and reordered writes.
+ */
+- (void)test_150_Offline_Queue {
+
+  [self runBenchmark:@"offline_queue" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSOfflineQueueBenchmark *benchmark = [self offlineQueueBenchmarkForCollection:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:benchmark.queueSizes forKey:@"queue_sizes"];
+    [report setParameter:@(benchmark.valueSize) forKey:@"value_size"];
+
+    [benchmark runWithReport:report];
+
+    if(_settings.showLogs && benchmark.lostCount > 0) {
+      NSLog(@"%lu queued Foo writes never arrived", (unsigned long)benchmark.lostCount);
+    }
+  }];
+}
+
+#pragma mark - Core Data store benchmarks
+
+/*!
+ * Fills in-memory, SQLite and binary stores with 1,000 to 1,000,000 Bar rows
+ * and reports insert and save throughput, how long the store takes to open
+ * again and fetch latency at each size. Nothing goes to Kinvey.
+ */
+- (void)test_160_Core_Data_Store {
+
+  [self runBenchmark:@"core_data_store" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    KSCoreDataBenchmark *benchmark = [[KSCoreDataBenchmark alloc] initWithEntity:@"Bar" field:@"barParameter"];
+
+    benchmark.fetchIterations = _settings.iterations;
+
+    if ([_settings.coreDataRowCounts count] > 0) {
+      benchmark.rowCounts = _settings.coreDataRowCounts;
+    }
+
+    if ([_settings.coreDataStoreTypes count] > 0) {
+      benchmark.storeTypes = _settings.coreDataStoreTypes;
+    }
+
+    [report setParameter:benchmark.storeTypes forKey:@"store_types"];
+    [report setParameter:benchmark.rowCounts forKey:@"row_counts"];
+    [report setParameter:@(benchmark.saveBatchSize) forKey:@"save_batch_size"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Core Data store steps failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Blob transfer benchmarks
+
+/*!
+ * Uploads and downloads 1 KB to 100 MB resources as NSData and through files
+ * on disk, and reports MB/s, peak resident memory and, against the stand-in,
+ * what happens when the connection drops mid-transfer.
+ */
+- (void)test_190_Blob_Transfer {
+
+  [self runBenchmark:@"blob_transfer" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSBlobTransferBenchmark *benchmark = [self blobTransferBenchmark];
+
+    [report setParameter:@(_settings.blobIterations) forKey:@"iterations"];
+    [report setParameter:benchmark.blobSizes forKey:@"blob_sizes"];
+    [report setParameter:@(benchmark.dropSize) forKey:@"drop_size"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu resource transfers failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Aggregation benchmarks
+
+/*!
+ * Computes count, sum, min, max and average over a 100,000-object Foo
+ * dataset with -group:reduce:condition:, through KCSCachedStore and by
+ * downloading every row, and reports how much faster the server and the
+ * cache are and what each way downloads.
+ */
+- (void)test_200_Aggregation {
+
+  [self runBenchmark:@"aggregation" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSAggregationBenchmark *benchmark = [self aggregationBenchmarkForCollection:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.aggregationIterations) forKey:@"iterations"];
+    [report setParameter:@(benchmark.rowCount) forKey:@"rows"];
+    [report setParameter:@(benchmark.pageSize) forKey:@"page_size"];
+    [report setParameter:benchmark.serverFunctions forKey:@"server_functions"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo aggregation saves or reads failed or came back wrong", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Geo query benchmarks
+
+/*!
+ * Seeds 10,000 to 1,000,000 located Foo objects around San Francisco and
+ * reports radius and bounding-box query latency and result sizes at each
+ * density.
+ */
+- (void)test_210_Geo_Query {
+
+  [self runBenchmark:@"geo_query" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSGeoQueryBenchmark *benchmark = [self geoQueryBenchmarkForCollection:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.geoIterations) forKey:@"iterations"];
+    [report setParameter:benchmark.rowCounts forKey:@"row_counts"];
+    [report setParameter:benchmark.radii forKey:@"radii_km"];
+    [report setParameter:@(benchmark.regionSpan) forKey:@"region_span_degrees"];
+    [report setParameter:@(benchmark.resultLimit) forKey:@"result_limit"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo geo saves or queries failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Query shape benchmarks
+
+/*!
+ * Runs equality, range, $in, regex, OR and two-key sort queries over
+ * 1,000 to 100,000 Foo objects and reports how each one's latency grows with
+ * the collection, to find the shapes Kinvey answers with a full scan.
+ */
+- (void)test_220_Query_Shapes {
+
+  [self runBenchmark:@"query_shapes" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSQueryShapeBenchmark *benchmark = [self queryShapeBenchmarkForCollection:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.queryIterations) forKey:@"iterations"];
+    [report setParameter:benchmark.rowCounts forKey:@"row_counts"];
+    [report setParameter:benchmark.shapes forKey:@"shapes"];
+    [report setParameter:@(benchmark.resultLimit) forKey:@"result_limit"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo query shape saves or queries failed or returned the wrong objects", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Query cache benchmarks
+
+/*!
+ * Replays a read-heavy mix of Foo list queries and saves straight against
+ * Kinvey and again through KSQueryCache, and reports the hit rate and the
+ * requests and read time the cache saved next to reading every list from
+ * the backend.
+ */
+- (void)test_230_Query_Cache {
+
+  [self runBenchmark:@"query_cache" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSQueryCacheBenchmark *benchmark = [self queryCacheBenchmarkForCollection:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(benchmark.operations) forKey:@"operations"];
+    [report setParameter:@(benchmark.readRatio) forKey:@"read_ratio"];
+    [report setParameter:@(benchmark.keyCount) forKey:@"key_count"];
+    [report setParameter:@(benchmark.objectsPerKey) forKey:@"objects_per_key"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo query cache operations failed or read stale lists", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Connection reuse benchmarks
+
+/*!
+ * Counts the TCP and TLS handshakes the Kinvey SDK makes per 1000 Foo
+ * queries, sequentially, concurrently and in bursts with idle gaps between
+ * them. Needs StandInMode Replay.
+ */
+- (void)test_240_Connection_Reuse {
+
+  [self runBenchmark:@"connection_reuse" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSConnectionReuseBenchmark *benchmark = [self connectionReuseBenchmarkForCollection:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(benchmark.operations) forKey:@"operations"];
+    [report setParameter:@(benchmark.concurrency) forKey:@"concurrency"];
+    [report setParameter:@(benchmark.burstSize) forKey:@"burst_size"];
+    [report setParameter:@(benchmark.idleBursts) forKey:@"idle_bursts"];
+    [report setParameter:@(benchmark.idleGap) forKey:@"idle_gap_s"];
+
+    [benchmark runWithReport:report];
+
+    if (benchmark.skipped) {
+      if(_settings.showLogs) NSLog(@"StandInMode isn't Replay, skipping %@", NSStringFromSelector(_cmd));
+      *discard = YES;
+      return;
+    }
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo queries failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Fault injection benchmarks
+
+/*!
+ * Runs Foo queries through the Kinvey SDK while the stand-in answers some
+ * requests with 503s, resets others and holds others back, and reports
+ * tail latency, success rate and the requests its retries add.
+ * Needs StandInMode Record or Replay.
+ */
+- (void)test_250_Fault_Injection {
+
+  [self runBenchmark:@"fault_injection" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSFaultInjectionBenchmark *benchmark = [self faultInjectionBenchmarkForCollection:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(benchmark.operations) forKey:@"operations"];
+    [report setParameter:@(benchmark.concurrency) forKey:@"concurrency"];
+    [report setParameter:@(benchmark.serviceUnavailableRate) forKey:@"service_unavailable_rate"];
+    [report setParameter:@(benchmark.resetRate) forKey:@"reset_rate"];
+    [report setParameter:@(benchmark.latencySpikeRate) forKey:@"latency_spike_rate"];
+    [report setParameter:@(benchmark.latencySpike) forKey:@"latency_spike_s"];
+
+    [benchmark runWithReport:report];
+
+    if (benchmark.skipped) {
+      if(_settings.showLogs) NSLog(@"StandInMode is Off, skipping %@", NSStringFromSelector(_cmd));
+      *discard = YES;
+      return;
+    }
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo queries failed without faults", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+@end
@@ -8,19 +8,35 @@
 #import "Foo.h"
 #import "Bar.h"
 #import "KinveyConfigurator.h"
+#import "KSCompletionWaiter.h"
+#import "KSBulkDeleter.h"
+#import "KSPagedQuery.h"
+#import "KSRandomString.h"
+#import "KSRunNamespace.h"
+#import "KSCoreDataStack.h"
 
 @interface KitchenSyncKinveyTests()
 
 @property (nonatomic, assign) BOOL showLogs;
 @property (nonatomic, assign) BOOL usingSecureBackend;
 @property (nonatomic, assign) BOOL runCoreDataTests;
-@property (nonatomic, copy) void (^testForCompletionBlock)(BOOL *testCompleted);
+@property (nonatomic, assign) NSTimeInterval testTimeout;
+@property (nonatomic, strong) NSDictionary *configuration;
+@property (nonatomic, assign) KCSCachePolicy cachePolicy;
+@property (nonatomic, assign) BOOL deleteAllTestDataEnabled;
+@property (nonatomic, strong) KSRunNamespace *runNamespace;
+@property (nonatomic, copy) NSString *coreDataStoreType;
 
 - (void)configureBackend:(BOOL)overrideConfig;
 - (void)deleteAllTestData;
+- (void)deleteRunTestData;
 - (void)setupCoreDataEnvironment;
 - (void)deleteAllFoo;
+- (void)deleteAllBar;
+- (void)deleteAllObjectsInStore:(KCSAppdataStore *)store named:(NSString *)name;
+- (void)deleteAllObjectsInStore:(KCSAppdataStore *)store named:(NSString *)name taggedInField:(NSString *)field;
 - (NSString *)randomString:(int)numCharacters;
+- (void)waitForCompletion:(KSCompletionWaiter *)waiter;
 
 @end
 
@@ -32,27 +48,40 @@
 
     [super setUp];
   
-    _testForCompletionBlock = ^(BOOL *testCompleted) {
-      
-      while (!*testCompleted) {
-        
-        NSDate *cycle = [NSDate dateWithTimeIntervalSinceNow:0.01];
-        
-        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode
-                                 beforeDate:cycle];
-      }
-    };
-  
   NSDictionary *kinveyAppConfiguration = [[KinveyConfigurator sharedInstance] applicationConfiguration];
   
   _showLogs           = [kinveyAppConfiguration[@"ShowLogs"] boolValue];
   _usingSecureBackend = [kinveyAppConfiguration[@"UseSecure"] boolValue];
   _runCoreDataTests   = [kinveyAppConfiguration[@"RunCoreDataTests"] boolValue];
+
+  _testTimeout         = [kinveyAppConfiguration[@"TestTimeout"] doubleValue];
+  _configuration       = kinveyAppConfiguration;
+
+  _deleteAllTestDataEnabled = [kinveyAppConfiguration[@"DeleteAllTestData"] boolValue];
+  _runNamespace             = [KSRunNamespace currentNamespace];
+  _coreDataStoreType        = [KSCoreDataStack storeTypeForName:kinveyAppConfiguration[@"CoreDataStoreType"]];
+
+  if (_testTimeout <= 0) {
+    _testTimeout = 30.0;
+  }
+
+  STAssertNotNil(_coreDataStoreType, @"unknown CoreDataStoreType %@, expected InMemory, SQLite or Binary", kinveyAppConfiguration[@"CoreDataStoreType"]);
+
+  // CachePolicy lets the suite run against the Foo store under any policy;
+  // the cache policy benchmark compares them all.
+  NSDictionary *cachePolicies = @{@"None"         : @(KCSCachePolicyNone),
+                                  @"LocalOnly"    : @(KCSCachePolicyLocalOnly),
+                                  @"LocalFirst"   : @(KCSCachePolicyLocalFirst),
+                                  @"NetworkFirst" : @(KCSCachePolicyNetworkFirst),
+                                  @"Both"         : @(KCSCachePolicyBoth)};
+
+  NSNumber *cachePolicy = cachePolicies[kinveyAppConfiguration[@"CachePolicy"]];
+
+  _cachePolicy = cachePolicy ? (KCSCachePolicy)[cachePolicy intValue] : KCSCachePolicyNetworkFirst;
   
   // Set-up code here.
     [self setupCoreDataEnvironment];
     [self configureBackend:NO];
-    [self deleteAllTestData];
 }
 
 /*!
@@ -88,44 +117,34 @@
                            ofClass:[Bar class]];
     _fooStore = [KCSCachedStore
                 storeWithCollection:foos
-                options:@{ KCSStoreKeyCachePolicy : @(KCSCachePolicyNetworkFirst)}];
+                options:@{ KCSStoreKeyCachePolicy : @(_cachePolicy)}];
     _barStore = [KCSLinkedAppdataStore
                 storeWithCollection:bars
                 options:nil];
 }
 
+/*!
+ * Gives the test a new context on the run's Core Data stack, which is built
+ * once, on first use, with the store CoreDataStoreType names.
+ */
 - (void)setupCoreDataEnvironment {
-    // Destroy objects
-    _persistentStoreCoordinator = nil;
-    _managedObjectModel         = nil;
-    _managedObjectContext       = nil;
-
-    // Setup Core Data
-    _managedObjectModel         = [NSManagedObjectModel mergedModelFromBundles:nil];
-    _persistentStoreCoordinator = [[NSPersistentStoreCoordinator alloc]
-                                  initWithManagedObjectModel:_managedObjectModel];
-    NSError *error;
-    // Setup an in memory store
-    if(![_persistentStoreCoordinator addPersistentStoreWithType:NSInMemoryStoreType
-                                                  configuration:nil
-                                                            URL:nil
-                                                        options:nil
-                                                          error:&error]) {
-
-      STFail(@"Could not create store coordinator: %@", [error localizedDescription]);
+
+    NSError *error         = nil;
+    KSCoreDataStack *stack = [KSCoreDataStack sharedStackWithStoreType:_coreDataStoreType error:&error];
+
+    if (!stack) {
+        STFail(@"Could not create store coordinator: %@", [error localizedDescription]);
     }
-  
-    _managedObjectContext = [[NSManagedObjectContext alloc] init];
 
-    [_managedObjectContext setPersistentStoreCoordinator:_persistentStoreCoordinator];
-    [_managedObjectContext setUndoManager:nil];
+    _managedObjectModel         = stack.managedObjectModel;
+    _persistentStoreCoordinator = stack.persistentStoreCoordinator;
+    _managedObjectContext       = [stack newContext];
 }
 
 #pragma mark - Teardown
 
 - (void)tearDown {
     [super tearDown];
-    [self deleteAllTestData];
 }
 
 /*!
@@ -140,25 +159,38 @@
     }
 }
 
+/*!
+ This method deletes the Foo and Bar data this run tagged, on the open and
+ the secure backend: test_101 writes to the secure one whatever UseSecure
+ says.
+ */
+- (void)deleteRunTestData {
+
+    BOOL usingSecureBackend = _usingSecureBackend;
+
+    @try {
+        _usingSecureBackend = NO;
+        [self configureBackend:NO];
+        [self deleteAllObjectsInStore:_fooStore named:@"Foo" taggedInField:@"fooParameter"];
+        [self deleteAllObjectsInStore:_barStore named:@"Bar" taggedInField:@"barParameter"];
+
+        [self configureBackend:YES];
+        [self deleteAllObjectsInStore:_fooStore named:@"Foo" taggedInField:@"fooParameter"];
+        [self deleteAllObjectsInStore:_barStore named:@"Bar" taggedInField:@"barParameter"];
+    } @catch (NSException * e) {
+        NSLog(@"deleteRunTestData failed: %@", [e description]);
+    }
+
+    _usingSecureBackend = usingSecureBackend;
+    [self configureBackend:NO];
+}
+
 /*!
  This method deletes all Foo data from the backend.
  */
 - (void)deleteAllFoo {
     @try {
-      __block BOOL testCompleted = NO;
-        [_fooStore queryWithQuery:[KCSQuery query] withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
-          STAssertNil(errorOrNil, @"error should be nil: %@", [errorOrNil description]);
-          for (id obj in objectsOrNil) {
-          [_fooStore removeObject:obj
-              withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil){
-                testCompleted = YES;
-                STAssertNil(errorOrNil, @"error should be nil: %@", [errorOrNil description]);
-              }
-                withProgressBlock:nil];
-          }
-          testCompleted = YES;
-        } withProgressBlock:nil];
-      _testForCompletionBlock(&testCompleted);
+        [self deleteAllObjectsInStore:_fooStore named:@"Foo"];
     } @catch (NSException * e) {
         NSLog(@"deleteAllFoo failed: %@", [e description]);
     }
@@ -169,34 +201,96 @@
  */
 - (void)deleteAllBar {
     @try {
-      __block BOOL testCompleted = NO;
-        [_barStore queryWithQuery:[KCSQuery query] withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
-          STAssertNil(errorOrNil, @"error should be nil: %@", [errorOrNil description]);
-
-          for (id obj in objectsOrNil) {
-            
-            [_barStore removeObject:obj
-                withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil){
-                  testCompleted = YES;
-                  STAssertNil(errorOrNil, @"error should be nil: %@", [errorOrNil description]);
-                }
-                withProgressBlock:nil];
-          }
-          testCompleted = YES;
-        } withProgressBlock:nil];
-      
-      _testForCompletionBlock(&testCompleted);
+        [self deleteAllObjectsInStore:_barStore named:@"Bar"];
     } @catch (NSException * e) {
         NSLog(@"deleteAllBar failed: %@", [e description]);
     }
 }
 
+/*!
+ * Deletes everything in the store, a page at a time. removeObject: accepts
+ * an array, so each page is removed in batches with TeardownConcurrency
+ * batches in flight. Only one page of entities is held at a time.
+ */
+- (void)deleteAllObjectsInStore:(KCSAppdataStore *)store named:(NSString *)name {
+  [self deleteAllObjectsInStore:store named:name taggedInField:nil];
+}
+
+/*!
+ * Same as -deleteAllObjectsInStore:named:, limited to the entities whose
+ * field matches this run's prefix when field is given.
+ */
+- (void)deleteAllObjectsInStore:(KCSAppdataStore *)store named:(NSString *)name taggedInField:(NSString *)field {
+
+  NSString *pattern = _runNamespace.valuePattern;
+
+  KSPagedQuery *pages = [KSPagedQuery queryWithPageSize:1000 fetchBlock:^(NSUInteger offset, NSUInteger limit, KSPageCompletion done) {
+
+    KCSQuery *query = field ? [KCSQuery queryOnField:field usingConditional:kKCSRegex forValue:pattern] : [KCSQuery query];
+
+    query.limitModifer = [[KCSQueryLimitModifier alloc] initWithLimit:limit];
+    query.skipModifier = [[KCSQuerySkipModifier alloc] initWithcount:offset];
+
+    [store queryWithQuery:query withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+      done(objectsOrNil, errorOrNil);
+    } withProgressBlock:nil];
+  }];
+
+  pages.timeout       = _testTimeout;
+  pages.consumesPages = YES;
+
+  BOOL completed = [pages enumeratePagesUsingBlock:^(NSArray *page, NSUInteger offset, BOOL *stop) {
+
+    KSBulkDeleter *deleter = [KSBulkDeleter deleterWithConfiguration:_configuration];
+
+    [deleter deleteItems:page inBatchesWithBlock:^(NSArray *batch, KSBulkDeleteCompletion done) {
+      [store removeObject:batch withCompletionBlock:^(NSArray *objectsOrNil, NSError *errorOrNil) {
+        done(errorOrNil);
+      } withProgressBlock:nil];
+    }];
+
+    NSString *failure = [deleter waitAndReportNamed:name timeout:_testTimeout];
+    STAssertNil(failure, @"%@", failure);
+
+    // Don't keep re-reading a page that can't be deleted.
+    if (deleter.failedCount > 0 || deleter.deletedCount < [page count]) {
+      *stop = YES;
+    }
+  }];
+
+  STAssertTrue(completed, @"error should be nil: %@", [pages.error description]);
+}
+
+#pragma mark - Async helpers
+
+/*!
+ * Waits for the waiter to be signalled by an SDK completion block, failing
+ * the test if it does not happen within the configured TestTimeout.
+ */
+- (void)waitForCompletion:(KSCompletionWaiter *)waiter {
+
+  BOOL completed = [waiter waitWithTimeout:_testTimeout];
+
+  STAssertTrue(completed, @"timed out after %.3fs waiting for completion", waiter.elapsed);
+
+  if(_showLogs) {
+    NSLog(@"completion wait took %.3f ms", waiter.elapsed * 1000.0);
+  }
+}
+
 #pragma mark - Setup and configuration tests
 
 /*!
- This method deletes all Test data from the backend.
+ * Empties Foo and Bar of every run's data, including data other runs are
+ * still using, so it only runs with DeleteAllTestData set.
  */
 - (void)test_000_Delete_All_Test_Data {
+
+  if (!_deleteAllTestDataEnabled) {
+    NSLog(@"DeleteAllTestData is off, leaving other runs' data alone");
+    return;
+  }
+
   @try {
     [self deleteAllFoo];
     [self deleteAllBar];
@@ -217,7 +311,7 @@
 //        if(_showLogs) NSLog(@"test_100_Public_Access Foo:foo before save = %@",
 //                           [f1 description]);
 //      
-//        __block BOOL testCompleted = NO;
+//        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
 //        // create an object to make sure backend is really working
 //        [_fooStore saveObject:f1 withCompletionBlock:^(NSArray *objectsOrNil,
 //                                                      NSError *createError) {
@@ -246,18 +340,18 @@
 //                                           [readError localizedDescription]);
 //                       } withProgressBlock:nil];
 //
-//              testCompleted = YES;
+//              [waiter signal];
 //
 //            } else {
 //              
-//              testCompleted = YES;
+//              [waiter signal];
 //              
 //              STAssertNil(createError, @"saveObject failed: %@",
 //                          [createError localizedDescription]);
 //            }
 //        } withProgressBlock:nil];
 //      
-//      _testForCompletionBlock(&testCompleted);
+//      [self waitForCompletion:waiter];
 //    } @catch (NSException * e) {
 //        STAssertNil(e, @"test failed: %@", [e description]);
 //    }
@@ -270,11 +364,11 @@
     @try {
       [self configureBackend:YES];
         Foo * f1 = [[Foo alloc] init];
-        f1.fooParameter = @"Testing secure access";
+        f1.fooParameter = [_runNamespace tagValue:@"Testing secure access"];
         if(_showLogs) NSLog(@"test_100_Public_Access Foo : foo before save = %@",
                            [f1 description]);
       
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
 
         // create an object to make sure backend is really working
         [_fooStore saveObject:f1
@@ -287,18 +381,18 @@
                  if(_showLogs) NSLog(@"\r\n\t test_100_Public_Access f1 after save = %@, \r\n\tMetadata: %@",[f1 description], [f1 metadata]);
                  if(_showLogs) NSLog(@"\r\n\t test_100_Public_Access f2 after save = %@, \r\n\tMetadata: %@",[f2 description], f2.metadata);
 
-                 testCompleted = YES;
+                 [waiter signal];
                
              } else {
 
-               testCompleted = YES;
+               [waiter signal];
                
                STAssertNil(createError, @"saveObject failed: %@",
                            [createError localizedDescription]);
              }
          } withProgressBlock:nil];
       
-      _testForCompletionBlock(&testCompleted);
+      [self waitForCompletion:waiter];
     } @catch (NSException * e) {
         STAssertNil(e, @"test failed: %@", [e description]);
     }
@@ -326,7 +420,7 @@
 - (void)test_104_New_Collection_Allowed {
     @try {
       
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
       
         if(!_usingSecureBackend) {
             NSString * clazz = [self randomString:5];
@@ -341,18 +435,18 @@
           
             [dic saveToCollection:c withCompletionBlock:^(NSArray *objectsOrNil,
                                                           NSError *createError) {
-                testCompleted = YES;
+                [waiter signal];
                 STAssertNil(createError, @"test failed: %@",
                             [createError localizedDescription]);
                 if(_showLogs) NSLog(@"\r\n\t test_104_New_Class_Allowed obj after read = %@, \r\n\tMetadata: %@",
                                    [dic description], [dic valueForKey:@"metadata"]);
             } withProgressBlock:nil];
         } else if(_showLogs) {
-          testCompleted = YES;
+          [waiter signal];
           NSLog(@"test_104_New_Class_Allowed could not run with this configuration, skipping test");
         }
       
-      _testForCompletionBlock(&testCompleted);
+      [self waitForCompletion:waiter];
     } @catch (NSException * e) {
         STAssertNil(e, @"test failed: %@", [e description]);
     }
@@ -367,7 +461,7 @@
     STFail(@"kinvey doesn't prevent new collections from being created via client");
 //    @try {
 //      
-//       __block BOOL testCompleted = NO;
+//       KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
 //        if(_usingSecureBackend) {
 //            NSString * clazz = [self randomString:5];
 //            NSString * cs = [NSString stringWithFormat:@"NSDictionary with clazz %@",clazz];
@@ -380,17 +474,17 @@
 //                               [dic description], [dic valueForKey:@"metadata"]);
 //            [dic saveToCollection:c withCompletionBlock:^(NSArray *objectsOrNil,
 //                                                          NSError *createError) {
-//                testCompleted = YES;
+//                [waiter signal];
 //                STAssertNotNil(createError, @"test failed: %@",
 //                               [createError localizedDescription]);
 //                if(!createError)
 //                    STFail(@"Should not have been able to create this on the backend.");
 //            } withProgressBlock:nil];
 //        } else if(_showLogs) {
-//            testCompleted = YES;
+//            [waiter signal];
 //            NSLog(@"test_105_New_Class_Disallowed could not be run with this configuration, skipping test");
 //        }
-//      _testForCompletionBlock(&testCompleted);
+//      [self waitForCompletion:waiter];
 //    } @catch (NSException * e) {
 //        STAssertNil(e, @"test failed: %@", [e description]);
 //    }
@@ -414,22 +508,22 @@
         NSError * crudError;
         [self configureBackend:NO];
         Foo * f1 = [[Foo alloc] init];
-        f1.fooParameter = @"Some string in a Foo : NSObject object";
+        f1.fooParameter = [_runNamespace tagValue:@"Some string in a Foo : NSObject object"];
         if(_showLogs) NSLog(@"test_107_Multiple_Backends Foo : f1 before save = %@",
                            [f1 description]);
       
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
         // create the object
         [_fooStore saveObject:f1 withCompletionBlock:^(NSArray *objectsOrNil,
                                                       NSError *createError) {
-            testCompleted = YES;
+            [waiter signal];
             STAssertNil(createError, @"test failed: %@",
                         [createError localizedDescription]);
             if(_showLogs) NSLog(@"\r\n\t test_104_New_Class_Allowed obj after save = %@, \r\n\tMetadata: %@",
                                [f1 description], [f1 metadata]);
         } withProgressBlock:nil];
         Foo * f2 = [[Foo alloc] init];
-        f2.fooParameter = @"Some string in a Foo : NSObject object";
+        f2.fooParameter = [_runNamespace tagValue:@"Some string in a Foo : NSObject object"];
         if(_showLogs) NSLog(@"test_107_Multiple_Backends Foo : f2 before save = %@",
                            [f2 description]);
 
@@ -452,14 +546,14 @@
         [[KCSClient sharedClient] setAuthCredentials:kc];
         [f2 saveToCollection:foo1 withCompletionBlock:^(NSArray *objectsOrNil,
                                                         NSError *createError) {
-           testCompleted = YES;
+           [waiter signal];
             STAssertNil(createError, @"test failed: %@",
                         [createError localizedDescription]);
             if(_showLogs) NSLog(@"\r\n\t test_104_New_Class_Allowed obj after save = %@, \r\n\tMetadata: %@",
                                [f2 description], [f2 metadata]);
         } withProgressBlock:nil];
       
-        _testForCompletionBlock(&testCompleted);
+        [self waitForCompletion:waiter];
     } @catch (NSException * e) {
         STAssertNil(e, @"test failed: %@", [e description]);
     }
@@ -481,18 +575,18 @@
     @try {
       [self configureBackend:NO];
         Foo * f1 = [[Foo alloc] init];
-        f1.fooParameter = @"Foo : NSObject object";
+        f1.fooParameter = [_runNamespace tagValue:@"Foo : NSObject object"];
         // or, if you prefer
-        [f1 setFooParameter:@"Foo : NSObject object"];
+        [f1 setFooParameter:[_runNamespace tagValue:@"Foo : NSObject object"]];
         if(_showLogs) NSLog(@"test_200_Foo_ObjCClass Foo : f1 before save = %@",
                            [f1 description]);
       
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
         // create the object
         [_fooStore saveObject:f1 withCompletionBlock:^(NSArray *objectsOrNil,
                                                       NSError *createError) {
           
-          testCompleted = YES;
+          [waiter signal];
              STAssertNil(createError, @"saveObject failed: %@",
                          [createError localizedDescription]);
              Foo *f2 = (Foo *)objectsOrNil[0];
@@ -500,7 +594,7 @@
                                 [f2 description], f2.metadata);
          } withProgressBlock:nil];
       
-      _testForCompletionBlock(&testCompleted);
+      [self waitForCompletion:waiter];
     } @catch (NSException * e) {
         STAssertNil(e, @"test failed: %@", [e description]);
     }
@@ -513,16 +607,16 @@
     @try {
       [self configureBackend:NO];
         NSDictionary * f1 = [NSDictionary dictionaryWithObjectsAndKeys:
-                             @"NSDictionary Foo",@"fooParameter",
+                             [_runNamespace tagValue:@"NSDictionary Foo"],@"fooParameter",
                              KCSEntityKeyId,@"kinveyObjectId",
                              nil];
         if(_showLogs) NSLog(@"test_201_Foo_Schemaless NSDictionary : foo before save = %@",
                            [f1 description]);
       
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
         [_fooStore saveObject:f1
          withCompletionBlock:^(NSArray *objectsOrNil, NSError *createError) {
-           testCompleted = YES;
+           [waiter signal];
              STAssertNil(createError, @"saveObject failed: %@",
                          [createError localizedDescription]);
              NSDictionary *f2 = objectsOrNil[0];
@@ -530,7 +624,7 @@
                                 [f2 description], [f2 valueForKey:@"metadata"]);
          } withProgressBlock:nil];
       
-      _testForCompletionBlock(&testCompleted);
+      [self waitForCompletion:waiter];
     } @catch (NSException * e) {
         STAssertNil(e, @"test failed: %@", [e description]);
     }
@@ -544,16 +638,15 @@
   if (_runCoreDataTests) {
     @try {
         [self configureBackend:NO];
-        [self setupCoreDataEnvironment];
         Bar * b1 = [NSEntityDescription
                     insertNewObjectForEntityForName:@"Bar"
                     inManagedObjectContext:_managedObjectContext];
-        b1.barParameter = @"Bar : NSManagedObject object";
+        b1.barParameter = [_runNamespace tagValue:@"Bar : NSManagedObject object"];
         // or, if you prefer
-        [b1 setBarParameter:@"Bar : NSManagedObject object"];
+        [b1 setBarParameter:[_runNamespace tagValue:@"Bar : NSManagedObject object"]];
         if(_showLogs) NSLog(@"test_202_Bar_NSManagedObject Bar : bar before save = %@",
                            [b1 description]);
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
         // save the object locally
         NSError * error;
         if (![_managedObjectContext save:&error]) {
@@ -563,14 +656,14 @@
         // create the object on the backend
         [_barStore saveObject:b1
          withCompletionBlock:^(NSArray *objectsOrNil, NSError *createError) {
-           testCompleted = YES;
+           [waiter signal];
              STAssertNil(createError, @"saveObject failed: %@",
                          [createError localizedDescription]);
              Bar * b2 = objectsOrNil[0];
              if(_showLogs) NSLog(@"\r\n\t test_202_Bar_NSManagedObject_SubClass f2 after save = %@, \r\n\tMetadata: %@",[b2 description], [b2 valueForKey:@"metadata"]);
          } withProgressBlock:nil];
       
-      _testForCompletionBlock(&testCompleted);
+      [self waitForCompletion:waiter];
     } @catch (NSException * e) {
         STAssertNil(e, @"test failed: %@", [e description]);
     }
@@ -585,15 +678,14 @@
   if (_runCoreDataTests) {
     @try {
         [self configureBackend:NO];
-        [self setupCoreDataEnvironment];
         NSManagedObject *b1 = [NSEntityDescription
                                insertNewObjectForEntityForName:@"Bar"
                                inManagedObjectContext:_managedObjectContext];
-        [b1 setValue:@"NSManagedObject for Entity named Bar" forKey:@"barParameter"];
+        [b1 setValue:[_runNamespace tagValue:@"NSManagedObject for Entity named Bar"] forKey:@"barParameter"];
         if(_showLogs) NSLog(@"test_203_NSManagedObject_Called_Bar Bar : bar before save = %@",
                            [b1 description]);
       
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
         NSError * error;
         if (![_managedObjectContext save:&error]) {
           STAssertNil(error, @"context save error should be nil: %@", error);
@@ -604,13 +696,13 @@
         [_barStore saveObject:b1
          withCompletionBlock:^(NSArray *objectsOrNil, NSError *createError) {
              Bar * b2 = objectsOrNil[0];
-           testCompleted = YES;
+           [waiter signal];
              if(_showLogs) NSLog(@"\r\n\t test_203_NSManagedObject_Called_Bar f2 after save = %@, \r\n\tMetadata: %@",[b2 description], [b2 valueForKey:@"metadata"]);
              STAssertNil(createError, @"saveObject failed: %@",
                          [createError localizedDescription]);
          } withProgressBlock:nil];
       
-      _testForCompletionBlock(&testCompleted);
+      [self waitForCompletion:waiter];
     } @catch (NSException * e) {
         STAssertNil(e, @"test failed: %@", [e description]);
     }
@@ -629,23 +721,23 @@
             [self configureBackend:NO];
             NSString * memberName = [self randomString:5];
             NSDictionary * f1 = [NSDictionary dictionaryWithObjectsAndKeys:
-                                 @"NSDictionary with class Foo",@"fooParameter",
+                                 [_runNamespace tagValue:@"NSDictionary with class Foo"],@"fooParameter",
                                  @"a schemaless addition",memberName,
                                  nil];
             if(_showLogs) NSLog(@"test_204_New_Member_Allowed NSDictionary : f1 before save = %@",
                                [f1 description]);
           
-            __block BOOL testCompleted = NO;
+            KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
             [_fooStore saveObject:f1
              withCompletionBlock:^(NSArray *objectsOrNil, NSError *createError) {
                  NSDictionary *f2 = objectsOrNil[0];
-               testCompleted = YES;
+               [waiter signal];
                  if(_showLogs) NSLog(@"\r\n\t test_204_New_Member_Allowed f2 after save = %@, \r\n\tMetadata: %@",[f2 description], [f2 valueForKey:@"metadata"]);
                  STAssertNil(createError, @"saveObject failed: %@",
                              [createError localizedDescription]);
              } withProgressBlock:nil];
           
-          _testForCompletionBlock(&testCompleted);
+          [self waitForCompletion:waiter];
         } else if(_showLogs)
             NSLog(@"test_204_New_Member_Allowed could not be run with this configuration, skipping test");
     } @catch (NSException * e) {
@@ -661,11 +753,11 @@
  */
 - (void)test_205_New_Member_Disallowed {
     @try {
-          __block BOOL testCompleted = NO;
+          KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
         if(_usingSecureBackend) {
             NSString * memberName = [self randomString:5];
             NSDictionary * f1 = [NSDictionary dictionaryWithObjectsAndKeys:
-                                 @"NSDictionary with class Foo",@"fooParameter",
+                                 [_runNamespace tagValue:@"NSDictionary with class Foo"],@"fooParameter",
                                  @"a schemaless addition",memberName,
                                  nil];
             if(_showLogs) NSLog(@"test_205_New_Member_Disallowed NSDictionary : f1 before save = %@",
@@ -673,15 +765,15 @@
 
             [_fooStore saveObject:f1
              withCompletionBlock:^(NSArray *objectsOrNil, NSError *createError) {
-               testCompleted = YES;
+               [waiter signal];
                  STAssertNotNil(createError, @"test failed: %@", [createError localizedDescription]);
                  if(!createError)
                      STFail(@"Should not have been able to create object to backend.");
              } withProgressBlock:nil];
           
-          _testForCompletionBlock(&testCompleted);
+          [self waitForCompletion:waiter];
         } else if(_showLogs) {
-          testCompleted = YES;
+          [waiter signal];
             NSLog(@"test_205_New_Member_Disallowed could not be run with this configuration, skipping test");
         }
     } @catch (NSException * e) {
@@ -694,14 +786,14 @@
  */
 - (void)test_206_Metadata_Provided {
     @try {
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
         Foo * f1 = [[Foo alloc] init];
-        f1.fooParameter = @"Foo : NSObject object";
+        f1.fooParameter = [_runNamespace tagValue:@"Foo : NSObject object"];
         if(_showLogs) NSLog(@"\r\n\t test_206_Metadata_Provided f1 before save = %@",[f1 description]);
         // create the object
         [_fooStore saveObject:f1
          withCompletionBlock:^(NSArray *objectsOrNil, NSError *createError) {
-           testCompleted = YES;
+           [waiter signal];
              STAssertNil(createError, @"test failed: %@",
                          [createError localizedDescription]);
              Foo * f2 = objectsOrNil[0];
@@ -710,28 +802,31 @@
              NSLog(@"metadata: %@",[f2.metadata description]);
          } withProgressBlock:nil];
       
-      _testForCompletionBlock(&testCompleted);
+      [self waitForCompletion:waiter];
     } @catch (NSException * e) {
         STAssertNil(e, @"test failed: %@", [e description]);
     }
 }
 
+#pragma mark - Run cleanup
+
+/*!
+ * Runs last and removes what this run wrote, in one scoped query per
+ * collection.
+ */
+- (void)test_999_Delete_Run_Data {
+  [self deleteRunTestData];
+}
+
 #pragma mark - Sample data utilities
 
 /*!
- * Generates a random string of up to 1000 characters in length. Generates a random
+ * Generates a random string of numCharacters characters. Generates a random
  * length up to 1000 if numCharacters is set to 0.
  */
 - (NSString *)randomString:(int)numCharacters {
-    static char const possibleChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
-    int len;
-    if(numCharacters > 1000 || numCharacters == 0) len = (int)rand() % (1000);
-    else len = numCharacters;
-    unichar characters[len];
-    for( int i=0; i < len; ++i ) {
-        characters[i] = possibleChars[arc4random_uniform(sizeof(possibleChars)-1)];
-    }
-    return [NSString stringWithCharacters:characters length:len] ;
+    int len = numCharacters > 0 ? numCharacters : (int)rand() % (1000);
+    return KSRandomString(len);
 }
 
 @end
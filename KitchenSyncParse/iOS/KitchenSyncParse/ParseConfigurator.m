@@ -6,6 +6,7 @@
 //
 
 #import "ParseConfigurator.h"
+#import "KSStandIn.h"
 
 @implementation ParseConfigurator
 
@@ -32,6 +33,8 @@
                                                                           ofType:@"plist"];
     
     configurationDict = [NSDictionary dictionaryWithContentsOfFile:dataPath];
+
+    [KSStandIn startWithConfiguration:configurationDict name:@"Parse"];
   });
   
   return configurationDict;
@@ -0,0 +1,16 @@
+//
+//  KitchenSyncParseBenchmarks.h
+//  KitchenSyncParseTests
+//
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+#import <Parse/Parse.h>
+
+/*!
+ * Performance benchmarks for the Parse SDK. They only run when RunBenchmarks
+ * is set in ParseConfiguration.plist, and write a JSON report per run.
+ */
+@interface KitchenSyncParseBenchmarks : SenTestCase
+
+@end
@@ -0,0 +1,1236 @@
+//
+//  KitchenSyncParseBenchmarks.m
+//  KitchenSyncParseTests
+//
+//
+
+#import "KitchenSyncParseBenchmarks.h"
+#import "ParseConfigurator.h"
+#import "ParseAdapter.h"
+#import "KSBenchmarkReport.h"
+#import "KSBenchmarkSettings.h"
+#import "KSAdapterWorkloads.h"
+#import "KSCRUDBenchmark.h"
+#import "KSWireTrace.h"
+#import "KSLoadGenerator.h"
+#import "KSBulkDeleter.h"
+#import "KSBatchWriteBenchmark.h"
+#import "KSPayloadScalingBenchmark.h"
+#import "KSStartupBenchmark.h"
+#import "KSCachePolicyBenchmark.h"
+#import "KSOfflineQueueBenchmark.h"
+#import "KSPagedQuery.h"
+#import "KSProjectionBenchmark.h"
+#import "KSBlobTransferBenchmark.h"
+#import "KSAggregationBenchmark.h"
+#import "KSGeoQueryBenchmark.h"
+#import "KSQueryShapeBenchmark.h"
+#import "KSQueryCacheBenchmark.h"
+#import "KSConnectionReuseBenchmark.h"
+#import "KSFaultInjectionBenchmark.h"
+#import "KSRunNamespace.h"
+
+@interface KitchenSyncParseBenchmarks()
+
+@property (nonatomic, strong) KSBenchmarkSettings *settings;
+@property (nonatomic, strong) KSAdapterWorkloads *workloads;
+
+- (void)initializeParse;
+- (void)configureWorkloadsWithAdapter:(id<KSProviderAdapter>)adapter;
+- (KSLoadGenerator *)runCreateLoadWithBenchmark:(KSCRUDBenchmark *)benchmark workers:(NSUInteger)workers;
+- (KSCachePolicyBenchmark *)cachePolicyBenchmarkForClassName:(NSString *)className field:(NSString *)field;
+- (KSOfflineQueueBenchmark *)offlineQueueBenchmarkForClassName:(NSString *)className field:(NSString *)field;
+- (KSProjectionBenchmark *)projectionBenchmarkForClassName:(NSString *)className field:(NSString *)field;
+- (KSBlobTransferBenchmark *)blobTransferBenchmarkForClassName:(NSString *)className field:(NSString *)field;
+- (KSAggregationBenchmark *)aggregationBenchmarkForClassName:(NSString *)className field:(NSString *)field;
+- (KSGeoQueryBenchmark *)geoQueryBenchmarkForClassName:(NSString *)className field:(NSString *)field;
+- (KSQueryShapeBenchmark *)queryShapeBenchmarkForClassName:(NSString *)className field:(NSString *)field;
+- (KSQueryCacheBenchmark *)queryCacheBenchmarkForClassName:(NSString *)className field:(NSString *)field;
+- (KSConnectionReuseBenchmark *)connectionReuseBenchmarkForClassName:(NSString *)className field:(NSString *)field;
+- (KSFaultInjectionBenchmark *)faultInjectionBenchmarkForClassName:(NSString *)className field:(NSString *)field;
+- (KSStartupBenchmark *)startupBenchmark;
+- (void)runBenchmark:(NSString *)benchmark test:(SEL)test block:(KSBenchmarkBlock)block;
+
+@end
+
+@implementation KitchenSyncParseBenchmarks
+
+#pragma mark - Setup and Init
+
+- (void)setUp {
+
+  [super setUp];
+
+  NSDictionary *parseAppConfiguration = [[ParseConfigurator sharedInstance] applicationConfiguration];
+
+  _settings = [KSBenchmarkSettings settingsWithConfiguration:parseAppConfiguration];
+}
+
+/*!
+ * Same backend selection as the functional tests.
+ */
+- (void)initializeParse {
+
+  NSDictionary *parseAppConfiguration = [[ParseConfigurator sharedInstance] applicationConfiguration];
+
+  if([parseAppConfiguration[@"UseSecure"] boolValue]) {
+    [Parse setApplicationId:parseAppConfiguration[@"SecureApplicationId"]
+                  clientKey:parseAppConfiguration[@"SecureClientKey"]];
+  } else {
+    [Parse setApplicationId:parseAppConfiguration[@"OpenApplicationId"]
+                  clientKey:parseAppConfiguration[@"OpenClientKey"]];
+  }
+
+  [self configureWorkloadsWithAdapter:[[ParseAdapter alloc] init]];
+}
+
+/*!
+ * The shared workloads, run through the adapter with this suite's settings.
+ */
+- (void)configureWorkloadsWithAdapter:(id<KSProviderAdapter>)adapter {
+
+  _workloads = [[KSAdapterWorkloads alloc] initWithAdapter:adapter];
+
+  _workloads.iterations         = _settings.iterations;
+  _workloads.timeout            = _settings.testTimeout;
+  _workloads.batchSizes         = _settings.batchSizes;
+  _workloads.cleanupConcurrency = _settings.teardownConcurrency;
+  _workloads.payloadIterations  = _settings.payloadIterations;
+  _workloads.payloadSizes       = _settings.payloadSizes;
+  _workloads.payloadFieldCounts = _settings.payloadFieldCounts;
+}
+
+#pragma mark - Teardown
+
+- (void)tearDown {
+  [super tearDown];
+}
+
+#pragma mark - Benchmark utilities
+
+/*!
+ * Runs the benchmark's create block with the given number of concurrent
+ * workers for LoadDuration seconds, then deletes what it created.
+ */
+- (KSLoadGenerator *)runCreateLoadWithBenchmark:(KSCRUDBenchmark *)benchmark workers:(NSUInteger)workers {
+
+  KSLoadGenerator *generator        = [KSLoadGenerator generatorWithName:[NSString stringWithFormat:@"%@.create", benchmark.entity] workers:workers];
+  KSBenchmarkIterationBlock create  = benchmark.createBlock;
+  KSBenchmarkObjectBlock remove     = benchmark.deleteBlock;
+  NSMutableArray *created           = [NSMutableArray array];
+
+  generator.targetRate       = _settings.loadTargetRate;
+  generator.duration         = _settings.loadDuration;
+  generator.operationTimeout = _settings.testTimeout;
+
+  BOOL drained = [generator runWithBlock:^(NSUInteger sequence, KSBenchmarkCompletion done) {
+    create(sequence, ^(id result, NSError *error) {
+
+      if (result && !error) {
+        @synchronized(created) {
+          [created addObject:result];
+        }
+      }
+
+      done(result, error);
+    });
+  }];
+
+  STAssertTrue(drained, @"%@ still had operations outstanding", generator.name);
+
+  NSArray *createdObjects = nil;
+
+  @synchronized(created) {
+    createdObjects = [created copy];
+  }
+
+  KSBulkDeleter *deleter = [KSBulkDeleter deleterWithConfiguration:[[ParseConfigurator sharedInstance] applicationConfiguration]];
+
+  [deleter deleteItems:createdObjects withBlock:^(id object, KSBulkDeleteCompletion done) {
+    remove(object, 0, ^(id result, NSError *error) {
+      done(error);
+    });
+  }];
+
+  // Everything the run created goes at once, so allow a timeout per round
+  // of deletes.
+  NSTimeInterval timeout = _settings.testTimeout * MAX(1, [createdObjects count] / deleter.maxConcurrentDeletes);
+  NSString *failure      = [deleter waitAndReportNamed:generator.name timeout:timeout];
+
+  if (failure) {
+    NSLog(@"%@; %lu objects left behind", failure, (unsigned long)(createdObjects.count - deleter.deletedCount));
+  }
+
+  return generator;
+}
+
+/*!
+ * Reads one PFObject with the same objectId query under each PFCachePolicy.
+ * The query cache is keyed by the query, and +clearAllCachedResults empties
+ * it. Writes are plain saves, which never go through the cache.
+ */
+- (KSCachePolicyBenchmark *)cachePolicyBenchmarkForClassName:(NSString *)className field:(NSString *)field {
+
+  KSCachePolicyBenchmark *benchmark = [[KSCachePolicyBenchmark alloc] initWithEntity:className iterations:_settings.iterations];
+  KSCRUDBenchmark *crud             = [_workloads crudBenchmarkForEntity:className field:field];
+
+  benchmark.timeout     = _settings.testTimeout;
+  benchmark.createBlock = crud.createBlock;
+  benchmark.deleteBlock = crud.deleteBlock;
+
+  [benchmark addPolicy:kPFCachePolicyIgnoreCache named:@"IgnoreCache"];
+  [benchmark addPolicy:kPFCachePolicyCacheOnly named:@"CacheOnly"];
+  [benchmark addPolicy:kPFCachePolicyNetworkOnly named:@"NetworkOnly"];
+  [benchmark addPolicy:kPFCachePolicyCacheElseNetwork named:@"CacheElseNetwork"];
+  [benchmark addPolicy:kPFCachePolicyNetworkElseCache named:@"NetworkElseCache"];
+  [benchmark addPolicy:kPFCachePolicyCacheThenNetwork named:@"CacheThenNetwork"];
+
+  benchmark.readBlock = ^(NSInteger policy, PFObject *object, KSBenchmarkCompletion done) {
+
+    PFQuery *query = [PFQuery queryWithClassName:className];
+
+    query.cachePolicy = (PFCachePolicy)policy;
+
+    [query whereKey:@"objectId" equalTo:object.objectId];
+    [query findObjectsInBackgroundWithBlock:^(NSArray *objects, NSError *error) {
+      done([[objects lastObject] objectForKey:field], error);
+    }];
+  };
+
+  benchmark.writeBlock = ^(PFObject *object, NSString *value, KSBenchmarkCompletion done) {
+
+    [object setObject:value forKey:field];
+    [object saveInBackgroundWithBlock:^(BOOL succeeded, NSError *error) {
+      done(object, error);
+    }];
+  };
+
+  benchmark.clearCacheBlock = ^(NSInteger policy) {
+    [PFQuery clearAllCachedResults];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Queues Foo saves with -saveEventually. Parse keeps the commands on disk
+ * and retries them on its own, and says nothing about how many are left, so
+ * the drain is followed by counting the class on the server. Past 10 MB of
+ * pending commands Parse drops the oldest ones.
+ */
+- (KSOfflineQueueBenchmark *)offlineQueueBenchmarkForClassName:(NSString *)className field:(NSString *)field {
+
+  KSOfflineQueueBenchmark *benchmark = [[KSOfflineQueueBenchmark alloc] initWithEntity:className field:field];
+  KSCRUDBenchmark *crud              = [_workloads crudBenchmarkForEntity:className field:field];
+  NSTimeInterval timeout             = _settings.testTimeout;
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  if ([_settings.offlineQueueSizes count] > 0) {
+    benchmark.queueSizes = _settings.offlineQueueSizes;
+  }
+
+  benchmark.enqueueBlock = ^(NSUInteger index, NSDictionary *fields) {
+
+    PFObject *object = [PFObject objectWithClassName:className];
+
+    [fields enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+      [object setObject:value forKey:key];
+    }];
+
+    [object saveEventually];
+  };
+
+  benchmark.countBlock = ^(NSString *prefix, KSBenchmarkCompletion done) {
+
+    PFQuery *query = [PFQuery queryWithClassName:className];
+
+    [query whereKey:field hasPrefix:prefix];
+    [query countObjectsInBackgroundWithBlock:^(int number, NSError *error) {
+      done(@(number), error);
+    }];
+  };
+
+  benchmark.fetchBlock = ^(NSString *prefix, KSBenchmarkCompletion done) {
+
+    NSMutableArray *objects = [NSMutableArray array];
+
+    KSPagedQuery *pages = [KSPagedQuery queryWithPageSize:1000 fetchBlock:^(NSUInteger offset, NSUInteger limit, KSPageCompletion pageDone) {
+
+      PFQuery *query = [PFQuery queryWithClassName:className];
+
+      [query whereKey:field hasPrefix:prefix];
+      [query orderByAscending:@"createdAt"];
+
+      query.limit = limit;
+      query.skip  = offset;
+
+      [query findObjectsInBackgroundWithBlock:^(NSArray *page, NSError *error) {
+        pageDone(page, error);
+      }];
+    }];
+
+    pages.timeout = timeout;
+
+    [pages enumeratePagesUsingBlock:^(NSArray *page, NSUInteger offset, BOOL *stop) {
+      [objects addObjectsFromArray:page];
+    }];
+
+    done(objects, pages.error);
+  };
+
+  benchmark.valueBlock = ^id(PFObject *object) {
+    return [object objectForKey:field];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Projects with -selectKeys: and expands the bar pointer with -includeKey:,
+ * both on a PFQuery for the objectId. Every Foo points at a Bar of its own.
+ */
+- (KSProjectionBenchmark *)projectionBenchmarkForClassName:(NSString *)className field:(NSString *)field {
+
+  KSProjectionBenchmark *benchmark = [[KSProjectionBenchmark alloc] initWithEntity:className field:field iterations:_settings.iterations];
+  KSCRUDBenchmark *crud            = [_workloads crudBenchmarkForEntity:className field:field];
+  id<KSProviderAdapter> adapter    = _workloads.adapter;
+  NSString *runTag                 = [[KSRunNamespace currentNamespace] tagValue:[[NSProcessInfo processInfo] globallyUniqueString]];
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.fieldCount         = _settings.projectionFieldCount;
+  benchmark.linkField          = @"bar";
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  benchmark.createBlock = ^(NSDictionary *fields, KSBenchmarkCompletion done) {
+    [adapter createObjectInEntity:className fields:fields completion:done];
+  };
+
+  benchmark.linkBlock = ^(NSUInteger iteration, KSBenchmarkCompletion done) {
+    [adapter createObjectInEntity:@"Bar"
+                           fields:@{@"barParameter" : [NSString stringWithFormat:@"%@-%lu", runTag, (unsigned long)iteration]}
+                       completion:done];
+  };
+
+  benchmark.linkDeleteBlock = ^(PFObject *bar, NSUInteger iteration, KSBenchmarkCompletion done) {
+    [adapter deleteObject:bar inEntity:@"Bar" completion:done];
+  };
+
+  benchmark.readBlock = ^(PFObject *object, NSArray *fields, NSUInteger depth, KSBenchmarkCompletion done) {
+
+    PFQuery *query = [PFQuery queryWithClassName:className];
+
+    if (fields) {
+      [query selectKeys:fields];
+    }
+
+    // One level per key path; a second level would be bar.<key>.
+    if (depth > 0) {
+      [query includeKey:@"bar"];
+    }
+
+    [query getObjectInBackgroundWithId:object.objectId block:^(PFObject *fetched, NSError *error) {
+      done(fetched, error);
+    }];
+  };
+
+  benchmark.fieldCountBlock = ^NSUInteger(PFObject *object) {
+    return [[object allKeys] count];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * PFFile has no way to point at an uploaded file but through the object it
+ * was saved on, so each upload saves the file and then a className object
+ * holding it under "blob", and each download fetches that object before
+ * asking its PFFile for the data. Both directions pay one small request on
+ * top of the file. The file path uploads with +fileWithName:contentsAtPath:
+ * and downloads with -getDataStreamInBackgroundWithBlock:, copying the
+ * stream to disk.
+ *
+ * Parse 1.2.6 can't delete files without the master key, so teardown only
+ * deletes the holders and the files stay with the app.
+ */
+- (KSBlobTransferBenchmark *)blobTransferBenchmarkForClassName:(NSString *)className field:(NSString *)field {
+
+  KSBlobTransferBenchmark *benchmark = [[KSBlobTransferBenchmark alloc] initWithEntity:@"PFFile" iterations:_settings.blobIterations];
+  KSCRUDBenchmark *crud              = [_workloads crudBenchmarkForEntity:className field:field];
+  id<KSProviderAdapter> adapter      = _workloads.adapter;
+  NSString *runTag                   = [[KSRunNamespace currentNamespace] tagValue:@"blob"];
+
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+
+  if ([_settings.blobSizes count] > 0) {
+    benchmark.blobSizes = _settings.blobSizes;
+  }
+
+  benchmark.deleteBlock = crud.deleteBlock;
+
+  void (^saveFile)(PFFile *, KSBenchmarkCompletion) = ^(PFFile *file, KSBenchmarkCompletion done) {
+    [file saveInBackgroundWithBlock:^(BOOL succeeded, NSError *error) {
+      if (!succeeded) {
+        done(nil, error);
+        return;
+      }
+      [adapter createObjectInEntity:className fields:@{field : runTag, @"blob" : file} completion:done];
+    }];
+  };
+
+  void (^fetchFile)(PFObject *, void (^)(PFFile *, NSError *)) = ^(PFObject *holder, void (^fetched)(PFFile *, NSError *)) {
+    [[PFQuery queryWithClassName:className] getObjectInBackgroundWithId:holder.objectId block:^(PFObject *object, NSError *error) {
+      fetched(object[@"blob"], error);
+    }];
+  };
+
+  benchmark.uploadDataBlock = ^(NSData *data, NSUInteger iteration, KSBenchmarkCompletion done) {
+    saveFile([PFFile fileWithName:@"blob.bin" data:data], done);
+  };
+
+  benchmark.uploadFileBlock = ^(NSString *path, NSUInteger iteration, KSBenchmarkCompletion done) {
+    saveFile([PFFile fileWithName:@"blob.bin" contentsAtPath:path], done);
+  };
+
+  benchmark.downloadDataBlock = ^(PFObject *holder, NSString *path, KSBenchmarkCompletion done) {
+    fetchFile(holder, ^(PFFile *file, NSError *error) {
+      if (!file) {
+        done(nil, error);
+        return;
+      }
+      [file getDataInBackgroundWithBlock:^(NSData *data, NSError *error) {
+        done(data, error);
+      }];
+    });
+  };
+
+  benchmark.downloadFileBlock = ^(PFObject *holder, NSString *path, KSBenchmarkCompletion done) {
+    fetchFile(holder, ^(PFFile *file, NSError *error) {
+      if (!file) {
+        done(nil, error);
+        return;
+      }
+      [file getDataStreamInBackgroundWithBlock:^(NSInputStream *stream, NSError *error) {
+
+        if (!stream) {
+          done(nil, error);
+          return;
+        }
+
+        NSOutputStream *output = [NSOutputStream outputStreamToFileAtPath:path append:NO];
+        uint8_t buffer[65536];
+        NSInteger read;
+
+        [stream open];
+        [output open];
+
+        while ((read = [stream read:buffer maxLength:sizeof(buffer)]) > 0) {
+          [output write:buffer maxLength:read];
+        }
+
+        [output close];
+        [stream close];
+
+        done(read < 0 ? nil : path, [stream streamError]);
+      }];
+    });
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Parse counts on the server with -countObjectsInBackgroundWithBlock: and has
+ * no sum, min, max or average, so those only run as the client fold. Pages
+ * select just the value field and are ordered by objectId, each starting
+ * after the last objectId of the page before: skip stops at 10,000.
+ */
+- (KSAggregationBenchmark *)aggregationBenchmarkForClassName:(NSString *)className field:(NSString *)field {
+
+  KSAggregationBenchmark *benchmark = [[KSAggregationBenchmark alloc] initWithEntity:className field:field valueField:@"fooValue" iterations:_settings.aggregationIterations];
+  KSCRUDBenchmark *crud             = [_workloads crudBenchmarkForEntity:className field:field];
+  id<KSProviderAdapter> adapter     = _workloads.adapter;
+  NSString *valueField              = benchmark.valueField;
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.rowCount           = _settings.aggregationRowCount;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.serverFunctions    = @[KSAggregateCount];
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  benchmark.seedBlock = ^(NSArray *fieldsList, KSBenchmarkCompletion done) {
+    [adapter createObjectsInEntity:className fieldsList:fieldsList completion:done];
+  };
+
+  benchmark.valueBlock = ^NSNumber *(PFObject *object) {
+    return object[valueField];
+  };
+
+  benchmark.pageBlock = ^(NSString *tag, PFObject *lastObject, NSUInteger offset, NSUInteger limit, KSPageCompletion done) {
+
+    PFQuery *query = [PFQuery queryWithClassName:className];
+
+    [query whereKey:field equalTo:tag];
+    [query selectKeys:@[valueField]];
+    [query orderByAscending:@"objectId"];
+
+    if (lastObject) {
+      [query whereKey:@"objectId" greaterThan:lastObject.objectId];
+    }
+
+    query.limit = limit;
+
+    [query findObjectsInBackgroundWithBlock:^(NSArray *objects, NSError *error) {
+      done(objects, error);
+    }];
+  };
+
+  benchmark.serverBlock = ^(NSString *tag, NSString *function, KSBenchmarkCompletion done) {
+
+    PFQuery *query = [PFQuery queryWithClassName:className];
+
+    [query whereKey:field equalTo:tag];
+
+    [query countObjectsInBackgroundWithBlock:^(int count, NSError *error) {
+      done(error ? nil : @(count), error);
+    }];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Foo objects keep their PFGeoPoint in location. Radius queries use
+ * -whereKey:nearGeoPoint:withinKilometers:, which also sorts by distance,
+ * box queries -whereKey:withinGeoBoxFromSouthwest:toNortheast:. Parse
+ * returns at most 1,000 objects a query.
+ */
+- (KSGeoQueryBenchmark *)geoQueryBenchmarkForClassName:(NSString *)className field:(NSString *)field {
+
+  KSGeoQueryBenchmark *benchmark = [[KSGeoQueryBenchmark alloc] initWithEntity:className field:field locationField:@"location" iterations:_settings.geoIterations];
+  KSCRUDBenchmark *crud          = [_workloads crudBenchmarkForEntity:className field:field];
+  id<KSProviderAdapter> adapter  = _workloads.adapter;
+  NSString *locationField        = benchmark.locationField;
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  if ([_settings.geoRowCounts count] > 0) {
+    benchmark.rowCounts = _settings.geoRowCounts;
+  }
+
+  benchmark.pointBlock = ^id(double latitude, double longitude) {
+    return [PFGeoPoint geoPointWithLatitude:latitude longitude:longitude];
+  };
+
+  benchmark.seedBlock = ^(NSArray *fieldsList, KSBenchmarkCompletion done) {
+    [adapter createObjectsInEntity:className fieldsList:fieldsList completion:done];
+  };
+
+  void (^find)(PFQuery *, NSString *, NSUInteger, KSBenchmarkCompletion) = ^(PFQuery *query, NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    [query whereKey:field equalTo:tag];
+
+    query.limit = limit;
+
+    [query findObjectsInBackgroundWithBlock:^(NSArray *objects, NSError *error) {
+      done(objects, error);
+    }];
+  };
+
+  benchmark.radiusBlock = ^(NSString *tag, double latitude, double longitude, double kilometers, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    PFQuery *query = [PFQuery queryWithClassName:className];
+
+    [query whereKey:locationField nearGeoPoint:[PFGeoPoint geoPointWithLatitude:latitude longitude:longitude] withinKilometers:kilometers];
+
+    find(query, tag, limit, done);
+  };
+
+  benchmark.boxBlock = ^(NSString *tag, double southLatitude, double westLongitude, double northLatitude, double eastLongitude, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    PFQuery *query = [PFQuery queryWithClassName:className];
+
+    [query whereKey:locationField
+        withinGeoBoxFromSouthwest:[PFGeoPoint geoPointWithLatitude:southLatitude longitude:westLongitude]
+                      toNortheast:[PFGeoPoint geoPointWithLatitude:northLatitude longitude:eastLongitude]];
+
+    find(query, tag, limit, done);
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Every shape is a PFQuery on the run's tag: -whereKey:equalTo:, a
+ * greaterThanOrEqualTo:/lessThan: pair, -whereKey:containedIn:,
+ * -whereKey:matchesRegex:, +orQueryWithSubqueries: over two tagged queries,
+ * and -orderByAscending: with -addDescendingOrder:.
+ */
+- (KSQueryShapeBenchmark *)queryShapeBenchmarkForClassName:(NSString *)className field:(NSString *)field {
+
+  KSQueryShapeBenchmark *benchmark = [[KSQueryShapeBenchmark alloc] initWithEntity:className field:field iterations:_settings.queryIterations];
+  KSCRUDBenchmark *crud            = [_workloads crudBenchmarkForEntity:className field:field];
+  id<KSProviderAdapter> adapter    = _workloads.adapter;
+  NSString *categoryField          = benchmark.categoryField;
+  NSString *valueField             = benchmark.valueField;
+  NSString *nameField              = benchmark.nameField;
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  if ([_settings.queryRowCounts count] > 0) {
+    benchmark.rowCounts = _settings.queryRowCounts;
+  }
+
+  benchmark.seedBlock = ^(NSArray *fieldsList, KSBenchmarkCompletion done) {
+    [adapter createObjectsInEntity:className fieldsList:fieldsList completion:done];
+  };
+
+  benchmark.valueBlock = ^id(PFObject *object, NSString *valueName) {
+    return object[valueName];
+  };
+
+  PFQuery *(^tagged)(NSString *) = ^PFQuery *(NSString *tag) {
+
+    PFQuery *query = [PFQuery queryWithClassName:className];
+
+    [query whereKey:field equalTo:tag];
+
+    return query;
+  };
+
+  void (^find)(PFQuery *, NSUInteger, KSBenchmarkCompletion) = ^(PFQuery *query, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    query.limit = limit;
+
+    [query findObjectsInBackgroundWithBlock:^(NSArray *objects, NSError *error) {
+      done(objects, error);
+    }];
+  };
+
+  [benchmark addShape:KSQueryShapeEquality block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    PFQuery *query = tagged(tag);
+
+    [query whereKey:categoryField equalTo:@"category-3"];
+
+    find(query, limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeRange block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    PFQuery *query = tagged(tag);
+
+    [query whereKey:valueField greaterThanOrEqualTo:@100];
+    [query whereKey:valueField lessThan:@200];
+
+    find(query, limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeContainedIn block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    PFQuery *query = tagged(tag);
+
+    [query whereKey:categoryField containedIn:@[@"category-1", @"category-5", @"category-7"]];
+
+    find(query, limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeRegex block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    PFQuery *query = tagged(tag);
+
+    [query whereKey:nameField matchesRegex:@"^3-"];
+
+    find(query, limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeOr block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    PFQuery *category = tagged(tag);
+    PFQuery *value    = tagged(tag);
+
+    [category whereKey:categoryField equalTo:@"category-2"];
+    [value whereKey:valueField lessThan:@50];
+
+    find([PFQuery orQueryWithSubqueries:@[category, value]], limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeSort block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    PFQuery *query = tagged(tag);
+
+    [query orderByAscending:categoryField];
+    [query addDescendingOrder:valueField];
+
+    find(query, limit, done);
+  }];
+
+  return benchmark;
+}
+
+/*!
+ * Reads are a PFQuery on the benchmark field. PFQuery keeps its constraints
+ * to itself, so the cache key is built from the class, constraint and limit
+ * the query was given, in the shape of the find request's parameters.
+ */
+- (KSQueryCacheBenchmark *)queryCacheBenchmarkForClassName:(NSString *)className field:(NSString *)field {
+
+  KSQueryCacheBenchmark *benchmark = [[KSQueryCacheBenchmark alloc] initWithAdapter:_workloads.adapter entity:className field:field operations:_settings.queryCacheOperations];
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.readRatio          = _settings.queryCacheReadRatio;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+
+  benchmark.readBlock = ^(NSString *value, KSQueryCache *cache, KSBenchmarkCompletion done) {
+
+    PFQuery *query = [PFQuery queryWithClassName:className];
+
+    [query whereKey:field equalTo:value];
+
+    KSQueryCacheFetchBlock fetch = ^(KSBenchmarkCompletion fetched) {
+      [query findObjectsInBackgroundWithBlock:^(NSArray *objects, NSError *error) {
+        fetched(objects, error);
+      }];
+    };
+
+    if (!cache) {
+      fetch(done);
+      return;
+    }
+
+    NSString *key = [NSString stringWithFormat:@"%@?where={\"%@\":\"%@\"}&limit=%ld", className, field, value, (long)query.limit];
+
+    [cache readEntity:className key:key fetch:fetch completion:done];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * The Parse SDK keeps one client per process, set up by
+ * +setApplicationId:clientKey:, so there is only the one to run through.
+ */
+- (KSConnectionReuseBenchmark *)connectionReuseBenchmarkForClassName:(NSString *)className field:(NSString *)field {
+
+  KSConnectionReuseBenchmark *benchmark = [[KSConnectionReuseBenchmark alloc] initWithEntity:className field:field operations:_settings.connectionReuseOperations];
+
+  benchmark.timeout = _settings.testTimeout;
+  benchmark.idleGap = _settings.connectionReuseIdleGap;
+
+  [benchmark addClient:@"shared" adapter:_workloads.adapter];
+
+  return benchmark;
+}
+
+/*!
+ * The Parse SDK has no retry settings, so only its own behaviour runs,
+ * through the adapter's query.
+ *
+ * Fault rates missing from the configuration keep the benchmark's defaults.
+ */
+- (KSFaultInjectionBenchmark *)faultInjectionBenchmarkForClassName:(NSString *)className field:(NSString *)field {
+
+  KSFaultInjectionBenchmark *benchmark = [[KSFaultInjectionBenchmark alloc] initWithEntity:className field:field operations:_settings.faultInjectionOperations];
+
+  benchmark.timeout = _settings.testTimeout;
+
+  if (_settings.faultServiceUnavailableRate) {
+    benchmark.serviceUnavailableRate = [_settings.faultServiceUnavailableRate doubleValue];
+  }
+
+  if (_settings.faultResetRate) {
+    benchmark.resetRate = [_settings.faultResetRate doubleValue];
+  }
+
+  if (_settings.faultLatencySpikeRate) {
+    benchmark.latencySpikeRate = [_settings.faultLatencySpikeRate doubleValue];
+  }
+
+  if (_settings.faultLatencySpike) {
+    benchmark.latencySpike = [_settings.faultLatencySpike doubleValue];
+  }
+
+  id<KSProviderAdapter> adapter = _workloads.adapter;
+
+  [benchmark addVariant:@"default" block:^(NSString *value, KSBenchmarkCompletion done) {
+    [adapter queryEntity:className whereField:field equals:value completion:done];
+  }];
+
+  return benchmark;
+}
+
+/*!
+ * Loads ParseConfiguration.plist the way ParseConfigurator does, hands the
+ * keys to +setApplicationId:clientKey: and finds one Foo. Parse keeps the
+ * keys process-wide and has nothing to tear down, so warm passes measure what
+ * each functional test pays for calling +initializeParse again.
+ */
+- (KSStartupBenchmark *)startupBenchmark {
+
+  KSStartupBenchmark *benchmark       = [[KSStartupBenchmark alloc] initWithProvider:@"Parse" passes:_settings.startupPasses];
+  __block NSDictionary *configuration = nil;
+
+  benchmark.timeout = _settings.testTimeout;
+
+  [benchmark addPhase:@"configuration" block:^(NSUInteger pass, KSBenchmarkCompletion done) {
+
+    NSString *path = [[NSBundle bundleForClass:[ParseConfigurator class]] pathForResource:@"ParseConfiguration" ofType:@"plist"];
+
+    configuration = [NSDictionary dictionaryWithContentsOfFile:path];
+
+    done(configuration, nil);
+  }];
+
+  [benchmark addPhase:@"client" block:^(NSUInteger pass, KSBenchmarkCompletion done) {
+
+    NSString *prefix = [configuration[@"UseSecure"] boolValue] ? @"Secure" : @"Open";
+
+    [Parse setApplicationId:configuration[[prefix stringByAppendingString:@"ApplicationId"]]
+                  clientKey:configuration[[prefix stringByAppendingString:@"ClientKey"]]];
+
+    done(nil, nil);
+  }];
+
+  [benchmark addPhase:@"first_request" block:^(NSUInteger pass, KSBenchmarkCompletion done) {
+
+    PFQuery *query = [PFQuery queryWithClassName:@"Foo"];
+
+    query.limit = 1;
+
+    [query findObjectsInBackgroundWithBlock:^(NSArray *objects, NSError *error) {
+      done(objects, error);
+    }];
+  }];
+
+  return benchmark;
+}
+
+/*!
+ * Runs one test's benchmark through the shared settings, which write the
+ * report where BenchmarkReportDirectory points, and fails the test if it
+ * raised or the report could not be written.
+ */
+- (void)runBenchmark:(NSString *)benchmark test:(SEL)test block:(KSBenchmarkBlock)block {
+
+  NSString *failure = [_settings runBenchmark:benchmark provider:@"Parse" test:test block:block];
+
+  STAssertNil(failure, @"%@", failure);
+}
+
+#pragma mark - Startup benchmarks
+
+/*!
+ * Times loading the configuration, setting up the SDK and the first request
+ * to Foo, StartupPasses times. The first pass is reported as cold, and the
+ * report records how long the test process had been up, since earlier tests
+ * may already have warmed the SDK.
+ */
+- (void)test_050_Cold_Start {
+
+  [self runBenchmark:@"startup" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    KSStartupBenchmark *benchmark = [self startupBenchmark];
+
+    [report setParameter:@(benchmark.passes) forKey:@"passes"];
+    [report setParameter:@([KSStartupBenchmark processUptime]) forKey:@"process_uptime_s"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Parse startup phases failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Latency benchmarks
+
+/*!
+ * Measures p50/p95/p99 latency and throughput of create, read by id, query,
+ * update and delete for Foo and Bar.
+ *
+ * Each entity also gets a wire trace: DNS, connect, time to first byte and
+ * transfer per request, and how much of the operation time was spent on the
+ * wire rather than in the SDK.
+ */
+- (void)test_100_CRUD_Latency {
+
+  [self runBenchmark:@"crud_latency" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeParse];
+
+    [report setParameter:@(_settings.iterations) forKey:@"iterations"];
+
+    NSDictionary *fields = @{@"Foo" : @"fooParameter", @"Bar" : @"barParameter"};
+
+    for (NSString *className in @[@"Foo", @"Bar"]) {
+
+      KSCRUDBenchmark *benchmark = [_workloads crudBenchmarkForEntity:className field:fields[className]];
+
+      [KSWireTrace start];
+      [benchmark runWithReport:report];
+      [KSWireTrace stop];
+
+      [KSWireTrace addToReport:report operations:benchmark.histograms attributes:@{@"entity" : benchmark.entity}];
+
+      STAssertTrue(benchmark.errorCount == 0, @"%lu %@ operations failed", (unsigned long)benchmark.errorCount, className);
+    }
+  }];
+}
+
+#pragma mark - Load benchmarks
+
+/*!
+ * Creates Foo objects as fast as LoadWorkers concurrent workers allow (or at
+ * LoadTargetRate) and reports achieved throughput, error rate and latency
+ * at each worker count.
+ */
+- (void)test_110_Create_Throughput_Under_Load {
+
+  [self runBenchmark:@"load" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeParse];
+
+    [report setParameter:_settings.loadWorkers forKey:@"workers"];
+    [report setParameter:@(_settings.loadTargetRate) forKey:@"target_rate"];
+    [report setParameter:@(_settings.loadDuration) forKey:@"duration_s"];
+
+    KSCRUDBenchmark *benchmark = [_workloads crudBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    for (NSNumber *workers in _settings.loadWorkers) {
+
+      KSLoadGenerator *generator = [self runCreateLoadWithBenchmark:benchmark workers:[workers unsignedIntegerValue]];
+
+      if(_settings.showLogs) NSLog(@"%@", generator);
+
+      [generator addToReport:report];
+    }
+  }];
+}
+
+#pragma mark - Batch write benchmarks
+
+/*!
+ * Saves BatchSizes Foo objects one at a time, then again through
+ * +saveAllInBackground:block:.
+ * Reports objects/sec and bytes on the wire for both paths.
+ */
+- (void)test_120_Batch_Write {
+
+  [self runBenchmark:@"batch_write" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeParse];
+
+    [report setParameter:_settings.batchSizes forKey:@"batch_sizes"];
+
+    KSBatchWriteBenchmark *benchmark = [_workloads batchWriteBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo saves failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Cache policy benchmarks
+
+/*!
+ * Reads a Foo under every PFCachePolicy, reporting cold and warm latency, hit
+ * ratio and how stale the answers were after a write.
+ */
+- (void)test_130_Cache_Policy_Matrix {
+
+  [self runBenchmark:@"cache_policy" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeParse];
+
+    [report setParameter:@(_settings.iterations) forKey:@"iterations"];
+
+    KSCachePolicyBenchmark *benchmark = [self cachePolicyBenchmarkForClassName:@"Foo" field:@"fooParameter"];
+
+    BOOL completed = [benchmark runWithReport:report];
+
+    STAssertTrue(completed, @"%lu Foo creates or writes failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Payload scaling benchmarks
+
+/*!
+ * Creates and reads Foo objects as the field grows from 100 B to 1 MB and as
+ * the field count grows from 1 to 500, and reports latency, JSON
+ * serialisation cost and wire time at each step.
+ */
+- (void)test_140_Payload_Scaling {
+
+  [self runBenchmark:@"payload_scaling" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeParse];
+
+    KSPayloadScalingBenchmark *benchmark = [_workloads payloadScalingBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.payloadIterations) forKey:@"iterations"];
+    [report setParameter:benchmark.payloadSizes forKey:@"payload_sizes"];
+    [report setParameter:benchmark.fieldCounts forKey:@"field_counts"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo payload operations failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Offline queue benchmarks
+
+/*!
+ * Queues 10 to 10,000 Foo saves with -saveEventually while the backend is
+ * away, then brings it back. Reports enqueue cost, the queue's size on disk,
+ * drain time and rate, and lost, duplicated and reordered writes.
+ */
+- (void)test_150_Offline_Queue {
+
+  [self runBenchmark:@"offline_queue" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeParse];
+
+    KSOfflineQueueBenchmark *benchmark = [self offlineQueueBenchmarkForClassName:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:benchmark.queueSizes forKey:@"queue_sizes"];
+    [report setParameter:@(benchmark.valueSize) forKey:@"value_size"];
+
+    [benchmark runWithReport:report];
+
+    if(_settings.showLogs && benchmark.lostCount > 0) {
+      NSLog(@"%lu queued Foo writes never arrived", (unsigned long)benchmark.lostCount);
+    }
+  }];
+}
+
+#pragma mark - Projection benchmarks
+
+/*!
+ * Reads 200-field Foo objects whole, with only fooParameter selected and with
+ * the Bar they point at included, and reports latency, bytes received and
+ * decode time for each.
+ */
+- (void)test_180_Field_Projection {
+
+  [self runBenchmark:@"projection" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeParse];
+
+    KSProjectionBenchmark *benchmark = [self projectionBenchmarkForClassName:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.iterations) forKey:@"iterations"];
+    [report setParameter:@(benchmark.fieldCount) forKey:@"fields"];
+    [report setParameter:benchmark.projectedFields forKey:@"projected_fields"];
+    [report setParameter:@(benchmark.expandDepth) forKey:@"expand_depth"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo projection saves or reads failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Blob transfer benchmarks
+
+/*!
+ * Uploads and downloads 1 KB to 100 MB PFFiles as NSData and through files
+ * on disk, and reports MB/s, peak resident memory and, against the stand-in,
+ * what happens when the connection drops mid-transfer.
+ */
+- (void)test_190_Blob_Transfer {
+
+  [self runBenchmark:@"blob_transfer" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeParse];
+
+    KSBlobTransferBenchmark *benchmark = [self blobTransferBenchmarkForClassName:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.blobIterations) forKey:@"iterations"];
+    [report setParameter:benchmark.blobSizes forKey:@"blob_sizes"];
+    [report setParameter:@(benchmark.dropSize) forKey:@"drop_size"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu PFFile transfers failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Aggregation benchmarks
+
+/*!
+ * Counts a 100,000-object Foo dataset with -countObjects and by downloading
+ * every row, and folds sum, min, max and average on the client, reporting
+ * how much faster the server count is and what each way downloads.
+ */
+- (void)test_200_Aggregation {
+
+  [self runBenchmark:@"aggregation" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeParse];
+
+    KSAggregationBenchmark *benchmark = [self aggregationBenchmarkForClassName:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.aggregationIterations) forKey:@"iterations"];
+    [report setParameter:@(benchmark.rowCount) forKey:@"rows"];
+    [report setParameter:@(benchmark.pageSize) forKey:@"page_size"];
+    [report setParameter:benchmark.serverFunctions forKey:@"server_functions"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo aggregation saves or reads failed or came back wrong", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Geo query benchmarks
+
+/*!
+ * Seeds 10,000 to 1,000,000 located Foo objects around San Francisco and
+ * reports radius and bounding-box query latency and result sizes at each
+ * density.
+ */
+- (void)test_210_Geo_Query {
+
+  [self runBenchmark:@"geo_query" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeParse];
+
+    KSGeoQueryBenchmark *benchmark = [self geoQueryBenchmarkForClassName:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.geoIterations) forKey:@"iterations"];
+    [report setParameter:benchmark.rowCounts forKey:@"row_counts"];
+    [report setParameter:benchmark.radii forKey:@"radii_km"];
+    [report setParameter:@(benchmark.regionSpan) forKey:@"region_span_degrees"];
+    [report setParameter:@(benchmark.resultLimit) forKey:@"result_limit"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo geo saves or queries failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Query shape benchmarks
+
+/*!
+ * Runs equality, range, containedIn, regex, OR and two-key sort queries over
+ * 1,000 to 100,000 Foo objects and reports how each one's latency grows with
+ * the class, to find the shapes Parse answers with a full scan.
+ */
+- (void)test_220_Query_Shapes {
+
+  [self runBenchmark:@"query_shapes" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeParse];
+
+    KSQueryShapeBenchmark *benchmark = [self queryShapeBenchmarkForClassName:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.queryIterations) forKey:@"iterations"];
+    [report setParameter:benchmark.rowCounts forKey:@"row_counts"];
+    [report setParameter:benchmark.shapes forKey:@"shapes"];
+    [report setParameter:@(benchmark.resultLimit) forKey:@"result_limit"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo query shape saves or queries failed or returned the wrong objects", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Query cache benchmarks
+
+/*!
+ * Replays a read-heavy mix of Foo list queries and saves straight against
+ * Parse and again through KSQueryCache, which PFCachePolicy can't stand in
+ * for because no write ever invalidates it, and reports the hit rate and
+ * the requests and read time the cache saved.
+ */
+- (void)test_230_Query_Cache {
+
+  [self runBenchmark:@"query_cache" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeParse];
+
+    KSQueryCacheBenchmark *benchmark = [self queryCacheBenchmarkForClassName:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(benchmark.operations) forKey:@"operations"];
+    [report setParameter:@(benchmark.readRatio) forKey:@"read_ratio"];
+    [report setParameter:@(benchmark.keyCount) forKey:@"key_count"];
+    [report setParameter:@(benchmark.objectsPerKey) forKey:@"objects_per_key"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo query cache operations failed or read stale lists", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Connection reuse benchmarks
+
+/*!
+ * Counts the TCP and TLS handshakes the Parse SDK makes per 1000 Foo
+ * queries, sequentially, concurrently and in bursts with idle gaps between
+ * them. Needs StandInMode Replay.
+ */
+- (void)test_240_Connection_Reuse {
+
+  [self runBenchmark:@"connection_reuse" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeParse];
+
+    KSConnectionReuseBenchmark *benchmark = [self connectionReuseBenchmarkForClassName:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(benchmark.operations) forKey:@"operations"];
+    [report setParameter:@(benchmark.concurrency) forKey:@"concurrency"];
+    [report setParameter:@(benchmark.burstSize) forKey:@"burst_size"];
+    [report setParameter:@(benchmark.idleBursts) forKey:@"idle_bursts"];
+    [report setParameter:@(benchmark.idleGap) forKey:@"idle_gap_s"];
+
+    [benchmark runWithReport:report];
+
+    if (benchmark.skipped) {
+      if(_settings.showLogs) NSLog(@"StandInMode isn't Replay, skipping %@", NSStringFromSelector(_cmd));
+      *discard = YES;
+      return;
+    }
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo queries failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Fault injection benchmarks
+
+/*!
+ * Runs Foo queries through the Parse SDK while the stand-in answers some
+ * requests with 503s, resets others and holds others back, and reports
+ * tail latency, success rate and the requests its retries add.
+ * Needs StandInMode Record or Replay.
+ */
+- (void)test_250_Fault_Injection {
+
+  [self runBenchmark:@"fault_injection" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self initializeParse];
+
+    KSFaultInjectionBenchmark *benchmark = [self faultInjectionBenchmarkForClassName:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(benchmark.operations) forKey:@"operations"];
+    [report setParameter:@(benchmark.concurrency) forKey:@"concurrency"];
+    [report setParameter:@(benchmark.serviceUnavailableRate) forKey:@"service_unavailable_rate"];
+    [report setParameter:@(benchmark.resetRate) forKey:@"reset_rate"];
+    [report setParameter:@(benchmark.latencySpikeRate) forKey:@"latency_spike_rate"];
+    [report setParameter:@(benchmark.latencySpike) forKey:@"latency_spike_s"];
+
+    [benchmark runWithReport:report];
+
+    if (benchmark.skipped) {
+      if(_settings.showLogs) NSLog(@"StandInMode is Off, skipping %@", NSStringFromSelector(_cmd));
+      *discard = YES;
+      return;
+    }
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo queries failed without faults", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+@end
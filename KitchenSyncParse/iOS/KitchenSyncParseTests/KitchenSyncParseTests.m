@@ -8,15 +8,26 @@
 #import "Foo.h"
 #import "Bar.h"
 #import "ParseConfigurator.h"
+#import "KSBulkDeleter.h"
+#import "KSPagedQuery.h"
+#import "KSRandomString.h"
+#import "KSRunNamespace.h"
 
 @interface KitchenSyncParseTests()
 
 @property (nonatomic, assign) BOOL showLogs;
 @property (nonatomic, assign) BOOL usingSecureBackend;
+@property (nonatomic, assign) NSTimeInterval testTimeout;
+@property (nonatomic, strong) NSDictionary *configuration;
+@property (nonatomic, assign) BOOL deleteAllTestDataEnabled;
+@property (nonatomic, strong) KSRunNamespace *runNamespace;
 
 - (void)deleteAllTestData;
+- (void)deleteRunTestData;
 - (void)deleteAllFoo;
 - (void)deleteAllBar;
+- (void)deleteAllObjectsOfClass:(NSString *)className;
+- (void)deleteAllObjectsOfClass:(NSString *)className taggedInKey:(NSString *)key;
 - (NSString *)randomString:(int)numCharacters;
 + (void)initializeParse;
 
@@ -54,9 +65,17 @@
     _showLogs           = [parseAppConfiguration[@"ShowLogs"] boolValue];
     _usingSecureBackend = [parseAppConfiguration[@"UseSecure"] boolValue];
 
-    [Foo registerSubclass];
+    _testTimeout         = [parseAppConfiguration[@"TestTimeout"] doubleValue];
+    _configuration       = parseAppConfiguration;
+
+    _deleteAllTestDataEnabled = [parseAppConfiguration[@"DeleteAllTestData"] boolValue];
+    _runNamespace             = [KSRunNamespace currentNamespace];
+
+    if (_testTimeout <= 0) {
+      _testTimeout = 30.0;
+    }
 
-    [self deleteAllTestData];
+    [Foo registerSubclass];
 }
 
 #pragma mark - Teardown
@@ -78,16 +97,24 @@
     }
 }
 
+/*!
+ This method deletes the Foo and Bar objects this run tagged.
+ */
+- (void) deleteRunTestData {
+    @try {
+        [self deleteAllObjectsOfClass:@"Foo" taggedInKey:@"fooParameter"];
+        [self deleteAllObjectsOfClass:@"Bar" taggedInKey:@"barParameter"];
+    } @catch (NSException * e) {
+        NSLog(@"deleteRunTestData failed: %@", [e description]);
+    }
+}
+
 /*!
  This method deletes all Foo objects from the backend.
  */
 - (void) deleteAllFoo {
     @try {
-        PFQuery *query = [PFQuery queryWithClassName:@"Foo"];
-        NSArray *foos = [query findObjects];
-        for (id obj in foos) {
-            [obj delete];
-        }
+        [self deleteAllObjectsOfClass:@"Foo"];
     } @catch (NSException * e) {
         NSLog(@"deleteAllFoo failed: %@", [e description]);
     }
@@ -98,18 +125,89 @@
  */
 - (void) deleteAllBar {
     @try {
-        PFQuery *query = [PFQuery queryWithClassName:@"Bar"];
-        NSArray *bars = [query findObjects];
-        for (id obj in bars) {
-            [obj delete];
-        }
+        [self deleteAllObjectsOfClass:@"Bar"];
     } @catch (NSException * e) {
         NSLog(@"deleteAllBar failed: %@", [e description]);
     }
 }
 
+/*!
+ * Deletes every object of the class, a page at a time, keeping
+ * TeardownConcurrency deletes in flight. Parse 1.2.6 has no batch delete,
+ * so each object is deleted with its own background request. Only one page
+ * of objects is held at a time.
+ */
+- (void)deleteAllObjectsOfClass:(NSString *)className {
+    [self deleteAllObjectsOfClass:className taggedInKey:nil];
+}
+
+/*!
+ * Same as -deleteAllObjectsOfClass:, limited to the objects whose key
+ * starts with this run's prefix when key is given.
+ */
+- (void)deleteAllObjectsOfClass:(NSString *)className taggedInKey:(NSString *)key {
+
+    NSString *prefix = _runNamespace.valuePrefix;
+
+    KSPagedQuery *pages = [KSPagedQuery queryWithPageSize:1000 fetchBlock:^(NSUInteger offset, NSUInteger limit, KSPageCompletion done) {
+
+        PFQuery *query = [PFQuery queryWithClassName:className];
+
+        if (key) {
+            [query whereKey:key hasPrefix:prefix];
+        }
+
+        query.limit = limit;
+        query.skip  = offset;
+
+        [query findObjectsInBackgroundWithBlock:^(NSArray *objects, NSError *error) {
+            done(objects, error);
+        }];
+    }];
+
+    pages.timeout       = _testTimeout;
+    pages.consumesPages = YES;
+
+    BOOL completed = [pages enumeratePagesUsingBlock:^(NSArray *page, NSUInteger offset, BOOL *stop) {
+
+        KSBulkDeleter *deleter = [KSBulkDeleter deleterWithConfiguration:_configuration];
+
+        [deleter deleteItems:page withBlock:^(PFObject *obj, KSBulkDeleteCompletion done) {
+            [obj deleteInBackgroundWithBlock:^(BOOL succeeded, NSError *error) {
+                done(error);
+            }];
+        }];
+
+        NSString *failure = [deleter waitAndReportNamed:className timeout:_testTimeout];
+        STAssertNil(failure, @"%@", failure);
+
+        // Don't keep re-reading a page that can't be deleted.
+        if (deleter.failedCount > 0 || deleter.deletedCount < [page count]) {
+            *stop = YES;
+        }
+    }];
+
+    if (!completed && _showLogs) {
+        NSLog(@"reading %@ failed: %@", className, [pages.error description]);
+    }
+}
+
 #pragma mark - Setup and configuration tests
 
+/*!
+ * Empties Foo and Bar of every run's objects, including ones other runs
+ * are still using, so it only runs with DeleteAllTestData set.
+ */
+- (void)test_000_Delete_All_Test_Data {
+
+  if (!_deleteAllTestDataEnabled) {
+    NSLog(@"DeleteAllTestData is off, leaving other runs' data alone");
+    return;
+  }
+
+  [self deleteAllTestData];
+}
+
 /*!
  * Tests the ability to access data without authentication key if allowed.
  */
@@ -118,7 +216,7 @@
     @try {
         // create a foo object
         Foo * foo = [[Foo alloc] init];
-        foo.fooParameter = @"Testing public access";
+        foo.fooParameter = [_runNamespace tagValue:@"Testing public access"];
         if(_showLogs) NSLog(@"test_100_Public_Access Foo : foo before save = %@",
                            [foo description]);
         // create an object to make sure backend is really working
@@ -150,7 +248,7 @@
     @try {
         // create a foo object
         Foo * foo = [[Foo alloc] init];
-        foo.fooParameter = @"Testing secure access";
+        foo.fooParameter = [_runNamespace tagValue:@"Testing secure access"];
         if(_showLogs) NSLog(@"test_101_Secure_Access Foo : foo before save = %@",
                            [foo description]);
         // create an object to make sure backend is really working
@@ -267,7 +365,7 @@
   
     @try {
         Foo * f1 = [[Foo alloc] init];
-        f1.fooParameter = @"Some string in a Foo : NSObject object";
+        f1.fooParameter = [_runNamespace tagValue:@"Some string in a Foo : NSObject object"];
         if(_showLogs) NSLog(@"test_101_Multiple_Backends Foo : f1 before save = %@",
                            [f1 description]);
         // create the object
@@ -278,7 +376,7 @@
                            [f1 description]);
         if(_parse_secure) {
             Foo * f2 = [[Foo alloc] init];
-            f2.fooParameter = @"Some string in a Foo : NSObject object";
+            f2.fooParameter = [_runNamespace tagValue:@"Some string in a Foo : NSObject object"];
             if(_showLogs) NSLog(@"test_101_Multiple_Backends Foo : f2 before save = %@",
                                [f2 description]);
             // create the object
@@ -312,9 +410,9 @@
   
     @try {
         Foo * foo = [[Foo alloc] init];
-        foo.fooParameter = @"Foo : NSObject object";
+        foo.fooParameter = [_runNamespace tagValue:@"Foo : NSObject object"];
         // or, if you prefer
-        [foo setFooParameter:@"Foo : NSObject object"];
+        [foo setFooParameter:[_runNamespace tagValue:@"Foo : NSObject object"]];
         if(_showLogs) NSLog(@"test_200_Foo_ObjCClass Foo : foo before save = %@",
                            [foo description]);
         // create the object
@@ -336,7 +434,7 @@
   
     @try {
         PFObject * foo = [PFObject objectWithClassName:@"Foo"];
-        [foo setValue:@"PFObject with ClassName Foo" forKey:@"fooParameter"];
+        [foo setValue:[_runNamespace tagValue:@"PFObject with ClassName Foo"] forKey:@"fooParameter"];
         if(_showLogs) NSLog(@"test_201_Foo_Schemaless Foo * foo before save = %@",
                            [foo description]);
         // create the object
@@ -378,7 +476,7 @@
         if(!_usingSecureBackend) {
             NSString * memberName = [self randomString:5];
             PFObject * foo = [PFObject objectWithClassName:@"Foo"];
-            [foo setValue:@"PFObject with ClassName Foo" forKey:@"fooParameter"];
+            [foo setValue:[_runNamespace tagValue:@"PFObject with ClassName Foo"] forKey:@"fooParameter"];
             [foo setValue:@"a schemaless addition" forKey:memberName];
             if(_showLogs) NSLog(@"test_204_New_Member_Allowed NSDictionary : foo before save = %@",
                                [foo description]);
@@ -409,7 +507,7 @@
         if(_usingSecureBackend) {
             NSString * memberName = [self randomString:5];
             PFObject * foo = [PFObject objectWithClassName:@"Foo"];
-            [foo setValue:@"PFObject with ClassName Foo" forKey:@"fooParameter"];
+            [foo setValue:[_runNamespace tagValue:@"PFObject with ClassName Foo"] forKey:@"fooParameter"];
             [foo setValue:@"a schemaless addition" forKey:memberName];
             if(_showLogs) NSLog(@"test_205_New_Member_Disallowed NSDictionary : foo before save = %@",
                                [foo description]);
@@ -435,7 +533,7 @@
   
     @try {
         Foo * foo = [[Foo alloc] init];
-        foo.fooParameter = @"Foo : NSObject object";
+        foo.fooParameter = [_runNamespace tagValue:@"Foo : NSObject object"];
         if(_showLogs) NSLog(@"\r\n\t test_206_Metadata_Provided f1 before save = %@",[foo description]);
         // create the object
         NSError * crudError;
@@ -469,21 +567,23 @@
     STFail(@"Parse does not support Core Data");
 }
 
+#pragma mark - Run cleanup
+
+/*!
+ * Runs last and removes what this run wrote, in one scoped query per class.
+ */
+- (void)test_999_Delete_Run_Data {
+  [self deleteRunTestData];
+}
+
 #pragma mark - Sample data utilities
 
 /*!
- Generates a random string of up to 1000 characters in length. Generates a random length up to 1000 if numCharacters is set to 0.
+ Generates a random string of numCharacters characters. Generates a random length up to 1000 if numCharacters is set to 0.
  */
 -(NSString *)randomString:(int)numCharacters {
-    static char const possibleChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
-    int len;
-    if(numCharacters > 1000 || numCharacters == 0) len = (int)rand() % (1000);
-    else len = numCharacters;
-    unichar characters[len];
-    for( int i=0; i < len; ++i ) {
-        characters[i] = possibleChars[arc4random_uniform(sizeof(possibleChars)-1)];
-    }
-    return [NSString stringWithCharacters:characters length:len] ;
+    int len = numCharacters > 0 ? numCharacters : (int)rand() % (1000);
+    return KSRandomString(len);
 }
 
 @end
@@ -0,0 +1,18 @@
+//
+//  ParseAdapter.h
+//  KitchenSyncParseTests
+//
+//
+
+#import <Foundation/Foundation.h>
+#import <Parse/Parse.h>
+#import "KSProviderAdapter.h"
+
+/*!
+ * KSProviderAdapter over PFObject, using the background (block) variants so
+ * the SDK's own request path is measured end to end. Entities are class
+ * names; objects are PFObjects.
+ */
+@interface ParseAdapter : NSObject <KSProviderAdapter>
+
+@end
@@ -0,0 +1,89 @@
+//
+//  ParseAdapter.m
+//  KitchenSyncParseTests
+//
+//
+
+#import "ParseAdapter.h"
+
+@implementation ParseAdapter
+
+- (NSString *)providerName {
+  return @"Parse";
+}
+
+- (void)createObjectInEntity:(NSString *)entity fields:(NSDictionary *)fields completion:(KSBenchmarkCompletion)done {
+
+  PFObject *object = [PFObject objectWithClassName:entity];
+
+  [fields enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+    [object setObject:value forKey:key];
+  }];
+
+  [object saveInBackgroundWithBlock:^(BOOL succeeded, NSError *error) {
+    done(object, error);
+  }];
+}
+
+/*!
+ * +saveAllInBackground:block: sends the objects in batch requests. It fails
+ * or succeeds as a whole.
+ */
+- (void)createObjectsInEntity:(NSString *)entity fieldsList:(NSArray *)fieldsList completion:(KSBenchmarkCompletion)done {
+
+  NSMutableArray *objects = [NSMutableArray arrayWithCapacity:[fieldsList count]];
+
+  for (NSDictionary *fields in fieldsList) {
+
+    PFObject *object = [PFObject objectWithClassName:entity];
+
+    [fields enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+      [object setObject:value forKey:key];
+    }];
+
+    [objects addObject:object];
+  }
+
+  [PFObject saveAllInBackground:objects block:^(BOOL succeeded, NSError *error) {
+    done(succeeded ? objects : nil, error);
+  }];
+}
+
+- (void)getObject:(PFObject *)object inEntity:(NSString *)entity completion:(KSBenchmarkCompletion)done {
+  [[PFQuery queryWithClassName:entity] getObjectInBackgroundWithId:object.objectId block:^(PFObject *fetched, NSError *error) {
+    done(fetched, error);
+  }];
+}
+
+- (void)queryEntity:(NSString *)entity whereField:(NSString *)field equals:(id)value completion:(KSBenchmarkCompletion)done {
+
+  PFQuery *query = [PFQuery queryWithClassName:entity];
+
+  [query whereKey:field equalTo:value];
+  [query findObjectsInBackgroundWithBlock:^(NSArray *objects, NSError *error) {
+    done(objects, error);
+  }];
+}
+
+- (void)updateObject:(PFObject *)object inEntity:(NSString *)entity fields:(NSDictionary *)fields completion:(KSBenchmarkCompletion)done {
+
+  [fields enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+    [object setObject:value forKey:key];
+  }];
+
+  [object saveInBackgroundWithBlock:^(BOOL succeeded, NSError *error) {
+    done(object, error);
+  }];
+}
+
+- (void)deleteObject:(PFObject *)object inEntity:(NSString *)entity completion:(KSBenchmarkCompletion)done {
+  [object deleteInBackgroundWithBlock:^(BOOL succeeded, NSError *error) {
+    done(object, error);
+  }];
+}
+
+- (id)valueForField:(NSString *)field ofObject:(PFObject *)object {
+  return [object objectForKey:field];
+}
+
+@end
@@ -0,0 +1,75 @@
+//
+//  KSAdapterWorkloads.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSProviderAdapter.h"
+
+@class KSCRUDBenchmark;
+@class KSBatchWriteBenchmark;
+@class KSPayloadScalingBenchmark;
+
+/*!
+ * Builds the shared benchmarks on top of a provider adapter, so every
+ * provider runs exactly the same operations: the same field values, the
+ * same query, the same update and the same bulk path.
+ *
+ *   KSAdapterWorkloads *workloads = [[KSAdapterWorkloads alloc] initWithAdapter:[[ParseAdapter alloc] init]];
+ *   [[workloads crudBenchmarkForEntity:@"Foo" field:@"fooParameter"] runWithReport:report];
+ */
+@interface KSAdapterWorkloads : NSObject
+
+- (id)initWithAdapter:(id<KSProviderAdapter>)adapter;
+
+@property (nonatomic, readonly, strong) id<KSProviderAdapter> adapter;
+
+/*!
+ * Operations per verb in CRUD benchmarks. Defaults to 20.
+ */
+@property (nonatomic, assign) NSUInteger iterations;
+
+/*!
+ * Seconds to wait for a single operation. Defaults to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+/*!
+ * Batch sizes for batch write benchmarks. Defaults to 1, 10, 100 and 1000.
+ */
+@property (nonatomic, copy) NSArray *batchSizes;
+
+/*!
+ * Deletes kept in flight when cleaning up. Defaults to 8.
+ */
+@property (nonatomic, assign) NSUInteger cleanupConcurrency;
+
+/*!
+ * Objects per step in payload scaling benchmarks. Defaults to 5.
+ */
+@property (nonatomic, assign) NSUInteger payloadIterations;
+
+/*!
+ * Steps for payload scaling benchmarks; nil keeps the benchmark's defaults.
+ */
+@property (nonatomic, copy) NSArray *payloadSizes;
+@property (nonatomic, copy) NSArray *payloadFieldCounts;
+
+/*!
+ * Creates objects with field set to a per-run value, reads them by id,
+ * queries for that value, updates it and deletes them. Values carry the
+ * KSRunNamespace tag, so anything a failed run leaves behind goes with the
+ * suites' scoped cleanup.
+ */
+- (KSCRUDBenchmark *)crudBenchmarkForEntity:(NSString *)entity field:(NSString *)field;
+
+/*!
+ * Single saves go through -createObjectInEntity:..., bulk saves through
+ * -createObjectsInEntity:....
+ */
+- (KSBatchWriteBenchmark *)batchWriteBenchmarkForEntity:(NSString *)entity field:(NSString *)field;
+
+- (KSPayloadScalingBenchmark *)payloadScalingBenchmarkForEntity:(NSString *)entity field:(NSString *)field;
+
+@end
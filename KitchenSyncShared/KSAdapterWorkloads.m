@@ -0,0 +1,122 @@
+//
+//  KSAdapterWorkloads.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSAdapterWorkloads.h"
+#import "KSCRUDBenchmark.h"
+#import "KSBatchWriteBenchmark.h"
+#import "KSPayloadScalingBenchmark.h"
+#import "KSRunNamespace.h"
+
+@implementation KSAdapterWorkloads
+
+- (id)initWithAdapter:(id<KSProviderAdapter>)adapter {
+
+  self = [super init];
+
+  if (self) {
+    _adapter            = adapter;
+    _iterations         = 20;
+    _timeout            = 30.0;
+    _batchSizes         = @[@1, @10, @100, @1000];
+    _cleanupConcurrency = 8;
+    _payloadIterations  = 5;
+  }
+
+  return self;
+}
+
+- (KSCRUDBenchmark *)crudBenchmarkForEntity:(NSString *)entity field:(NSString *)field {
+
+  KSCRUDBenchmark *benchmark    = [[KSCRUDBenchmark alloc] initWithEntity:entity iterations:_iterations];
+  NSString *runTag              = [[KSRunNamespace currentNamespace] tagValue:[[NSProcessInfo processInfo] globallyUniqueString]];
+  id<KSProviderAdapter> adapter = _adapter;
+
+  benchmark.timeout = _timeout;
+
+  benchmark.createBlock = ^(NSUInteger iteration, KSBenchmarkCompletion done) {
+    [adapter createObjectInEntity:entity
+                           fields:@{field : [NSString stringWithFormat:@"%@-%lu", runTag, (unsigned long)iteration]}
+                       completion:done];
+  };
+
+  benchmark.readBlock = ^(id object, NSUInteger iteration, KSBenchmarkCompletion done) {
+    [adapter getObject:object inEntity:entity completion:done];
+  };
+
+  benchmark.queryBlock = ^(NSUInteger iteration, KSBenchmarkCompletion done) {
+    [adapter queryEntity:entity
+              whereField:field
+                  equals:[NSString stringWithFormat:@"%@-%lu", runTag, (unsigned long)iteration]
+              completion:done];
+  };
+
+  benchmark.updateBlock = ^(id object, NSUInteger iteration, KSBenchmarkCompletion done) {
+    [adapter updateObject:object
+                 inEntity:entity
+                   fields:@{field : [NSString stringWithFormat:@"%@-%lu-updated", runTag, (unsigned long)iteration]}
+               completion:done];
+  };
+
+  benchmark.deleteBlock = ^(id object, NSUInteger iteration, KSBenchmarkCompletion done) {
+    [adapter deleteObject:object inEntity:entity completion:done];
+  };
+
+  return benchmark;
+}
+
+- (KSBatchWriteBenchmark *)batchWriteBenchmarkForEntity:(NSString *)entity field:(NSString *)field {
+
+  KSBatchWriteBenchmark *benchmark = [[KSBatchWriteBenchmark alloc] initWithEntity:entity batchSizes:_batchSizes];
+  KSCRUDBenchmark *crud            = [self crudBenchmarkForEntity:entity field:field];
+  NSString *runTag                 = [[KSRunNamespace currentNamespace] tagValue:[[NSProcessInfo processInfo] globallyUniqueString]];
+  id<KSProviderAdapter> adapter    = _adapter;
+
+  benchmark.timeout            = _timeout;
+  benchmark.cleanupConcurrency = _cleanupConcurrency;
+  benchmark.singleSaveBlock    = crud.createBlock;
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  benchmark.bulkSaveBlock = ^(NSUInteger count, KSBenchmarkCompletion done) {
+
+    NSMutableArray *fieldsList = [NSMutableArray arrayWithCapacity:count];
+
+    for (NSUInteger i = 0; i < count; i++) {
+      [fieldsList addObject:@{field : [NSString stringWithFormat:@"%@-%lu", runTag, (unsigned long)i]}];
+    }
+
+    [adapter createObjectsInEntity:entity fieldsList:fieldsList completion:done];
+  };
+
+  return benchmark;
+}
+
+- (KSPayloadScalingBenchmark *)payloadScalingBenchmarkForEntity:(NSString *)entity field:(NSString *)field {
+
+  KSPayloadScalingBenchmark *benchmark = [[KSPayloadScalingBenchmark alloc] initWithEntity:entity field:field iterations:_payloadIterations];
+  KSCRUDBenchmark *crud                = [self crudBenchmarkForEntity:entity field:field];
+  id<KSProviderAdapter> adapter        = _adapter;
+
+  benchmark.timeout            = _timeout;
+  benchmark.cleanupConcurrency = _cleanupConcurrency;
+  benchmark.readBlock          = crud.readBlock;
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  if ([_payloadSizes count] > 0) {
+    benchmark.payloadSizes = _payloadSizes;
+  }
+
+  if ([_payloadFieldCounts count] > 0) {
+    benchmark.fieldCounts = _payloadFieldCounts;
+  }
+
+  benchmark.createBlock = ^(NSDictionary *fields, KSBenchmarkCompletion done) {
+    [adapter createObjectInEntity:entity fields:fields completion:done];
+  };
+
+  return benchmark;
+}
+
+@end
@@ -0,0 +1,124 @@
+//
+//  KSAggregationBenchmark.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSCRUDBenchmark.h"
+#import "KSPagedQuery.h"
+
+@class KSBenchmarkReport;
+
+/*!
+ * Names of the aggregates, as passed to a KSAggregationReduceBlock and used in
+ * the report.
+ */
+extern NSString * const KSAggregateCount;
+extern NSString * const KSAggregateSum;
+extern NSString * const KSAggregateMin;
+extern NSString * const KSAggregateMax;
+extern NSString * const KSAggregateAverage;
+
+/*!
+ * Saves one object per entry of fieldsList, through the SDK's bulk path, and
+ * calls done with the objects that were saved.
+ */
+typedef void (^KSAggregationSeedBlock)(NSArray *fieldsList, KSBenchmarkCompletion done);
+
+/*!
+ * Asks the backend for function (one of the KSAggregate names) of the value
+ * field over the objects whose benchmark field equals tag, and calls done
+ * with the result as an NSNumber.
+ */
+typedef void (^KSAggregationReduceBlock)(NSString *tag, NSString *function, KSBenchmarkCompletion done);
+
+/*!
+ * Reads a page of at most limit objects whose benchmark field equals tag,
+ * only the value field where the SDK can select fields. Pages can be found by
+ * offset or, where the backend caps skipping, by coming after lastObject (the
+ * last object of the page before; nil for the first page).
+ */
+typedef void (^KSAggregationPageBlock)(NSString *tag, id lastObject, NSUInteger offset, NSUInteger limit, KSPageCompletion done);
+
+/*!
+ * The value field of an object the seed or page blocks returned, as an
+ * NSNumber.
+ */
+typedef NSNumber *(^KSAggregationValueBlock)(id object);
+
+/*!
+ * Computes count, sum, min, max and average over a seeded dataset the way a
+ * dashboard could:
+ *
+ * - client: download every row a page at a time and fold them here;
+ * - server: ask the backend, for the aggregates serverFunctions lists;
+ * - server_cached: the same through the SDK's cache, when the suite sets a
+ *   cachedServerBlock. The first call fills the cache; first_s shows it.
+ *
+ * rowCount objects are saved first, seedBatchSize at a time, all with the
+ * same tagged benchmark field and valueField running 0 to 999 over and over.
+ * Each strategy then runs iterations times per aggregate under its own wire
+ * trace, so the report also shows what each one downloads. Every row says
+ * whether the value matched the seeded data, and server rows how many times
+ * faster than the client fold they were.
+ */
+@interface KSAggregationBenchmark : NSObject
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field valueField:(NSString *)valueField iterations:(NSUInteger)iterations;
+
+@property (nonatomic, readonly, copy) NSString *entity;
+@property (nonatomic, readonly, copy) NSString *field;
+@property (nonatomic, readonly, copy) NSString *valueField;
+@property (nonatomic, readonly) NSUInteger iterations;
+
+/*!
+ * Seconds to wait for a single request. Defaults to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+/*!
+ * Objects seeded. Defaults to 100,000.
+ */
+@property (nonatomic, assign) NSUInteger rowCount;
+
+/*!
+ * Objects per seed call. Defaults to 1,000.
+ */
+@property (nonatomic, assign) NSUInteger seedBatchSize;
+
+/*!
+ * Objects per page of the client fold. Defaults to 1,000.
+ */
+@property (nonatomic, assign) NSUInteger pageSize;
+
+/*!
+ * Deletes run in parallel when tearing the dataset down. Defaults to 8.
+ */
+@property (nonatomic, assign) NSUInteger cleanupConcurrency;
+
+/*!
+ * Aggregates the backend computes itself. Defaults to none.
+ */
+@property (nonatomic, copy) NSArray *serverFunctions;
+
+@property (nonatomic, copy) KSAggregationSeedBlock   seedBlock;
+@property (nonatomic, copy) KSAggregationPageBlock   pageBlock;
+@property (nonatomic, copy) KSAggregationValueBlock  valueBlock;
+@property (nonatomic, copy) KSAggregationReduceBlock serverBlock;
+@property (nonatomic, copy) KSAggregationReduceBlock cachedServerBlock;
+@property (nonatomic, copy) KSBenchmarkObjectBlock   deleteBlock;
+
+/*!
+ * Seeds, adds a histogram, a wire trace and a result row per aggregate and
+ * strategy to report, and deletes the dataset again.
+ */
+- (void)runWithReport:(KSBenchmarkReport *)report;
+
+/*!
+ * Failed seeds and aggregations, and aggregates that came back wrong, in the
+ * last run.
+ */
+@property (nonatomic, readonly) NSUInteger errorCount;
+
+@end
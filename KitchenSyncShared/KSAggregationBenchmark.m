@@ -0,0 +1,399 @@
+//
+//  KSAggregationBenchmark.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSAggregationBenchmark.h"
+#import "KSBenchmarkReport.h"
+#import "KSBulkDeleter.h"
+#import "KSMonotonicClock.h"
+#import "KSRunNamespace.h"
+#import "KSWireTrace.h"
+
+NSString * const KSAggregateCount   = @"count";
+NSString * const KSAggregateSum     = @"sum";
+NSString * const KSAggregateMin     = @"min";
+NSString * const KSAggregateMax     = @"max";
+NSString * const KSAggregateAverage = @"avg";
+
+/*!
+ * Folds values into count, sum, min, max and avg. min, max and avg are left
+ * out when there are no values.
+ */
+static NSDictionary *KSAggregatesOfValues(NSUInteger count, double sum, double min, double max) {
+
+  if (count == 0) {
+    return @{KSAggregateCount : @0, KSAggregateSum : @0};
+  }
+
+  return @{KSAggregateCount   : @(count),
+           KSAggregateSum     : @(sum),
+           KSAggregateMin     : @(min),
+           KSAggregateMax     : @(max),
+           KSAggregateAverage : @(sum / count)};
+}
+
+static BOOL KSAggregateMatches(NSNumber *value, NSNumber *expected) {
+
+  if (!value || !expected) {
+    return NO;
+  }
+
+  double difference = fabs([value doubleValue] - [expected doubleValue]);
+
+  return difference <= 1e-6 * MAX(1.0, fabs([expected doubleValue]));
+}
+
+@interface KSAggregationBenchmark()
+
+@property (nonatomic, readwrite) NSUInteger errorCount;
+
+- (NSDictionary *)seedWithTag:(NSString *)tag objects:(NSMutableArray *)objects;
+- (NSDictionary *)timeClientFoldWithTag:(NSString *)tag expected:(NSDictionary *)expected report:(KSBenchmarkReport *)report;
+- (void)timeStrategy:(NSString *)strategy
+           withBlock:(KSAggregationReduceBlock)block
+                 tag:(NSString *)tag
+            expected:(NSDictionary *)expected
+          clientTime:(NSTimeInterval)clientTime
+              report:(KSBenchmarkReport *)report;
+- (NSDictionary *)foldWithTag:(NSString *)tag foldTime:(NSTimeInterval *)foldTime error:(NSError **)error;
+- (void)deleteObjects:(NSArray *)objects;
+
+@end
+
+@implementation KSAggregationBenchmark
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field valueField:(NSString *)valueField iterations:(NSUInteger)iterations {
+
+  self = [super init];
+
+  if (self) {
+    _entity             = [entity copy];
+    _field              = [field copy];
+    _valueField         = [valueField copy];
+    _iterations         = iterations;
+    _timeout            = 30.0;
+    _rowCount           = 100000;
+    _seedBatchSize      = 1000;
+    _pageSize           = 1000;
+    _cleanupConcurrency = 8;
+    _serverFunctions    = @[];
+  }
+
+  return self;
+}
+
+- (void)runWithReport:(KSBenchmarkReport *)report {
+
+  NSString *tag           = [[KSRunNamespace currentNamespace] tagValue:[NSString stringWithFormat:@"aggregation-%@", [[NSProcessInfo processInfo] globallyUniqueString]]];
+  NSMutableArray *objects = [NSMutableArray arrayWithCapacity:_rowCount];
+
+  self.errorCount = 0;
+
+  NSDictionary *expected = [self seedWithTag:tag objects:objects];
+
+  if ([objects count] > 0) {
+
+    NSDictionary *client = [self timeClientFoldWithTag:tag expected:expected report:report];
+    NSTimeInterval fold  = [client[@"p50_s"] doubleValue];
+
+    if (_serverBlock && [_serverFunctions count] > 0) {
+      [self timeStrategy:@"server" withBlock:_serverBlock tag:tag expected:expected clientTime:fold report:report];
+    }
+
+    if (_cachedServerBlock && [_serverFunctions count] > 0) {
+      [self timeStrategy:@"server_cached" withBlock:_cachedServerBlock tag:tag expected:expected clientTime:fold report:report];
+    }
+  }
+
+  [self deleteObjects:objects];
+}
+
+/*!
+ * Saves up to rowCount objects and returns the aggregates of the ones that
+ * were saved, which is what every strategy should come back with.
+ */
+- (NSDictionary *)seedWithTag:(NSString *)tag objects:(NSMutableArray *)objects {
+
+  KSLatencyHistogram *seed      = [KSLatencyHistogram histogramWithName:[NSString stringWithFormat:@"%@.aggregation.seed", _entity]];
+  KSAggregationSeedBlock save   = _seedBlock;
+  KSAggregationValueBlock value = _valueBlock;
+  NSUInteger batchSize          = MAX(_seedBatchSize, 1);
+  NSTimeInterval timeout        = _timeout * MAX(1, (batchSize + 9) / 10);
+  NSTimeInterval start          = KSMonotonicTime();
+
+  double sum = 0, min = DBL_MAX, max = -DBL_MAX;
+
+  for (NSUInteger first = 0; first < _rowCount; first += batchSize) {
+
+    @autoreleasepool {
+
+      NSUInteger count            = MIN(batchSize, _rowCount - first);
+      NSMutableArray *fieldsList  = [NSMutableArray arrayWithCapacity:count];
+
+      for (NSUInteger i = first; i < first + count; i++) {
+        [fieldsList addObject:@{_field : tag, _valueField : @(i % 1000)}];
+      }
+
+      NSArray *saved = [seed measure:^(KSBenchmarkCompletion done) {
+        save(fieldsList, done);
+      } timeout:timeout];
+
+      for (id object in saved) {
+
+        double v = [value(object) doubleValue];
+
+        sum += v;
+        min  = MIN(min, v);
+        max  = MAX(max, v);
+      }
+
+      [objects addObjectsFromArray:saved];
+    }
+  }
+
+  NSLog(@"%@ aggregation: seeded %lu of %lu objects in %.1fs", _entity, (unsigned long)[objects count], (unsigned long)_rowCount, KSMonotonicTime() - start);
+
+  if (seed.errorCount > 0 || [objects count] < _rowCount) {
+    self.errorCount += MAX(seed.errorCount, 1);
+    NSLog(@"%@ aggregation: %lu seed batches failed: %@", _entity, (unsigned long)seed.errorCount, [seed.errors lastObject]);
+  }
+
+  return KSAggregatesOfValues([objects count], sum, min, max);
+}
+
+/*!
+ * Returns the client row for count, which carries the fold's p50.
+ */
+- (NSDictionary *)timeClientFoldWithTag:(NSString *)tag expected:(NSDictionary *)expected report:(KSBenchmarkReport *)report {
+
+  KSLatencyHistogram *fetch = [KSLatencyHistogram histogramWithName:[NSString stringWithFormat:@"%@.client.fetch_all", _entity]];
+  NSDictionary *attributes  = @{@"entity" : _entity, @"strategy" : @"client"};
+  NSTimeInterval pages      = MAX(1, [expected[KSAggregateCount] unsignedIntegerValue] / MAX(_pageSize, 1) + 1);
+  NSTimeInterval foldTime   = 0;
+  NSTimeInterval firstTime  = 0;
+  NSDictionary *aggregates  = nil;
+
+  [KSWireTrace start];
+
+  for (NSUInteger i = 0; i < _iterations; i++) {
+
+    @autoreleasepool {
+
+      __block NSTimeInterval iterationFold = 0;
+      NSTimeInterval start                 = KSMonotonicTime();
+
+      NSDictionary *folded = [fetch measure:^(KSBenchmarkCompletion done) {
+        NSError *error          = nil;
+        NSDictionary *result    = [self foldWithTag:tag foldTime:&iterationFold error:&error];
+        done(result, error);
+      } timeout:_timeout * pages];
+
+      if (i == 0) {
+        firstTime = KSMonotonicTime() - start;
+      }
+
+      if (folded) {
+        aggregates = folded;
+        foldTime   = MAX(foldTime, iterationFold);
+      }
+    }
+  }
+
+  [KSWireTrace stop];
+
+  [report addHistogram:fetch withAttributes:attributes];
+
+  [KSWireTrace addToReport:report operations:@[fetch] attributes:attributes];
+
+  NSDictionary *countRow = nil;
+
+  for (NSString *function in @[KSAggregateCount, KSAggregateSum, KSAggregateMin, KSAggregateMax, KSAggregateAverage]) {
+
+    BOOL correct = KSAggregateMatches(aggregates[function], expected[function]);
+
+    NSDictionary *row = @{@"entity"   : _entity,
+                          @"strategy" : @"client",
+                          @"function" : function,
+                          @"rows"     : expected[KSAggregateCount],
+                          @"p50_s"    : @([fetch percentile:50]),
+                          @"p95_s"    : @([fetch percentile:95]),
+                          @"first_s"  : @(firstTime),
+                          @"fold_s"   : @(foldTime),
+                          @"value"    : aggregates[function] ? aggregates[function] : [NSNull null],
+                          @"expected" : expected[function] ? expected[function] : [NSNull null],
+                          @"correct"  : @(correct),
+                          @"errors"   : @(fetch.errorCount)};
+
+    [report addResult:row];
+
+    if (!countRow) {
+      countRow = row;
+    }
+
+    if (aggregates && !correct) {
+      self.errorCount++;
+      NSLog(@"%@ client %@ came back %@, expected %@", _entity, function, aggregates[function], expected[function]);
+    }
+  }
+
+  if (fetch.errorCount > 0) {
+    self.errorCount += fetch.errorCount;
+    NSLog(@"%@ client fold: %lu failed: %@", _entity, (unsigned long)fetch.errorCount, [fetch.errors lastObject]);
+  }
+
+  return countRow;
+}
+
+- (void)timeStrategy:(NSString *)strategy
+           withBlock:(KSAggregationReduceBlock)block
+                 tag:(NSString *)tag
+            expected:(NSDictionary *)expected
+          clientTime:(NSTimeInterval)clientTime
+              report:(KSBenchmarkReport *)report {
+
+  NSMutableArray *histograms = [NSMutableArray arrayWithCapacity:[_serverFunctions count]];
+  NSMutableArray *rows       = [NSMutableArray arrayWithCapacity:[_serverFunctions count]];
+
+  [KSWireTrace start];
+
+  for (NSString *function in _serverFunctions) {
+
+    KSLatencyHistogram *histogram = [KSLatencyHistogram histogramWithName:[NSString stringWithFormat:@"%@.%@.%@", _entity, strategy, function]];
+    NSTimeInterval firstTime      = 0;
+    NSNumber *value               = nil;
+
+    for (NSUInteger i = 0; i < _iterations; i++) {
+
+      NSTimeInterval start = KSMonotonicTime();
+
+      NSNumber *result = [histogram measure:^(KSBenchmarkCompletion done) {
+        block(tag, function, done);
+      } timeout:_timeout];
+
+      if (i == 0) {
+        firstTime = KSMonotonicTime() - start;
+      }
+
+      if (result) {
+        value = result;
+      }
+    }
+
+    NSTimeInterval p50 = [histogram percentile:50];
+    BOOL correct       = KSAggregateMatches(value, expected[function]);
+
+    [histograms addObject:histogram];
+
+    [rows addObject:@{@"entity"       : _entity,
+                      @"strategy"     : strategy,
+                      @"function"     : function,
+                      @"rows"         : expected[KSAggregateCount],
+                      @"p50_s"        : @(p50),
+                      @"p95_s"        : @([histogram percentile:95]),
+                      @"first_s"      : @(firstTime),
+                      @"client_p50_s" : @(clientTime),
+                      @"speedup"      : @(p50 > 0 ? clientTime / p50 : 0),
+                      @"value"        : value ? value : [NSNull null],
+                      @"expected"     : expected[function] ? expected[function] : [NSNull null],
+                      @"correct"      : @(correct),
+                      @"errors"       : @(histogram.errorCount)}];
+
+    if (value && !correct) {
+      self.errorCount++;
+      NSLog(@"%@ %@ %@ came back %@, expected %@", _entity, strategy, function, value, expected[function]);
+    }
+
+    if (histogram.errorCount > 0) {
+      self.errorCount += histogram.errorCount;
+      NSLog(@"%@ %@ %@: %lu failed: %@", _entity, strategy, function, (unsigned long)histogram.errorCount, [histogram.errors lastObject]);
+    }
+  }
+
+  [KSWireTrace stop];
+
+  NSDictionary *attributes = @{@"entity" : _entity, @"strategy" : strategy};
+
+  for (KSLatencyHistogram *histogram in histograms) {
+    [report addHistogram:histogram withAttributes:attributes];
+  }
+
+  [KSWireTrace addToReport:report operations:histograms attributes:attributes];
+
+  for (NSDictionary *row in rows) {
+    [report addResult:row];
+  }
+}
+
+/*!
+ * Reads every object tagged with tag and folds their values. foldTime is the
+ * part spent folding rather than fetching.
+ */
+- (NSDictionary *)foldWithTag:(NSString *)tag foldTime:(NSTimeInterval *)foldTime error:(NSError **)error {
+
+  KSAggregationPageBlock fetchPage = _pageBlock;
+  KSAggregationValueBlock value    = _valueBlock;
+  __block id lastObject            = nil;
+  __block NSUInteger count         = 0;
+  __block NSTimeInterval folding   = 0;
+
+  __block double sum = 0, min = DBL_MAX, max = -DBL_MAX;
+
+  KSPagedQuery *pages = [KSPagedQuery queryWithPageSize:_pageSize fetchBlock:^(NSUInteger offset, NSUInteger limit, KSPageCompletion done) {
+    fetchPage(tag, lastObject, offset, limit, done);
+  }];
+
+  pages.timeout = _timeout;
+
+  BOOL completed = [pages enumeratePagesUsingBlock:^(NSArray *page, NSUInteger offset, BOOL *stop) {
+
+    NSTimeInterval start = KSMonotonicTime();
+
+    for (id object in page) {
+
+      double v = [value(object) doubleValue];
+
+      sum += v;
+      min  = MIN(min, v);
+      max  = MAX(max, v);
+    }
+
+    count     += [page count];
+    lastObject = [page lastObject];
+    folding   += KSMonotonicTime() - start;
+  }];
+
+  *foldTime = folding;
+
+  if (!completed) {
+    if (error) {
+      *error = pages.error;
+    }
+    return nil;
+  }
+
+  return KSAggregatesOfValues(count, sum, min, max);
+}
+
+- (void)deleteObjects:(NSArray *)objects {
+
+  if ([objects count] == 0 || !_deleteBlock) {
+    return;
+  }
+
+  KSBenchmarkObjectBlock block = _deleteBlock;
+  KSBulkDeleter *deleter       = [KSBulkDeleter deleterWithMaxConcurrentDeletes:_cleanupConcurrency];
+
+  [deleter deleteItems:objects withBlock:^(id object, KSBulkDeleteCompletion done) {
+    block(object, 0, ^(id result, NSError *error) {
+      done(error);
+    });
+  }];
+
+  if (![deleter waitWithTimeout:_timeout * MAX(1, [objects count] / MAX(_cleanupConcurrency, 1))] || deleter.failedCount > 0) {
+    NSLog(@"%@ aggregation left %lu objects behind", _entity, (unsigned long)([objects count] - deleter.deletedCount));
+  }
+}
+
+@end
@@ -0,0 +1,62 @@
+//
+//  KSBatchWriteBenchmark.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSCRUDBenchmark.h"
+
+/*!
+ * Saves count new objects with one bulk call (or one batch of requests) and
+ * calls done with the array of saved objects.
+ */
+typedef void (^KSBenchmarkBatchBlock)(NSUInteger count, KSBenchmarkCompletion done);
+
+/*!
+ * Compares writing N objects one save at a time with writing them through
+ * the SDK's bulk path, for each N in batchSizes.
+ *
+ * For every size and path the report gets a histogram (per object for the
+ * single path, per batch for the bulk path) plus a result row with
+ * objects/sec and the bytes sent and received, as counted by KSWireMeter.
+ * Everything written is deleted again before the next step.
+ */
+@interface KSBatchWriteBenchmark : NSObject
+
+- (id)initWithEntity:(NSString *)entity batchSizes:(NSArray *)batchSizes;
+
+@property (nonatomic, readonly, copy) NSString *entity;
+@property (nonatomic, readonly, copy) NSArray *batchSizes;
+
+/*!
+ * Seconds to wait for a single save. Bulk saves get this per 10 objects.
+ * Defaults to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+/*!
+ * Deletes in flight while cleaning up. Defaults to 8.
+ */
+@property (nonatomic, assign) NSUInteger cleanupConcurrency;
+
+/*!
+ * Saves one new object; iteration is its index within the step.
+ */
+@property (nonatomic, copy) KSBenchmarkIterationBlock singleSaveBlock;
+
+@property (nonatomic, copy) KSBenchmarkBatchBlock bulkSaveBlock;
+
+/*!
+ * Deletes an object returned by either save block.
+ */
+@property (nonatomic, copy) KSBenchmarkObjectBlock deleteBlock;
+
+- (void)runWithReport:(KSBenchmarkReport *)report;
+
+/*!
+ * Failed saves in the last run.
+ */
+@property (nonatomic, readonly) NSUInteger errorCount;
+
+@end
@@ -0,0 +1,182 @@
+//
+//  KSBatchWriteBenchmark.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSBatchWriteBenchmark.h"
+#import "KSBenchmarkReport.h"
+#import "KSBulkDeleter.h"
+#import "KSMonotonicClock.h"
+#import "KSWireMeter.h"
+
+@interface KSBatchWriteBenchmark()
+
+@property (nonatomic, readwrite) NSUInteger errorCount;
+
+- (NSArray *)runSingleStep:(NSUInteger)count report:(KSBenchmarkReport *)report;
+- (NSArray *)runBulkStep:(NSUInteger)count report:(KSBenchmarkReport *)report;
+- (void)addResultForPath:(NSString *)path
+               batchSize:(NSUInteger)batchSize
+                   saved:(NSUInteger)saved
+                  errors:(NSUInteger)errors
+                wallTime:(NSTimeInterval)wallTime
+                  report:(KSBenchmarkReport *)report;
+- (void)deleteObjects:(NSArray *)objects;
+
+@end
+
+@implementation KSBatchWriteBenchmark
+
+- (id)initWithEntity:(NSString *)entity batchSizes:(NSArray *)batchSizes {
+
+  self = [super init];
+
+  if (self) {
+    _entity             = [entity copy];
+    _batchSizes         = [batchSizes copy];
+    _timeout            = 30.0;
+    _cleanupConcurrency = 8;
+  }
+
+  return self;
+}
+
+- (void)runWithReport:(KSBenchmarkReport *)report {
+
+  [KSWireMeter install];
+
+  self.errorCount = 0;
+
+  for (NSNumber *batchSize in _batchSizes) {
+
+    NSUInteger count = [batchSize unsignedIntegerValue];
+
+    if (_singleSaveBlock) {
+      [self deleteObjects:[self runSingleStep:count report:report]];
+    }
+
+    if (_bulkSaveBlock) {
+      [self deleteObjects:[self runBulkStep:count report:report]];
+    }
+  }
+}
+
+/*!
+ * Saves count objects one after another, each waiting for the previous one.
+ */
+- (NSArray *)runSingleStep:(NSUInteger)count report:(KSBenchmarkReport *)report {
+
+  KSLatencyHistogram *histogram  = [KSLatencyHistogram histogramWithName:[NSString stringWithFormat:@"%@.save", _entity]];
+  NSMutableArray *saved          = [NSMutableArray arrayWithCapacity:count];
+  KSBenchmarkIterationBlock save = _singleSaveBlock;
+
+  [KSWireMeter reset];
+
+  NSTimeInterval startedAt = KSMonotonicTime();
+
+  for (NSUInteger i = 0; i < count; i++) {
+
+    id object = [histogram measure:^(KSBenchmarkCompletion done) {
+      save(i, done);
+    } timeout:_timeout];
+
+    if (object) {
+      [saved addObject:object];
+    }
+  }
+
+  histogram.wallTime = KSMonotonicTime() - startedAt;
+
+  [report addHistogram:histogram withAttributes:@{@"entity" : _entity, @"path" : @"single", @"batch_size" : @(count)}];
+
+  [self addResultForPath:@"single"
+               batchSize:count
+                   saved:[saved count]
+                  errors:histogram.errorCount
+                wallTime:histogram.wallTime
+                  report:report];
+
+  return saved;
+}
+
+/*!
+ * Saves count objects with a single call to the bulk block.
+ */
+- (NSArray *)runBulkStep:(NSUInteger)count report:(KSBenchmarkReport *)report {
+
+  KSLatencyHistogram *histogram = [KSLatencyHistogram histogramWithName:[NSString stringWithFormat:@"%@.save_all", _entity]];
+  KSBenchmarkBatchBlock save    = _bulkSaveBlock;
+  NSTimeInterval timeout        = _timeout * MAX(1, (count + 9) / 10);
+
+  [KSWireMeter reset];
+
+  NSTimeInterval startedAt = KSMonotonicTime();
+
+  NSArray *saved = [histogram measure:^(KSBenchmarkCompletion done) {
+    save(count, done);
+  } timeout:timeout];
+
+  histogram.wallTime = KSMonotonicTime() - startedAt;
+
+  [report addHistogram:histogram withAttributes:@{@"entity" : _entity, @"path" : @"bulk", @"batch_size" : @(count)}];
+
+  [self addResultForPath:@"bulk"
+               batchSize:count
+                   saved:[saved count]
+                  errors:count - MIN([saved count], count)
+                wallTime:histogram.wallTime
+                  report:report];
+
+  return saved;
+}
+
+- (void)addResultForPath:(NSString *)path
+               batchSize:(NSUInteger)batchSize
+                   saved:(NSUInteger)saved
+                  errors:(NSUInteger)errors
+                wallTime:(NSTimeInterval)wallTime
+                  report:(KSBenchmarkReport *)report {
+
+  NSDictionary *wire = [KSWireMeter totals];
+
+  unsigned long long bytesSent = [wire[@"bytes_sent"] unsignedLongLongValue];
+
+  self.errorCount += errors;
+
+  [report addResult:@{@"entity"                : _entity,
+                      @"path"                  : path,
+                      @"batch_size"            : @(batchSize),
+                      @"saved"                 : @(saved),
+                      @"errors"                : @(errors),
+                      @"wall_time_s"           : @(wallTime),
+                      @"objects_per_second"    : @(wallTime > 0 ? saved / wallTime : 0),
+                      @"requests"              : wire[@"requests"],
+                      @"bytes_sent"            : wire[@"bytes_sent"],
+                      @"bytes_received"        : wire[@"bytes_received"],
+                      @"bytes_sent_per_object" : @(saved > 0 ? (double)bytesSent / saved : 0)}];
+}
+
+- (void)deleteObjects:(NSArray *)objects {
+
+  if ([objects count] == 0 || !_deleteBlock) {
+    return;
+  }
+
+  KSBenchmarkObjectBlock remove = _deleteBlock;
+  KSBulkDeleter *deleter        = [KSBulkDeleter deleterWithMaxConcurrentDeletes:_cleanupConcurrency];
+
+  [deleter deleteItems:objects withBlock:^(id object, KSBulkDeleteCompletion done) {
+    remove(object, 0, ^(id result, NSError *error) {
+      done(error);
+    });
+  }];
+
+  NSTimeInterval timeout = _timeout * MAX(1, [objects count] / MAX(_cleanupConcurrency, 1));
+
+  if (![deleter waitWithTimeout:timeout] || deleter.failedCount > 0) {
+    NSLog(@"%@ batch write left %lu objects behind", _entity, (unsigned long)([objects count] - deleter.deletedCount));
+  }
+}
+
+@end
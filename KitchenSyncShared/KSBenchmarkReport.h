@@ -0,0 +1,70 @@
+//
+//  KSBenchmarkReport.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+
+@class KSLatencyHistogram;
+
+/*!
+ * Collects the results of one benchmark run against one provider and writes
+ * them out as JSON, so runs can be compared across providers and over time.
+ *
+ * The file is named <provider>-<benchmark>-<timestamp>.json and contains the
+ * run parameters, one entry per latency histogram and any extra result rows.
+ */
+@interface KSBenchmarkReport : NSObject
+
++ (KSBenchmarkReport *)reportWithProvider:(NSString *)provider benchmark:(NSString *)benchmark;
+
+- (id)initWithProvider:(NSString *)provider benchmark:(NSString *)benchmark;
+
+@property (nonatomic, readonly, copy) NSString *provider;
+@property (nonatomic, readonly, copy) NSString *benchmark;
+
+/*!
+ * Records a run parameter (iterations, concurrency, ...) in the report.
+ */
+- (void)setParameter:(id)value forKey:(NSString *)key;
+
+/*!
+ * Adds the histogram's summary to the report.
+ */
+- (void)addHistogram:(KSLatencyHistogram *)histogram;
+
+/*!
+ * Adds the histogram's summary with extra fields merged in, e.g. the object
+ * count or payload size it was measured at.
+ */
+- (void)addHistogram:(KSLatencyHistogram *)histogram withAttributes:(NSDictionary *)attributes;
+
+/*!
+ * Adds a free-form result row. Values must be JSON-serialisable.
+ */
+- (void)addResult:(NSDictionary *)result;
+
+@property (nonatomic, readonly) NSArray *histograms;
+
+- (NSDictionary *)dictionaryRepresentation;
+
+/*!
+ * Writes the report to directory (created if needed) and returns the path,
+ * or nil with error set.
+ */
+- (NSString *)writeToDirectory:(NSString *)directory error:(NSError **)error;
+
+/*!
+ * Logs one line per histogram and result row.
+ */
+- (void)logSummary;
+
+/*!
+ * The directory reports go to when a configuration doesn't name one:
+ * $KS_BENCHMARK_REPORT_DIR if set, otherwise KitchenSyncBenchmarks in the
+ * temporary directory.
+ */
++ (NSString *)defaultDirectory;
+
+@end
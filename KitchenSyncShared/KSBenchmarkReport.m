@@ -0,0 +1,169 @@
+//
+//  KSBenchmarkReport.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSBenchmarkReport.h"
+#import "KSLatencyHistogram.h"
+
+@implementation KSBenchmarkReport {
+
+  NSDate              *_startedAt;
+  NSMutableDictionary *_parameters;
+  NSMutableArray      *_histograms;
+  NSMutableArray      *_histogramAttributes;
+  NSMutableArray      *_results;
+}
+
++ (KSBenchmarkReport *)reportWithProvider:(NSString *)provider benchmark:(NSString *)benchmark {
+  return [[KSBenchmarkReport alloc] initWithProvider:provider benchmark:benchmark];
+}
+
+- (id)initWithProvider:(NSString *)provider benchmark:(NSString *)benchmark {
+
+  self = [super init];
+
+  if (self) {
+    _provider            = [provider copy];
+    _benchmark           = [benchmark copy];
+    _startedAt           = [NSDate date];
+    _parameters          = [NSMutableDictionary dictionary];
+    _histograms          = [NSMutableArray array];
+    _histogramAttributes = [NSMutableArray array];
+    _results             = [NSMutableArray array];
+  }
+
+  return self;
+}
+
++ (NSString *)defaultDirectory {
+
+  NSString *directory = [[NSProcessInfo processInfo] environment][@"KS_BENCHMARK_REPORT_DIR"];
+
+  if ([directory length] > 0) {
+    return directory;
+  }
+
+  return [NSTemporaryDirectory() stringByAppendingPathComponent:@"KitchenSyncBenchmarks"];
+}
+
++ (NSDateFormatter *)timestampFormatter {
+
+  static NSDateFormatter *formatter;
+  static dispatch_once_t onceToken;
+
+  dispatch_once(&onceToken, ^{
+    formatter = [[NSDateFormatter alloc] init];
+    [formatter setLocale:[[NSLocale alloc] initWithLocaleIdentifier:@"en_US_POSIX"]];
+    [formatter setTimeZone:[NSTimeZone timeZoneWithAbbreviation:@"UTC"]];
+    [formatter setDateFormat:@"yyyy-MM-dd'T'HH:mm:ss'Z'"];
+  });
+
+  return formatter;
+}
+
+- (void)setParameter:(id)value forKey:(NSString *)key {
+  @synchronized(self) {
+    _parameters[key] = value ? value : [NSNull null];
+  }
+}
+
+- (void)addHistogram:(KSLatencyHistogram *)histogram {
+  [self addHistogram:histogram withAttributes:nil];
+}
+
+- (void)addHistogram:(KSLatencyHistogram *)histogram withAttributes:(NSDictionary *)attributes {
+  @synchronized(self) {
+    [_histograms addObject:histogram];
+    [_histogramAttributes addObject:attributes ? attributes : @{}];
+  }
+}
+
+- (void)addResult:(NSDictionary *)result {
+  @synchronized(self) {
+    [_results addObject:result];
+  }
+}
+
+- (NSArray *)histograms {
+  @synchronized(self) {
+    return [_histograms copy];
+  }
+}
+
+- (NSDictionary *)dictionaryRepresentation {
+
+  @synchronized(self) {
+
+    NSMutableArray *operations = [NSMutableArray arrayWithCapacity:[_histograms count]];
+
+    [_histograms enumerateObjectsUsingBlock:^(KSLatencyHistogram *histogram, NSUInteger idx, BOOL *stop) {
+
+      NSMutableDictionary *entry = [[histogram dictionaryRepresentation] mutableCopy];
+
+      [entry addEntriesFromDictionary:_histogramAttributes[idx]];
+      [operations addObject:entry];
+    }];
+
+    NSProcessInfo *processInfo = [NSProcessInfo processInfo];
+
+    return @{@"provider"   : _provider,
+             @"benchmark"  : _benchmark,
+             @"started_at" : [[[self class] timestampFormatter] stringFromDate:_startedAt],
+             @"host"       : @{@"os" : [processInfo operatingSystemVersionString],
+                               @"processors" : @([processInfo activeProcessorCount])},
+             @"parameters" : [_parameters copy],
+             @"operations" : operations,
+             @"results"    : [_results copy]};
+  }
+}
+
+- (NSString *)writeToDirectory:(NSString *)directory error:(NSError **)error {
+
+  if ([directory length] == 0) {
+    directory = [[self class] defaultDirectory];
+  }
+
+  if (![[NSFileManager defaultManager] createDirectoryAtPath:directory
+                                 withIntermediateDirectories:YES
+                                                  attributes:nil
+                                                       error:error]) {
+    return nil;
+  }
+
+  NSData *json = [NSJSONSerialization dataWithJSONObject:[self dictionaryRepresentation]
+                                                 options:NSJSONWritingPrettyPrinted
+                                                   error:error];
+
+  if (!json) {
+    return nil;
+  }
+
+  NSString *timestamp = [[[[self class] timestampFormatter] stringFromDate:_startedAt] stringByReplacingOccurrencesOfString:@":" withString:@""];
+  NSString *fileName  = [NSString stringWithFormat:@"%@-%@-%@.json", _provider, _benchmark, timestamp];
+  NSString *path      = [directory stringByAppendingPathComponent:fileName];
+
+  if (![json writeToFile:path options:NSDataWritingAtomic error:error]) {
+    return nil;
+  }
+
+  return path;
+}
+
+- (void)logSummary {
+
+  NSLog(@"%@ %@ benchmark %@", _provider, _benchmark, _parameters);
+
+  for (KSLatencyHistogram *histogram in self.histograms) {
+    NSLog(@"  %@", histogram);
+  }
+
+  @synchronized(self) {
+    for (NSDictionary *result in _results) {
+      NSLog(@"  %@", result);
+    }
+  }
+}
+
+@end
@@ -0,0 +1,152 @@
+//
+//  KSBenchmarkSettings.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+
+@class KSBenchmarkReport;
+
+/*!
+ * Runs the body of one benchmark test against report. Set *discard to YES
+ * when the benchmark skipped itself, so no report is written.
+ */
+typedef void (^KSBenchmarkBlock)(KSBenchmarkReport *report, BOOL *discard);
+
+/*!
+ * The benchmark keys of a provider configuration dictionary, read once with
+ * their defaults applied, plus the steps every benchmark test shares: the
+ * RunBenchmarks gate, catching failures and writing the report.
+ *
+ *   KSBenchmarkSettings *settings = [KSBenchmarkSettings settingsWithConfiguration:[[ParseConfigurator sharedInstance] applicationConfiguration]];
+ *   NSString *failure = [settings runBenchmark:@"crud_latency" provider:@"Parse" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) { ... }];
+ *   STAssertNil(failure, @"%@", failure);
+ */
+@interface KSBenchmarkSettings : NSObject
+
++ (KSBenchmarkSettings *)settingsWithConfiguration:(NSDictionary *)configuration;
+
+- (id)initWithConfiguration:(NSDictionary *)configuration;
+
+/*!
+ * The dictionary the settings were read from, for provider specific keys.
+ */
+@property (nonatomic, readonly, copy) NSDictionary *configuration;
+
+@property (nonatomic, readonly) BOOL showLogs;
+@property (nonatomic, readonly) BOOL runBenchmarks;
+
+/*!
+ * BenchmarkIterations. Defaults to 20.
+ */
+@property (nonatomic, readonly) NSUInteger iterations;
+
+/*!
+ * TestTimeout, in seconds. Defaults to 30.
+ */
+@property (nonatomic, readonly) NSTimeInterval testTimeout;
+
+/*!
+ * BenchmarkReportDirectory; nil writes to KSBenchmarkReport's default.
+ */
+@property (nonatomic, readonly, copy) NSString *reportDirectory;
+
+/*!
+ * LoadWorkers defaults to 1, 4 and 16, LoadDuration to 10 seconds.
+ * LoadTargetRate of 0 runs the workers flat out.
+ */
+@property (nonatomic, readonly, copy) NSArray *loadWorkers;
+@property (nonatomic, readonly) double loadTargetRate;
+@property (nonatomic, readonly) NSTimeInterval loadDuration;
+
+/*!
+ * BatchSizes. Defaults to 1, 10, 100 and 1000.
+ */
+@property (nonatomic, readonly, copy) NSArray *batchSizes;
+
+/*!
+ * TeardownConcurrency. Defaults to 8.
+ */
+@property (nonatomic, readonly) NSUInteger teardownConcurrency;
+
+/*!
+ * PayloadIterations defaults to 5. Missing PayloadSizes or
+ * PayloadFieldCounts keep the benchmark's own steps.
+ */
+@property (nonatomic, readonly, copy) NSArray *payloadSizes;
+@property (nonatomic, readonly, copy) NSArray *payloadFieldCounts;
+@property (nonatomic, readonly) NSUInteger payloadIterations;
+
+@property (nonatomic, readonly, copy) NSArray *offlineQueueSizes;
+
+/*!
+ * StartupPasses. Defaults to 5.
+ */
+@property (nonatomic, readonly) NSUInteger startupPasses;
+
+/*!
+ * CoreDataRowCounts and CoreDataBenchmarkStoreTypes, nil when missing.
+ */
+@property (nonatomic, readonly, copy) NSArray *coreDataRowCounts;
+@property (nonatomic, readonly, copy) NSArray *coreDataStoreTypes;
+
+/*!
+ * ProjectionFieldCount. Defaults to 200.
+ */
+@property (nonatomic, readonly) NSUInteger projectionFieldCount;
+
+/*!
+ * BlobIterations defaults to 3.
+ */
+@property (nonatomic, readonly, copy) NSArray *blobSizes;
+@property (nonatomic, readonly) NSUInteger blobIterations;
+
+/*!
+ * AggregationRowCount defaults to 100000, AggregationIterations to 5.
+ */
+@property (nonatomic, readonly) NSUInteger aggregationRowCount;
+@property (nonatomic, readonly) NSUInteger aggregationIterations;
+
+/*!
+ * GeoIterations and QueryIterations default to 5.
+ */
+@property (nonatomic, readonly, copy) NSArray *geoRowCounts;
+@property (nonatomic, readonly) NSUInteger geoIterations;
+@property (nonatomic, readonly, copy) NSArray *queryRowCounts;
+@property (nonatomic, readonly) NSUInteger queryIterations;
+
+/*!
+ * QueryCacheOperations defaults to 200, QueryCacheReadRatio to 0.9 when it
+ * is missing or outside (0, 1].
+ */
+@property (nonatomic, readonly) NSUInteger queryCacheOperations;
+@property (nonatomic, readonly) double queryCacheReadRatio;
+
+/*!
+ * ConnectionReuseOperations defaults to 200, ConnectionReuseIdleGap to 5
+ * seconds.
+ */
+@property (nonatomic, readonly) NSUInteger connectionReuseOperations;
+@property (nonatomic, readonly) NSTimeInterval connectionReuseIdleGap;
+
+/*!
+ * FaultInjectionOperations defaults to 100. The rates and the spike are nil
+ * when missing, keeping the benchmark's defaults.
+ */
+@property (nonatomic, readonly) NSUInteger faultInjectionOperations;
+@property (nonatomic, readonly, strong) NSNumber *faultServiceUnavailableRate;
+@property (nonatomic, readonly, strong) NSNumber *faultResetRate;
+@property (nonatomic, readonly, strong) NSNumber *faultLatencySpikeRate;
+@property (nonatomic, readonly, strong) NSNumber *faultLatencySpike;
+
+/*!
+ * Runs one benchmark test: logs and returns nil when RunBenchmarks is off,
+ * otherwise creates the report, runs block and writes the report to
+ * reportDirectory (logging its summary when ShowLogs is set). Returns a
+ * description of the failure when block raised or the report could not be
+ * written, nil otherwise, so a test can STAssertNil the result.
+ */
+- (NSString *)runBenchmark:(NSString *)benchmark provider:(NSString *)provider test:(SEL)test block:(KSBenchmarkBlock)block;
+
+@end
@@ -0,0 +1,182 @@
+//
+//  KSBenchmarkSettings.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSBenchmarkSettings.h"
+#import "KSBenchmarkReport.h"
+
+@implementation KSBenchmarkSettings
+
++ (KSBenchmarkSettings *)settingsWithConfiguration:(NSDictionary *)configuration {
+  return [[KSBenchmarkSettings alloc] initWithConfiguration:configuration];
+}
+
+- (id)init {
+  return [self initWithConfiguration:nil];
+}
+
+- (id)initWithConfiguration:(NSDictionary *)configuration {
+
+  self = [super init];
+
+  if (self) {
+
+    _configuration   = [configuration copy];
+    _showLogs        = [configuration[@"ShowLogs"] boolValue];
+    _runBenchmarks   = [configuration[@"RunBenchmarks"] boolValue];
+    _iterations      = [configuration[@"BenchmarkIterations"] unsignedIntegerValue];
+    _testTimeout     = [configuration[@"TestTimeout"] doubleValue];
+    _reportDirectory = [configuration[@"BenchmarkReportDirectory"] copy];
+    _loadWorkers     = [configuration[@"LoadWorkers"] copy];
+    _loadTargetRate  = [configuration[@"LoadTargetRate"] doubleValue];
+    _loadDuration    = [configuration[@"LoadDuration"] doubleValue];
+    _batchSizes      = [configuration[@"BatchSizes"] copy];
+
+    _teardownConcurrency = [configuration[@"TeardownConcurrency"] unsignedIntegerValue];
+    _payloadSizes        = [configuration[@"PayloadSizes"] copy];
+    _payloadFieldCounts  = [configuration[@"PayloadFieldCounts"] copy];
+    _payloadIterations   = [configuration[@"PayloadIterations"] unsignedIntegerValue];
+    _offlineQueueSizes   = [configuration[@"OfflineQueueSizes"] copy];
+    _startupPasses       = [configuration[@"StartupPasses"] unsignedIntegerValue];
+    _coreDataRowCounts   = [configuration[@"CoreDataRowCounts"] copy];
+    _coreDataStoreTypes  = [configuration[@"CoreDataBenchmarkStoreTypes"] copy];
+
+    _projectionFieldCount  = [configuration[@"ProjectionFieldCount"] unsignedIntegerValue];
+    _blobSizes             = [configuration[@"BlobSizes"] copy];
+    _blobIterations        = [configuration[@"BlobIterations"] unsignedIntegerValue];
+    _aggregationRowCount   = [configuration[@"AggregationRowCount"] unsignedIntegerValue];
+    _aggregationIterations = [configuration[@"AggregationIterations"] unsignedIntegerValue];
+    _geoRowCounts          = [configuration[@"GeoRowCounts"] copy];
+    _geoIterations         = [configuration[@"GeoIterations"] unsignedIntegerValue];
+    _queryRowCounts        = [configuration[@"QueryRowCounts"] copy];
+    _queryIterations       = [configuration[@"QueryIterations"] unsignedIntegerValue];
+    _queryCacheOperations  = [configuration[@"QueryCacheOperations"] unsignedIntegerValue];
+    _queryCacheReadRatio   = [configuration[@"QueryCacheReadRatio"] doubleValue];
+
+    _connectionReuseOperations   = [configuration[@"ConnectionReuseOperations"] unsignedIntegerValue];
+    _connectionReuseIdleGap      = [configuration[@"ConnectionReuseIdleGap"] doubleValue];
+    _faultInjectionOperations    = [configuration[@"FaultInjectionOperations"] unsignedIntegerValue];
+    _faultServiceUnavailableRate = configuration[@"FaultServiceUnavailableRate"];
+    _faultResetRate              = configuration[@"FaultResetRate"];
+    _faultLatencySpikeRate       = configuration[@"FaultLatencySpikeRate"];
+    _faultLatencySpike           = configuration[@"FaultLatencySpike"];
+
+    if (_iterations == 0) {
+      _iterations = 20;
+    }
+
+    if (_testTimeout <= 0) {
+      _testTimeout = 30.0;
+    }
+
+    if ([_loadWorkers count] == 0) {
+      _loadWorkers = @[@1, @4, @16];
+    }
+
+    if (_loadDuration <= 0) {
+      _loadDuration = 10.0;
+    }
+
+    if ([_batchSizes count] == 0) {
+      _batchSizes = @[@1, @10, @100, @1000];
+    }
+
+    if (_teardownConcurrency == 0) {
+      _teardownConcurrency = 8;
+    }
+
+    if (_payloadIterations == 0) {
+      _payloadIterations = 5;
+    }
+
+    if (_startupPasses == 0) {
+      _startupPasses = 5;
+    }
+
+    if (_projectionFieldCount == 0) {
+      _projectionFieldCount = 200;
+    }
+
+    if (_blobIterations == 0) {
+      _blobIterations = 3;
+    }
+
+    if (_aggregationRowCount == 0) {
+      _aggregationRowCount = 100000;
+    }
+
+    if (_aggregationIterations == 0) {
+      _aggregationIterations = 5;
+    }
+
+    if (_geoIterations == 0) {
+      _geoIterations = 5;
+    }
+
+    if (_queryIterations == 0) {
+      _queryIterations = 5;
+    }
+
+    if (_queryCacheOperations == 0) {
+      _queryCacheOperations = 200;
+    }
+
+    if (_queryCacheReadRatio <= 0 || _queryCacheReadRatio > 1) {
+      _queryCacheReadRatio = 0.9;
+    }
+
+    if (_connectionReuseOperations == 0) {
+      _connectionReuseOperations = 200;
+    }
+
+    if (_connectionReuseIdleGap <= 0) {
+      _connectionReuseIdleGap = 5.0;
+    }
+
+    if (_faultInjectionOperations == 0) {
+      _faultInjectionOperations = 100;
+    }
+  }
+
+  return self;
+}
+
+- (NSString *)runBenchmark:(NSString *)benchmark provider:(NSString *)provider test:(SEL)test block:(KSBenchmarkBlock)block {
+
+  if (!_runBenchmarks) {
+    if(_showLogs) NSLog(@"RunBenchmarks is off, skipping %@", NSStringFromSelector(test));
+    return nil;
+  }
+
+  KSBenchmarkReport *report = [KSBenchmarkReport reportWithProvider:provider benchmark:benchmark];
+  BOOL discard              = NO;
+
+  @try {
+    block(report, &discard);
+  } @catch (NSException * e) {
+    return [NSString stringWithFormat:@"test failed: %@", [e description]];
+  }
+
+  if (discard) {
+    return nil;
+  }
+
+  if(_showLogs) {
+    [report logSummary];
+  }
+
+  NSError *error = nil;
+  NSString *path = [report writeToDirectory:_reportDirectory error:&error];
+
+  if (path == nil) {
+    return [NSString stringWithFormat:@"could not write benchmark report: %@", [error localizedDescription]];
+  }
+
+  NSLog(@"%@ %@ report written to %@", provider, benchmark, path);
+
+  return nil;
+}
+
+@end
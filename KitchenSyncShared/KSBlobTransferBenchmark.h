@@ -0,0 +1,105 @@
+//
+//  KSBlobTransferBenchmark.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSPayloadScalingBenchmark.h"
+
+/*!
+ * Uploads source, an NSData on the memory path or the path of a file on the
+ * file path, and calls done with whatever the download and delete blocks
+ * need to find the blob again (a PFFile, a resource id, ...).
+ */
+typedef void (^KSBlobUploadBlock)(id source, NSUInteger iteration, KSBenchmarkCompletion done);
+
+/*!
+ * Downloads blob. With a nil path calls done with the blob as NSData; with a
+ * path writes the blob there and calls done with any non-nil result.
+ */
+typedef void (^KSBlobDownloadBlock)(id blob, NSString *path, KSBenchmarkCompletion done);
+
+/*!
+ * Moves binary payloads of each of blobSizes through an SDK's file API, two
+ * ways where the SDK has both:
+ *
+ * - memory: the payload is an NSData going up and comes back as one;
+ * - file: the payload is read from a file going up and written to one
+ *   coming back, so the SDK can stream it.
+ *
+ * Each path uploads iterations random (incompressible) blobs and downloads
+ * each once. A path missing one direction borrows the other path's upload to
+ * have something to download, untimed. Every transfer runs with the resident
+ * size sampled every few milliseconds; the result row per size and path has
+ * the p50 time, MB/s (10^6 bytes per second at the p50) and the largest rise
+ * in resident size over the transfer, which on the memory path includes the
+ * payload itself, as it would in an app.
+ *
+ * When the size is dropSize and KSStandIn is recording or replaying, each
+ * direction of each path is then run once more and the stand-in drops the
+ * connection dropPoint of the way through (going by the p50). A failed
+ * transfer is retried once, as an app would. The drop row says whether the
+ * SDK noticed, whether the blob got through in the end and how many bytes went
+ * over the wire after the drop: fewer than the blob means the transfer
+ * resumed rather than started over.
+ */
+@interface KSBlobTransferBenchmark : NSObject
+
+- (id)initWithEntity:(NSString *)entity iterations:(NSUInteger)iterations;
+
+/*!
+ * Names the blobs in the report, e.g. "PFFile".
+ */
+@property (nonatomic, readonly, copy) NSString *entity;
+@property (nonatomic, readonly) NSUInteger iterations;
+
+/*!
+ * Seconds to wait for a single transfer. Defaults to 300.
+ */
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+/*!
+ * Deletes run in parallel when cleaning up. Defaults to 8.
+ */
+@property (nonatomic, assign) NSUInteger cleanupConcurrency;
+
+/*!
+ * Blob sizes in bytes. Defaults to 1 KB, 100 KB, 1 MB, 10 MB and 100 MB.
+ */
+@property (nonatomic, copy) NSArray *blobSizes;
+
+/*!
+ * Size to run the drop with; 0 skips it. Defaults to 10 MB.
+ */
+@property (nonatomic, assign) NSUInteger dropSize;
+
+/*!
+ * How far through a transfer the connection is dropped, as a fraction of
+ * the p50. Defaults to 0.5.
+ */
+@property (nonatomic, assign) double dropPoint;
+
+@property (nonatomic, copy) KSBlobUploadBlock   uploadDataBlock;
+@property (nonatomic, copy) KSBlobUploadBlock   uploadFileBlock;
+@property (nonatomic, copy) KSBlobDownloadBlock downloadDataBlock;
+@property (nonatomic, copy) KSBlobDownloadBlock downloadFileBlock;
+
+/*!
+ * Deletes a blob an upload block returned.
+ */
+@property (nonatomic, copy) KSBenchmarkObjectBlock deleteBlock;
+
+/*!
+ * Adds upload and download histograms and a result row per size and path,
+ * and a row per drop, to report.
+ */
+- (void)runWithReport:(KSBenchmarkReport *)report;
+
+/*!
+ * Failed transfers in the last run, leaving out ones the drop caused that
+ * went through on the retry.
+ */
+@property (nonatomic, readonly) NSUInteger errorCount;
+
+@end
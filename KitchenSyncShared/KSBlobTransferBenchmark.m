@@ -0,0 +1,457 @@
+//
+//  KSBlobTransferBenchmark.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSBlobTransferBenchmark.h"
+#import "KSBenchmarkReport.h"
+#import "KSBulkDeleter.h"
+#import "KSCompletionWaiter.h"
+#import "KSLatencyHistogram.h"
+#import "KSMemoryFootprint.h"
+#import "KSMonotonicClock.h"
+#import "KSStandIn.h"
+#import "KSWireMeter.h"
+
+static NSTimeInterval const KSBlobTransferSampleInterval = 0.005;
+static NSUInteger const KSBlobTransferChunkSize          = 1000000;
+
+static NSData *KSBlobPayload(NSUInteger size) {
+
+  NSMutableData *data = [NSMutableData dataWithLength:size];
+
+  arc4random_buf([data mutableBytes], size);
+
+  return data;
+}
+
+@interface KSBlobTransferBenchmark()
+
+@property (nonatomic, readwrite) NSUInteger errorCount;
+
+- (void)runSize:(NSUInteger)size path:(NSString *)path file:(NSString *)file report:(KSBenchmarkReport *)report;
+- (void)dropTransfersOfSize:(NSUInteger)size path:(NSString *)path file:(NSString *)file blob:(id)blob times:(NSArray *)times created:(NSMutableArray *)created report:(KSBenchmarkReport *)report;
+- (void)dropTransfer:(void (^)(KSBenchmarkCompletion done))transfer
+           direction:(NSString *)direction
+                path:(NSString *)path
+                size:(NSUInteger)size
+               after:(NSTimeInterval)delay
+             created:(NSMutableArray *)created
+              report:(KSBenchmarkReport *)report;
+- (NSString *)writePayloadFileOfSize:(NSUInteger)size;
+- (NSString *)scratchPathWithName:(NSString *)name;
+- (void)startSampling;
+- (unsigned long long)stopSampling;
+- (void)deleteBlobs:(NSArray *)blobs;
+
+@end
+
+@implementation KSBlobTransferBenchmark {
+
+  dispatch_queue_t   _samplerQueue;
+  dispatch_source_t  _sampler;
+  unsigned long long _baselineResident;
+  unsigned long long _peakResident;
+}
+
+- (id)initWithEntity:(NSString *)entity iterations:(NSUInteger)iterations {
+
+  self = [super init];
+
+  if (self) {
+    _entity             = [entity copy];
+    _iterations         = iterations;
+    _timeout            = 300.0;
+    _cleanupConcurrency = 8;
+    _blobSizes          = @[@1000, @100000, @1000000, @10000000, @100000000];
+    _dropSize           = 10000000;
+    _dropPoint          = 0.5;
+    _samplerQueue       = dispatch_queue_create("com.kitchensync.blobtransfer.sampler", DISPATCH_QUEUE_SERIAL);
+  }
+
+  return self;
+}
+
+- (void)runWithReport:(KSBenchmarkReport *)report {
+
+  self.errorCount = 0;
+
+  // The meter reads streamed request bodies into memory, which would hide
+  // what the file path saves. The drops put it back to count bytes.
+  [KSWireMeter uninstall];
+
+  for (NSNumber *size in _blobSizes) {
+
+    NSUInteger bytes = [size unsignedIntegerValue];
+    NSString *file   = nil;
+
+    if (_uploadFileBlock) {
+
+      file = [self writePayloadFileOfSize:bytes];
+
+      if (!file) {
+        self.errorCount++;
+        continue;
+      }
+    }
+
+    for (NSString *path in @[@"memory", @"file"]) {
+      [self runSize:bytes path:path file:file report:report];
+    }
+
+    if (file) {
+      [[NSFileManager defaultManager] removeItemAtPath:file error:NULL];
+    }
+  }
+}
+
+- (void)runSize:(NSUInteger)size path:(NSString *)path file:(NSString *)file report:(KSBenchmarkReport *)report {
+
+  BOOL memory                  = [path isEqualToString:@"memory"];
+  KSBlobUploadBlock upload     = memory ? _uploadDataBlock : _uploadFileBlock;
+  KSBlobDownloadBlock download = memory ? _downloadDataBlock : _downloadFileBlock;
+
+  if (!upload && !download) {
+    return;
+  }
+
+  // A path that only downloads gets its blobs from the other path's upload.
+  BOOL uploadFromMemory         = upload ? memory : !memory;
+  KSBlobUploadBlock setupUpload = upload ? upload : (memory ? _uploadFileBlock : _uploadDataBlock);
+
+  if (!setupUpload) {
+    NSLog(@"%@ blob transfer: nothing to upload %@ blobs with", _entity, path);
+    return;
+  }
+
+  NSString *prefix         = [NSString stringWithFormat:@"%@.%@", _entity, path];
+  KSLatencyHistogram *up   = [KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:upload ? @".upload" : @".setup"]];
+  KSLatencyHistogram *down = [KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:@".download"]];
+  NSDictionary *attributes = @{@"entity" : _entity, @"path" : path, @"size_bytes" : @(size)};
+  NSMutableArray *blobs    = [NSMutableArray arrayWithCapacity:_iterations];
+  NSMutableArray *times    = [NSMutableArray arrayWithCapacity:2];
+
+  unsigned long long uploadPeak   = 0;
+  unsigned long long downloadPeak = 0;
+  NSUInteger mismatched           = 0;
+
+  for (NSUInteger i = 0; i < _iterations; i++) {
+
+    @autoreleasepool {
+
+      [self startSampling];
+
+      // Made inside the sample, so the memory path pays for holding it.
+      id source = uploadFromMemory ? KSBlobPayload(size) : file;
+
+      id blob = [up measure:^(KSBenchmarkCompletion done) {
+        setupUpload(source, i, done);
+      } timeout:_timeout];
+
+      source = nil;
+
+      uploadPeak = MAX(uploadPeak, [self stopSampling]);
+
+      if (blob) {
+        [blobs addObject:blob];
+      }
+    }
+  }
+
+  if (download) {
+
+    for (id blob in blobs) {
+
+      @autoreleasepool {
+
+        NSString *target            = memory ? nil : [self scratchPathWithName:[NSString stringWithFormat:@"%@-download", prefix]];
+        unsigned long long received = 0;
+
+        [self startSampling];
+
+        id result = [down measure:^(KSBenchmarkCompletion done) {
+          download(blob, target, done);
+        } timeout:_timeout];
+
+        if (result) {
+          received = memory ? [result length] : [[[NSFileManager defaultManager] attributesOfItemAtPath:target error:NULL] fileSize];
+        }
+
+        result = nil;
+
+        downloadPeak = MAX(downloadPeak, [self stopSampling]);
+
+        if (target) {
+          [[NSFileManager defaultManager] removeItemAtPath:target error:NULL];
+        }
+
+        if (received > 0 && received != size) {
+          mismatched++;
+        }
+      }
+    }
+  }
+
+  NSMutableDictionary *result = [@{@"entity"     : _entity,
+                                   @"path"       : path,
+                                   @"size_bytes" : @(size),
+                                   @"blobs"      : @([blobs count])} mutableCopy];
+
+  if (upload) {
+
+    NSTimeInterval p50 = [up percentile:50];
+
+    [report addHistogram:up withAttributes:attributes];
+
+    [times addObject:@(p50)];
+
+    result[@"upload_p50_s"]               = @(p50);
+    result[@"upload_mb_s"]                = @(p50 > 0 ? size / p50 / 1e6 : 0);
+    result[@"upload_peak_resident_bytes"] = @(uploadPeak);
+    result[@"upload_errors"]              = @(up.errorCount);
+  } else {
+    [times addObject:@0];
+  }
+
+  if (download) {
+
+    NSTimeInterval p50 = [down percentile:50];
+
+    [report addHistogram:down withAttributes:attributes];
+
+    [times addObject:@(p50)];
+
+    result[@"download_p50_s"]               = @(p50);
+    result[@"download_mb_s"]                = @(p50 > 0 ? size / p50 / 1e6 : 0);
+    result[@"download_peak_resident_bytes"] = @(downloadPeak);
+    result[@"download_errors"]              = @(down.errorCount);
+    result[@"download_size_mismatches"]     = @(mismatched);
+  } else {
+    [times addObject:@0];
+  }
+
+  [report addResult:result];
+
+  NSLog(@"%@ %lu bytes: up %.2f MB/s, down %.2f MB/s, peak resident +%llu / +%llu bytes",
+        prefix, (unsigned long)size, [result[@"upload_mb_s"] doubleValue], [result[@"download_mb_s"] doubleValue], uploadPeak, downloadPeak);
+
+  if (up.errorCount + down.errorCount + mismatched > 0) {
+    self.errorCount += up.errorCount + down.errorCount + mismatched;
+    NSLog(@"%@: %lu uploads and %lu downloads failed, %lu came back the wrong size: %@",
+          prefix, (unsigned long)up.errorCount, (unsigned long)down.errorCount, (unsigned long)mismatched,
+          [up.errors lastObject] ? [up.errors lastObject] : [down.errors lastObject]);
+  }
+
+  if (size == _dropSize && [blobs count] > 0) {
+    [self dropTransfersOfSize:size path:path file:file blob:blobs[0] times:times created:blobs report:report];
+  }
+
+  [self deleteBlobs:blobs];
+}
+
+#pragma mark - Drops
+
+/*!
+ * times holds the upload and download p50s, 0 for a direction the path does
+ * not time.
+ */
+- (void)dropTransfersOfSize:(NSUInteger)size path:(NSString *)path file:(NSString *)file blob:(id)blob times:(NSArray *)times created:(NSMutableArray *)created report:(KSBenchmarkReport *)report {
+
+  if ([KSStandIn mode] == KSStandInModeOff) {
+    NSLog(@"%@.%@: the stand-in is off, so there is no connection to drop", _entity, path);
+    return;
+  }
+
+  BOOL memory                  = [path isEqualToString:@"memory"];
+  KSBlobUploadBlock upload     = memory ? _uploadDataBlock : _uploadFileBlock;
+  KSBlobDownloadBlock download = memory ? _downloadDataBlock : _downloadFileBlock;
+  NSTimeInterval uploadTime    = [times[0] doubleValue];
+  NSTimeInterval downloadTime  = [times[1] doubleValue];
+
+  if (upload && uploadTime > 0) {
+
+    id source = memory ? KSBlobPayload(size) : file;
+
+    [self dropTransfer:^(KSBenchmarkCompletion done) {
+      upload(source, 0, done);
+    } direction:@"upload" path:path size:size after:uploadTime * _dropPoint created:created report:report];
+  }
+
+  if (download && downloadTime > 0) {
+
+    NSString *target = memory ? nil : [self scratchPathWithName:[NSString stringWithFormat:@"%@.%@-drop", _entity, path]];
+
+    [self dropTransfer:^(KSBenchmarkCompletion done) {
+      download(blob, target, done);
+    } direction:@"download" path:path size:size after:downloadTime * _dropPoint created:nil report:report];
+
+    if (target) {
+      [[NSFileManager defaultManager] removeItemAtPath:target error:NULL];
+    }
+  }
+}
+
+/*!
+ * Runs transfer, drops the stand-in's connections delay seconds in and
+ * retries once if the transfer failed. Uploaded blobs go into created.
+ */
+- (void)dropTransfer:(void (^)(KSBenchmarkCompletion done))transfer
+           direction:(NSString *)direction
+                path:(NSString *)path
+                size:(NSUInteger)size
+               after:(NSTimeInterval)delay
+             created:(NSMutableArray *)created
+              report:(KSBenchmarkReport *)report {
+
+  NSString *prefix             = [NSString stringWithFormat:@"%@.%@.%@", _entity, path, direction];
+  KSLatencyHistogram *attempts = [KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:@".drop"]];
+  KSCompletionWaiter *dropped  = [KSCompletionWaiter waiter];
+  BOOL upload                  = [direction isEqualToString:@"upload"];
+  __block NSUInteger cut       = 0;
+
+  [KSWireMeter install];
+
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    [KSWireMeter reset];
+    cut = [KSStandIn dropConnections];
+    [dropped signal];
+  });
+
+  NSTimeInterval start = KSMonotonicTime();
+  id first             = [attempts measure:transfer timeout:_timeout];
+
+  // The retry must not race the drop.
+  [dropped waitWithTimeout:delay + _timeout];
+
+  id second                = first ? nil : [attempts measure:transfer timeout:_timeout];
+  NSTimeInterval recovery  = KSMonotonicTime() - start;
+  unsigned long long after = upload ? [KSWireMeter bytesSent] : [KSWireMeter bytesReceived];
+  BOOL recovered           = first || second;
+
+  [KSWireMeter uninstall];
+
+  if (upload) {
+    if (first) {
+      [created addObject:first];
+    }
+    if (second) {
+      [created addObject:second];
+    }
+  }
+
+  [report addResult:@{@"entity"               : _entity,
+                      @"path"                 : path,
+                      @"direction"            : direction,
+                      @"size_bytes"           : @(size),
+                      @"drop_after_s"         : @(delay),
+                      @"dropped_requests"     : @(cut),
+                      @"first_attempt_failed" : @(first == nil),
+                      @"recovered"            : @(recovered),
+                      @"recovery_s"           : @(recovery),
+                      @"bytes_after_drop"     : @(after),
+                      @"resumed"              : @(recovered && cut > 0 && after < size)}];
+
+  if (cut == 0) {
+    NSLog(@"%@: the transfer was over before the drop", prefix);
+  } else {
+    NSLog(@"%@: dropped %lu requests, %@, %llu bytes after the drop",
+          prefix, (unsigned long)cut, recovered ? (first ? @"the SDK carried on" : @"the retry went through") : @"the retry failed too", after);
+  }
+
+  if (!recovered) {
+    self.errorCount++;
+    NSLog(@"%@: %@", prefix, [attempts.errors lastObject]);
+  }
+}
+
+#pragma mark - Files
+
+/*!
+ * Writes size random bytes a chunk at a time, so the file path never holds
+ * the whole payload in memory.
+ */
+- (NSString *)writePayloadFileOfSize:(NSUInteger)size {
+
+  NSString *path = [self scratchPathWithName:[NSString stringWithFormat:@"%@-%lu.bin", _entity, (unsigned long)size]];
+
+  if (![[NSFileManager defaultManager] createFileAtPath:path contents:nil attributes:nil]) {
+    NSLog(@"%@ blob transfer: could not create %@", _entity, path);
+    return nil;
+  }
+
+  NSFileHandle *handle = [NSFileHandle fileHandleForWritingAtPath:path];
+
+  for (NSUInteger written = 0; written < size; written += KSBlobTransferChunkSize) {
+    @autoreleasepool {
+      [handle writeData:KSBlobPayload(MIN(KSBlobTransferChunkSize, size - written))];
+    }
+  }
+
+  [handle closeFile];
+
+  return path;
+}
+
+- (NSString *)scratchPathWithName:(NSString *)name {
+
+  NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:@"KitchenSyncBlobs"];
+
+  [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+
+  return [directory stringByAppendingPathComponent:name];
+}
+
+#pragma mark - Resident size
+
+- (void)startSampling {
+
+  _baselineResident = KSResidentBytes();
+  _peakResident     = _baselineResident;
+  _sampler          = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, _samplerQueue);
+
+  dispatch_source_set_timer(_sampler, DISPATCH_TIME_NOW, (uint64_t)(KSBlobTransferSampleInterval * NSEC_PER_SEC), (uint64_t)(KSBlobTransferSampleInterval * NSEC_PER_SEC / 10));
+  dispatch_source_set_event_handler(_sampler, ^{
+    _peakResident = MAX(_peakResident, KSResidentBytes());
+  });
+  dispatch_resume(_sampler);
+}
+
+/*!
+ * Returns the largest rise in resident size since -startSampling.
+ */
+- (unsigned long long)stopSampling {
+
+  __block unsigned long long peak = 0;
+
+  dispatch_sync(_samplerQueue, ^{
+    dispatch_source_cancel(_sampler);
+    peak = MAX(_peakResident, KSResidentBytes());
+  });
+
+  _sampler = nil;
+
+  return peak > _baselineResident ? peak - _baselineResident : 0;
+}
+
+- (void)deleteBlobs:(NSArray *)blobs {
+
+  if ([blobs count] == 0 || !_deleteBlock) {
+    return;
+  }
+
+  KSBenchmarkObjectBlock block = _deleteBlock;
+  KSBulkDeleter *deleter       = [KSBulkDeleter deleterWithMaxConcurrentDeletes:_cleanupConcurrency];
+
+  [deleter deleteItems:blobs withBlock:^(id blob, KSBulkDeleteCompletion done) {
+    block(blob, 0, ^(id result, NSError *error) {
+      done(error);
+    });
+  }];
+
+  if (![deleter waitWithTimeout:_timeout * MAX(1, [blobs count] / MAX(_cleanupConcurrency, 1))] || deleter.failedCount > 0) {
+    NSLog(@"%@ blob transfer left %lu blobs behind", _entity, (unsigned long)([blobs count] - deleter.deletedCount));
+  }
+}
+
+@end
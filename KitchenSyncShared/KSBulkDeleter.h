@@ -0,0 +1,121 @@
+//
+//  KSBulkDeleter.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+
+/*!
+ * Called exactly once by a delete block when its request has finished. Pass
+ * nil on success.
+ */
+typedef void (^KSBulkDeleteCompletion)(NSError *error);
+
+/*!
+ * Deletes a single item and calls done when the backend has answered.
+ */
+typedef void (^KSBulkDeleteItemBlock)(id item, KSBulkDeleteCompletion done);
+
+/*!
+ * Deletes a batch of items with one provider call (or one batch of HTTP
+ * operations) and calls done when every item in it has been handled.
+ */
+typedef void (^KSBulkDeleteBatchBlock)(NSArray *items, KSBulkDeleteCompletion done);
+
+/*!
+ * Deletes test data with a bounded number of requests in flight.
+ *
+ * Work is handed to the delete blocks on the invocation queue. Keep the main
+ * queue (the default) for SDKs that call back on the main thread, so their
+ * callbacks are serviced while the test waits. Use a global queue for SDKs
+ * whose delete call is synchronous.
+ *
+ *   KSBulkDeleter *deleter = [KSBulkDeleter deleter];
+ *   [deleter deleteItems:objects withBlock:^(id obj, KSBulkDeleteCompletion done) { ... }];
+ *   STAssertNil([deleter waitAndReportNamed:@"Foo" timeout:30.0], nil);
+ */
+@interface KSBulkDeleter : NSObject
+
+/*!
+ * Returns a deleter allowing 8 requests in flight, with batches of 50.
+ */
++ (KSBulkDeleter *)deleter;
+
++ (KSBulkDeleter *)deleterWithMaxConcurrentDeletes:(NSUInteger)maxConcurrentDeletes;
+
+/*!
+ * Returns a deleter set up from a provider configuration dictionary: it
+ * allows TeardownConcurrency requests in flight (8 when the key is missing
+ * or 0) and logs its results when ShowLogs is set.
+ */
++ (KSBulkDeleter *)deleterWithConfiguration:(NSDictionary *)configuration;
+
+- (id)initWithMaxConcurrentDeletes:(NSUInteger)maxConcurrentDeletes;
+
+/*!
+ * Maximum number of delete blocks whose done callback is outstanding.
+ * Fixed when the deleter is created.
+ */
+@property (nonatomic, readonly) NSUInteger maxConcurrentDeletes;
+
+/*!
+ * Number of items passed to each call of a batch block.
+ */
+@property (nonatomic, assign) NSUInteger batchSize;
+
+/*!
+ * Queue the delete blocks are invoked on. Defaults to the main queue.
+ */
+@property (nonatomic, strong) dispatch_queue_t invocationQueue;
+
+/*!
+ * YES to have -waitAndReportNamed:timeout: log how many items it deleted.
+ */
+@property (nonatomic, assign) BOOL showLogs;
+
+/*!
+ * Submits each item to block. Returns immediately.
+ */
+- (void)deleteItems:(NSArray *)items withBlock:(KSBulkDeleteItemBlock)block;
+
+/*!
+ * Splits items into batchSize chunks and submits each chunk to block.
+ * Returns immediately.
+ */
+- (void)deleteItems:(NSArray *)items inBatchesWithBlock:(KSBulkDeleteBatchBlock)block;
+
+/*!
+ * Waits until every submitted delete has called back. Returns NO if timeout
+ * seconds passed first. No more items may be submitted afterwards.
+ */
+- (BOOL)waitWithTimeout:(NSTimeInterval)timeout;
+
+/*!
+ * Waits like -waitWithTimeout: and describes what went wrong, naming the
+ * deleted data after name. Returns nil when every delete finished in time
+ * without an error, so a test can STAssertNil the result.
+ */
+- (NSString *)waitAndReportNamed:(NSString *)name timeout:(NSTimeInterval)timeout;
+
+/*!
+ * Items whose delete has finished without an error.
+ */
+@property (nonatomic, readonly) NSUInteger deletedCount;
+
+/*!
+ * Items whose delete returned an error.
+ */
+@property (nonatomic, readonly) NSUInteger failedCount;
+
+/*!
+ * Errors reported by the delete blocks, in completion order.
+ */
+@property (nonatomic, readonly) NSArray *errors;
+
+/*!
+ * Seconds spent in the last call to -waitWithTimeout:.
+ */
+@property (nonatomic, readonly) NSTimeInterval elapsed;
+
+@end
@@ -0,0 +1,210 @@
+//
+//  KSBulkDeleter.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSBulkDeleter.h"
+#import "KSCompletionWaiter.h"
+
+static NSString * const KSBulkDeleterErrorDomain = @"KSBulkDeleterErrorDomain";
+
+@interface KSBulkDeleter()
+
+@property (nonatomic, readwrite) NSTimeInterval elapsed;
+
+- (void)enqueueItemCount:(NSUInteger)count work:(void (^)(KSBulkDeleteCompletion done))work;
+
+@end
+
+@implementation KSBulkDeleter {
+
+  dispatch_queue_t     _feederQueue;
+  dispatch_semaphore_t _slots;
+  KSCompletionWaiter  *_waiter;
+  BOOL                 _sealed;
+  NSUInteger           _deletedCount;
+  NSUInteger           _failedCount;
+  NSMutableArray      *_errors;
+}
+
++ (KSBulkDeleter *)deleter {
+  return [[KSBulkDeleter alloc] initWithMaxConcurrentDeletes:8];
+}
+
++ (KSBulkDeleter *)deleterWithMaxConcurrentDeletes:(NSUInteger)maxConcurrentDeletes {
+  return [[KSBulkDeleter alloc] initWithMaxConcurrentDeletes:maxConcurrentDeletes];
+}
+
++ (KSBulkDeleter *)deleterWithConfiguration:(NSDictionary *)configuration {
+
+  NSUInteger concurrency = [configuration[@"TeardownConcurrency"] unsignedIntegerValue];
+  KSBulkDeleter *deleter = [[KSBulkDeleter alloc] initWithMaxConcurrentDeletes:(concurrency > 0 ? concurrency : 8)];
+
+  deleter.showLogs = [configuration[@"ShowLogs"] boolValue];
+
+  return deleter;
+}
+
+- (id)init {
+  return [self initWithMaxConcurrentDeletes:8];
+}
+
+- (id)initWithMaxConcurrentDeletes:(NSUInteger)maxConcurrentDeletes {
+
+  self = [super init];
+
+  if (self) {
+
+    _maxConcurrentDeletes = MAX(maxConcurrentDeletes, 1);
+    _batchSize            = 50;
+    _invocationQueue      = dispatch_get_main_queue();
+    _feederQueue          = dispatch_queue_create("com.kitchensync.bulkdeleter", DISPATCH_QUEUE_SERIAL);
+    _slots                = dispatch_semaphore_create(_maxConcurrentDeletes);
+    _errors               = [NSMutableArray array];
+
+    // The extra signal is released by -waitWithTimeout:, so the waiter cannot
+    // complete while items are still being submitted.
+    _waiter = [KSCompletionWaiter waiter];
+  }
+
+  return self;
+}
+
+- (NSUInteger)deletedCount {
+  @synchronized(self) {
+    return _deletedCount;
+  }
+}
+
+- (NSUInteger)failedCount {
+  @synchronized(self) {
+    return _failedCount;
+  }
+}
+
+- (NSArray *)errors {
+  @synchronized(self) {
+    return [_errors copy];
+  }
+}
+
+- (void)deleteItems:(NSArray *)items withBlock:(KSBulkDeleteItemBlock)block {
+
+  for (id item in items) {
+    [self enqueueItemCount:1 work:^(KSBulkDeleteCompletion done) {
+      block(item, done);
+    }];
+  }
+}
+
+- (void)deleteItems:(NSArray *)items inBatchesWithBlock:(KSBulkDeleteBatchBlock)block {
+
+  NSUInteger batchSize = MAX(_batchSize, 1);
+
+  for (NSUInteger location = 0; location < [items count]; location += batchSize) {
+
+    NSArray *batch = [items subarrayWithRange:NSMakeRange(location, MIN(batchSize, [items count] - location))];
+
+    [self enqueueItemCount:[batch count] work:^(KSBulkDeleteCompletion done) {
+      block(batch, done);
+    }];
+  }
+}
+
+/*!
+ * Waits on the feeder queue for a free slot, then runs work on the
+ * invocation queue. The slot is returned when work calls done.
+ */
+- (void)enqueueItemCount:(NSUInteger)count work:(void (^)(KSBulkDeleteCompletion done))work {
+
+  @synchronized(self) {
+    NSAssert(!_sealed, @"items submitted after -waitWithTimeout:");
+  }
+
+  [_waiter expectSignal];
+
+  dispatch_async(_feederQueue, ^{
+
+    dispatch_semaphore_wait(_slots, DISPATCH_TIME_FOREVER);
+
+    __block BOOL finished = NO;
+
+    KSBulkDeleteCompletion done = ^(NSError *error) {
+
+      @synchronized(self) {
+
+        if (finished) {
+          return;
+        }
+
+        finished = YES;
+
+        if (error) {
+          _failedCount += count;
+          [_errors addObject:error];
+        } else {
+          _deletedCount += count;
+        }
+      }
+
+      dispatch_semaphore_signal(_slots);
+      [_waiter signal];
+    };
+
+    dispatch_async(_invocationQueue, ^{
+      @try {
+        work(done);
+      } @catch (NSException *e) {
+        done([NSError errorWithDomain:KSBulkDeleterErrorDomain
+                                 code:0
+                             userInfo:@{NSLocalizedDescriptionKey : [e description]}]);
+      }
+    });
+  });
+}
+
+- (BOOL)waitWithTimeout:(NSTimeInterval)timeout {
+
+  BOOL seal = NO;
+
+  @synchronized(self) {
+    if (!_sealed) {
+      _sealed = YES;
+      seal    = YES;
+    }
+  }
+
+  if (seal) {
+    [_waiter signal];
+  }
+
+  BOOL completed = [_waiter waitWithTimeout:timeout];
+
+  self.elapsed = _waiter.elapsed;
+
+  return completed;
+}
+
+- (NSString *)waitAndReportNamed:(NSString *)name timeout:(NSTimeInterval)timeout {
+
+  BOOL completed = [self waitWithTimeout:timeout];
+
+  if (!completed) {
+    return [NSString stringWithFormat:@"deleting %@ timed out after %.3fs", name, self.elapsed];
+  }
+
+  NSUInteger failed = self.failedCount;
+
+  if (failed > 0) {
+    return [NSString stringWithFormat:@"%lu %@ deletes failed: %@", (unsigned long)failed, name, self.errors];
+  }
+
+  if (_showLogs) {
+    NSLog(@"deleted %lu %@ objects in %.3f ms", (unsigned long)self.deletedCount, name, self.elapsed * 1000.0);
+  }
+
+  return nil;
+}
+
+@end
@@ -0,0 +1,67 @@
+//
+//  KSCRUDBenchmark.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSLatencyHistogram.h"
+
+@class KSBenchmarkReport;
+
+/*!
+ * Starts an operation for the given iteration. Call done with the object the
+ * operation produced (for create, the saved object).
+ */
+typedef void (^KSBenchmarkIterationBlock)(NSUInteger iteration, KSBenchmarkCompletion done);
+
+/*!
+ * Starts an operation on an object returned by the create block.
+ */
+typedef void (^KSBenchmarkObjectBlock)(id object, NSUInteger iteration, KSBenchmarkCompletion done);
+
+/*!
+ * Times create, read-by-id, query, update and delete against one entity.
+ *
+ * Each verb runs as its own phase over all iterations: every object is
+ * created, then each is read back, queried for, updated and finally deleted.
+ * The blocks are provider specific; the runner only measures them and waits
+ * for each to call done before starting the next, so latencies are not
+ * affected by queueing inside the SDK.
+ */
+@interface KSCRUDBenchmark : NSObject
+
+- (id)initWithEntity:(NSString *)entity iterations:(NSUInteger)iterations;
+
+@property (nonatomic, readonly, copy) NSString *entity;
+@property (nonatomic, readonly) NSUInteger iterations;
+
+/*!
+ * Seconds to wait for a single operation before counting it as failed.
+ * Defaults to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+@property (nonatomic, copy) KSBenchmarkIterationBlock createBlock;
+@property (nonatomic, copy) KSBenchmarkObjectBlock    readBlock;
+@property (nonatomic, copy) KSBenchmarkIterationBlock queryBlock;
+@property (nonatomic, copy) KSBenchmarkObjectBlock    updateBlock;
+@property (nonatomic, copy) KSBenchmarkObjectBlock    deleteBlock;
+
+/*!
+ * Runs every phase that has a block and adds one histogram per verb
+ * ("<entity>.create", ...) to report.
+ */
+- (void)runWithReport:(KSBenchmarkReport *)report;
+
+/*!
+ * The histograms from the last run.
+ */
+@property (nonatomic, readonly) NSArray *histograms;
+
+/*!
+ * Total failed operations in the last run.
+ */
+@property (nonatomic, readonly) NSUInteger errorCount;
+
+@end
@@ -0,0 +1,126 @@
+//
+//  KSCRUDBenchmark.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSCRUDBenchmark.h"
+#import "KSBenchmarkReport.h"
+#import "KSMonotonicClock.h"
+
+@interface KSCRUDBenchmark()
+
+@property (nonatomic, readwrite) NSArray *histograms;
+
+- (KSLatencyHistogram *)runPhase:(NSString *)verb
+                         objects:(NSArray *)objects
+                  iterationBlock:(KSBenchmarkIterationBlock)iterationBlock
+                     objectBlock:(KSBenchmarkObjectBlock)objectBlock
+                         results:(NSMutableArray *)results;
+
+@end
+
+@implementation KSCRUDBenchmark
+
+- (id)initWithEntity:(NSString *)entity iterations:(NSUInteger)iterations {
+
+  self = [super init];
+
+  if (self) {
+    _entity     = [entity copy];
+    _iterations = iterations;
+    _timeout    = 30.0;
+  }
+
+  return self;
+}
+
+- (NSUInteger)errorCount {
+
+  NSUInteger errorCount = 0;
+
+  for (KSLatencyHistogram *histogram in _histograms) {
+    errorCount += histogram.errorCount;
+  }
+
+  return errorCount;
+}
+
+- (void)runWithReport:(KSBenchmarkReport *)report {
+
+  NSMutableArray *histograms = [NSMutableArray array];
+  NSMutableArray *objects    = [NSMutableArray arrayWithCapacity:_iterations];
+
+  if (_createBlock) {
+    [histograms addObject:[self runPhase:@"create" objects:nil iterationBlock:_createBlock objectBlock:nil results:objects]];
+  }
+
+  if (_readBlock) {
+    [histograms addObject:[self runPhase:@"read" objects:objects iterationBlock:nil objectBlock:_readBlock results:nil]];
+  }
+
+  if (_queryBlock) {
+    [histograms addObject:[self runPhase:@"query" objects:nil iterationBlock:_queryBlock objectBlock:nil results:nil]];
+  }
+
+  if (_updateBlock) {
+
+    NSMutableArray *updated = [NSMutableArray arrayWithCapacity:[objects count]];
+
+    [histograms addObject:[self runPhase:@"update" objects:objects iterationBlock:nil objectBlock:_updateBlock results:updated]];
+
+    // Some SDKs hand back a fresh object from an update; delete that one.
+    if ([updated count] == [objects count]) {
+      objects = updated;
+    }
+  }
+
+  if (_deleteBlock) {
+    [histograms addObject:[self runPhase:@"delete" objects:objects iterationBlock:nil objectBlock:_deleteBlock results:nil]];
+  }
+
+  self.histograms = histograms;
+
+  for (KSLatencyHistogram *histogram in histograms) {
+    [report addHistogram:histogram withAttributes:@{@"entity" : _entity}];
+  }
+}
+
+/*!
+ * Runs one verb either once per iteration or once per object, one operation
+ * at a time. Results that came back non-nil are collected into results.
+ */
+- (KSLatencyHistogram *)runPhase:(NSString *)verb
+                         objects:(NSArray *)objects
+                  iterationBlock:(KSBenchmarkIterationBlock)iterationBlock
+                     objectBlock:(KSBenchmarkObjectBlock)objectBlock
+                         results:(NSMutableArray *)results {
+
+  KSLatencyHistogram *histogram = [KSLatencyHistogram histogramWithName:[NSString stringWithFormat:@"%@.%@", _entity, verb]];
+
+  NSUInteger count         = objectBlock ? [objects count] : _iterations;
+  NSTimeInterval startedAt = KSMonotonicTime();
+
+  for (NSUInteger i = 0; i < count; i++) {
+
+    id object = objectBlock ? objects[i] : nil;
+
+    id result = [histogram measure:^(KSBenchmarkCompletion done) {
+      if (objectBlock) {
+        objectBlock(object, i, done);
+      } else {
+        iterationBlock(i, done);
+      }
+    } timeout:_timeout];
+
+    if (result) {
+      [results addObject:result];
+    }
+  }
+
+  histogram.wallTime = KSMonotonicTime() - startedAt;
+
+  return histogram;
+}
+
+@end
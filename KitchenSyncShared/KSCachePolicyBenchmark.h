@@ -0,0 +1,80 @@
+//
+//  KSCachePolicyBenchmark.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSCRUDBenchmark.h"
+
+/*!
+ * Reads object under the given cache policy and calls done with the value of
+ * the benchmark field, as returned by the SDK.
+ */
+typedef void (^KSCachePolicyReadBlock)(NSInteger policy, id object, KSBenchmarkCompletion done);
+
+/*!
+ * Sets the benchmark field of object to value on the backend, bypassing any
+ * cache, and calls done once the backend has it.
+ */
+typedef void (^KSCachePolicyWriteBlock)(id object, NSString *value, KSBenchmarkCompletion done);
+
+/*!
+ * Empties whatever cache the given policy reads from. Runs synchronously.
+ */
+typedef void (^KSCachePolicyClearBlock)(NSInteger policy);
+
+/*!
+ * Runs the same read workload against one object under each registered cache
+ * policy.
+ *
+ * Every iteration writes a new value, clears the cache, reads twice (cold and
+ * warm), writes again and reads once more. A read counts as a cache hit when
+ * KSWireMeter saw no request between starting it and its completion; a
+ * background refresh started by an earlier read can turn a hit into a miss,
+ * never the other way round. A read is stale when it returns a value other
+ * than the last one written, and its staleness is how long ago that value
+ * was replaced.
+ *
+ * Policies that never touch the network are expected to fail cold reads;
+ * read failures are reported per policy and not counted as errors.
+ */
+@interface KSCachePolicyBenchmark : NSObject
+
+- (id)initWithEntity:(NSString *)entity iterations:(NSUInteger)iterations;
+
+@property (nonatomic, readonly, copy) NSString *entity;
+@property (nonatomic, readonly) NSUInteger iterations;
+
+/*!
+ * Seconds to wait for a single operation. Defaults to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+/*!
+ * Adds a policy to the matrix. Policies run in the order they were added.
+ */
+- (void)addPolicy:(NSInteger)policy named:(NSString *)name;
+
+/*!
+ * Creates the object the reads run against, once per policy.
+ */
+@property (nonatomic, copy) KSBenchmarkIterationBlock createBlock;
+@property (nonatomic, copy) KSCachePolicyReadBlock    readBlock;
+@property (nonatomic, copy) KSCachePolicyWriteBlock   writeBlock;
+@property (nonatomic, copy) KSCachePolicyClearBlock   clearCacheBlock;
+@property (nonatomic, copy) KSBenchmarkObjectBlock    deleteBlock;
+
+/*!
+ * Adds cold, warm and after-write histograms and a result row per policy to
+ * report. Returns NO when an object could not be created or written, which
+ * leaves that policy's numbers meaningless.
+ */
+- (BOOL)runWithReport:(KSBenchmarkReport *)report;
+
+/*!
+ * Failed creates and writes in the last run.
+ */
+@property (nonatomic, readonly) NSUInteger errorCount;
+
+@end
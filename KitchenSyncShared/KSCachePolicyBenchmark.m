@@ -0,0 +1,314 @@
+//
+//  KSCachePolicyBenchmark.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSCachePolicyBenchmark.h"
+#import "KSBenchmarkReport.h"
+#import "KSCompletionWaiter.h"
+#import "KSMonotonicClock.h"
+#import "KSWireMeter.h"
+
+static NSString * const KSCachePolicyBenchmarkErrorDomain = @"KSCachePolicyBenchmarkErrorDomain";
+
+/*!
+ * Outcome counts for the reads of one phase. Failed reads are in the phase's
+ * histogram.
+ */
+typedef struct {
+  NSUInteger reads;
+  NSUInteger hits;
+  NSUInteger stale;
+  NSUInteger empty;
+} KSCachePolicyTally;
+
+@interface KSCachePolicyBenchmark()
+
+@property (nonatomic, readwrite) NSUInteger errorCount;
+
+- (BOOL)runPolicy:(NSInteger)policy named:(NSString *)name report:(KSBenchmarkReport *)report;
+- (void)readObject:(id)object
+            policy:(NSInteger)policy
+         histogram:(KSLatencyHistogram *)histogram
+             tally:(KSCachePolicyTally *)tally;
+- (BOOL)writeValue:(NSString *)value toObject:(id)object;
+- (id)waitFor:(void (^)(KSBenchmarkCompletion done))operation error:(NSError **)error;
+
+@end
+
+@implementation KSCachePolicyBenchmark {
+
+  NSMutableArray      *_policies;
+  NSMutableArray      *_policyNames;
+  NSString            *_runTag;
+
+  // Per policy run: the value last written, when each earlier value was
+  // overwritten, and how old the stale values read were.
+  NSString            *_currentValue;
+  NSMutableDictionary *_replacedAt;
+  KSLatencyHistogram  *_staleness;
+}
+
+- (id)initWithEntity:(NSString *)entity iterations:(NSUInteger)iterations {
+
+  self = [super init];
+
+  if (self) {
+    _entity      = [entity copy];
+    _iterations  = iterations;
+    _timeout     = 30.0;
+    _policies    = [NSMutableArray array];
+    _policyNames = [NSMutableArray array];
+    _runTag      = [[NSProcessInfo processInfo] globallyUniqueString];
+  }
+
+  return self;
+}
+
+- (void)addPolicy:(NSInteger)policy named:(NSString *)name {
+  [_policies addObject:@(policy)];
+  [_policyNames addObject:name];
+}
+
+- (BOOL)runWithReport:(KSBenchmarkReport *)report {
+
+  [KSWireMeter install];
+
+  self.errorCount = 0;
+
+  BOOL succeeded = YES;
+
+  for (NSUInteger i = 0; i < [_policies count]; i++) {
+    succeeded = [self runPolicy:[_policies[i] integerValue] named:_policyNames[i] report:report] && succeeded;
+  }
+
+  return succeeded;
+}
+
+- (BOOL)runPolicy:(NSInteger)policy named:(NSString *)name report:(KSBenchmarkReport *)report {
+
+  NSString *prefix                   = [NSString stringWithFormat:@"%@.%@", _entity, name];
+  KSLatencyHistogram *cold           = [KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:@".cold"]];
+  KSLatencyHistogram *warm           = [KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:@".warm"]];
+  KSLatencyHistogram *afterWrite     = [KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:@".after_write"]];
+  KSBenchmarkIterationBlock create   = _createBlock;
+  KSCachePolicyTally coldTally       = {0, 0, 0, 0};
+  KSCachePolicyTally warmTally       = {0, 0, 0, 0};
+  KSCachePolicyTally afterWriteTally = {0, 0, 0, 0};
+
+  _currentValue = nil;
+  _replacedAt   = [NSMutableDictionary dictionary];
+  _staleness    = [KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:@".staleness"]];
+
+  NSError *error = nil;
+
+  id object = [self waitFor:^(KSBenchmarkCompletion done) {
+    create(0, done);
+  } error:&error];
+
+  if (!object) {
+    self.errorCount++;
+    NSLog(@"%@: could not create the object to read: %@", prefix, error);
+    return NO;
+  }
+
+  BOOL written = YES;
+
+  for (NSUInteger i = 0; i < _iterations && written; i++) {
+
+    NSString *value = [NSString stringWithFormat:@"%@-%@-%lu", _runTag, name, (unsigned long)i];
+
+    written = [self writeValue:[value stringByAppendingString:@"-a"] toObject:object];
+
+    if (!written) {
+      break;
+    }
+
+    if (_clearCacheBlock) {
+      _clearCacheBlock(policy);
+    }
+
+    [self readObject:object policy:policy histogram:cold tally:&coldTally];
+    [self readObject:object policy:policy histogram:warm tally:&warmTally];
+
+    written = [self writeValue:[value stringByAppendingString:@"-b"] toObject:object];
+
+    if (written) {
+      [self readObject:object policy:policy histogram:afterWrite tally:&afterWriteTally];
+    }
+  }
+
+  if (_deleteBlock) {
+
+    KSBenchmarkObjectBlock remove = _deleteBlock;
+
+    [self waitFor:^(KSBenchmarkCompletion done) {
+      remove(object, 0, done);
+    } error:&error];
+
+    if (error) {
+      NSLog(@"%@: could not delete the object read: %@", prefix, error);
+    }
+  }
+
+  NSDictionary *(^attributes)(NSString *) = ^(NSString *phase) {
+    return @{@"entity" : _entity, @"policy" : name, @"phase" : phase};
+  };
+
+  [report addHistogram:cold withAttributes:attributes(@"cold")];
+  [report addHistogram:warm withAttributes:attributes(@"warm")];
+  [report addHistogram:afterWrite withAttributes:attributes(@"after_write")];
+
+  if (_staleness.count > 0) {
+    [report addHistogram:_staleness withAttributes:attributes(@"staleness")];
+  }
+
+  NSUInteger reads = coldTally.reads + warmTally.reads + afterWriteTally.reads;
+  NSUInteger hits  = coldTally.hits + warmTally.hits + afterWriteTally.hits;
+  NSUInteger stale = coldTally.stale + warmTally.stale + afterWriteTally.stale;
+
+  [report addResult:@{@"entity"               : _entity,
+                      @"policy"               : name,
+                      @"iterations"           : @(_iterations),
+                      @"cold_p50_s"           : @([cold percentile:50]),
+                      @"warm_p50_s"           : @([warm percentile:50]),
+                      @"after_write_p50_s"    : @([afterWrite percentile:50]),
+                      @"cold_failures"        : @(cold.errorCount),
+                      @"warm_failures"        : @(warm.errorCount),
+                      @"after_write_failures" : @(afterWrite.errorCount),
+                      @"cold_hit_ratio"       : @(coldTally.reads > 0 ? (double)coldTally.hits / coldTally.reads : 0),
+                      @"warm_hit_ratio"       : @(warmTally.reads > 0 ? (double)warmTally.hits / warmTally.reads : 0),
+                      @"hit_ratio"            : @(reads > 0 ? (double)hits / reads : 0),
+                      @"empty_reads"          : @(coldTally.empty + warmTally.empty + afterWriteTally.empty),
+                      @"stale_reads"          : @(stale),
+                      @"stale_ratio"          : @(reads > 0 ? (double)stale / reads : 0),
+                      @"after_write_stale"    : @(afterWriteTally.stale),
+                      @"staleness_p50_s"      : @([_staleness percentile:50]),
+                      @"staleness_max_s"      : @(_staleness.max)}];
+
+  return written;
+}
+
+/*!
+ * Times one read and sorts it into hit or miss, and fresh or stale.
+ */
+- (void)readObject:(id)object
+            policy:(NSInteger)policy
+         histogram:(KSLatencyHistogram *)histogram
+             tally:(KSCachePolicyTally *)tally {
+
+  KSCachePolicyReadBlock read = _readBlock;
+  NSUInteger requestsBefore   = [KSWireMeter requestCount];
+
+  __block NSUInteger requestsAtCompletion = NSNotFound;
+  __block BOOL failed                     = NO;
+
+  id value = [histogram measure:^(KSBenchmarkCompletion done) {
+    read(policy, object, ^(id result, NSError *error) {
+
+      // Policies that answer from the cache and then the network call back
+      // twice; the first answer is the one the app would show.
+      @synchronized(histogram) {
+        if (requestsAtCompletion == NSNotFound) {
+          requestsAtCompletion = [KSWireMeter requestCount];
+          failed               = error != nil;
+        }
+      }
+
+      done(result, error);
+    });
+  } timeout:_timeout];
+
+  @synchronized(histogram) {
+    if (failed || requestsAtCompletion == NSNotFound) {
+      return;
+    }
+  }
+
+  tally->reads++;
+
+  if (requestsAtCompletion == requestsBefore) {
+    tally->hits++;
+  }
+
+  if (![value isKindOfClass:[NSString class]]) {
+    tally->empty++;
+    return;
+  }
+
+  if (![value isEqualToString:_currentValue]) {
+
+    NSNumber *replacedAt = _replacedAt[value];
+
+    tally->stale++;
+
+    if (replacedAt) {
+      [_staleness recordLatency:KSMonotonicTime() - [replacedAt doubleValue]];
+    }
+  }
+}
+
+- (BOOL)writeValue:(NSString *)value toObject:(id)object {
+
+  KSCachePolicyWriteBlock write = _writeBlock;
+  NSError *error                = nil;
+
+  [self waitFor:^(KSBenchmarkCompletion done) {
+    write(object, value, done);
+  } error:&error];
+
+  if (error) {
+    self.errorCount++;
+    NSLog(@"%@: write failed: %@", _entity, error);
+    return NO;
+  }
+
+  if (_currentValue) {
+    _replacedAt[_currentValue] = @(KSMonotonicTime());
+  }
+
+  _currentValue = value;
+
+  return YES;
+}
+
+/*!
+ * Runs an untimed operation and waits for it.
+ */
+- (id)waitFor:(void (^)(KSBenchmarkCompletion done))operation error:(NSError **)error {
+
+  KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
+
+  __block id       result  = nil;
+  __block NSError *failure = nil;
+
+  operation(^(id operationResult, NSError *operationError) {
+
+    @synchronized(waiter) {
+      if (!result && !failure) {
+        result  = operationResult;
+        failure = operationError;
+      }
+    }
+
+    [waiter signal];
+  });
+
+  if (![waiter waitWithTimeout:_timeout]) {
+    failure = [NSError errorWithDomain:KSCachePolicyBenchmarkErrorDomain
+                                  code:1
+                              userInfo:@{NSLocalizedDescriptionKey : [NSString stringWithFormat:@"%@ timed out after %.3fs", _entity, _timeout]}];
+  }
+
+  @synchronized(waiter) {
+
+    if (error) {
+      *error = failure;
+    }
+
+    return failure ? nil : result;
+  }
+}
+
+@end
@@ -0,0 +1,58 @@
+//
+//  KSCompletionWaiter.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+
+/*!
+ * Blocks the calling thread until one or more asynchronous SDK callbacks have
+ * fired, or until a deadline passes.
+ *
+ * On the main thread the run loop keeps being serviced while waiting, because
+ * the SDKs deliver their callbacks there, but the waiter sleeps until it is
+ * signalled instead of polling. Off the main thread it waits on a semaphore.
+ */
+@interface KSCompletionWaiter : NSObject
+
+/*!
+ * Returns a waiter that completes after a single call to -signal.
+ */
++ (KSCompletionWaiter *)waiter;
+
+/*!
+ * Returns a waiter that completes after count calls to -signal.
+ */
++ (KSCompletionWaiter *)waiterWithExpectedSignals:(NSUInteger)count;
+
+- (id)initWithExpectedSignals:(NSUInteger)count;
+
+/*!
+ * Expects one more call to -signal before the waiter completes.
+ */
+- (void)expectSignal;
+
+/*!
+ * Records that one expected callback has fired. Safe to call from any thread;
+ * signals beyond the expected count are ignored.
+ */
+- (void)signal;
+
+/*!
+ * Waits until every expected signal has arrived or timeout seconds have
+ * passed. Returns NO if the deadline was hit first.
+ */
+- (BOOL)waitWithTimeout:(NSTimeInterval)timeout;
+
+/*!
+ * YES once every expected signal has arrived.
+ */
+@property (nonatomic, readonly) BOOL completed;
+
+/*!
+ * Seconds spent inside the last call to -waitWithTimeout:.
+ */
+@property (nonatomic, readonly) NSTimeInterval elapsed;
+
+@end
@@ -0,0 +1,160 @@
+//
+//  KSCompletionWaiter.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSCompletionWaiter.h"
+#import "KSMonotonicClock.h"
+
+/*!
+ * Run loop source callback. It does nothing; handling the source is enough to
+ * make CFRunLoopRunInMode return so the waiter can re-check its state.
+ */
+static void KSCompletionWaiterWake(void *info) {
+}
+
+@interface KSCompletionWaiter()
+
+@property (nonatomic, readwrite) BOOL completed;
+@property (nonatomic, readwrite) NSTimeInterval elapsed;
+
+@end
+
+@implementation KSCompletionWaiter {
+
+  NSUInteger           _pendingSignals;
+  dispatch_semaphore_t _semaphore;
+  CFRunLoopRef         _waitingRunLoop;
+  CFRunLoopSourceRef   _wakeSource;
+}
+
++ (KSCompletionWaiter *)waiter {
+  return [[KSCompletionWaiter alloc] initWithExpectedSignals:1];
+}
+
++ (KSCompletionWaiter *)waiterWithExpectedSignals:(NSUInteger)count {
+  return [[KSCompletionWaiter alloc] initWithExpectedSignals:count];
+}
+
+- (id)init {
+  return [self initWithExpectedSignals:1];
+}
+
+- (id)initWithExpectedSignals:(NSUInteger)count {
+
+  self = [super init];
+
+  if (self) {
+    _pendingSignals = count;
+    _semaphore      = dispatch_semaphore_create(0);
+    _completed      = (count == 0);
+  }
+
+  return self;
+}
+
+- (BOOL)completed {
+  @synchronized(self) {
+    return _completed;
+  }
+}
+
+- (void)expectSignal {
+  @synchronized(self) {
+    if (!_completed) {
+      _pendingSignals++;
+    }
+  }
+}
+
+- (void)signal {
+
+  CFRunLoopRef       runLoop = NULL;
+  CFRunLoopSourceRef source  = NULL;
+
+  @synchronized(self) {
+
+    if (_completed || _pendingSignals == 0) {
+      return;
+    }
+
+    _pendingSignals--;
+
+    if (_pendingSignals > 0) {
+      return;
+    }
+
+    _completed = YES;
+
+    if (_waitingRunLoop) {
+      runLoop = (CFRunLoopRef)CFRetain(_waitingRunLoop);
+      source  = (CFRunLoopSourceRef)CFRetain(_wakeSource);
+    }
+  }
+
+  dispatch_semaphore_signal(_semaphore);
+
+  if (runLoop) {
+    CFRunLoopSourceSignal(source);
+    CFRunLoopWakeUp(runLoop);
+    CFRelease(source);
+    CFRelease(runLoop);
+  }
+}
+
+- (BOOL)waitWithTimeout:(NSTimeInterval)timeout {
+
+  NSTimeInterval start    = KSMonotonicTime();
+  NSTimeInterval deadline = start + timeout;
+
+  if ([NSThread isMainThread]) {
+
+    CFRunLoopSourceContext context = {0};
+    context.perform = KSCompletionWaiterWake;
+
+    CFRunLoopRef       runLoop = CFRunLoopGetCurrent();
+    CFRunLoopSourceRef source  = CFRunLoopSourceCreate(kCFAllocatorDefault, 0, &context);
+
+    CFRunLoopAddSource(runLoop, source, kCFRunLoopDefaultMode);
+
+    @synchronized(self) {
+      _waitingRunLoop = runLoop;
+      _wakeSource     = source;
+    }
+
+    while (!self.completed) {
+
+      NSTimeInterval remaining = deadline - KSMonotonicTime();
+
+      if (remaining <= 0) {
+        break;
+      }
+
+      CFRunLoopRunInMode(kCFRunLoopDefaultMode, remaining, true);
+    }
+
+    @synchronized(self) {
+      _waitingRunLoop = NULL;
+      _wakeSource     = NULL;
+    }
+
+    CFRunLoopRemoveSource(runLoop, source, kCFRunLoopDefaultMode);
+    CFRelease(source);
+
+  } else if (!self.completed) {
+
+    dispatch_time_t when = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(timeout * NSEC_PER_SEC));
+
+    if (dispatch_semaphore_wait(_semaphore, when) == 0) {
+      // Leave the semaphore signalled for any later wait on a completed waiter.
+      dispatch_semaphore_signal(_semaphore);
+    }
+  }
+
+  self.elapsed = KSMonotonicTime() - start;
+
+  return self.completed;
+}
+
+@end
@@ -0,0 +1,93 @@
+//
+//  KSConnectionReuseBenchmark.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSProviderAdapter.h"
+
+@class KSBenchmarkReport;
+
+/*!
+ * Counts the TCP and TLS handshakes an SDK makes per 1000 operations, so
+ * SDKs that reuse their connections can be told from those that open new
+ * ones.
+ *
+ * Needs the stand-in replaying: it starts KSStandIn's socket transport, so
+ * every request travels over a loopback connection the server can count,
+ * and stops it again when done. While recording it runs the same requests
+ * so they can be replayed, but reports nothing; with the stand-in off it
+ * runs nothing. Either way it sets skipped.
+ *
+ * Every operation is the adapter's query for a per-run value nothing has,
+ * so no data has to be seeded or deleted. The operations are run three
+ * ways:
+ *
+ *   sequential  one after another
+ *   concurrent  concurrency at a time
+ *   keep_alive  idleBursts bursts of burstSize sequential operations, idleGap
+ *               seconds apart, so connections have to survive being idle
+ *
+ * The suites build their clients the way the functional tests do, several
+ * per backend in some. Every workload runs once through the first client
+ * and, when there are more, once more taking turns through all of them. The
+ * pool is emptied before each run, so its first connection counts too.
+ */
+@interface KSConnectionReuseBenchmark : NSObject
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field operations:(NSUInteger)operations;
+
+@property (nonatomic, readonly, copy) NSString *entity;
+@property (nonatomic, readonly, copy) NSString *field;
+
+/*!
+ * Operations in the sequential and concurrent workloads.
+ */
+@property (nonatomic, readonly) NSUInteger operations;
+
+/*!
+ * Adds a client to take turns with; name goes in the result rows.
+ */
+- (void)addClient:(NSString *)name adapter:(id<KSProviderAdapter>)adapter;
+
+/*!
+ * Seconds to wait for a single operation. Defaults to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+/*!
+ * Operations in flight in the concurrent workload. Defaults to 8.
+ */
+@property (nonatomic, assign) NSUInteger concurrency;
+
+/*!
+ * Operations per burst and bursts in the keep-alive workload. Default to
+ * 10 and 5.
+ */
+@property (nonatomic, assign) NSUInteger burstSize;
+@property (nonatomic, assign) NSUInteger idleBursts;
+
+/*!
+ * Seconds between keep-alive bursts. Defaults to 5.
+ */
+@property (nonatomic, assign) NSTimeInterval idleGap;
+
+/*!
+ * Runs every workload, adding its latency histogram and a result row with
+ * the handshake counts to report.
+ */
+- (void)runWithReport:(KSBenchmarkReport *)report;
+
+/*!
+ * YES if the last run counted nothing because the stand-in wasn't
+ * replaying.
+ */
+@property (nonatomic, readonly) BOOL skipped;
+
+/*!
+ * Failed operations in the last run.
+ */
+@property (nonatomic, readonly) NSUInteger errorCount;
+
+@end
@@ -0,0 +1,206 @@
+//
+//  KSConnectionReuseBenchmark.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSConnectionReuseBenchmark.h"
+#import "KSBenchmarkReport.h"
+#import "KSCompletionWaiter.h"
+#import "KSLatencyHistogram.h"
+#import "KSLoadGenerator.h"
+#import "KSMonotonicClock.h"
+#import "KSRunNamespace.h"
+#import "KSStandIn.h"
+#import "KSStandInServer.h"
+
+@interface KSConnectionReuseBenchmark()
+
+@property (nonatomic, readwrite) BOOL skipped;
+@property (nonatomic, readwrite) NSUInteger errorCount;
+
+- (NSDictionary *)runWorkload:(NSString *)workload
+                      clients:(NSUInteger)clientCount
+                       server:(KSStandInServer *)server
+                        value:(NSString *)value
+                       report:(KSBenchmarkReport *)report;
+
+@end
+
+@implementation KSConnectionReuseBenchmark {
+
+  NSMutableArray *_clientNames;
+  NSMutableArray *_adapters;
+}
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field operations:(NSUInteger)operations {
+
+  self = [super init];
+
+  if (self) {
+    _entity      = [entity copy];
+    _field       = [field copy];
+    _operations  = operations;
+    _timeout     = 30.0;
+    _concurrency = 8;
+    _burstSize   = 10;
+    _idleBursts  = 5;
+    _idleGap     = 5.0;
+    _clientNames = [NSMutableArray array];
+    _adapters    = [NSMutableArray array];
+  }
+
+  return self;
+}
+
+- (void)addClient:(NSString *)name adapter:(id<KSProviderAdapter>)adapter {
+  [_clientNames addObject:name];
+  [_adapters addObject:adapter];
+}
+
+- (void)runWithReport:(KSBenchmarkReport *)report {
+
+  self.errorCount = 0;
+  self.skipped    = NO;
+
+  if ([KSStandIn mode] == KSStandInModeOff || [_adapters count] == 0) {
+    self.skipped = YES;
+    NSLog(@"%@ connection reuse needs the stand-in replaying and at least one client, skipping", _entity);
+    return;
+  }
+
+  // Recording runs the same requests so there is something to replay, but
+  // nothing can be counted.
+  KSStandInServer *server = [KSStandIn startSocketTransport];
+  NSString *value         = [[KSRunNamespace currentNamespace] tagValue:[NSString stringWithFormat:@"connection-reuse-%@", [[NSProcessInfo processInfo] globallyUniqueString]]];
+
+  self.skipped = (server == nil);
+
+  for (NSString *workload in @[@"sequential", @"concurrent", @"keep_alive"]) {
+
+    NSDictionary *result = [self runWorkload:workload clients:1 server:server value:value report:report];
+
+    if (result) {
+      [report addResult:result];
+    }
+
+    if ([_adapters count] > 1) {
+
+      result = [self runWorkload:workload clients:[_adapters count] server:server value:value report:report];
+
+      if (result) {
+        [report addResult:result];
+      }
+    }
+  }
+
+  [KSStandIn stopSocketTransport];
+}
+
+/*!
+ * Runs one workload through the first clientCount clients, starting from an
+ * empty connection pool, and returns its result row. Returns nil without a
+ * server to count with.
+ */
+- (NSDictionary *)runWorkload:(NSString *)workload
+                      clients:(NSUInteger)clientCount
+                       server:(KSStandInServer *)server
+                        value:(NSString *)value
+                       report:(KSBenchmarkReport *)report {
+
+  NSString *name              = [NSString stringWithFormat:@"%@.connection_reuse.%@.%lu_clients", _entity, workload, (unsigned long)clientCount];
+  NSArray *adapters           = [_adapters subarrayWithRange:NSMakeRange(0, clientCount)];
+  NSString *entity            = _entity;
+  NSString *field             = _field;
+  KSLatencyHistogram *latency = nil;
+  NSUInteger operations       = 0;
+
+  KSLoadOperationBlock operation = ^(NSUInteger sequence, KSBenchmarkCompletion done) {
+    [adapters[sequence % [adapters count]] queryEntity:entity whereField:field equals:value completion:done];
+  };
+
+  [server closeAllConnections];
+  [server resetCounts];
+
+  NSTimeInterval startedAt = KSMonotonicTime();
+
+  if ([workload isEqualToString:@"concurrent"]) {
+
+    KSLoadGenerator *generator = [KSLoadGenerator generatorWithName:name workers:MAX(_concurrency, 1)];
+
+    generator.maxOperations    = _operations;
+    generator.duration         = _timeout * MAX(_operations, 1);
+    generator.operationTimeout = _timeout;
+
+    [generator runWithBlock:operation];
+
+    latency    = generator.latency;
+    operations = generator.startedCount;
+
+    self.errorCount += generator.failedCount;
+
+  } else {
+
+    BOOL keepAlive   = [workload isEqualToString:@"keep_alive"];
+    NSUInteger count = keepAlive ? _burstSize * _idleBursts : _operations;
+
+    latency = [KSLatencyHistogram histogramWithName:name];
+
+    for (NSUInteger i = 0; i < count; i++) {
+
+      // Long enough for an idle connection to be closed by a client that
+      // doesn't keep them.
+      if (keepAlive && i > 0 && i % MAX(_burstSize, 1) == 0) {
+        [[KSCompletionWaiter waiter] waitWithTimeout:_idleGap];
+      }
+
+      [latency measure:^(KSBenchmarkCompletion done) {
+        operation(i, done);
+      } timeout:_timeout];
+    }
+
+    operations = count;
+
+    self.errorCount += latency.errorCount;
+  }
+
+  latency.wallTime = KSMonotonicTime() - startedAt;
+
+  if (!server) {
+    return nil;
+  }
+
+  NSString *clients = [[_clientNames subarrayWithRange:NSMakeRange(0, clientCount)] componentsJoinedByString:@","];
+
+  [report addHistogram:latency withAttributes:@{@"entity" : _entity, @"workload" : workload, @"clients" : clients}];
+
+  NSUInteger connections = server.connectionCount;
+  NSUInteger tls         = server.tlsConnectionCount;
+  NSUInteger requests    = server.requestCount;
+  double perThousand     = operations > 0 ? 1000.0 / operations : 0;
+
+  if (latency.errorCount > 0) {
+    NSLog(@"%@: %lu operations failed: %@", name, (unsigned long)latency.errorCount, [latency.errors lastObject]);
+  }
+
+  return @{@"entity"                  : _entity,
+           @"workload"                : workload,
+           @"clients"                 : clients,
+           @"operations"              : @(operations),
+           @"failures"                : @(latency.errorCount),
+           @"tcp_handshakes"          : @(connections),
+           @"tls_handshakes"          : @(tls),
+           @"tcp_per_1000_ops"        : @(connections * perThousand),
+           @"tls_per_1000_ops"        : @(tls * perThousand),
+           @"requests"                : @(requests),
+           @"requests_per_connection" : @(connections > 0 ? (double)requests / connections : 0),
+           @"reused_requests"         : @(server.reusedRequestCount),
+           @"pipelined_requests"      : @(server.pipelinedRequestCount),
+           @"max_open_connections"    : @(server.maxOpenConnections),
+           @"connections_by_origin"   : server.connectionCountsByOrigin,
+           @"p50_s"                   : @([latency percentile:50]),
+           @"p95_s"                   : @([latency percentile:95]),
+           @"wall_time_s"             : @(latency.wallTime)};
+}
+
+@end
@@ -0,0 +1,72 @@
+//
+//  KSCoreDataBenchmark.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+
+@class KSBenchmarkReport;
+
+/*!
+ * Measures the local Core Data store an app keeps its synced objects in,
+ * with no backend involved.
+ *
+ * For each store type and row count, a new store is filled with that many
+ * objects of entity, saving every saveBatchSize inserts. The store is then
+ * closed and opened again, as on the next launch, and the benchmark times
+ * fetching one object by field (which Core Data answers by scanning, since
+ * the field is not indexed), a 100-row page sorted by field, and a count.
+ * Each step starts from an empty store file, which is deleted afterwards.
+ *
+ * A step that takes longer than stepTimeLimit to fill stops where it got to.
+ * Its result row says so, and larger row counts are skipped for that store
+ * type. The binary store rewrites the whole file on every save, so it reaches
+ * the limit first.
+ */
+@interface KSCoreDataBenchmark : NSObject
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field;
+
+@property (nonatomic, readonly, copy) NSString *entity;
+@property (nonatomic, readonly, copy) NSString *field;
+
+/*!
+ * Store types by configuration name (InMemory, SQLite, Binary). Defaults to
+ * all three.
+ */
+@property (nonatomic, copy) NSArray *storeTypes;
+
+/*!
+ * Rows stored at each step. Defaults to 1,000, 10,000, 100,000 and
+ * 1,000,000.
+ */
+@property (nonatomic, copy) NSArray *rowCounts;
+
+/*!
+ * Inserts between saves. Defaults to 1000.
+ */
+@property (nonatomic, assign) NSUInteger saveBatchSize;
+
+/*!
+ * Fetches timed per kind at each step. Defaults to 20.
+ */
+@property (nonatomic, assign) NSUInteger fetchIterations;
+
+/*!
+ * Seconds a step may spend filling its store. Defaults to 300.
+ */
+@property (nonatomic, assign) NSTimeInterval stepTimeLimit;
+
+/*!
+ * Adds save and fetch histograms and a result row per step to report.
+ */
+- (void)runWithReport:(KSBenchmarkReport *)report;
+
+/*!
+ * Steps that could not create, save to or reopen their store in the last
+ * run.
+ */
+@property (nonatomic, readonly) NSUInteger errorCount;
+
+@end
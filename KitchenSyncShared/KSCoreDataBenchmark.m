@@ -0,0 +1,279 @@
+//
+//  KSCoreDataBenchmark.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSCoreDataBenchmark.h"
+#import "KSBenchmarkReport.h"
+#import "KSCoreDataStack.h"
+#import "KSLatencyHistogram.h"
+#import "KSMonotonicClock.h"
+
+static NSUInteger const KSCoreDataBenchmarkPageSize = 100;
+
+@interface KSCoreDataBenchmark()
+
+@property (nonatomic, readwrite) NSUInteger errorCount;
+
+- (BOOL)runStoreType:(NSString *)storeType rows:(NSUInteger)rows report:(KSBenchmarkReport *)report;
+- (NSUInteger)fillStack:(KSCoreDataStack *)stack rows:(NSUInteger)rows save:(KSLatencyHistogram *)save insertTime:(NSTimeInterval *)insertTime;
+- (void)timeFetchesInStack:(KSCoreDataStack *)stack rows:(NSUInteger)rows histograms:(NSArray *)histograms;
+- (NSString *)valueAtIndex:(NSUInteger)index;
+
+@end
+
+@implementation KSCoreDataBenchmark
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field {
+
+  self = [super init];
+
+  if (self) {
+    _entity          = [entity copy];
+    _field           = [field copy];
+    _storeTypes      = @[@"InMemory", @"SQLite", @"Binary"];
+    _rowCounts       = @[@1000, @10000, @100000, @1000000];
+    _saveBatchSize   = 1000;
+    _fetchIterations = 20;
+    _stepTimeLimit   = 300.0;
+  }
+
+  return self;
+}
+
+- (void)runWithReport:(KSBenchmarkReport *)report {
+
+  self.errorCount = 0;
+
+  for (NSString *name in _storeTypes) {
+
+    NSString *storeType = [KSCoreDataStack storeTypeForName:name];
+
+    if (!storeType) {
+      self.errorCount++;
+      NSLog(@"%@ Core Data benchmark: unknown store type %@", _entity, name);
+      continue;
+    }
+
+    for (NSNumber *rows in _rowCounts) {
+      if (![self runStoreType:storeType rows:[rows unsignedIntegerValue] report:report]) {
+        break;
+      }
+    }
+  }
+}
+
+/*!
+ * Returns NO when the step failed or hit the time limit, so larger steps for
+ * the same store type are not worth running.
+ */
+- (BOOL)runStoreType:(NSString *)storeType rows:(NSUInteger)rows report:(KSBenchmarkReport *)report {
+
+  NSString *name           = [KSCoreDataStack nameForStoreType:storeType];
+  NSString *prefix         = [NSString stringWithFormat:@"%@.%@", _entity, name];
+  NSURL *url               = [KSCoreDataStack storeURLForStoreType:storeType name:[NSString stringWithFormat:@"%@-%lu", prefix, (unsigned long)rows]];
+  KSLatencyHistogram *save = [KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:@".save"]];
+  NSDictionary *attributes = @{@"store" : name, @"rows" : @(rows)};
+  NSError *error           = nil;
+
+  if (url && ![KSCoreDataStack removeStoreAtURL:url error:&error]) {
+    self.errorCount++;
+    NSLog(@"%@: could not remove an old store: %@", prefix, [error localizedDescription]);
+    return NO;
+  }
+
+  KSCoreDataStack *stack = [[KSCoreDataStack alloc] initWithStoreType:storeType URL:url error:&error];
+
+  if (!stack) {
+    self.errorCount++;
+    NSLog(@"%@: could not create the store: %@", prefix, [error localizedDescription]);
+    return NO;
+  }
+
+  NSTimeInterval insertTime = 0;
+  NSTimeInterval fillStart  = KSMonotonicTime();
+  NSUInteger inserted       = [self fillStack:stack rows:rows save:save insertTime:&insertTime];
+  NSTimeInterval fillTime   = KSMonotonicTime() - fillStart;
+  BOOL truncated            = inserted < rows;
+
+  save.wallTime = fillTime;
+
+  [report addHistogram:save withAttributes:attributes];
+
+  NSMutableDictionary *result = [@{@"store"           : name,
+                                   @"rows"            : @(rows),
+                                   @"rows_inserted"   : @(inserted),
+                                   @"truncated"       : @(truncated),
+                                   @"insert_s"        : @(insertTime),
+                                   @"fill_s"          : @(fillTime),
+                                   @"rows_per_s"      : @(fillTime > 0 ? inserted / fillTime : 0),
+                                   @"save_batch_size" : @(_saveBatchSize)} mutableCopy];
+
+  // Reopening only means something for stores on disk; an in-memory store
+  // goes with its coordinator.
+  if (url && inserted > 0) {
+
+    stack = nil;
+
+    NSTimeInterval openStart = KSMonotonicTime();
+
+    stack = [[KSCoreDataStack alloc] initWithStoreType:storeType URL:url error:&error];
+
+    if (!stack) {
+      self.errorCount++;
+      NSLog(@"%@: could not reopen the store: %@", prefix, [error localizedDescription]);
+      [KSCoreDataStack removeStoreAtURL:url error:NULL];
+      return NO;
+    }
+
+    result[@"open_s"]      = @(KSMonotonicTime() - openStart);
+    result[@"store_bytes"] = @([stack storeSize]);
+  }
+
+  if (inserted > 0) {
+
+    NSArray *histograms = @[[KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:@".fetch_by_value"]],
+                            [KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:@".fetch_page"]],
+                            [KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:@".count"]]];
+
+    [self timeFetchesInStack:stack rows:inserted histograms:histograms];
+
+    for (KSLatencyHistogram *histogram in histograms) {
+      [report addHistogram:histogram withAttributes:attributes];
+    }
+
+    result[@"fetch_by_value_p50_s"] = @([histograms[0] percentile:50]);
+    result[@"fetch_page_p50_s"]     = @([histograms[1] percentile:50]);
+    result[@"count_p50_s"]          = @([histograms[2] percentile:50]);
+  }
+
+  [report addResult:result];
+
+  NSLog(@"%@: %lu of %lu rows in %.3fs (%.0f rows/s)%@",
+        prefix, (unsigned long)inserted, (unsigned long)rows, fillTime,
+        fillTime > 0 ? inserted / fillTime : 0, truncated ? @", stopped at the time limit" : @"");
+
+  stack = nil;
+
+  if (url) {
+    [KSCoreDataStack removeStoreAtURL:url error:NULL];
+  }
+
+  return !truncated && save.errorCount == 0;
+}
+
+/*!
+ * Inserts up to rows objects, saving and resetting the context every
+ * saveBatchSize, and returns how many were saved. insertTime is the part
+ * spent outside -save:.
+ */
+- (NSUInteger)fillStack:(KSCoreDataStack *)stack rows:(NSUInteger)rows save:(KSLatencyHistogram *)save insertTime:(NSTimeInterval *)insertTime {
+
+  NSManagedObjectContext *context = [stack newContext];
+  NSUInteger batchSize            = MAX(_saveBatchSize, 1);
+  NSTimeInterval start            = KSMonotonicTime();
+  NSUInteger saved                = 0;
+
+  *insertTime = 0;
+
+  while (saved < rows && KSMonotonicTime() - start < _stepTimeLimit) {
+
+    @autoreleasepool {
+
+      NSUInteger count           = MIN(batchSize, rows - saved);
+      NSTimeInterval insertStart = KSMonotonicTime();
+
+      for (NSUInteger i = 0; i < count; i++) {
+
+        NSManagedObject *object = [NSEntityDescription insertNewObjectForEntityForName:_entity inManagedObjectContext:context];
+
+        [object setValue:[self valueAtIndex:saved + i] forKey:_field];
+      }
+
+      *insertTime += KSMonotonicTime() - insertStart;
+
+      NSError *error           = nil;
+      NSTimeInterval saveStart = KSMonotonicTime();
+
+      if (![context save:&error]) {
+        [save recordError:error];
+        self.errorCount++;
+        NSLog(@"%@ Core Data save failed after %lu rows: %@", _entity, (unsigned long)saved, [error localizedDescription]);
+        break;
+      }
+
+      [save recordLatency:KSMonotonicTime() - saveStart];
+
+      // Keeps memory flat; the rows live in the store, not the context.
+      [context reset];
+
+      saved += count;
+    }
+  }
+
+  return saved;
+}
+
+- (void)timeFetchesInStack:(KSCoreDataStack *)stack rows:(NSUInteger)rows histograms:(NSArray *)histograms {
+
+  NSManagedObjectContext *context = [stack newContext];
+
+  for (NSUInteger i = 0; i < _fetchIterations; i++) {
+
+    @autoreleasepool {
+
+      NSFetchRequest *byValue = [NSFetchRequest fetchRequestWithEntityName:_entity];
+      NSFetchRequest *page    = [NSFetchRequest fetchRequestWithEntityName:_entity];
+      NSFetchRequest *count   = [NSFetchRequest fetchRequestWithEntityName:_entity];
+      NSError *error          = nil;
+
+      byValue.predicate = [NSPredicate predicateWithFormat:@"%K == %@", _field, [self valueAtIndex:arc4random_uniform((u_int32_t)rows)]];
+
+      page.sortDescriptors = @[[NSSortDescriptor sortDescriptorWithKey:_field ascending:YES]];
+      page.fetchLimit      = KSCoreDataBenchmarkPageSize;
+      page.fetchOffset     = rows > KSCoreDataBenchmarkPageSize ? arc4random_uniform((u_int32_t)(rows - KSCoreDataBenchmarkPageSize)) : 0;
+
+      // Each fetch starts from an empty context, so none is answered from
+      // objects an earlier one registered.
+      [context reset];
+
+      NSTimeInterval start = KSMonotonicTime();
+      NSArray *objects     = [context executeFetchRequest:byValue error:&error];
+
+      if ([objects count] == 1) {
+        [histograms[0] recordLatency:KSMonotonicTime() - start];
+      } else {
+        [histograms[0] recordError:error];
+      }
+
+      [context reset];
+
+      start   = KSMonotonicTime();
+      objects = [context executeFetchRequest:page error:&error];
+
+      if (objects) {
+        [histograms[1] recordLatency:KSMonotonicTime() - start];
+      } else {
+        [histograms[1] recordError:error];
+      }
+
+      start = KSMonotonicTime();
+
+      if ([context countForFetchRequest:count error:&error] != NSNotFound) {
+        [histograms[2] recordLatency:KSMonotonicTime() - start];
+      } else {
+        [histograms[2] recordError:error];
+      }
+    }
+  }
+}
+
+/*!
+ * Zero-padded, so sorting by value sorts by insertion order.
+ */
+- (NSString *)valueAtIndex:(NSUInteger)index {
+  return [NSString stringWithFormat:@"%@-%08lu", _entity, (unsigned long)index];
+}
+
+@end
@@ -0,0 +1,88 @@
+//
+//  KSCoreDataStack.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreData/CoreData.h>
+
+/*!
+ * A Core Data model, coordinator and store built once and handed out to
+ * every test that needs one, instead of rebuilding
+ * +mergedModelFromBundles: and a coordinator in each -setUp.
+ *
+ * The store can be in memory, SQLite or binary, named in a configuration as
+ * InMemory, SQLite or Binary. On-disk stores live in +defaultDirectory and
+ * start out empty in each process.
+ *
+ *   NSError *error                  = nil;
+ *   KSCoreDataStack *stack          = [KSCoreDataStack sharedStackWithStoreType:NSSQLiteStoreType error:&error];
+ *   NSManagedObjectContext *context = [stack newContext];
+ */
+@interface KSCoreDataStack : NSObject
+
+/*!
+ * The model merged from every loaded bundle, built on first use.
+ */
++ (NSManagedObjectModel *)sharedModel;
+
+/*!
+ * The stack for storeType, built on the first call and returned from then on.
+ * Returns nil with error set if the store could not be added; the next call
+ * tries again.
+ */
++ (KSCoreDataStack *)sharedStackWithStoreType:(NSString *)storeType error:(NSError **)error;
+
+/*!
+ * NSInMemoryStoreType, NSSQLiteStoreType or NSBinaryStoreType for InMemory,
+ * SQLite or Binary; NSInMemoryStoreType for nil, and nil for anything else.
+ */
++ (NSString *)storeTypeForName:(NSString *)name;
+
+/*!
+ * The configuration name of storeType, e.g. SQLite.
+ */
++ (NSString *)nameForStoreType:(NSString *)storeType;
+
+/*!
+ * Where a store called name of storeType goes: a file in +defaultDirectory,
+ * or nil for an in-memory store.
+ */
++ (NSURL *)storeURLForStoreType:(NSString *)storeType name:(NSString *)name;
+
+/*!
+ * Deletes the store file at url along with SQLite's journal files. Missing
+ * files are not an error.
+ */
++ (BOOL)removeStoreAtURL:(NSURL *)url error:(NSError **)error;
+
+/*!
+ * $KS_COREDATA_DIR if set, otherwise KitchenSyncCoreData in the temporary
+ * directory.
+ */
++ (NSString *)defaultDirectory;
+
+/*!
+ * Adds a store of storeType at url (nil for in memory) to a coordinator on
+ * +sharedModel. An existing store at url is opened as it is.
+ */
+- (id)initWithStoreType:(NSString *)storeType URL:(NSURL *)url error:(NSError **)error;
+
+@property (nonatomic, readonly, copy) NSString *storeType;
+@property (nonatomic, readonly, strong) NSURL *storeURL;
+@property (nonatomic, readonly, strong) NSManagedObjectModel *managedObjectModel;
+@property (nonatomic, readonly, strong) NSPersistentStoreCoordinator *persistentStoreCoordinator;
+
+/*!
+ * A new confinement context on the coordinator, without an undo manager.
+ * Contexts are cheap; each test gets its own.
+ */
+- (NSManagedObjectContext *)newContext;
+
+/*!
+ * Bytes the store takes on disk, journal files included. 0 in memory.
+ */
+- (unsigned long long)storeSize;
+
+@end
@@ -0,0 +1,175 @@
+//
+//  KSCoreDataStack.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSCoreDataStack.h"
+#include <unistd.h>
+
+@implementation KSCoreDataStack
+
++ (NSManagedObjectModel *)sharedModel {
+
+  static NSManagedObjectModel *sharedModel = nil;
+  static dispatch_once_t onceToken;
+
+  dispatch_once(&onceToken, ^{
+    sharedModel = [NSManagedObjectModel mergedModelFromBundles:nil];
+  });
+
+  return sharedModel;
+}
+
++ (KSCoreDataStack *)sharedStackWithStoreType:(NSString *)storeType error:(NSError **)error {
+
+  static NSMutableDictionary *sharedStacks = nil;
+  static dispatch_once_t onceToken;
+
+  dispatch_once(&onceToken, ^{
+    sharedStacks = [NSMutableDictionary dictionary];
+  });
+
+  @synchronized(sharedStacks) {
+
+    KSCoreDataStack *stack = sharedStacks[storeType];
+
+    if (!stack) {
+
+      NSURL *url = [self storeURLForStoreType:storeType name:[NSString stringWithFormat:@"KitchenSync-%d", getpid()]];
+
+      // Left over from an earlier run with the same pid, or from a crash.
+      if (url && ![self removeStoreAtURL:url error:error]) {
+        return nil;
+      }
+
+      stack = [[KSCoreDataStack alloc] initWithStoreType:storeType URL:url error:error];
+
+      if (stack) {
+        sharedStacks[storeType] = stack;
+      }
+    }
+
+    return stack;
+  }
+}
+
++ (NSString *)storeTypeForName:(NSString *)name {
+
+  if (!name) {
+    return NSInMemoryStoreType;
+  }
+
+  NSDictionary *storeTypes = @{@"InMemory" : NSInMemoryStoreType,
+                               @"SQLite"   : NSSQLiteStoreType,
+                               @"Binary"   : NSBinaryStoreType};
+
+  return storeTypes[name];
+}
+
++ (NSString *)nameForStoreType:(NSString *)storeType {
+
+  NSDictionary *names = @{NSInMemoryStoreType : @"InMemory",
+                          NSSQLiteStoreType   : @"SQLite",
+                          NSBinaryStoreType   : @"Binary"};
+
+  return names[storeType] ?: storeType;
+}
+
++ (NSURL *)storeURLForStoreType:(NSString *)storeType name:(NSString *)name {
+
+  if ([storeType isEqualToString:NSInMemoryStoreType]) {
+    return nil;
+  }
+
+  NSString *extension = [storeType isEqualToString:NSSQLiteStoreType] ? @"sqlite" : @"binary";
+  NSString *path      = [[[self defaultDirectory] stringByAppendingPathComponent:name] stringByAppendingPathExtension:extension];
+
+  return [NSURL fileURLWithPath:path];
+}
+
++ (BOOL)removeStoreAtURL:(NSURL *)url error:(NSError **)error {
+
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  NSString *path             = [url path];
+
+  for (NSString *suffix in @[@"", @"-wal", @"-shm", @"-journal"]) {
+
+    NSString *file = [path stringByAppendingString:suffix];
+
+    if ([fileManager fileExistsAtPath:file] && ![fileManager removeItemAtPath:file error:error]) {
+      return NO;
+    }
+  }
+
+  return YES;
+}
+
++ (NSString *)defaultDirectory {
+
+  NSString *directory = [[[NSProcessInfo processInfo] environment] objectForKey:@"KS_COREDATA_DIR"];
+
+  if ([directory length] > 0) {
+    return directory;
+  }
+
+  return [NSTemporaryDirectory() stringByAppendingPathComponent:@"KitchenSyncCoreData"];
+}
+
+- (id)initWithStoreType:(NSString *)storeType URL:(NSURL *)url error:(NSError **)error {
+
+  self = [super init];
+
+  if (self) {
+
+    _storeType                  = [storeType copy];
+    _storeURL                   = url;
+    _managedObjectModel         = [KSCoreDataStack sharedModel];
+    _persistentStoreCoordinator = [[NSPersistentStoreCoordinator alloc] initWithManagedObjectModel:_managedObjectModel];
+
+    if (url && ![[NSFileManager defaultManager] createDirectoryAtPath:[[url path] stringByDeletingLastPathComponent]
+                                          withIntermediateDirectories:YES
+                                                           attributes:nil
+                                                                error:error]) {
+      return nil;
+    }
+
+    if (![_persistentStoreCoordinator addPersistentStoreWithType:storeType
+                                                   configuration:nil
+                                                             URL:url
+                                                         options:nil
+                                                           error:error]) {
+      return nil;
+    }
+  }
+
+  return self;
+}
+
+- (NSManagedObjectContext *)newContext {
+
+  NSManagedObjectContext *context = [[NSManagedObjectContext alloc] init];
+
+  [context setPersistentStoreCoordinator:_persistentStoreCoordinator];
+  [context setUndoManager:nil];
+
+  return context;
+}
+
+- (unsigned long long)storeSize {
+
+  if (!_storeURL) {
+    return 0;
+  }
+
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  unsigned long long total   = 0;
+
+  for (NSString *suffix in @[@"", @"-wal", @"-shm", @"-journal"]) {
+    total += [[fileManager attributesOfItemAtPath:[[_storeURL path] stringByAppendingString:suffix] error:NULL] fileSize];
+  }
+
+  return total;
+}
+
+@end
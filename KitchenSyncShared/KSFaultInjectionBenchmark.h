@@ -0,0 +1,85 @@
+//
+//  KSFaultInjectionBenchmark.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSLatencyHistogram.h"
+
+@class KSBenchmarkReport;
+
+/*!
+ * Runs the SDK's query for the objects whose benchmark field equals value
+ * and calls done with them, retrying however the variant retries.
+ */
+typedef void (^KSFaultInjectionReadBlock)(NSString *value, KSBenchmarkCompletion done);
+
+/*!
+ * Measures how an SDK behaves while its backend browns out: tail latency,
+ * success rate and how many HTTP requests its retries add.
+ *
+ * Every variant (an SDK's default retry behaviour, or another retry policy
+ * it can be configured with) runs the same queries twice, concurrency at a
+ * time: a clean pass, then a faulted pass with KSStandIn answering
+ * serviceUnavailableRate of the requests with a 503, resetting resetRate of
+ * them and holding latencySpikeRate of them back by latencySpike seconds.
+ * The queries are for a per-run value nothing has, so no data has to be
+ * seeded or deleted.
+ *
+ * The result row per pass has the p50, p95, p99 and worst latency, the
+ * success rate, the HTTP requests the stand-in saw and the retry
+ * amplification: requests per operation. Needs the stand-in recording or
+ * replaying; with it off nothing runs and skipped is set.
+ */
+@interface KSFaultInjectionBenchmark : NSObject
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field operations:(NSUInteger)operations;
+
+@property (nonatomic, readonly, copy) NSString *entity;
+@property (nonatomic, readonly, copy) NSString *field;
+
+/*!
+ * Queries per pass.
+ */
+@property (nonatomic, readonly) NSUInteger operations;
+
+- (void)addVariant:(NSString *)name block:(KSFaultInjectionReadBlock)block;
+
+/*!
+ * Seconds to wait for a single query, retries included. Defaults to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+/*!
+ * Queries in flight at once. Defaults to 4.
+ */
+@property (nonatomic, assign) NSUInteger concurrency;
+
+/*!
+ * Fault rates, each a share of all requests, and how long a spike holds a
+ * request back. Default to 0.1, 0.05, 0.05 and 2 seconds.
+ */
+@property (nonatomic, assign) double serviceUnavailableRate;
+@property (nonatomic, assign) double resetRate;
+@property (nonatomic, assign) double latencySpikeRate;
+@property (nonatomic, assign) NSTimeInterval latencySpike;
+
+/*!
+ * Runs both passes of every variant, adding a latency histogram and a
+ * result row per pass to report.
+ */
+- (void)runWithReport:(KSBenchmarkReport *)report;
+
+/*!
+ * YES if the last run did nothing because the stand-in was off.
+ */
+@property (nonatomic, readonly) BOOL skipped;
+
+/*!
+ * Failed queries in the clean passes of the last run. Faulted passes are
+ * expected to fail some.
+ */
+@property (nonatomic, readonly) NSUInteger errorCount;
+
+@end
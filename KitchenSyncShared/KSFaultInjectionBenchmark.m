@@ -0,0 +1,146 @@
+//
+//  KSFaultInjectionBenchmark.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSFaultInjectionBenchmark.h"
+#import "KSBenchmarkReport.h"
+#import "KSLoadGenerator.h"
+#import "KSRunNamespace.h"
+#import "KSStandIn.h"
+
+@interface KSFaultInjectionBenchmark()
+
+@property (nonatomic, readwrite) BOOL skipped;
+@property (nonatomic, readwrite) NSUInteger errorCount;
+
+- (NSDictionary *)runVariant:(NSUInteger)index
+                     faulted:(BOOL)faulted
+                       value:(NSString *)value
+                      report:(KSBenchmarkReport *)report;
+
+@end
+
+@implementation KSFaultInjectionBenchmark {
+
+  NSMutableArray *_variantNames;
+  NSMutableArray *_variantBlocks;
+}
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field operations:(NSUInteger)operations {
+
+  self = [super init];
+
+  if (self) {
+    _entity                 = [entity copy];
+    _field                  = [field copy];
+    _operations             = operations;
+    _timeout                = 30.0;
+    _concurrency            = 4;
+    _serviceUnavailableRate = 0.1;
+    _resetRate              = 0.05;
+    _latencySpikeRate       = 0.05;
+    _latencySpike           = 2.0;
+    _variantNames           = [NSMutableArray array];
+    _variantBlocks          = [NSMutableArray array];
+  }
+
+  return self;
+}
+
+- (void)addVariant:(NSString *)name block:(KSFaultInjectionReadBlock)block {
+  [_variantNames addObject:name];
+  [_variantBlocks addObject:[block copy]];
+}
+
+- (void)runWithReport:(KSBenchmarkReport *)report {
+
+  self.errorCount = 0;
+  self.skipped    = NO;
+
+  if ([KSStandIn mode] == KSStandInModeOff) {
+    self.skipped = YES;
+    NSLog(@"%@ fault injection needs the stand-in recording or replaying, skipping", _entity);
+    return;
+  }
+
+  NSString *value = [[KSRunNamespace currentNamespace] tagValue:[NSString stringWithFormat:@"fault-injection-%@", [[NSProcessInfo processInfo] globallyUniqueString]]];
+
+  for (NSUInteger i = 0; i < [_variantBlocks count]; i++) {
+
+    NSDictionary *clean = [self runVariant:i faulted:NO value:value report:report];
+
+    self.errorCount += [clean[@"failed"] unsignedIntegerValue];
+
+    [report addResult:clean];
+    [report addResult:[self runVariant:i faulted:YES value:value report:report]];
+  }
+}
+
+/*!
+ * Runs one pass of a variant and returns its result row. Faults are counted
+ * from zero in every pass, clean ones included, so both rows have the
+ * requests sent.
+ */
+- (NSDictionary *)runVariant:(NSUInteger)index
+                     faulted:(BOOL)faulted
+                       value:(NSString *)value
+                      report:(KSBenchmarkReport *)report {
+
+  NSString *variant              = _variantNames[index];
+  NSString *pass                 = faulted ? @"faulted" : @"clean";
+  KSFaultInjectionReadBlock read = _variantBlocks[index];
+  KSLoadGenerator *generator     = [KSLoadGenerator generatorWithName:[NSString stringWithFormat:@"%@.fault_injection.%@.%@", _entity, variant, pass] workers:MAX(_concurrency, 1)];
+
+  generator.maxOperations    = _operations;
+  generator.duration         = _timeout * MAX(_operations, 1);
+  generator.operationTimeout = _timeout;
+
+  if (faulted) {
+    [KSStandIn injectFaultsWithServiceUnavailableRate:_serviceUnavailableRate resetRate:_resetRate latencySpikeRate:_latencySpikeRate latencySpike:_latencySpike];
+  } else {
+    [KSStandIn injectFaultsWithServiceUnavailableRate:0 resetRate:0 latencySpikeRate:0 latencySpike:0];
+  }
+
+  [generator runWithBlock:^(NSUInteger sequence, KSBenchmarkCompletion done) {
+    read(value, done);
+  }];
+
+  NSDictionary *faults = [KSStandIn faultCounts];
+
+  [KSStandIn stopInjectingFaults];
+
+  KSLatencyHistogram *latency = generator.latency;
+  NSUInteger started          = generator.startedCount;
+  NSUInteger requests         = [faults[@"requests"] unsignedIntegerValue];
+
+  [report addHistogram:latency withAttributes:@{@"entity" : _entity, @"variant" : variant, @"pass" : pass}];
+
+  if (faulted) {
+    NSLog(@"%@ %@ under faults: %lu of %lu queries succeeded, %lu requests sent", _entity, variant,
+          (unsigned long)generator.succeededCount, (unsigned long)started, (unsigned long)requests);
+  } else if (generator.failedCount > 0) {
+    NSLog(@"%@ %@: %lu clean queries failed: %@", _entity, variant, (unsigned long)generator.failedCount, [latency.errors lastObject]);
+  }
+
+  return @{@"entity"              : _entity,
+           @"variant"             : variant,
+           @"pass"                : pass,
+           @"operations"          : @(started),
+           @"succeeded"           : @(generator.succeededCount),
+           @"failed"              : @(generator.failedCount),
+           @"success_rate"        : @(started > 0 ? (double)generator.succeededCount / started : 0),
+           @"requests"            : @(requests),
+           @"retry_amplification" : @(started > 0 ? (double)requests / started : 0),
+           @"service_unavailable" : faults[@"service_unavailable"],
+           @"resets"              : faults[@"resets"],
+           @"latency_spikes"      : faults[@"latency_spikes"],
+           @"p50_s"               : @([latency percentile:50]),
+           @"p95_s"               : @([latency percentile:95]),
+           @"p99_s"               : @([latency percentile:99]),
+           @"max_s"               : @([latency percentile:100]),
+           @"elapsed_s"           : @(generator.elapsed)};
+}
+
+@end
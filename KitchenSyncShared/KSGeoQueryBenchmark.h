@@ -0,0 +1,128 @@
+//
+//  KSGeoQueryBenchmark.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSCRUDBenchmark.h"
+
+@class KSBenchmarkReport;
+
+/*!
+ * Returns the SDK's value for a location (a PFGeoPoint, an SMGeoPoint, a
+ * Kinvey [longitude, latitude] array, ...), to be saved in the location
+ * field.
+ */
+typedef id (^KSGeoPointBlock)(double latitude, double longitude);
+
+/*!
+ * Saves one object per entry of fieldsList, through the SDK's bulk path, and
+ * calls done with the objects that were saved.
+ */
+typedef void (^KSGeoSeedBlock)(NSArray *fieldsList, KSBenchmarkCompletion done);
+
+/*!
+ * Finds at most limit objects whose benchmark field equals tag and whose
+ * location is within kilometers of the given point, and calls done with
+ * them.
+ */
+typedef void (^KSGeoRadiusBlock)(NSString *tag, double latitude, double longitude, double kilometers, NSUInteger limit, KSBenchmarkCompletion done);
+
+/*!
+ * Finds at most limit objects whose benchmark field equals tag and whose
+ * location is inside the box from southwest to northeast, and calls done
+ * with them.
+ */
+typedef void (^KSGeoBoxBlock)(NSString *tag, double southLatitude, double westLongitude, double northLatitude, double eastLongitude, NSUInteger limit, KSBenchmarkCompletion done);
+
+/*!
+ * Times the store-locator queries a map screen makes as the dataset around
+ * it gets denser.
+ *
+ * Objects are saved with the tagged benchmark field and a location spread
+ * evenly over a regionSpan-degree square around the center. The spread comes
+ * from a fixed seed, so every run and every provider gets the same points.
+ * The dataset grows to each of rowCounts in turn; at each size every one of
+ * radii is queried iterations times around the center as a circle and as the
+ * square around that circle, each shape under its own wire trace.
+ *
+ * The result row per size, shape and radius has the p50 and p95, how many
+ * objects came back next to how many of the seeded points fall inside the
+ * shape, and whether resultLimit cut the answer short. Edge cases aside,
+ * recall below 1 means the backend missed objects it should have found.
+ */
+@interface KSGeoQueryBenchmark : NSObject
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field locationField:(NSString *)locationField iterations:(NSUInteger)iterations;
+
+@property (nonatomic, readonly, copy) NSString *entity;
+@property (nonatomic, readonly, copy) NSString *field;
+@property (nonatomic, readonly, copy) NSString *locationField;
+@property (nonatomic, readonly) NSUInteger iterations;
+
+/*!
+ * Seconds to wait for a single request. Defaults to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+/*!
+ * Dataset sizes, smallest first. Defaults to 10,000, 100,000 and 1,000,000.
+ */
+@property (nonatomic, copy) NSArray *rowCounts;
+
+/*!
+ * Objects per seed call. Defaults to 1,000.
+ */
+@property (nonatomic, assign) NSUInteger seedBatchSize;
+
+/*!
+ * Radii in kilometers. Defaults to 1, 5 and 20.
+ */
+@property (nonatomic, copy) NSArray *radii;
+
+/*!
+ * Center of the seeded region and of every query. Defaults to downtown San
+ * Francisco.
+ */
+@property (nonatomic, assign) double centerLatitude;
+@property (nonatomic, assign) double centerLongitude;
+
+/*!
+ * Side of the seeded square in degrees. Defaults to 0.5, about 55 km north
+ * to south.
+ */
+@property (nonatomic, assign) double regionSpan;
+
+/*!
+ * Most objects a query asks for. Defaults to 1,000.
+ */
+@property (nonatomic, assign) NSUInteger resultLimit;
+
+/*!
+ * Deletes run in parallel when tearing the dataset down. Defaults to 8.
+ */
+@property (nonatomic, assign) NSUInteger cleanupConcurrency;
+
+@property (nonatomic, copy) KSGeoPointBlock        pointBlock;
+@property (nonatomic, copy) KSGeoSeedBlock         seedBlock;
+@property (nonatomic, copy) KSGeoRadiusBlock       radiusBlock;
+@property (nonatomic, copy) KSBenchmarkObjectBlock deleteBlock;
+
+/*!
+ * Leave nil where the SDK has no bounding-box query.
+ */
+@property (nonatomic, copy) KSGeoBoxBlock boxBlock;
+
+/*!
+ * Seeds up to each size, adds histograms, wire traces and a result row per
+ * size, shape and radius to report, and deletes the dataset again.
+ */
+- (void)runWithReport:(KSBenchmarkReport *)report;
+
+/*!
+ * Failed seeds and queries in the last run.
+ */
+@property (nonatomic, readonly) NSUInteger errorCount;
+
+@end
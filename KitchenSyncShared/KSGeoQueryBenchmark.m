@@ -0,0 +1,274 @@
+//
+//  KSGeoQueryBenchmark.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSGeoQueryBenchmark.h"
+#import "KSBenchmarkReport.h"
+#import "KSBulkDeleter.h"
+#import "KSLatencyHistogram.h"
+#import "KSMonotonicClock.h"
+#import "KSRunNamespace.h"
+#import "KSWireTrace.h"
+
+// Mean earth radius, the one Parse and MongoDB use for spherical distances.
+static double const KSEarthRadiusKilometers = 6371.0;
+
+typedef struct {
+  double latitude;
+  double longitude;
+} KSGeoPoint;
+
+static double KSRadians(double degrees) {
+  return degrees * M_PI / 180.0;
+}
+
+static double KSDistanceInKilometers(KSGeoPoint a, KSGeoPoint b) {
+
+  double dLatitude  = KSRadians(b.latitude - a.latitude);
+  double dLongitude = KSRadians(b.longitude - a.longitude);
+  double h          = sin(dLatitude / 2) * sin(dLatitude / 2) +
+                      cos(KSRadians(a.latitude)) * cos(KSRadians(b.latitude)) * sin(dLongitude / 2) * sin(dLongitude / 2);
+
+  return 2 * KSEarthRadiusKilometers * asin(MIN(1.0, sqrt(h)));
+}
+
+@interface KSGeoQueryBenchmark()
+
+@property (nonatomic, readwrite) NSUInteger errorCount;
+
+- (BOOL)seedUpTo:(NSUInteger)rows tag:(NSString *)tag points:(NSMutableData *)points objects:(NSMutableArray *)objects random:(unsigned short *)random;
+- (void)timeShape:(NSString *)shape tag:(NSString *)tag points:(NSData *)points report:(KSBenchmarkReport *)report;
+- (NSUInteger)countPoints:(NSData *)points inShape:(NSString *)shape kilometers:(double)kilometers;
+- (void)deleteObjects:(NSArray *)objects;
+
+@end
+
+@implementation KSGeoQueryBenchmark
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field locationField:(NSString *)locationField iterations:(NSUInteger)iterations {
+
+  self = [super init];
+
+  if (self) {
+    _entity             = [entity copy];
+    _field              = [field copy];
+    _locationField      = [locationField copy];
+    _iterations         = iterations;
+    _timeout            = 30.0;
+    _rowCounts          = @[@10000, @100000, @1000000];
+    _seedBatchSize      = 1000;
+    _radii              = @[@1, @5, @20];
+    _centerLatitude     = 37.7749;
+    _centerLongitude    = -122.4194;
+    _regionSpan         = 0.5;
+    _resultLimit        = 1000;
+    _cleanupConcurrency = 8;
+  }
+
+  return self;
+}
+
+- (void)runWithReport:(KSBenchmarkReport *)report {
+
+  NSString *tag           = [[KSRunNamespace currentNamespace] tagValue:[NSString stringWithFormat:@"geo-%@", [[NSProcessInfo processInfo] globallyUniqueString]]];
+  NSMutableData *points   = [NSMutableData data];
+  NSMutableArray *objects = [NSMutableArray array];
+
+  // Same seed every run, so every provider gets the same points.
+  unsigned short random[3] = {0x4b53, 0x6765, 0x6f21};
+
+  self.errorCount = 0;
+
+  for (NSNumber *rowCount in _rowCounts) {
+
+    if (![self seedUpTo:[rowCount unsignedIntegerValue] tag:tag points:points objects:objects random:random]) {
+      NSLog(@"%@ geo: stopping at %lu objects", _entity, (unsigned long)[objects count]);
+      break;
+    }
+
+    [self timeShape:@"radius" tag:tag points:points report:report];
+
+    if (_boxBlock) {
+      [self timeShape:@"box" tag:tag points:points report:report];
+    }
+  }
+
+  [self deleteObjects:objects];
+}
+
+/*!
+ * Saves objects until there are rows of them, remembering each one's point.
+ * Returns NO when a batch failed.
+ */
+- (BOOL)seedUpTo:(NSUInteger)rows tag:(NSString *)tag points:(NSMutableData *)points objects:(NSMutableArray *)objects random:(unsigned short *)random {
+
+  KSLatencyHistogram *seed = [KSLatencyHistogram histogramWithName:[NSString stringWithFormat:@"%@.geo.seed", _entity]];
+  KSGeoSeedBlock save      = _seedBlock;
+  NSUInteger batchSize     = MAX(_seedBatchSize, 1);
+  NSTimeInterval timeout   = _timeout * MAX(1, (batchSize + 9) / 10);
+  NSTimeInterval start     = KSMonotonicTime();
+  NSUInteger first         = [objects count];
+
+  while ([objects count] < rows) {
+
+    @autoreleasepool {
+
+      NSUInteger count           = MIN(batchSize, rows - [objects count]);
+      NSMutableArray *fieldsList = [NSMutableArray arrayWithCapacity:count];
+      NSMutableData *batch       = [NSMutableData dataWithLength:count * sizeof(KSGeoPoint)];
+      KSGeoPoint *point          = [batch mutableBytes];
+
+      for (NSUInteger i = 0; i < count; i++) {
+
+        point[i].latitude  = _centerLatitude + (erand48(random) - 0.5) * _regionSpan;
+        point[i].longitude = _centerLongitude + (erand48(random) - 0.5) * _regionSpan;
+
+        [fieldsList addObject:@{_field : tag, _locationField : _pointBlock(point[i].latitude, point[i].longitude)}];
+      }
+
+      NSArray *saved = [seed measure:^(KSBenchmarkCompletion done) {
+        save(fieldsList, done);
+      } timeout:timeout];
+
+      if ([saved count] != count) {
+        self.errorCount += 1;
+        NSLog(@"%@ geo: seed batch saved %lu of %lu: %@", _entity, (unsigned long)[saved count], (unsigned long)count, [seed.errors lastObject]);
+        [objects addObjectsFromArray:saved];
+        return NO;
+      }
+
+      [points appendData:batch];
+      [objects addObjectsFromArray:saved];
+    }
+  }
+
+  NSLog(@"%@ geo: seeded %lu objects up to %lu in %.1fs", _entity, (unsigned long)([objects count] - first), (unsigned long)rows, KSMonotonicTime() - start);
+
+  return YES;
+}
+
+- (void)timeShape:(NSString *)shape tag:(NSString *)tag points:(NSData *)points report:(KSBenchmarkReport *)report {
+
+  NSUInteger rows            = [points length] / sizeof(KSGeoPoint);
+  NSMutableArray *histograms = [NSMutableArray arrayWithCapacity:[_radii count]];
+  NSMutableArray *rowsOut    = [NSMutableArray arrayWithCapacity:[_radii count]];
+  BOOL box                   = [shape isEqualToString:@"box"];
+  double latitude            = _centerLatitude;
+  double longitude           = _centerLongitude;
+  NSUInteger limit           = _resultLimit;
+  KSGeoRadiusBlock radius    = _radiusBlock;
+  KSGeoBoxBlock boxBlock     = _boxBlock;
+
+  [KSWireTrace start];
+
+  for (NSNumber *kilometers in _radii) {
+
+    KSLatencyHistogram *histogram = [KSLatencyHistogram histogramWithName:[NSString stringWithFormat:@"%@.%@.%lu.%@km", _entity, shape, (unsigned long)rows, kilometers]];
+    double km                     = [kilometers doubleValue];
+    double latitudeDelta          = km / (KSEarthRadiusKilometers * M_PI / 180.0);
+    double longitudeDelta         = latitudeDelta / cos(KSRadians(latitude));
+    NSUInteger results            = 0;
+
+    for (NSUInteger i = 0; i < _iterations; i++) {
+
+      NSArray *found = [histogram measure:^(KSBenchmarkCompletion done) {
+        if (box) {
+          boxBlock(tag, latitude - latitudeDelta, longitude - longitudeDelta, latitude + latitudeDelta, longitude + longitudeDelta, limit, done);
+        } else {
+          radius(tag, latitude, longitude, km, limit, done);
+        }
+      } timeout:_timeout];
+
+      if (found) {
+        results = [found count];
+      }
+    }
+
+    NSUInteger expected  = [self countPoints:points inShape:shape kilometers:km];
+    NSUInteger reachable = MIN(expected, limit);
+
+    [histograms addObject:histogram];
+
+    [rowsOut addObject:@{@"entity"    : _entity,
+                         @"shape"     : shape,
+                         @"rows"      : @(rows),
+                         @"radius_km" : kilometers,
+                         @"p50_s"     : @([histogram percentile:50]),
+                         @"p95_s"     : @([histogram percentile:95]),
+                         @"results"   : @(results),
+                         @"expected"  : @(expected),
+                         @"capped"    : @(results >= limit),
+                         @"recall"    : @(reachable > 0 ? (double)results / reachable : 1.0),
+                         @"errors"    : @(histogram.errorCount)}];
+
+    if (histogram.errorCount > 0) {
+      self.errorCount += histogram.errorCount;
+      NSLog(@"%@ geo %@ %@ km at %lu rows: %lu failed: %@", _entity, shape, kilometers, (unsigned long)rows, (unsigned long)histogram.errorCount, [histogram.errors lastObject]);
+    }
+  }
+
+  [KSWireTrace stop];
+
+  NSDictionary *attributes = @{@"entity" : _entity, @"shape" : shape, @"rows" : @(rows)};
+
+  for (KSLatencyHistogram *histogram in histograms) {
+    [report addHistogram:histogram withAttributes:attributes];
+  }
+
+  [KSWireTrace addToReport:report operations:histograms attributes:attributes];
+
+  for (NSDictionary *row in rowsOut) {
+    [report addResult:row];
+  }
+}
+
+/*!
+ * Seeded points inside the circle of kilometers around the center, or inside
+ * the square around that circle.
+ */
+- (NSUInteger)countPoints:(NSData *)points inShape:(NSString *)shape kilometers:(double)kilometers {
+
+  const KSGeoPoint *point = [points bytes];
+  NSUInteger count        = [points length] / sizeof(KSGeoPoint);
+  KSGeoPoint center       = {_centerLatitude, _centerLongitude};
+  double latitudeDelta    = kilometers / (KSEarthRadiusKilometers * M_PI / 180.0);
+  double longitudeDelta   = latitudeDelta / cos(KSRadians(center.latitude));
+  BOOL box                = [shape isEqualToString:@"box"];
+  NSUInteger inside       = 0;
+
+  for (NSUInteger i = 0; i < count; i++) {
+    if (box) {
+      if (fabs(point[i].latitude - center.latitude) <= latitudeDelta && fabs(point[i].longitude - center.longitude) <= longitudeDelta) {
+        inside++;
+      }
+    } else if (KSDistanceInKilometers(center, point[i]) <= kilometers) {
+      inside++;
+    }
+  }
+
+  return inside;
+}
+
+- (void)deleteObjects:(NSArray *)objects {
+
+  if ([objects count] == 0 || !_deleteBlock) {
+    return;
+  }
+
+  KSBenchmarkObjectBlock block = _deleteBlock;
+  KSBulkDeleter *deleter       = [KSBulkDeleter deleterWithMaxConcurrentDeletes:_cleanupConcurrency];
+
+  [deleter deleteItems:objects withBlock:^(id object, KSBulkDeleteCompletion done) {
+    block(object, 0, ^(id result, NSError *error) {
+      done(error);
+    });
+  }];
+
+  if (![deleter waitWithTimeout:_timeout * MAX(1, [objects count] / MAX(_cleanupConcurrency, 1))] || deleter.failedCount > 0) {
+    NSLog(@"%@ geo left %lu objects behind", _entity, (unsigned long)([objects count] - deleter.deletedCount));
+  }
+}
+
+@end
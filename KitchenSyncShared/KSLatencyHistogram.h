@@ -0,0 +1,86 @@
+//
+//  KSLatencyHistogram.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+
+/*!
+ * Called by a measured operation when it has finished. result is whatever
+ * the operation produced (a saved object, a page of results); pass an error
+ * instead if it failed.
+ */
+typedef void (^KSBenchmarkCompletion)(id result, NSError *error);
+
+/*!
+ * Latency samples for one operation, e.g. "Foo.create".
+ *
+ * Every sample is kept so percentiles are exact, and samples are also counted
+ * into power-of-two millisecond buckets for the report. Safe to record into
+ * from several threads.
+ */
+@interface KSLatencyHistogram : NSObject
+
++ (KSLatencyHistogram *)histogramWithName:(NSString *)name;
+
+- (id)initWithName:(NSString *)name;
+
+@property (nonatomic, readonly, copy) NSString *name;
+
+/*!
+ * Records one successful operation that took seconds.
+ */
+- (void)recordLatency:(NSTimeInterval)seconds;
+
+/*!
+ * Records one failed (or timed out) operation. Errors are not part of the
+ * latency statistics.
+ */
+- (void)recordError:(NSError *)error;
+
+/*!
+ * Runs operation, waits up to timeout seconds for it to call done, and records
+ * the time between the call and done. Returns the result passed to done, or
+ * nil if it failed or timed out. Must not be called from inside a measured
+ * operation.
+ */
+- (id)measure:(void (^)(KSBenchmarkCompletion done))operation timeout:(NSTimeInterval)timeout;
+
+@property (nonatomic, readonly) NSUInteger count;
+@property (nonatomic, readonly) NSUInteger errorCount;
+@property (nonatomic, readonly) NSArray *errors;
+
+@property (nonatomic, readonly) NSTimeInterval min;
+@property (nonatomic, readonly) NSTimeInterval max;
+@property (nonatomic, readonly) NSTimeInterval mean;
+
+/*!
+ * Latency at percentile (0-100) using the nearest-rank method, in seconds.
+ */
+- (NSTimeInterval)percentile:(double)percentile;
+
+/*!
+ * Wall-clock seconds the whole phase took. When set, the report includes
+ * throughput as (count + errorCount) / wallTime.
+ */
+@property (nonatomic, assign) NSTimeInterval wallTime;
+
+/*!
+ * Operations per second over wallTime, or 0 if wallTime is not set.
+ */
+@property (nonatomic, readonly) double throughput;
+
+/*!
+ * Bucket counts as an array of { "le_ms" : upper bound, "count" : n }. The
+ * last bucket has no upper bound.
+ */
+- (NSArray *)buckets;
+
+/*!
+ * JSON-ready summary: count, errors, min/mean/max, p50/p95/p99 in
+ * milliseconds, throughput and buckets.
+ */
+- (NSDictionary *)dictionaryRepresentation;
+
+@end
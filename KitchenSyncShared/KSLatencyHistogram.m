@@ -0,0 +1,249 @@
+//
+//  KSLatencyHistogram.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSLatencyHistogram.h"
+#import "KSCompletionWaiter.h"
+#import "KSMonotonicClock.h"
+
+// Bucket i holds samples <= 2^i ms; the last one holds everything slower.
+enum { KSLatencyHistogramBucketCount = 18 };
+
+static NSString * const KSLatencyHistogramErrorDomain = @"KSLatencyHistogramErrorDomain";
+
+@implementation KSLatencyHistogram {
+
+  NSMutableData  *_samples;
+  NSUInteger      _bucketCounts[KSLatencyHistogramBucketCount];
+  NSMutableArray *_errors;
+  NSTimeInterval  _min;
+  BOOL            _sorted;
+}
+
++ (KSLatencyHistogram *)histogramWithName:(NSString *)name {
+  return [[KSLatencyHistogram alloc] initWithName:name];
+}
+
+- (id)initWithName:(NSString *)name {
+
+  self = [super init];
+
+  if (self) {
+    _name    = [name copy];
+    _samples = [NSMutableData data];
+    _errors  = [NSMutableArray array];
+    _min     = DBL_MAX;
+  }
+
+  return self;
+}
+
+- (void)recordLatency:(NSTimeInterval)seconds {
+
+  double milliseconds = seconds * 1000.0;
+  NSUInteger bucket   = 0;
+
+  while (bucket < KSLatencyHistogramBucketCount - 1 && milliseconds > (double)(1 << bucket)) {
+    bucket++;
+  }
+
+  @synchronized(self) {
+
+    [_samples appendBytes:&seconds length:sizeof(seconds)];
+
+    _bucketCounts[bucket]++;
+    _count++;
+    _sorted = NO;
+    _min    = MIN(_min, seconds);
+    _max    = MAX(_max, seconds);
+  }
+}
+
+- (void)recordError:(NSError *)error {
+
+  if (!error) {
+    error = [NSError errorWithDomain:KSLatencyHistogramErrorDomain code:0 userInfo:nil];
+  }
+
+  @synchronized(self) {
+    _errorCount++;
+    [_errors addObject:error];
+  }
+}
+
+- (id)measure:(void (^)(KSBenchmarkCompletion done))operation timeout:(NSTimeInterval)timeout {
+
+  KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
+
+  __block id       result   = nil;
+  __block NSError *failure  = nil;
+  __block NSTimeInterval finishedAt = 0;
+
+  NSTimeInterval startedAt = KSMonotonicTime();
+
+  @try {
+    operation(^(id operationResult, NSError *error) {
+
+      // Stamp the time here, not when the waiter wakes up, so the run loop
+      // turnaround isn't counted.
+      @synchronized(waiter) {
+        if (finishedAt == 0) {
+          finishedAt = KSMonotonicTime();
+          result     = operationResult;
+          failure    = error;
+        }
+      }
+
+      [waiter signal];
+    });
+  } @catch (NSException *e) {
+    failure = [NSError errorWithDomain:KSLatencyHistogramErrorDomain
+                                  code:1
+                              userInfo:@{NSLocalizedDescriptionKey : [e description]}];
+    [waiter signal];
+  }
+
+  if (![waiter waitWithTimeout:timeout]) {
+
+    [self recordError:[NSError errorWithDomain:KSLatencyHistogramErrorDomain
+                                          code:2
+                                      userInfo:@{NSLocalizedDescriptionKey : [NSString stringWithFormat:@"%@ timed out after %.3fs", _name, timeout]}]];
+    return nil;
+  }
+
+  @synchronized(waiter) {
+
+    if (failure) {
+      [self recordError:failure];
+      return nil;
+    }
+
+    [self recordLatency:finishedAt - startedAt];
+
+    return result;
+  }
+}
+
+- (NSArray *)errors {
+  @synchronized(self) {
+    return [_errors copy];
+  }
+}
+
+- (NSTimeInterval)min {
+  @synchronized(self) {
+    return _count ? _min : 0;
+  }
+}
+
+- (NSTimeInterval)mean {
+
+  @synchronized(self) {
+
+    if (_count == 0) {
+      return 0;
+    }
+
+    const NSTimeInterval *values = [_samples bytes];
+    NSTimeInterval total         = 0;
+
+    for (NSUInteger i = 0; i < _count; i++) {
+      total += values[i];
+    }
+
+    return total / _count;
+  }
+}
+
+static int KSCompareTimeIntervals(const void *a, const void *b) {
+
+  NSTimeInterval lhs = *(const NSTimeInterval *)a;
+  NSTimeInterval rhs = *(const NSTimeInterval *)b;
+
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+- (NSTimeInterval)percentile:(double)percentile {
+
+  @synchronized(self) {
+
+    if (_count == 0) {
+      return 0;
+    }
+
+    if (!_sorted) {
+      qsort([_samples mutableBytes], _count, sizeof(NSTimeInterval), KSCompareTimeIntervals);
+      _sorted = YES;
+    }
+
+    double rank      = ceil(percentile / 100.0 * _count);
+    NSUInteger index = (NSUInteger)MAX(rank, 1.0) - 1;
+
+    return ((const NSTimeInterval *)[_samples bytes])[MIN(index, _count - 1)];
+  }
+}
+
+- (double)throughput {
+
+  if (_wallTime <= 0) {
+    return 0;
+  }
+
+  return (self.count + self.errorCount) / _wallTime;
+}
+
+- (NSArray *)buckets {
+
+  NSMutableArray *buckets = [NSMutableArray arrayWithCapacity:KSLatencyHistogramBucketCount];
+
+  @synchronized(self) {
+
+    for (NSUInteger i = 0; i < KSLatencyHistogramBucketCount; i++) {
+
+      id upperBound = (i == KSLatencyHistogramBucketCount - 1) ? (id)[NSNull null] : @(1 << i);
+
+      [buckets addObject:@{@"le_ms" : upperBound, @"count" : @(_bucketCounts[i])}];
+    }
+  }
+
+  return buckets;
+}
+
+- (NSDictionary *)dictionaryRepresentation {
+
+  NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+
+  dictionary[@"name"]    = _name;
+  dictionary[@"count"]   = @(self.count);
+  dictionary[@"errors"]  = @(self.errorCount);
+  dictionary[@"min_ms"]  = @(self.min * 1000.0);
+  dictionary[@"mean_ms"] = @(self.mean * 1000.0);
+  dictionary[@"max_ms"]  = @(self.max * 1000.0);
+  dictionary[@"p50_ms"]  = @([self percentile:50] * 1000.0);
+  dictionary[@"p95_ms"]  = @([self percentile:95] * 1000.0);
+  dictionary[@"p99_ms"]  = @([self percentile:99] * 1000.0);
+  dictionary[@"buckets"] = [self buckets];
+
+  if (_wallTime > 0) {
+    dictionary[@"wall_time_s"]    = @(_wallTime);
+    dictionary[@"ops_per_second"] = @(self.throughput);
+  }
+
+  return dictionary;
+}
+
+- (NSString *)description {
+  return [NSString stringWithFormat:@"%@: n=%lu errors=%lu p50=%.1fms p95=%.1fms p99=%.1fms max=%.1fms%@",
+          _name,
+          (unsigned long)self.count,
+          (unsigned long)self.errorCount,
+          [self percentile:50] * 1000.0,
+          [self percentile:95] * 1000.0,
+          [self percentile:99] * 1000.0,
+          self.max * 1000.0,
+          _wallTime > 0 ? [NSString stringWithFormat:@" %.1f ops/s", self.throughput] : @""];
+}
+
+@end
@@ -0,0 +1,121 @@
+//
+//  KSLoadGenerator.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSLatencyHistogram.h"
+
+@class KSBenchmarkReport;
+
+/*!
+ * Starts one operation and calls done when the backend has answered.
+ * sequence counts up from 0 across all workers.
+ */
+typedef void (^KSLoadOperationBlock)(NSUInteger sequence, KSBenchmarkCompletion done);
+
+/*!
+ * Drives an SDK with a fixed number of concurrent workers, optionally paced
+ * to a target request rate, and records latency under that load.
+ *
+ * A worker is a slot for one outstanding operation: a new operation starts as
+ * soon as a slot is free (and, with a target rate, its start time has come).
+ * When the SDK queues requests internally the achieved rate stops rising
+ * with more workers and the schedule lag - how late operations start
+ * compared to the target rate - grows, which is where it saturates.
+ *
+ *   KSLoadGenerator *generator = [KSLoadGenerator generatorWithName:@"Foo.create" workers:16];
+ *   generator.duration = 10.0;
+ *   [generator runWithBlock:^(NSUInteger sequence, KSBenchmarkCompletion done) { ... }];
+ *   [generator addToReport:report];
+ */
+@interface KSLoadGenerator : NSObject
+
++ (KSLoadGenerator *)generatorWithName:(NSString *)name workers:(NSUInteger)workers;
+
+- (id)initWithName:(NSString *)name workers:(NSUInteger)workers;
+
+@property (nonatomic, readonly, copy) NSString *name;
+@property (nonatomic, readonly) NSUInteger workers;
+
+/*!
+ * Operations started per second across all workers. 0 (the default) starts
+ * them as fast as workers free up.
+ */
+@property (nonatomic, assign) double targetRate;
+
+/*!
+ * Seconds during which new operations are started. Defaults to 10.
+ */
+@property (nonatomic, assign) NSTimeInterval duration;
+
+/*!
+ * Stops starting operations after this many, even if duration has not
+ * passed. 0 (the default) means no limit.
+ */
+@property (nonatomic, assign) NSUInteger maxOperations;
+
+/*!
+ * Seconds after which an operation that has not called back counts as
+ * failed. It keeps its slot until the SDK does call back, so no more than
+ * workers operations are ever running. Defaults to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval operationTimeout;
+
+/*!
+ * Queue the operation block is invoked on. Defaults to the main queue.
+ */
+@property (nonatomic, strong) dispatch_queue_t invocationQueue;
+
+/*!
+ * Runs the load and waits until every started operation has called back or
+ * timed out. Returns NO if operations were still outstanding at the end.
+ * A generator runs once.
+ */
+- (BOOL)runWithBlock:(KSLoadOperationBlock)block;
+
+/*!
+ * Latency of every successful operation under load.
+ */
+@property (nonatomic, readonly) KSLatencyHistogram *latency;
+
+/*!
+ * How late each operation started compared to its slot in the target rate.
+ * Empty when there is no target rate.
+ */
+@property (nonatomic, readonly) KSLatencyHistogram *scheduleLag;
+
+@property (nonatomic, readonly) NSUInteger startedCount;
+@property (nonatomic, readonly) NSUInteger succeededCount;
+@property (nonatomic, readonly) NSUInteger failedCount;
+
+/*!
+ * Operations that had timed out but not yet called back when the run
+ * ended. They are included in failedCount.
+ */
+@property (nonatomic, readonly) NSUInteger stillRunningCount;
+
+/*!
+ * Seconds from the first start until the last operation finished.
+ */
+@property (nonatomic, readonly) NSTimeInterval elapsed;
+
+/*!
+ * Successful operations per second over elapsed.
+ */
+@property (nonatomic, readonly) double achievedRate;
+
+/*!
+ * Failed operations as a fraction of those started.
+ */
+@property (nonatomic, readonly) double errorRate;
+
+/*!
+ * Adds the latency and schedule lag histograms and a summary row to report.
+ */
+- (void)addToReport:(KSBenchmarkReport *)report;
+
+- (NSDictionary *)dictionaryRepresentation;
+
+@end
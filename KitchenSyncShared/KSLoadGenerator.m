@@ -0,0 +1,301 @@
+//
+//  KSLoadGenerator.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSLoadGenerator.h"
+#import "KSBenchmarkReport.h"
+#import "KSCompletionWaiter.h"
+#import "KSMonotonicClock.h"
+
+static NSString * const KSLoadGeneratorErrorDomain = @"KSLoadGeneratorErrorDomain";
+
+@interface KSLoadGenerator()
+
+@property (nonatomic, readwrite) NSTimeInterval elapsed;
+
+- (void)startOperation:(NSUInteger)sequence
+           scheduledAt:(NSTimeInterval)scheduledAt
+                 block:(KSLoadOperationBlock)block
+                waiter:(KSCompletionWaiter *)waiter
+                 slots:(dispatch_semaphore_t)slots;
+
+@end
+
+@implementation KSLoadGenerator {
+
+  NSUInteger     _startedCount;
+  NSUInteger     _succeededCount;
+  NSUInteger     _failedCount;
+  NSUInteger     _overdueCount;
+  NSUInteger     _stillRunningCount;
+  NSTimeInterval _startedAt;
+  NSTimeInterval _finishedAt;
+  BOOL           _ran;
+}
+
++ (KSLoadGenerator *)generatorWithName:(NSString *)name workers:(NSUInteger)workers {
+  return [[KSLoadGenerator alloc] initWithName:name workers:workers];
+}
+
+- (id)initWithName:(NSString *)name workers:(NSUInteger)workers {
+
+  self = [super init];
+
+  if (self) {
+    _name             = [name copy];
+    _workers          = MAX(workers, 1);
+    _duration         = 10.0;
+    _operationTimeout = 30.0;
+    _invocationQueue  = dispatch_get_main_queue();
+    _latency          = [KSLatencyHistogram histogramWithName:[NSString stringWithFormat:@"%@.latency", _name]];
+    _scheduleLag      = [KSLatencyHistogram histogramWithName:[NSString stringWithFormat:@"%@.schedule_lag", _name]];
+  }
+
+  return self;
+}
+
+- (NSUInteger)startedCount {
+  @synchronized(self) {
+    return _startedCount;
+  }
+}
+
+- (NSUInteger)succeededCount {
+  @synchronized(self) {
+    return _succeededCount;
+  }
+}
+
+- (NSUInteger)failedCount {
+  @synchronized(self) {
+    return _failedCount;
+  }
+}
+
+- (NSUInteger)stillRunningCount {
+  @synchronized(self) {
+    return _stillRunningCount;
+  }
+}
+
+- (double)achievedRate {
+  return _elapsed > 0 ? self.succeededCount / _elapsed : 0;
+}
+
+- (double)errorRate {
+
+  NSUInteger started = self.startedCount;
+
+  return started > 0 ? (double)self.failedCount / started : 0;
+}
+
+- (BOOL)runWithBlock:(KSLoadOperationBlock)block {
+
+  @synchronized(self) {
+    NSAssert(!_ran, @"a load generator runs once");
+    _ran = YES;
+  }
+
+  dispatch_queue_t feederQueue = dispatch_queue_create("com.kitchensync.loadgenerator", DISPATCH_QUEUE_SERIAL);
+  dispatch_semaphore_t slots   = dispatch_semaphore_create(_workers);
+
+  // The extra signal is released by the feeder once it has stopped starting
+  // operations, so the waiter cannot complete between two of them.
+  KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
+
+  NSTimeInterval startedAt  = KSMonotonicTime();
+  NSTimeInterval duration   = _duration;
+  NSTimeInterval interval   = _targetRate > 0 ? 1.0 / _targetRate : 0;
+  NSUInteger maxOperations  = _maxOperations;
+
+  _startedAt  = startedAt;
+  _finishedAt = startedAt;
+
+  dispatch_async(feederQueue, ^{
+
+    for (NSUInteger sequence = 0; maxOperations == 0 || sequence < maxOperations; sequence++) {
+
+      NSTimeInterval scheduledAt = interval > 0 ? startedAt + sequence * interval : 0;
+      NSTimeInterval deadline    = startedAt + duration;
+
+      if (scheduledAt >= deadline) {
+        break;
+      }
+
+      NSTimeInterval remaining = deadline - KSMonotonicTime();
+
+      if (remaining <= 0 || dispatch_semaphore_wait(slots, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(remaining * NSEC_PER_SEC))) != 0) {
+        break;
+      }
+
+      NSTimeInterval now = KSMonotonicTime();
+
+      if (scheduledAt > now) {
+        [NSThread sleepForTimeInterval:scheduledAt - now];
+      }
+
+      [self startOperation:sequence scheduledAt:scheduledAt block:block waiter:waiter slots:slots];
+    }
+
+    [waiter signal];
+  });
+
+  BOOL completed = [waiter waitWithTimeout:duration + _operationTimeout + 5.0];
+
+  @synchronized(self) {
+    self.elapsed       = (completed ? _finishedAt : KSMonotonicTime()) - _startedAt;
+    _stillRunningCount = _overdueCount;
+  }
+
+  _latency.wallTime = self.elapsed;
+
+  return completed;
+}
+
+/*!
+ * Runs one operation on the invocation queue. Its result is recorded when it
+ * calls back or times out, whichever comes first, but its slot is only
+ * returned when it calls back.
+ */
+- (void)startOperation:(NSUInteger)sequence
+           scheduledAt:(NSTimeInterval)scheduledAt
+                 block:(KSLoadOperationBlock)block
+                waiter:(KSCompletionWaiter *)waiter
+                 slots:(dispatch_semaphore_t)slots {
+
+  [waiter expectSignal];
+
+  @synchronized(self) {
+    _startedCount++;
+  }
+
+  NSTimeInterval operationTimeout = _operationTimeout;
+
+  dispatch_async(_invocationQueue, ^{
+
+    NSTimeInterval operationStartedAt = KSMonotonicTime();
+    __block BOOL finished             = NO;
+    __block BOOL returned             = NO;
+
+    if (scheduledAt > 0) {
+      [_scheduleLag recordLatency:MAX(operationStartedAt - scheduledAt, 0)];
+    }
+
+    KSBenchmarkCompletion done = ^(id result, NSError *error) {
+
+      NSTimeInterval finishedAt = KSMonotonicTime();
+      BOOL overdue              = NO;
+
+      @synchronized(self) {
+
+        if (returned) {
+          return;
+        }
+
+        returned = YES;
+        overdue  = finished;
+
+        if (overdue) {
+          _overdueCount--;
+        } else {
+
+          finished    = YES;
+          _finishedAt = MAX(_finishedAt, finishedAt);
+
+          if (error) {
+            _failedCount++;
+          } else {
+            _succeededCount++;
+          }
+        }
+      }
+
+      // The timeout has already recorded this operation; only its slot is
+      // still to be returned.
+      if (!overdue) {
+
+        if (error) {
+          [_latency recordError:error];
+        } else {
+          [_latency recordLatency:finishedAt - operationStartedAt];
+        }
+      }
+
+      dispatch_semaphore_signal(slots);
+
+      if (!overdue) {
+        [waiter signal];
+      }
+    };
+
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(operationTimeout * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+
+      @synchronized(self) {
+
+        if (finished) {
+          return;
+        }
+
+        finished    = YES;
+        _finishedAt = MAX(_finishedAt, KSMonotonicTime());
+        _failedCount++;
+        _overdueCount++;
+      }
+
+      [_latency recordError:[NSError errorWithDomain:KSLoadGeneratorErrorDomain
+                                                code:1
+                                            userInfo:@{NSLocalizedDescriptionKey : [NSString stringWithFormat:@"%@ #%lu timed out after %.3fs", _name, (unsigned long)sequence, operationTimeout]}]];
+      [waiter signal];
+    });
+
+    @try {
+      block(sequence, done);
+    } @catch (NSException *e) {
+      done(nil, [NSError errorWithDomain:KSLoadGeneratorErrorDomain
+                                    code:0
+                                userInfo:@{NSLocalizedDescriptionKey : [e description]}]);
+    }
+  });
+}
+
+- (NSDictionary *)dictionaryRepresentation {
+  return @{@"name"                    : _name,
+           @"workers"                 : @(_workers),
+           @"target_rate"             : @(_targetRate),
+           @"duration_s"              : @(_duration),
+           @"started"                 : @(self.startedCount),
+           @"succeeded"               : @(self.succeededCount),
+           @"failed"                  : @(self.failedCount),
+           @"still_running"           : @(self.stillRunningCount),
+           @"error_rate"              : @(self.errorRate),
+           @"elapsed_s"               : @(_elapsed),
+           @"achieved_ops_per_second" : @(self.achievedRate)};
+}
+
+- (void)addToReport:(KSBenchmarkReport *)report {
+
+  NSDictionary *attributes = @{@"workers" : @(_workers), @"target_rate" : @(_targetRate)};
+
+  [report addHistogram:_latency withAttributes:attributes];
+
+  if (_scheduleLag.count > 0) {
+    [report addHistogram:_scheduleLag withAttributes:attributes];
+  }
+
+  [report addResult:[self dictionaryRepresentation]];
+}
+
+- (NSString *)description {
+  return [NSString stringWithFormat:@"%@: workers=%lu target=%.1f/s achieved=%.1f/s errors=%.1f%% p50=%.1fms p99=%.1fms",
+          _name,
+          (unsigned long)_workers,
+          _targetRate,
+          self.achievedRate,
+          self.errorRate * 100.0,
+          [_latency percentile:50] * 1000.0,
+          [_latency percentile:99] * 1000.0];
+}
+
+@end
@@ -0,0 +1,42 @@
+//
+//  KSMemoryFootprint.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#include <malloc/malloc.h>
+#include <mach/mach.h>
+
+/*!
+ * Returns the bytes currently allocated in every malloc zone. Unlike the
+ * resident size, it goes down again when memory is freed, so the difference
+ * between two calls is what is still alive in between rather than the peak.
+ * Drain autorelease pools before reading it.
+ */
+static inline unsigned long long KSHeapBytesInUse(void) {
+
+  malloc_statistics_t statistics;
+
+  malloc_zone_statistics(NULL, &statistics);
+
+  return statistics.size_in_use;
+}
+
+/*!
+ * Returns the process's resident size: pages actually in memory, including
+ * ones malloc has not handed back yet and mapped files being read. This is
+ * what the system weighs when it runs short of memory, so sample it to find
+ * the peak an operation needs. Returns 0 if the kernel will not say.
+ */
+static inline unsigned long long KSResidentBytes(void) {
+
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+    return 0;
+  }
+
+  return info.resident_size;
+}
@@ -0,0 +1,23 @@
+//
+//  KSMonotonicClock.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#include <mach/mach_time.h>
+
+/*!
+ * Returns a monotonic timestamp in seconds. Only differences between two
+ * calls are meaningful; unlike NSDate it never jumps with wall-clock changes.
+ */
+static inline NSTimeInterval KSMonotonicTime(void) {
+
+  static mach_timebase_info_data_t timebase;
+
+  if (timebase.denom == 0) {
+    mach_timebase_info(&timebase);
+  }
+
+  return (double)mach_absolute_time() * timebase.numer / timebase.denom / NSEC_PER_SEC;
+}
@@ -0,0 +1,133 @@
+//
+//  KSOfflineQueueBenchmark.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSCRUDBenchmark.h"
+
+/*!
+ * Hands one write with fields to the SDK's offline queue. Runs synchronously
+ * and returns once the SDK has accepted it.
+ */
+typedef void (^KSOfflineEnqueueBlock)(NSUInteger index, NSDictionary *fields);
+
+/*!
+ * Returns the number of writes the SDK still has queued.
+ */
+typedef NSUInteger (^KSOfflinePendingBlock)(void);
+
+/*!
+ * Calls done with the objects on the backend whose field starts with prefix,
+ * oldest first as the backend stored them.
+ */
+typedef void (^KSOfflineFetchBlock)(NSString *prefix, KSBenchmarkCompletion done);
+
+/*!
+ * Calls done with the number of objects on the backend whose field starts
+ * with prefix, as an NSNumber.
+ */
+typedef void (^KSOfflineCountBlock)(NSString *prefix, KSBenchmarkCompletion done);
+
+/*!
+ * Returns the value of the benchmark field of an object the fetch block
+ * returned.
+ */
+typedef id (^KSOfflineValueBlock)(id object);
+
+/*!
+ * Measures an SDK's offline write queue.
+ *
+ * For each queue size the backend is taken away with +[KSStandIn
+ * setOffline:], that many writes are queued and left to fail for
+ * offlineDwell seconds, and the backend is brought back. The benchmark
+ * reports what each queued write cost, how much the queue grew on disk, how
+ * long it took to drain and at what rate, and then fetches the step's
+ * objects to count lost and duplicated writes and writes that arrived out of
+ * order.
+ *
+ * The queue counts as drained when the pending block reports nothing left,
+ * or, for SDKs that don't say, when the count block sees every write or
+ * stops moving for stallTimeout seconds.
+ */
+@interface KSOfflineQueueBenchmark : NSObject
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field;
+
+@property (nonatomic, readonly, copy) NSString *entity;
+@property (nonatomic, readonly, copy) NSString *field;
+
+/*!
+ * Writes queued at each step. Defaults to 10, 100, 1000 and 10000.
+ */
+@property (nonatomic, copy) NSArray *queueSizes;
+
+/*!
+ * Bytes of padding in every value. Defaults to 1024, so the largest step
+ * queues about 10 MB.
+ */
+@property (nonatomic, assign) NSUInteger valueSize;
+
+/*!
+ * Seconds the writes stay queued with the backend away. Defaults to 5.
+ */
+@property (nonatomic, assign) NSTimeInterval offlineDwell;
+
+/*!
+ * Seconds to wait for a queue to drain. Defaults to 600.
+ */
+@property (nonatomic, assign) NSTimeInterval drainTimeout;
+
+/*!
+ * Seconds without progress after which a queue counts as stalled. Defaults
+ * to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval stallTimeout;
+
+/*!
+ * Seconds between progress checks while draining. Defaults to 1.
+ */
+@property (nonatomic, assign) NSTimeInterval pollInterval;
+
+/*!
+ * Seconds to wait for a single fetch, count or delete. Defaults to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+/*!
+ * Deletes run in parallel when cleaning up. Defaults to 8.
+ */
+@property (nonatomic, assign) NSUInteger cleanupConcurrency;
+
+/*!
+ * Where the SDK keeps its queue. Growth across the enqueue phase is
+ * reported as the queue's footprint. Defaults to the app's Library and
+ * Documents directories.
+ */
+@property (nonatomic, copy) NSArray *storagePaths;
+
+@property (nonatomic, copy) KSOfflineEnqueueBlock  enqueueBlock;
+@property (nonatomic, copy) KSOfflinePendingBlock  pendingCountBlock;
+@property (nonatomic, copy) KSOfflineCountBlock    countBlock;
+@property (nonatomic, copy) KSOfflineFetchBlock    fetchBlock;
+@property (nonatomic, copy) KSOfflineValueBlock    valueBlock;
+@property (nonatomic, copy) KSBenchmarkObjectBlock deleteBlock;
+
+/*!
+ * Called once the backend is back, for SDKs that only retry when told the
+ * network has returned.
+ */
+@property (nonatomic, copy) dispatch_block_t reconnectBlock;
+
+/*!
+ * Adds an enqueue histogram and a result row per queue size to report.
+ */
+- (void)runWithReport:(KSBenchmarkReport *)report;
+
+/*!
+ * Writes lost or left undrained in the last run.
+ */
+@property (nonatomic, readonly) NSUInteger lostCount;
+
+@end
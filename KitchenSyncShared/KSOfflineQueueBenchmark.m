@@ -0,0 +1,323 @@
+//
+//  KSOfflineQueueBenchmark.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSOfflineQueueBenchmark.h"
+#import "KSBenchmarkReport.h"
+#import "KSBulkDeleter.h"
+#import "KSCompletionWaiter.h"
+#import "KSMonotonicClock.h"
+#import "KSRandomString.h"
+#import "KSRunNamespace.h"
+#import "KSStandIn.h"
+
+@interface KSOfflineQueueBenchmark()
+
+@property (nonatomic, readwrite) NSUInteger lostCount;
+
+- (void)runQueueSize:(NSUInteger)size runTag:(NSString *)runTag report:(KSBenchmarkReport *)report;
+- (NSTimeInterval)drainWrites:(NSUInteger)size prefix:(NSString *)prefix drained:(BOOL *)drained;
+- (id)waitForOperation:(void (^)(KSBenchmarkCompletion done))operation error:(NSError **)error;
+- (unsigned long long)storageBytes;
+- (void)pauseFor:(NSTimeInterval)interval;
+- (void)deleteObjects:(NSArray *)objects;
+
+@end
+
+@implementation KSOfflineQueueBenchmark
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field {
+
+  self = [super init];
+
+  if (self) {
+
+    NSString *home = NSHomeDirectory();
+
+    _entity             = [entity copy];
+    _field              = [field copy];
+    _queueSizes         = @[@10, @100, @1000, @10000];
+    _valueSize          = 1024;
+    _offlineDwell       = 5.0;
+    _drainTimeout       = 600.0;
+    _stallTimeout       = 30.0;
+    _pollInterval       = 1.0;
+    _timeout            = 30.0;
+    _cleanupConcurrency = 8;
+    _storagePaths       = @[[home stringByAppendingPathComponent:@"Library"],
+                            [home stringByAppendingPathComponent:@"Documents"]];
+  }
+
+  return self;
+}
+
+- (void)runWithReport:(KSBenchmarkReport *)report {
+
+  // Keeps this run's steps apart from earlier runs in the same namespace.
+  NSString *runTag = [[[NSProcessInfo processInfo] globallyUniqueString] substringToIndex:8];
+
+  self.lostCount = 0;
+
+  for (NSNumber *size in _queueSizes) {
+    [self runQueueSize:[size unsignedIntegerValue] runTag:runTag report:report];
+  }
+}
+
+- (void)runQueueSize:(NSUInteger)size runTag:(NSString *)runTag report:(KSBenchmarkReport *)report {
+
+  NSString *name            = [NSString stringWithFormat:@"%@.offline.enqueue", _entity];
+  KSLatencyHistogram *queue = [KSLatencyHistogram histogramWithName:name];
+  NSString *prefix          = [[KSRunNamespace currentNamespace] tagValue:[NSString stringWithFormat:@"offline-%@-%lu-", runTag, (unsigned long)size]];
+  NSString *padding         = KSRandomString(_valueSize);
+
+  [KSStandIn setOffline:YES];
+
+  NSUInteger refusedBefore        = [KSStandIn refusedRequestCount];
+  unsigned long long storedBefore = [self storageBytes];
+  NSTimeInterval enqueueStart     = KSMonotonicTime();
+
+  for (NSUInteger i = 0; i < size; i++) {
+
+    @autoreleasepool {
+
+      NSDictionary *fields = @{_field : [NSString stringWithFormat:@"%@%06lu-%@", prefix, (unsigned long)i, padding]};
+      NSTimeInterval start = KSMonotonicTime();
+
+      _enqueueBlock(i, fields);
+
+      [queue recordLatency:KSMonotonicTime() - start];
+    }
+  }
+
+  queue.wallTime = KSMonotonicTime() - enqueueStart;
+
+  [self pauseFor:_offlineDwell];
+
+  unsigned long long storedAfter = [self storageBytes];
+  NSUInteger pendingOffline      = _pendingCountBlock ? _pendingCountBlock() : NSNotFound;
+  NSUInteger refused             = [KSStandIn refusedRequestCount] - refusedBefore;
+
+  [KSStandIn setOffline:NO];
+
+  if (_reconnectBlock) {
+    _reconnectBlock();
+  }
+
+  BOOL drained              = NO;
+  NSTimeInterval drainTime  = [self drainWrites:size prefix:prefix drained:&drained];
+  NSUInteger pendingAfter   = _pendingCountBlock ? _pendingCountBlock() : NSNotFound;
+  NSError *error            = nil;
+  NSArray *objects          = [self waitForOperation:^(KSBenchmarkCompletion done) {
+    _fetchBlock(prefix, done);
+  } error:&error];
+
+  NSMutableIndexSet *seen = [NSMutableIndexSet indexSet];
+  NSUInteger duplicates   = 0;
+  NSUInteger outOfOrder   = 0;
+  NSInteger previous      = -1;
+
+  for (id object in objects) {
+
+    NSString *value = _valueBlock(object);
+
+    if (![value isKindOfClass:[NSString class]] || ![value hasPrefix:prefix]) {
+      continue;
+    }
+
+    NSInteger index = [[value substringFromIndex:[prefix length]] integerValue];
+
+    if ([seen containsIndex:index]) {
+      duplicates++;
+    } else {
+      [seen addIndex:index];
+    }
+
+    if (index < previous) {
+      outOfOrder++;
+    }
+
+    previous = index;
+  }
+
+  NSUInteger lost = size - MIN([seen count], size);
+
+  NSMutableIndexSet *missing = [NSMutableIndexSet indexSetWithIndexesInRange:NSMakeRange(0, size)];
+
+  [missing removeIndexes:seen];
+
+  self.lostCount += lost;
+
+  NSDictionary *attributes = @{@"entity" : _entity, @"queued" : @(size)};
+
+  [report addHistogram:queue withAttributes:attributes];
+
+  NSMutableDictionary *result = [@{@"entity"            : _entity,
+                                   @"queued"            : @(size),
+                                   @"value_bytes"       : @([prefix length] + 7 + _valueSize),
+                                   @"enqueue_p50_s"     : @([queue percentile:50]),
+                                   @"enqueue_p95_s"     : @([queue percentile:95]),
+                                   @"enqueue_total_s"   : @(queue.wallTime),
+                                   @"footprint_bytes"   : @(storedAfter > storedBefore ? storedAfter - storedBefore : 0),
+                                   @"refused_requests"  : @(refused),
+                                   @"drained"           : @(drained),
+                                   @"drain_s"           : @(drainTime),
+                                   @"drain_rate_per_s"  : @(drainTime > 0 ? [seen count] / drainTime : 0),
+                                   @"delivered"         : @([seen count]),
+                                   @"lost"              : @(lost),
+                                   @"duplicates"        : @(duplicates),
+                                   @"out_of_order"      : @(outOfOrder)} mutableCopy];
+
+  if (pendingOffline != NSNotFound) {
+    result[@"pending_offline"] = @(pendingOffline);
+  }
+
+  if (pendingAfter != NSNotFound) {
+    result[@"pending_after_drain"] = @(pendingAfter);
+  }
+
+  // Which end went missing tells a discard-oldest queue from one that
+  // stopped accepting writes.
+  if ([missing count] > 0) {
+    result[@"first_lost_index"] = @([missing firstIndex]);
+    result[@"last_lost_index"]  = @([missing lastIndex]);
+  }
+
+  if (error) {
+    result[@"fetch_error"] = [error localizedDescription];
+  }
+
+  [report addResult:result];
+
+  NSLog(@"%@ offline queue of %lu: %lu delivered in %.3fs, %lu lost, %lu duplicated, %lu out of order",
+        _entity, (unsigned long)size, (unsigned long)[seen count], drainTime,
+        (unsigned long)lost, (unsigned long)duplicates, (unsigned long)outOfOrder);
+
+  [self deleteObjects:objects];
+}
+
+/*!
+ * Waits for the queue to empty and returns how long it took. drained is NO
+ * when it timed out or stalled.
+ */
+- (NSTimeInterval)drainWrites:(NSUInteger)size prefix:(NSString *)prefix drained:(BOOL *)drained {
+
+  NSTimeInterval start        = KSMonotonicTime();
+  NSTimeInterval lastProgress = start;
+  NSUInteger lastSeen         = NSNotFound;
+
+  *drained = NO;
+
+  while (KSMonotonicTime() - start < _drainTimeout) {
+
+    if (_pendingCountBlock) {
+
+      NSUInteger pending = _pendingCountBlock();
+
+      if (pending == 0) {
+        *drained = YES;
+        break;
+      }
+
+      if (pending != lastSeen) {
+        lastSeen     = pending;
+        lastProgress = KSMonotonicTime();
+      }
+
+    } else if (_countBlock) {
+
+      NSUInteger count = [[self waitForOperation:^(KSBenchmarkCompletion done) {
+        _countBlock(prefix, done);
+      } error:NULL] unsignedIntegerValue];
+
+      if (count >= size) {
+        *drained = YES;
+        break;
+      }
+
+      if (count != lastSeen) {
+        lastSeen     = count;
+        lastProgress = KSMonotonicTime();
+      }
+    }
+
+    if (KSMonotonicTime() - lastProgress > _stallTimeout) {
+      break;
+    }
+
+    [self pauseFor:_pollInterval];
+  }
+
+  return (*drained ? KSMonotonicTime() : lastProgress) - start;
+}
+
+- (id)waitForOperation:(void (^)(KSBenchmarkCompletion done))operation error:(NSError **)error {
+
+  KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
+  __block id result          = nil;
+  __block NSError *failure   = nil;
+
+  operation(^(id value, NSError *operationError) {
+    result  = value;
+    failure = operationError;
+    [waiter signal];
+  });
+
+  if (![waiter waitWithTimeout:_timeout] && !failure) {
+    failure = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorTimedOut userInfo:nil];
+  }
+
+  if (error) {
+    *error = failure;
+  }
+
+  return result;
+}
+
+- (unsigned long long)storageBytes {
+
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  unsigned long long total   = 0;
+
+  for (NSString *root in _storagePaths) {
+
+    NSDirectoryEnumerator *files = [fileManager enumeratorAtPath:root];
+
+    for (NSString *file in files) {
+      total += [[files fileAttributes] fileSize];
+    }
+  }
+
+  return total;
+}
+
+/*!
+ * Lets the SDKs run for interval seconds. A waiter that is never signalled
+ * keeps the main run loop going, which is where their retries are scheduled.
+ */
+- (void)pauseFor:(NSTimeInterval)interval {
+  [[KSCompletionWaiter waiter] waitWithTimeout:interval];
+}
+
+- (void)deleteObjects:(NSArray *)objects {
+
+  if ([objects count] == 0 || !_deleteBlock) {
+    return;
+  }
+
+  KSBenchmarkObjectBlock remove = _deleteBlock;
+  KSBulkDeleter *deleter        = [KSBulkDeleter deleterWithMaxConcurrentDeletes:_cleanupConcurrency];
+
+  [deleter deleteItems:objects withBlock:^(id object, KSBulkDeleteCompletion done) {
+    remove(object, 0, ^(id result, NSError *error) {
+      done(error);
+    });
+  }];
+
+  if (![deleter waitWithTimeout:_timeout * MAX(1, [objects count] / MAX(_cleanupConcurrency, 1))] || deleter.failedCount > 0) {
+    NSLog(@"%@ offline queue left %lu objects behind", _entity, (unsigned long)([objects count] - deleter.deletedCount));
+  }
+}
+
+@end
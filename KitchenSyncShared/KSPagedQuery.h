@@ -0,0 +1,73 @@
+//
+//  KSPagedQuery.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+
+/*!
+ * Called exactly once by a fetch block with the page it read (empty or nil
+ * past the end), or with an error.
+ */
+typedef void (^KSPageCompletion)(NSArray *page, NSError *error);
+
+/*!
+ * Reads at most limit objects starting at offset, using the provider's own
+ * paging (PFQuery limit/skip, MSQuery fetchLimit/fetchOffset, KCSQuery limit
+ * and skip modifiers, ...), and calls done with them.
+ */
+typedef void (^KSPageFetchBlock)(NSUInteger offset, NSUInteger limit, KSPageCompletion done);
+
+/*!
+ * Handles one page. Set *stop to YES to end the enumeration early.
+ */
+typedef void (^KSPageBlock)(NSArray *page, NSUInteger offset, BOOL *stop);
+
+/*!
+ * Walks a collection a page at a time, so at most one page is held in memory
+ * however large the collection is.
+ *
+ * Pages are fetched one after another on the calling thread and handed to the
+ * page block before the next one is requested. The enumeration ends at the
+ * first empty page, not the first short one, because some backends return
+ * fewer objects than asked for without saying so.
+ *
+ *   KSPagedQuery *query = [KSPagedQuery queryWithPageSize:100 fetchBlock:^(NSUInteger offset, NSUInteger limit, KSPageCompletion done) { ... }];
+ *   [query enumeratePagesUsingBlock:^(NSArray *page, NSUInteger offset, BOOL *stop) { ... }];
+ */
+@interface KSPagedQuery : NSObject
+
++ (KSPagedQuery *)queryWithPageSize:(NSUInteger)pageSize fetchBlock:(KSPageFetchBlock)fetchBlock;
+
+- (id)initWithPageSize:(NSUInteger)pageSize fetchBlock:(KSPageFetchBlock)fetchBlock;
+
+@property (nonatomic, readonly) NSUInteger pageSize;
+
+/*!
+ * Seconds to wait for a single page. Defaults to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+/*!
+ * Set when the page block removes what it is given, e.g. when deleting.
+ * Every page is then fetched from offset 0, because skipping past deleted
+ * rows would skip live ones instead.
+ */
+@property (nonatomic, assign) BOOL consumesPages;
+
+/*!
+ * Fetches and hands over pages until the collection is exhausted, the page
+ * block stops, or a fetch fails. Returns NO if a fetch failed or timed out.
+ */
+- (BOOL)enumeratePagesUsingBlock:(KSPageBlock)block;
+
+@property (nonatomic, readonly) NSUInteger pageCount;
+@property (nonatomic, readonly) NSUInteger objectCount;
+
+/*!
+ * Why the last enumeration ended early, if it did because of a fetch.
+ */
+@property (nonatomic, readonly) NSError *error;
+
+@end
@@ -0,0 +1,122 @@
+//
+//  KSPagedQuery.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSPagedQuery.h"
+#import "KSCompletionWaiter.h"
+
+static NSString * const KSPagedQueryErrorDomain = @"KSPagedQueryErrorDomain";
+
+@interface KSPagedQuery()
+
+@property (nonatomic, readwrite) NSUInteger pageCount;
+@property (nonatomic, readwrite) NSUInteger objectCount;
+@property (nonatomic, readwrite) NSError *error;
+
+- (NSArray *)fetchPageAtOffset:(NSUInteger)offset error:(NSError **)error;
+
+@end
+
+@implementation KSPagedQuery {
+
+  KSPageFetchBlock _fetchBlock;
+}
+
++ (KSPagedQuery *)queryWithPageSize:(NSUInteger)pageSize fetchBlock:(KSPageFetchBlock)fetchBlock {
+  return [[KSPagedQuery alloc] initWithPageSize:pageSize fetchBlock:fetchBlock];
+}
+
+- (id)initWithPageSize:(NSUInteger)pageSize fetchBlock:(KSPageFetchBlock)fetchBlock {
+
+  self = [super init];
+
+  if (self) {
+    _pageSize   = MAX(pageSize, 1);
+    _fetchBlock = [fetchBlock copy];
+    _timeout    = 30.0;
+  }
+
+  return self;
+}
+
+- (BOOL)enumeratePagesUsingBlock:(KSPageBlock)block {
+
+  NSUInteger offset = 0;
+  BOOL stop         = NO;
+
+  self.pageCount   = 0;
+  self.objectCount = 0;
+  self.error       = nil;
+
+  while (!stop) {
+
+    // Drain each page's autoreleased objects before the next one is read.
+    @autoreleasepool {
+
+      NSError *error = nil;
+      NSArray *page  = [self fetchPageAtOffset:offset error:&error];
+
+      if (error) {
+        self.error = error;
+        return NO;
+      }
+
+      if ([page count] == 0) {
+        break;
+      }
+
+      self.pageCount++;
+      self.objectCount += [page count];
+
+      block(page, offset, &stop);
+
+      // Keep going after a short page: backends cap page sizes silently.
+      if (!_consumesPages) {
+        offset += [page count];
+      }
+    }
+  }
+
+  return YES;
+}
+
+- (NSArray *)fetchPageAtOffset:(NSUInteger)offset error:(NSError **)error {
+
+  KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
+
+  __block NSArray *page     = nil;
+  __block NSError *failure  = nil;
+  __block BOOL     answered = NO;
+
+  // Only the first answer counts; SDKs that answer from a cache first may
+  // call back twice.
+
+  _fetchBlock(offset, _pageSize, ^(NSArray *fetched, NSError *fetchError) {
+
+    @synchronized(waiter) {
+      if (!answered) {
+        answered = YES;
+        page     = fetched;
+        failure  = fetchError;
+      }
+    }
+
+    [waiter signal];
+  });
+
+  if (![waiter waitWithTimeout:_timeout]) {
+    *error = [NSError errorWithDomain:KSPagedQueryErrorDomain
+                                 code:1
+                             userInfo:@{NSLocalizedDescriptionKey : [NSString stringWithFormat:@"page at offset %lu timed out after %.3fs", (unsigned long)offset, _timeout]}];
+    return nil;
+  }
+
+  @synchronized(waiter) {
+    *error = failure;
+    return failure ? nil : page;
+  }
+}
+
+@end
@@ -0,0 +1,95 @@
+//
+//  KSParallelRunner.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+
+/*!
+ * Runs one independent piece of a test, such as everything a test does
+ * against one backend. dataNamespace is unique to the task within the run;
+ * use it to tag or prefix whatever the task writes so that tasks running at
+ * the same time never see each other's data.
+ */
+typedef void (^KSParallelTaskBlock)(NSString *dataNamespace);
+
+/*!
+ * Runs independent tasks, typically one per backend configuration, at the
+ * same time and waits for all of them.
+ *
+ * Each task runs on its own background thread and may block there (on a
+ * KSCompletionWaiter, a KSBulkDeleter or a synchronous SDK call). When run
+ * from the main thread, the runner keeps the main run loop serviced while it
+ * waits, so SDKs that call back on the main thread keep working. With
+ * concurrent set to NO the same tasks run one after another on the calling
+ * thread, so a suite can switch modes from its configuration.
+ *
+ * Exceptions raised by a task, including failed STAssert* calls, end that
+ * task only; they are collected in exceptions for the test to report on its
+ * own thread:
+ *
+ *   KSParallelRunner *runner = [KSParallelRunner runner];
+ *   [runner addTaskNamed:@"open" block:^(NSString *dataNamespace) { ... }];
+ *   [runner addTaskNamed:@"secure" block:^(NSString *dataNamespace) { ... }];
+ *   [runner runWithTimeout:60.0];
+ *   for (NSException *e in [runner.exceptions allValues]) [self failWithException:e];
+ */
+@interface KSParallelRunner : NSObject
+
++ (KSParallelRunner *)runner;
+
+/*!
+ * Identifies this test run. Taken from $KS_RUN_ID when it is set (the
+ * Scripts/runAllProviders.sh runner sets it for every provider it starts),
+ * otherwise generated once per process. The resolved id and where it came
+ * from are logged the first time it is asked for.
+ */
++ (NSString *)runIdentifier;
+
+/*!
+ * YES (the default) to run tasks at the same time.
+ */
+@property (nonatomic, assign) BOOL concurrent;
+
+/*!
+ * Adds a task. Names must be unique within the runner.
+ */
+- (void)addTaskNamed:(NSString *)name block:(KSParallelTaskBlock)block;
+
+/*!
+ * The namespace handed to the task called name: the run identifier followed
+ * by the task name.
+ */
+- (NSString *)dataNamespaceForTaskNamed:(NSString *)name;
+
+/*!
+ * Runs every task added so far and waits until they have all finished or
+ * timeout seconds have passed. Returns NO on timeout; tasks that were still
+ * running carry on in the background and are listed in unfinishedTasks.
+ * Tasks run one after another are not timed out.
+ */
+- (BOOL)runWithTimeout:(NSTimeInterval)timeout;
+
+/*!
+ * Task name to the exception that ended it.
+ */
+@property (nonatomic, readonly) NSDictionary *exceptions;
+
+/*!
+ * Task name to the seconds it ran for.
+ */
+@property (nonatomic, readonly) NSDictionary *durations;
+
+/*!
+ * Names of tasks that had not finished when -runWithTimeout: returned.
+ */
+@property (nonatomic, readonly) NSArray *unfinishedTasks;
+
+/*!
+ * Seconds spent inside the last call to -runWithTimeout:. With concurrent
+ * tasks this is close to the slowest task rather than the sum.
+ */
+@property (nonatomic, readonly) NSTimeInterval elapsed;
+
+@end
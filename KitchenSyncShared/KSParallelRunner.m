@@ -0,0 +1,164 @@
+//
+//  KSParallelRunner.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSParallelRunner.h"
+#import "KSCompletionWaiter.h"
+#import "KSMonotonicClock.h"
+
+@interface KSParallelRunner()
+
+@property (nonatomic, readwrite) NSTimeInterval elapsed;
+
+- (void)runTaskNamed:(NSString *)name block:(KSParallelTaskBlock)block;
+
+@end
+
+@implementation KSParallelRunner {
+
+  NSMutableArray      *_taskNames;
+  NSMutableDictionary *_taskBlocks;
+  NSMutableDictionary *_exceptions;
+  NSMutableDictionary *_durations;
+  NSMutableSet        *_runningTasks;
+}
+
++ (KSParallelRunner *)runner {
+  return [[KSParallelRunner alloc] init];
+}
+
++ (NSString *)runIdentifier {
+
+  static NSString *runIdentifier = nil;
+  static dispatch_once_t onceToken;
+
+  dispatch_once(&onceToken, ^{
+
+    runIdentifier = [[NSProcessInfo processInfo] environment][@"KS_RUN_ID"];
+
+    if ([runIdentifier length] > 0) {
+      NSLog(@"KitchenSync run id %@ (from KS_RUN_ID)", runIdentifier);
+    } else {
+      runIdentifier = [[[NSProcessInfo processInfo] globallyUniqueString] substringToIndex:8];
+      NSLog(@"KitchenSync run id %@ (generated, KS_RUN_ID was not set)", runIdentifier);
+    }
+  });
+
+  return runIdentifier;
+}
+
+- (id)init {
+
+  self = [super init];
+
+  if (self) {
+    _concurrent   = YES;
+    _taskNames    = [NSMutableArray array];
+    _taskBlocks   = [NSMutableDictionary dictionary];
+    _exceptions   = [NSMutableDictionary dictionary];
+    _durations    = [NSMutableDictionary dictionary];
+    _runningTasks = [NSMutableSet set];
+  }
+
+  return self;
+}
+
+- (void)addTaskNamed:(NSString *)name block:(KSParallelTaskBlock)block {
+
+  NSParameterAssert(_taskBlocks[name] == nil);
+
+  [_taskNames addObject:name];
+
+  _taskBlocks[name] = [block copy];
+}
+
+- (NSString *)dataNamespaceForTaskNamed:(NSString *)name {
+  return [NSString stringWithFormat:@"%@-%@", [KSParallelRunner runIdentifier], name];
+}
+
+- (NSDictionary *)exceptions {
+  @synchronized(self) {
+    return [_exceptions copy];
+  }
+}
+
+- (NSDictionary *)durations {
+  @synchronized(self) {
+    return [_durations copy];
+  }
+}
+
+- (NSArray *)unfinishedTasks {
+  @synchronized(self) {
+    return [_runningTasks allObjects];
+  }
+}
+
+- (BOOL)runWithTimeout:(NSTimeInterval)timeout {
+
+  NSTimeInterval start = KSMonotonicTime();
+  BOOL completed       = YES;
+
+  @synchronized(self) {
+    [_exceptions removeAllObjects];
+    [_durations removeAllObjects];
+    [_runningTasks addObjectsFromArray:_taskNames];
+  }
+
+  if (_concurrent && [_taskNames count] > 1) {
+
+    KSCompletionWaiter *waiter = [KSCompletionWaiter waiterWithExpectedSignals:[_taskNames count]];
+    dispatch_queue_t queue     = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+
+    for (NSString *name in _taskNames) {
+
+      KSParallelTaskBlock block = _taskBlocks[name];
+
+      dispatch_async(queue, ^{
+        [self runTaskNamed:name block:block];
+        [waiter signal];
+      });
+    }
+
+    completed = [waiter waitWithTimeout:timeout];
+
+  } else {
+
+    for (NSString *name in _taskNames) {
+      [self runTaskNamed:name block:_taskBlocks[name]];
+    }
+  }
+
+  self.elapsed = KSMonotonicTime() - start;
+
+  return completed;
+}
+
+- (void)runTaskNamed:(NSString *)name block:(KSParallelTaskBlock)block {
+
+  NSTimeInterval startedAt = KSMonotonicTime();
+  NSException *exception   = nil;
+
+  @autoreleasepool {
+    @try {
+      block([self dataNamespaceForTaskNamed:name]);
+    } @catch (NSException *e) {
+      exception = e;
+    }
+  }
+
+  @synchronized(self) {
+
+    if (exception) {
+      _exceptions[name] = exception;
+    }
+
+    _durations[name] = @(KSMonotonicTime() - startedAt);
+
+    [_runningTasks removeObject:name];
+  }
+}
+
+@end
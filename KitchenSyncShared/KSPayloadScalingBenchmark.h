@@ -0,0 +1,83 @@
+//
+//  KSPayloadScalingBenchmark.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSCRUDBenchmark.h"
+
+/*!
+ * Saves a new object with the given fields (name to string value) and calls
+ * done with it.
+ */
+typedef void (^KSPayloadSaveBlock)(NSDictionary *fields, KSBenchmarkCompletion done);
+
+/*!
+ * Times create and read by id as objects grow, one dimension at a time:
+ *
+ * - size: one field, the benchmark field, holding payloadSizes bytes;
+ * - fields: fieldCounts fields (the benchmark field plus field001,
+ *   field002, ...) of fieldSize bytes each.
+ *
+ * Every object gets freshly generated values, so neither the backend nor the
+ * network can compress or cache its way past the payload. Each step also
+ * times encoding and decoding the payload with NSJSONSerialization, the
+ * client-side serialisation cost all the SDKs pay in some form, and runs a
+ * wire trace so SDK and wire time can be told apart per size.
+ *
+ * Backends cap object and request sizes. A step where every create fails is
+ * reported with limit_reached set, and larger steps of that dimension are
+ * skipped.
+ */
+@interface KSPayloadScalingBenchmark : NSObject
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field iterations:(NSUInteger)iterations;
+
+@property (nonatomic, readonly, copy) NSString *entity;
+@property (nonatomic, readonly, copy) NSString *field;
+@property (nonatomic, readonly) NSUInteger iterations;
+
+/*!
+ * Seconds to wait for a single operation. Defaults to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+/*!
+ * Deletes run in parallel when cleaning up. Defaults to 8.
+ */
+@property (nonatomic, assign) NSUInteger cleanupConcurrency;
+
+/*!
+ * Bytes in the benchmark field at each size step. Defaults to 100 B, 1 KB,
+ * 10 KB, 100 KB and 1 MB.
+ */
+@property (nonatomic, copy) NSArray *payloadSizes;
+
+/*!
+ * Fields per object at each field-count step. Defaults to 1, 10, 100 and
+ * 500.
+ */
+@property (nonatomic, copy) NSArray *fieldCounts;
+
+/*!
+ * Bytes per field in the field-count steps. Defaults to 32.
+ */
+@property (nonatomic, assign) NSUInteger fieldSize;
+
+@property (nonatomic, copy) KSPayloadSaveBlock     createBlock;
+@property (nonatomic, copy) KSBenchmarkObjectBlock readBlock;
+@property (nonatomic, copy) KSBenchmarkObjectBlock deleteBlock;
+
+/*!
+ * Runs both dimensions and adds create, read, encode and decode histograms,
+ * the wire trace and a result row per step to report.
+ */
+- (void)runWithReport:(KSBenchmarkReport *)report;
+
+/*!
+ * Failed creates and reads in steps below the backend's limit.
+ */
+@property (nonatomic, readonly) NSUInteger errorCount;
+
+@end
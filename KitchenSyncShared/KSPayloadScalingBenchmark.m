@@ -0,0 +1,201 @@
+//
+//  KSPayloadScalingBenchmark.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSPayloadScalingBenchmark.h"
+#import "KSBenchmarkReport.h"
+#import "KSBulkDeleter.h"
+#import "KSMonotonicClock.h"
+#import "KSRandomString.h"
+#import "KSWireTrace.h"
+
+@interface KSPayloadScalingBenchmark()
+
+@property (nonatomic, readwrite) NSUInteger errorCount;
+
+- (BOOL)runDimension:(NSString *)dimension
+           valueSize:(NSUInteger)valueSize
+          fieldCount:(NSUInteger)fieldCount
+              report:(KSBenchmarkReport *)report;
+- (NSDictionary *)payloadWithFieldCount:(NSUInteger)fieldCount valueSize:(NSUInteger)valueSize;
+- (void)deleteObjects:(NSArray *)objects;
+
+@end
+
+@implementation KSPayloadScalingBenchmark
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field iterations:(NSUInteger)iterations {
+
+  self = [super init];
+
+  if (self) {
+    _entity             = [entity copy];
+    _field              = [field copy];
+    _iterations         = iterations;
+    _timeout            = 30.0;
+    _cleanupConcurrency = 8;
+    _payloadSizes       = @[@100, @1000, @10000, @100000, @1000000];
+    _fieldCounts        = @[@1, @10, @100, @500];
+    _fieldSize          = 32;
+  }
+
+  return self;
+}
+
+- (void)runWithReport:(KSBenchmarkReport *)report {
+
+  self.errorCount = 0;
+
+  for (NSNumber *size in _payloadSizes) {
+    if (![self runDimension:@"size" valueSize:[size unsignedIntegerValue] fieldCount:1 report:report]) {
+      break;
+    }
+  }
+
+  for (NSNumber *count in _fieldCounts) {
+    if (![self runDimension:@"fields" valueSize:_fieldSize fieldCount:MAX([count unsignedIntegerValue], 1) report:report]) {
+      break;
+    }
+  }
+}
+
+/*!
+ * Runs one step and returns NO when the backend refused every object.
+ */
+- (BOOL)runDimension:(NSString *)dimension
+           valueSize:(NSUInteger)valueSize
+          fieldCount:(NSUInteger)fieldCount
+              report:(KSBenchmarkReport *)report {
+
+  NSString *prefix              = [NSString stringWithFormat:@"%@.%@", _entity, dimension];
+  KSLatencyHistogram *create    = [KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:@".create"]];
+  KSLatencyHistogram *read      = [KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:@".read"]];
+  KSLatencyHistogram *encode    = [KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:@".encode"]];
+  KSLatencyHistogram *decode    = [KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:@".decode"]];
+  KSPayloadSaveBlock save       = _createBlock;
+  KSBenchmarkObjectBlock reader = _readBlock;
+  NSMutableArray *created       = [NSMutableArray arrayWithCapacity:_iterations];
+  NSUInteger encodedBytes       = 0;
+
+  [KSWireTrace start];
+
+  for (NSUInteger i = 0; i < _iterations; i++) {
+
+    // Megabyte payloads add up quickly; drop each one before the next.
+    @autoreleasepool {
+
+      NSDictionary *fields = [self payloadWithFieldCount:fieldCount valueSize:valueSize];
+
+      NSTimeInterval encodingAt = KSMonotonicTime();
+      NSData *encoded           = [NSJSONSerialization dataWithJSONObject:fields options:0 error:NULL];
+
+      [encode recordLatency:KSMonotonicTime() - encodingAt];
+
+      NSTimeInterval decodingAt = KSMonotonicTime();
+
+      [NSJSONSerialization JSONObjectWithData:encoded options:0 error:NULL];
+
+      [decode recordLatency:KSMonotonicTime() - decodingAt];
+
+      encodedBytes = [encoded length];
+
+      id object = [create measure:^(KSBenchmarkCompletion done) {
+        save(fields, done);
+      } timeout:_timeout];
+
+      if (!object) {
+        continue;
+      }
+
+      [created addObject:object];
+
+      if (reader) {
+        [read measure:^(KSBenchmarkCompletion done) {
+          reader(object, i, done);
+        } timeout:_timeout];
+      }
+    }
+  }
+
+  [KSWireTrace stop];
+
+  BOOL limitReached = create.count == 0 && create.errorCount > 0;
+
+  NSDictionary *attributes = @{@"entity"      : _entity,
+                               @"dimension"   : dimension,
+                               @"value_bytes" : @(valueSize),
+                               @"fields"      : @(fieldCount)};
+
+  [report addHistogram:create withAttributes:attributes];
+
+  if (reader) {
+    [report addHistogram:read withAttributes:attributes];
+  }
+
+  [report addHistogram:encode withAttributes:attributes];
+  [report addHistogram:decode withAttributes:attributes];
+
+  [KSWireTrace addToReport:report operations:@[create, read] attributes:attributes];
+
+  [report addResult:@{@"entity"        : _entity,
+                      @"dimension"     : dimension,
+                      @"value_bytes"   : @(valueSize),
+                      @"fields"        : @(fieldCount),
+                      @"encoded_bytes" : @(encodedBytes),
+                      @"create_p50_s"  : @([create percentile:50]),
+                      @"create_p95_s"  : @([create percentile:95]),
+                      @"read_p50_s"    : @([read percentile:50]),
+                      @"encode_p50_s"  : @([encode percentile:50]),
+                      @"decode_p50_s"  : @([decode percentile:50]),
+                      @"create_errors" : @(create.errorCount),
+                      @"read_errors"   : @(read.errorCount),
+                      @"limit_reached" : @(limitReached)}];
+
+  if (limitReached) {
+    NSLog(@"%@: no %@ saved at %lu fields of %lu bytes, skipping larger steps: %@",
+          prefix, _entity, (unsigned long)fieldCount, (unsigned long)valueSize, [create.errors lastObject]);
+  } else {
+    self.errorCount += create.errorCount + read.errorCount;
+  }
+
+  [self deleteObjects:created];
+
+  return !limitReached;
+}
+
+- (NSDictionary *)payloadWithFieldCount:(NSUInteger)fieldCount valueSize:(NSUInteger)valueSize {
+
+  NSMutableDictionary *fields = [NSMutableDictionary dictionaryWithCapacity:fieldCount];
+
+  fields[_field] = KSRandomString(valueSize);
+
+  for (NSUInteger i = 1; i < fieldCount; i++) {
+    fields[[NSString stringWithFormat:@"field%03lu", (unsigned long)i]] = KSRandomString(valueSize);
+  }
+
+  return fields;
+}
+
+- (void)deleteObjects:(NSArray *)objects {
+
+  if ([objects count] == 0 || !_deleteBlock) {
+    return;
+  }
+
+  KSBenchmarkObjectBlock remove = _deleteBlock;
+  KSBulkDeleter *deleter        = [KSBulkDeleter deleterWithMaxConcurrentDeletes:_cleanupConcurrency];
+
+  [deleter deleteItems:objects withBlock:^(id object, KSBulkDeleteCompletion done) {
+    remove(object, 0, ^(id result, NSError *error) {
+      done(error);
+    });
+  }];
+
+  if (![deleter waitWithTimeout:_timeout * MAX(1, [objects count] / MAX(_cleanupConcurrency, 1))] || deleter.failedCount > 0) {
+    NSLog(@"%@ payload scaling left %lu objects behind", _entity, (unsigned long)([objects count] - deleter.deletedCount));
+  }
+}
+
+@end
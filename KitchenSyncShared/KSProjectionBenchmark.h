@@ -0,0 +1,109 @@
+//
+//  KSProjectionBenchmark.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSPayloadScalingBenchmark.h"
+
+/*!
+ * Saves the object a new record will point at and calls done with the value
+ * to store in the record's link field (a PFObject, an object id, ...).
+ */
+typedef void (^KSProjectionLinkBlock)(NSUInteger iteration, KSBenchmarkCompletion done);
+
+/*!
+ * Reads object back by id, asking for fields only (every field when nil) and
+ * for linked objects to be expanded depth levels deep (0 leaves references
+ * as they are). Calls done with the object as the SDK returned it.
+ */
+typedef void (^KSProjectionReadBlock)(id object, NSArray *fields, NSUInteger depth, KSBenchmarkCompletion done);
+
+/*!
+ * The number of fields the SDK returned on object, including its id and
+ * timestamps.
+ */
+typedef NSUInteger (^KSProjectionFieldCountBlock)(id object);
+
+/*!
+ * Reads wide objects three ways, the way a list view could:
+ *
+ * - full: every field;
+ * - projected: only projectedFields;
+ * - expanded: every field, with the object linkField points at expanded
+ *   expandDepth levels deep. Only run when a linkBlock is set.
+ *
+ * iterations objects of fieldCount fields (the benchmark field plus
+ * field001, field002, ...) are saved first, each pointing at a new linked
+ * object when linkBlock is set. Every mode then reads each of them once under
+ * its own wire trace, so the report has latency, bytes received per request
+ * and sdk_overhead_s (time not spent on the wire, which for a read is mostly
+ * decoding the response) per mode. fields_returned shows whether the backend
+ * actually left fields out.
+ */
+@interface KSProjectionBenchmark : NSObject
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field iterations:(NSUInteger)iterations;
+
+@property (nonatomic, readonly, copy) NSString *entity;
+@property (nonatomic, readonly, copy) NSString *field;
+@property (nonatomic, readonly) NSUInteger iterations;
+
+/*!
+ * Seconds to wait for a single operation. Defaults to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+/*!
+ * Deletes run in parallel when cleaning up. Defaults to 8.
+ */
+@property (nonatomic, assign) NSUInteger cleanupConcurrency;
+
+/*!
+ * Fields per object, the benchmark field included. Defaults to 200.
+ */
+@property (nonatomic, assign) NSUInteger fieldCount;
+
+/*!
+ * Bytes per field. Defaults to 32.
+ */
+@property (nonatomic, assign) NSUInteger fieldSize;
+
+/*!
+ * Fields the projected read asks for. Defaults to the benchmark field.
+ */
+@property (nonatomic, copy) NSArray *projectedFields;
+
+/*!
+ * Field holding the value linkBlock returned. Defaults to nil.
+ */
+@property (nonatomic, copy) NSString *linkField;
+
+/*!
+ * Levels the expanded read asks for. Defaults to 1.
+ */
+@property (nonatomic, assign) NSUInteger expandDepth;
+
+@property (nonatomic, copy) KSPayloadSaveBlock          createBlock;
+@property (nonatomic, copy) KSProjectionLinkBlock       linkBlock;
+@property (nonatomic, copy) KSProjectionReadBlock       readBlock;
+@property (nonatomic, copy) KSProjectionFieldCountBlock fieldCountBlock;
+@property (nonatomic, copy) KSBenchmarkObjectBlock      deleteBlock;
+
+/*!
+ * Deletes a value linkBlock returned.
+ */
+@property (nonatomic, copy) KSBenchmarkObjectBlock linkDeleteBlock;
+
+/*!
+ * Adds a read histogram, a wire trace and a result row per mode to report.
+ */
+- (void)runWithReport:(KSBenchmarkReport *)report;
+
+/*!
+ * Failed saves and reads in the last run.
+ */
+@property (nonatomic, readonly) NSUInteger errorCount;
+
+@end
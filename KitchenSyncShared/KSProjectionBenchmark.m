@@ -0,0 +1,188 @@
+//
+//  KSProjectionBenchmark.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSProjectionBenchmark.h"
+#import "KSBenchmarkReport.h"
+#import "KSBulkDeleter.h"
+#import "KSRandomString.h"
+#import "KSWireTrace.h"
+
+@interface KSProjectionBenchmark()
+
+@property (nonatomic, readwrite) NSUInteger errorCount;
+
+- (NSArray *)createObjectsWithLinks:(NSMutableArray *)links;
+- (void)readObjects:(NSArray *)objects mode:(NSString *)mode fields:(NSArray *)fields depth:(NSUInteger)depth report:(KSBenchmarkReport *)report;
+- (void)deleteItems:(NSArray *)items withBlock:(KSBenchmarkObjectBlock)block;
+
+@end
+
+@implementation KSProjectionBenchmark
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field iterations:(NSUInteger)iterations {
+
+  self = [super init];
+
+  if (self) {
+    _entity             = [entity copy];
+    _field              = [field copy];
+    _iterations         = iterations;
+    _timeout            = 30.0;
+    _cleanupConcurrency = 8;
+    _fieldCount         = 200;
+    _fieldSize          = 32;
+    _projectedFields    = @[_field];
+    _expandDepth        = 1;
+  }
+
+  return self;
+}
+
+- (void)runWithReport:(KSBenchmarkReport *)report {
+
+  NSMutableArray *links = [NSMutableArray array];
+
+  self.errorCount = 0;
+
+  NSArray *objects = [self createObjectsWithLinks:links];
+
+  if ([objects count] > 0) {
+
+    [self readObjects:objects mode:@"full" fields:nil depth:0 report:report];
+    [self readObjects:objects mode:@"projected" fields:_projectedFields depth:0 report:report];
+
+    if (_linkBlock && _linkField && _expandDepth > 0) {
+      [self readObjects:objects mode:@"expanded" fields:nil depth:_expandDepth report:report];
+    }
+  }
+
+  [self deleteItems:objects withBlock:_deleteBlock];
+  [self deleteItems:links withBlock:_linkDeleteBlock];
+}
+
+/*!
+ * Saves iterations wide objects, each with a new linked object when there
+ * is a linkBlock, and returns the ones that were saved. Saved links go into
+ * links, whether or not their object made it.
+ */
+- (NSArray *)createObjectsWithLinks:(NSMutableArray *)links {
+
+  KSLatencyHistogram *setup  = [KSLatencyHistogram histogramWithName:[NSString stringWithFormat:@"%@.projection.setup", _entity]];
+  KSPayloadSaveBlock save    = _createBlock;
+  KSProjectionLinkBlock link = _linkField ? _linkBlock : nil;
+  NSMutableArray *created    = [NSMutableArray arrayWithCapacity:_iterations];
+
+  for (NSUInteger i = 0; i < _iterations; i++) {
+
+    @autoreleasepool {
+
+      NSMutableDictionary *fields = [NSMutableDictionary dictionaryWithCapacity:_fieldCount + 1];
+
+      fields[_field] = KSRandomString(_fieldSize);
+
+      for (NSUInteger j = 1; j < _fieldCount; j++) {
+        fields[[NSString stringWithFormat:@"field%03lu", (unsigned long)j]] = KSRandomString(_fieldSize);
+      }
+
+      if (link) {
+
+        id linked = [setup measure:^(KSBenchmarkCompletion done) {
+          link(i, done);
+        } timeout:_timeout];
+
+        if (!linked) {
+          continue;
+        }
+
+        [links addObject:linked];
+
+        fields[_linkField] = linked;
+      }
+
+      id object = [setup measure:^(KSBenchmarkCompletion done) {
+        save(fields, done);
+      } timeout:_timeout];
+
+      if (object) {
+        [created addObject:object];
+      }
+    }
+  }
+
+  if (setup.errorCount > 0) {
+    self.errorCount += setup.errorCount;
+    NSLog(@"%@ projection: %lu saves failed: %@", _entity, (unsigned long)setup.errorCount, [setup.errors lastObject]);
+  }
+
+  return created;
+}
+
+- (void)readObjects:(NSArray *)objects mode:(NSString *)mode fields:(NSArray *)fields depth:(NSUInteger)depth report:(KSBenchmarkReport *)report {
+
+  KSLatencyHistogram *read                = [KSLatencyHistogram histogramWithName:[NSString stringWithFormat:@"%@.%@.read", _entity, mode]];
+  KSProjectionReadBlock reader            = _readBlock;
+  KSProjectionFieldCountBlock countFields = _fieldCountBlock;
+  NSUInteger fieldsReturned               = 0;
+
+  NSDictionary *attributes = @{@"entity" : _entity,
+                               @"mode"   : mode,
+                               @"fields" : @(_fieldCount)};
+
+  [KSWireTrace start];
+
+  for (id object in objects) {
+
+    @autoreleasepool {
+
+      id fetched = [read measure:^(KSBenchmarkCompletion done) {
+        reader(object, fields, depth, done);
+      } timeout:_timeout];
+
+      if (fetched && countFields) {
+        fieldsReturned = countFields(fetched);
+      }
+    }
+  }
+
+  [KSWireTrace stop];
+
+  [report addHistogram:read withAttributes:attributes];
+
+  [KSWireTrace addToReport:report operations:@[read] attributes:attributes];
+
+  [report addResult:@{@"entity"           : _entity,
+                      @"mode"             : mode,
+                      @"fields"           : @(_fieldCount),
+                      @"fields_requested" : @(fields ? [fields count] : _fieldCount),
+                      @"fields_returned"  : @(fieldsReturned),
+                      @"expand_depth"     : @(depth),
+                      @"read_p50_s"       : @([read percentile:50]),
+                      @"read_p95_s"       : @([read percentile:95]),
+                      @"read_errors"      : @(read.errorCount)}];
+
+  self.errorCount += read.errorCount;
+}
+
+- (void)deleteItems:(NSArray *)items withBlock:(KSBenchmarkObjectBlock)block {
+
+  if ([items count] == 0 || !block) {
+    return;
+  }
+
+  KSBulkDeleter *deleter = [KSBulkDeleter deleterWithMaxConcurrentDeletes:_cleanupConcurrency];
+
+  [deleter deleteItems:items withBlock:^(id item, KSBulkDeleteCompletion done) {
+    block(item, 0, ^(id result, NSError *error) {
+      done(error);
+    });
+  }];
+
+  if (![deleter waitWithTimeout:_timeout * MAX(1, [items count] / MAX(_cleanupConcurrency, 1))] || deleter.failedCount > 0) {
+    NSLog(@"%@ projection left %lu objects behind", _entity, (unsigned long)([items count] - deleter.deletedCount));
+  }
+}
+
+@end
@@ -0,0 +1,61 @@
+//
+//  KSProviderAdapter.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSLatencyHistogram.h"
+
+/*!
+ * One backend's SDK behind a common asynchronous interface, so a workload is
+ * written once and runs the same operation sequence against every provider.
+ *
+ * Entities and fields are named as in the data model (Foo, fooParameter);
+ * adapters map them to whatever the backend needs. Objects are whatever the
+ * SDK hands back (a PFObject, an item dictionary, ...) and are only passed
+ * back into the same adapter. Every method returns straight away and calls
+ * done exactly once, from any thread.
+ */
+@protocol KSProviderAdapter <NSObject>
+
+/*!
+ * The name reports use for this provider, e.g. "Parse".
+ */
+@property (nonatomic, readonly, copy) NSString *providerName;
+
+/*!
+ * Saves a new object with fields (name to value) and calls done with it.
+ */
+- (void)createObjectInEntity:(NSString *)entity fields:(NSDictionary *)fields completion:(KSBenchmarkCompletion)done;
+
+/*!
+ * Saves one object per entry of fieldsList using the SDK's bulk path, and
+ * calls done with the objects that were saved. Objects that failed are left
+ * out rather than failing the whole batch.
+ */
+- (void)createObjectsInEntity:(NSString *)entity fieldsList:(NSArray *)fieldsList completion:(KSBenchmarkCompletion)done;
+
+/*!
+ * Reads object back from the backend by its id.
+ */
+- (void)getObject:(id)object inEntity:(NSString *)entity completion:(KSBenchmarkCompletion)done;
+
+/*!
+ * Finds the objects whose field equals value and calls done with an array.
+ */
+- (void)queryEntity:(NSString *)entity whereField:(NSString *)field equals:(id)value completion:(KSBenchmarkCompletion)done;
+
+/*!
+ * Sets fields on object, saves it and calls done with the saved object.
+ */
+- (void)updateObject:(id)object inEntity:(NSString *)entity fields:(NSDictionary *)fields completion:(KSBenchmarkCompletion)done;
+
+- (void)deleteObject:(id)object inEntity:(NSString *)entity completion:(KSBenchmarkCompletion)done;
+
+/*!
+ * The value of field on an object this adapter returned.
+ */
+- (id)valueForField:(NSString *)field ofObject:(id)object;
+
+@end
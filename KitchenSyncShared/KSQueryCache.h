@@ -0,0 +1,71 @@
+//
+//  KSQueryCache.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSProviderAdapter.h"
+
+/*!
+ * Runs the query a cache entry stands for and calls done with its results.
+ */
+typedef void (^KSQueryCacheFetchBlock)(KSBenchmarkCompletion done);
+
+/*!
+ * Query results kept on the client, keyed by the SDK's normalized form of the
+ * query (-[MSQuery queryStringOrError:], -[KCSQuery JSONStringRepresentation],
+ * a PFQuery's class, constraints and limit, ...) and dropped for a whole
+ * entity whenever anything writes to it.
+ *
+ * The cache is itself a KSProviderAdapter around the suite's adapter, so
+ * writes that go through it invalidate the entity they touch, both when they
+ * start and when the backend has answered. A query that was already in
+ * flight when a write started doesn't store its results, so a read can never
+ * put back what the write replaced. Writes made around the cache (another
+ * device, the SDK directly) are not seen; the cache is only as fresh as the
+ * writes it is told about.
+ *
+ *   KSQueryCache *cache = [[KSQueryCache alloc] initWithAdapter:adapter];
+ *
+ *   [cache readEntity:@"Foo" key:[query queryStringOrError:nil] fetch:^(KSBenchmarkCompletion fetched) {
+ *     [query readWithCompletion:...];
+ *   } completion:done];
+ */
+@interface KSQueryCache : NSObject <KSProviderAdapter>
+
+- (id)initWithAdapter:(id<KSProviderAdapter>)adapter;
+
+@property (nonatomic, readonly, strong) id<KSProviderAdapter> adapter;
+
+/*!
+ * Most result sets kept across all entities; the oldest goes first. Defaults
+ * to 1,000.
+ */
+@property (nonatomic, assign) NSUInteger countLimit;
+
+/*!
+ * Calls done with the results cached for key in entity, straight away and on
+ * the calling thread, or runs fetch, caches what it returns unless entity was
+ * written to in the meantime, and calls done with it. Failed fetches are not
+ * cached.
+ */
+- (void)readEntity:(NSString *)entity key:(NSString *)key fetch:(KSQueryCacheFetchBlock)fetch completion:(KSBenchmarkCompletion)done;
+
+/*!
+ * Drops every result set cached for entity, and keeps queries already in
+ * flight for it from storing theirs.
+ */
+- (void)invalidateEntity:(NSString *)entity;
+
+- (void)removeAllResults;
+
+/*!
+ * Reads answered from the cache and reads that had to fetch, and how many
+ * times an entity was invalidated.
+ */
+@property (nonatomic, readonly) NSUInteger hitCount;
+@property (nonatomic, readonly) NSUInteger missCount;
+@property (nonatomic, readonly) NSUInteger invalidationCount;
+
+@end
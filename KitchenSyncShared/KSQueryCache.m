@@ -0,0 +1,188 @@
+//
+//  KSQueryCache.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSQueryCache.h"
+
+@interface KSQueryCache()
+
+- (void)storeResults:(id)results entity:(NSString *)entity key:(NSString *)key generation:(NSUInteger)generation;
+- (KSBenchmarkCompletion)invalidatingCompletion:(KSBenchmarkCompletion)done entity:(NSString *)entity;
+
+@end
+
+@implementation KSQueryCache {
+
+  // Entity to key to results, the order entries were stored in as
+  // [entity, key] pairs, and a counter per entity that every invalidation
+  // bumps.
+  NSMutableDictionary *_results;
+  NSMutableArray      *_storeOrder;
+  NSMutableDictionary *_generations;
+}
+
+- (id)initWithAdapter:(id<KSProviderAdapter>)adapter {
+
+  self = [super init];
+
+  if (self) {
+    _adapter     = adapter;
+    _countLimit  = 1000;
+    _results     = [NSMutableDictionary dictionary];
+    _storeOrder  = [NSMutableArray array];
+    _generations = [NSMutableDictionary dictionary];
+  }
+
+  return self;
+}
+
+#pragma mark - Cache
+
+- (void)readEntity:(NSString *)entity key:(NSString *)key fetch:(KSQueryCacheFetchBlock)fetch completion:(KSBenchmarkCompletion)done {
+
+  id cached             = nil;
+  NSUInteger generation = 0;
+
+  @synchronized(self) {
+
+    cached     = _results[entity][key];
+    generation = [_generations[entity] unsignedIntegerValue];
+
+    if (cached) {
+      _hitCount++;
+    } else {
+      _missCount++;
+    }
+  }
+
+  if (cached) {
+    done(cached, nil);
+    return;
+  }
+
+  fetch(^(id result, NSError *error) {
+
+    if (result && !error) {
+      [self storeResults:result entity:entity key:key generation:generation];
+    }
+
+    done(result, error);
+  });
+}
+
+- (void)storeResults:(id)results entity:(NSString *)entity key:(NSString *)key generation:(NSUInteger)generation {
+
+  @synchronized(self) {
+
+    if ([_generations[entity] unsignedIntegerValue] != generation || _countLimit == 0) {
+      return;
+    }
+
+    NSMutableDictionary *entityResults = _results[entity];
+
+    if (!entityResults) {
+      entityResults    = [NSMutableDictionary dictionary];
+      _results[entity] = entityResults;
+    }
+
+    if (!entityResults[key]) {
+      [_storeOrder addObject:@[entity, key]];
+    }
+
+    entityResults[key] = results;
+
+    while ([_storeOrder count] > _countLimit) {
+
+      NSArray *oldest = _storeOrder[0];
+
+      [_results[oldest[0]] removeObjectForKey:oldest[1]];
+      [_storeOrder removeObjectAtIndex:0];
+    }
+  }
+}
+
+- (void)invalidateEntity:(NSString *)entity {
+
+  @synchronized(self) {
+
+    _generations[entity] = @([_generations[entity] unsignedIntegerValue] + 1);
+    _invalidationCount++;
+
+    if (_results[entity]) {
+      [_results removeObjectForKey:entity];
+      [_storeOrder removeObjectsAtIndexes:[_storeOrder indexesOfObjectsPassingTest:^BOOL(NSArray *entry, NSUInteger index, BOOL *stop) {
+        return [entry[0] isEqualToString:entity];
+      }]];
+    }
+  }
+}
+
+- (void)removeAllResults {
+
+  @synchronized(self) {
+
+    for (NSString *entity in [_generations allKeys]) {
+      _generations[entity] = @([_generations[entity] unsignedIntegerValue] + 1);
+    }
+
+    [_results removeAllObjects];
+    [_storeOrder removeAllObjects];
+  }
+}
+
+/*!
+ * Invalidates entity again once the write has an answer, so a read that
+ * started while it was in flight isn't kept.
+ */
+- (KSBenchmarkCompletion)invalidatingCompletion:(KSBenchmarkCompletion)done entity:(NSString *)entity {
+
+  [self invalidateEntity:entity];
+
+  return ^(id result, NSError *error) {
+    [self invalidateEntity:entity];
+    done(result, error);
+  };
+}
+
+#pragma mark - KSProviderAdapter
+
+- (NSString *)providerName {
+  return [_adapter providerName];
+}
+
+- (void)createObjectInEntity:(NSString *)entity fields:(NSDictionary *)fields completion:(KSBenchmarkCompletion)done {
+  [_adapter createObjectInEntity:entity fields:fields completion:[self invalidatingCompletion:done entity:entity]];
+}
+
+- (void)createObjectsInEntity:(NSString *)entity fieldsList:(NSArray *)fieldsList completion:(KSBenchmarkCompletion)done {
+  [_adapter createObjectsInEntity:entity fieldsList:fieldsList completion:[self invalidatingCompletion:done entity:entity]];
+}
+
+- (void)getObject:(id)object inEntity:(NSString *)entity completion:(KSBenchmarkCompletion)done {
+  [_adapter getObject:object inEntity:entity completion:done];
+}
+
+- (void)queryEntity:(NSString *)entity whereField:(NSString *)field equals:(id)value completion:(KSBenchmarkCompletion)done {
+
+  id<KSProviderAdapter> adapter = _adapter;
+
+  [self readEntity:entity key:[NSString stringWithFormat:@"%@ == %@", field, value] fetch:^(KSBenchmarkCompletion fetched) {
+    [adapter queryEntity:entity whereField:field equals:value completion:fetched];
+  } completion:done];
+}
+
+- (void)updateObject:(id)object inEntity:(NSString *)entity fields:(NSDictionary *)fields completion:(KSBenchmarkCompletion)done {
+  [_adapter updateObject:object inEntity:entity fields:fields completion:[self invalidatingCompletion:done entity:entity]];
+}
+
+- (void)deleteObject:(id)object inEntity:(NSString *)entity completion:(KSBenchmarkCompletion)done {
+  [_adapter deleteObject:object inEntity:entity completion:[self invalidatingCompletion:done entity:entity]];
+}
+
+- (id)valueForField:(NSString *)field ofObject:(id)object {
+  return [_adapter valueForField:field ofObject:object];
+}
+
+@end
@@ -0,0 +1,92 @@
+//
+//  KSQueryCacheBenchmark.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSQueryCache.h"
+
+@class KSBenchmarkReport;
+
+/*!
+ * Runs the SDK's own query for the objects whose benchmark field equals
+ * value and calls done with them. When cache isn't nil the query goes
+ * through -[KSQueryCache readEntity:key:fetch:completion:], keyed by the
+ * SDK's normalized form of it.
+ */
+typedef void (^KSQueryCacheReadBlock)(NSString *value, KSQueryCache *cache, KSBenchmarkCompletion done);
+
+/*!
+ * Replays the same read-heavy mix of list queries and saves twice, once
+ * straight against the backend and once through a KSQueryCache, so
+ * providers without a write-aware client cache can be compared with one.
+ *
+ * keyCount lists of objectsPerKey objects each are seeded through adapter.
+ * Every operation then either reads one list or saves a new object into one,
+ * readRatio of them reads. A few lists get most of the reads and saves, the
+ * way a home screen's do. The sequence comes from a fixed seed, so both
+ * passes and every provider run the same operations. Saves go through the
+ * cache in the cached pass, which is what invalidates it.
+ *
+ * The result row per pass has the read p50 and p95, the HTTP requests and
+ * bytes KSWireMeter counted, and, for the cached pass, the hit rate and the
+ * requests and read seconds saved against the direct pass. A read is stale
+ * when it returns a different number of objects than its list has; stale
+ * reads the cache adds over the direct pass are errors.
+ */
+@interface KSQueryCacheBenchmark : NSObject
+
+- (id)initWithAdapter:(id<KSProviderAdapter>)adapter entity:(NSString *)entity field:(NSString *)field operations:(NSUInteger)operations;
+
+@property (nonatomic, readonly, strong) id<KSProviderAdapter> adapter;
+@property (nonatomic, readonly, copy) NSString *entity;
+@property (nonatomic, readonly, copy) NSString *field;
+@property (nonatomic, readonly) NSUInteger operations;
+
+/*!
+ * Seconds to wait for a single operation. Defaults to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+/*!
+ * Distinct lists read. Defaults to 20.
+ */
+@property (nonatomic, assign) NSUInteger keyCount;
+
+/*!
+ * Objects seeded into each list. Defaults to 5.
+ */
+@property (nonatomic, assign) NSUInteger objectsPerKey;
+
+/*!
+ * Share of operations that are reads. Defaults to 0.9.
+ */
+@property (nonatomic, assign) double readRatio;
+
+/*!
+ * Deletes run in parallel when tearing the lists down. Defaults to 8.
+ */
+@property (nonatomic, assign) NSUInteger cleanupConcurrency;
+
+@property (nonatomic, copy) KSQueryCacheReadBlock readBlock;
+
+/*!
+ * Runs both passes, each on lists of its own, adds read and save
+ * histograms and a result row per pass to report, and deletes everything it
+ * saved.
+ */
+- (void)runWithReport:(KSBenchmarkReport *)report;
+
+/*!
+ * Share of cached-pass reads the cache answered, in the last run.
+ */
+@property (nonatomic, readonly) double hitRate;
+
+/*!
+ * Failed seeds, saves and reads, and stale reads the cache added, in the
+ * last run.
+ */
+@property (nonatomic, readonly) NSUInteger errorCount;
+
+@end
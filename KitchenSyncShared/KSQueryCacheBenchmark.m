@@ -0,0 +1,254 @@
+//
+//  KSQueryCacheBenchmark.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSQueryCacheBenchmark.h"
+#import "KSBenchmarkReport.h"
+#import "KSBulkDeleter.h"
+#import "KSLatencyHistogram.h"
+#import "KSMonotonicClock.h"
+#import "KSRunNamespace.h"
+#import "KSWireMeter.h"
+
+@interface KSQueryCacheBenchmark()
+
+@property (nonatomic, readwrite) double hitRate;
+@property (nonatomic, readwrite) NSUInteger errorCount;
+
+- (NSMutableDictionary *)runPass:(NSString *)pass
+                           cache:(KSQueryCache *)cache
+                             tag:(NSString *)tag
+                           saved:(NSMutableArray *)saved
+                          report:(KSBenchmarkReport *)report;
+- (void)deleteObjects:(NSArray *)objects;
+
+@end
+
+@implementation KSQueryCacheBenchmark
+
+- (id)initWithAdapter:(id<KSProviderAdapter>)adapter entity:(NSString *)entity field:(NSString *)field operations:(NSUInteger)operations {
+
+  self = [super init];
+
+  if (self) {
+    _adapter            = adapter;
+    _entity             = [entity copy];
+    _field              = [field copy];
+    _operations         = operations;
+    _timeout            = 30.0;
+    _keyCount           = 20;
+    _objectsPerKey      = 5;
+    _readRatio          = 0.9;
+    _cleanupConcurrency = 8;
+  }
+
+  return self;
+}
+
+- (void)runWithReport:(KSBenchmarkReport *)report {
+
+  NSString *tag         = [[KSRunNamespace currentNamespace] tagValue:[NSString stringWithFormat:@"query-cache-%@", [[NSProcessInfo processInfo] globallyUniqueString]]];
+  NSMutableArray *saved = [NSMutableArray array];
+  KSQueryCache *cache   = [[KSQueryCache alloc] initWithAdapter:_adapter];
+
+  [KSWireMeter install];
+
+  self.errorCount = 0;
+  self.hitRate    = 0;
+
+  NSMutableDictionary *direct = [self runPass:@"direct" cache:nil tag:tag saved:saved report:report];
+  NSMutableDictionary *cached = [self runPass:@"cached" cache:cache tag:tag saved:saved report:report];
+
+  if (direct && cached) {
+
+    NSUInteger directStale = [direct[@"stale_reads"] unsignedIntegerValue];
+    NSUInteger cachedStale = [cached[@"stale_reads"] unsignedIntegerValue];
+
+    cached[@"requests_saved"]     = @([direct[@"requests"] doubleValue] - [cached[@"requests"] doubleValue]);
+    cached[@"read_seconds_saved"] = @([direct[@"read_seconds"] doubleValue] - [cached[@"read_seconds"] doubleValue]);
+    cached[@"read_p50_saved_s"]   = @([direct[@"read_p50_s"] doubleValue] - [cached[@"read_p50_s"] doubleValue]);
+
+    if (cachedStale > directStale) {
+      self.errorCount += cachedStale - directStale;
+      NSLog(@"%@ query cache: %lu stale reads through the cache, %lu without it", _entity, (unsigned long)cachedStale, (unsigned long)directStale);
+    }
+
+    self.hitRate = [cached[@"hit_rate"] doubleValue];
+  }
+
+  if (direct) {
+    [report addResult:direct];
+  }
+
+  if (cached) {
+    [report addResult:cached];
+  }
+
+  [self deleteObjects:saved];
+}
+
+/*!
+ * Seeds this pass's lists and replays the operation sequence against them,
+ * through cache when it isn't nil. Returns the pass's result row, or nil when
+ * the lists could not be seeded.
+ */
+- (NSMutableDictionary *)runPass:(NSString *)pass
+                           cache:(KSQueryCache *)cache
+                             tag:(NSString *)tag
+                           saved:(NSMutableArray *)saved
+                          report:(KSBenchmarkReport *)report {
+
+  NSString *prefix              = [NSString stringWithFormat:@"%@.query_cache.%@", _entity, pass];
+  KSLatencyHistogram *reads     = [KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:@".read"]];
+  KSLatencyHistogram *saves     = [KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:@".save"]];
+  id<KSProviderAdapter> adapter = _adapter;
+  id<KSProviderAdapter> writer  = cache ? cache : _adapter;
+  KSQueryCacheReadBlock read    = _readBlock;
+  NSString *entity              = _entity;
+  NSString *field               = _field;
+  NSUInteger keyCount           = MAX(_keyCount, 1);
+  NSMutableArray *values        = [NSMutableArray arrayWithCapacity:keyCount];
+  NSMutableArray *counts        = [NSMutableArray arrayWithCapacity:keyCount];
+  NSMutableArray *fieldsList    = [NSMutableArray arrayWithCapacity:keyCount * _objectsPerKey];
+  NSUInteger hits               = 0;
+  NSUInteger stale              = 0;
+  NSTimeInterval readSeconds    = 0;
+
+  // Same seed for both passes, so they run the same operations.
+  unsigned short random[3] = {0x4b53, 0x7163, 0x6321};
+
+  for (NSUInteger i = 0; i < keyCount; i++) {
+
+    NSString *value = [NSString stringWithFormat:@"%@-%@-%lu", tag, pass, (unsigned long)i];
+
+    [values addObject:value];
+    [counts addObject:@(_objectsPerKey)];
+
+    for (NSUInteger j = 0; j < _objectsPerKey; j++) {
+      [fieldsList addObject:@{field : value}];
+    }
+  }
+
+  KSLatencyHistogram *seed = [KSLatencyHistogram histogramWithName:[prefix stringByAppendingString:@".seed"]];
+
+  NSArray *seeded = [seed measure:^(KSBenchmarkCompletion done) {
+    [adapter createObjectsInEntity:entity fieldsList:fieldsList completion:done];
+  } timeout:_timeout * MAX(1, ([fieldsList count] + 9) / 10)];
+
+  [saved addObjectsFromArray:seeded];
+
+  if ([seeded count] != [fieldsList count]) {
+    self.errorCount += 1;
+    NSLog(@"%@ query cache %@: seeded %lu of %lu objects: %@", _entity, pass, (unsigned long)[seeded count], (unsigned long)[fieldsList count], [seed.errors lastObject]);
+    return nil;
+  }
+
+  [KSWireMeter reset];
+
+  NSTimeInterval startedAt = KSMonotonicTime();
+
+  for (NSUInteger i = 0; i < _operations; i++) {
+
+    @autoreleasepool {
+
+      // Squaring skews the pick towards the first lists.
+      double pick     = erand48(random);
+      BOOL isRead     = erand48(random) < _readRatio;
+      NSUInteger key  = MIN((NSUInteger)(pick * pick * keyCount), keyCount - 1);
+      NSString *value = values[key];
+
+      if (!isRead) {
+
+        id object = [saves measure:^(KSBenchmarkCompletion done) {
+          [writer createObjectInEntity:entity fields:@{field : value} completion:done];
+        } timeout:_timeout];
+
+        if (object) {
+          [saved addObject:object];
+          counts[key] = @([counts[key] unsignedIntegerValue] + 1);
+        }
+
+        continue;
+      }
+
+      NSUInteger hitsBefore    = cache.hitCount;
+      NSTimeInterval readStart = KSMonotonicTime();
+
+      NSArray *found = [reads measure:^(KSBenchmarkCompletion done) {
+        read(value, cache, done);
+      } timeout:_timeout];
+
+      if (!found) {
+        continue;
+      }
+
+      readSeconds += KSMonotonicTime() - readStart;
+
+      if (cache && cache.hitCount > hitsBefore) {
+        hits++;
+      }
+
+      if ([found count] != [counts[key] unsignedIntegerValue]) {
+        stale++;
+      }
+    }
+  }
+
+  NSTimeInterval wallTime = KSMonotonicTime() - startedAt;
+  NSDictionary *wire      = [KSWireMeter totals];
+
+  reads.wallTime = wallTime;
+  saves.wallTime = wallTime;
+
+  [report addHistogram:reads withAttributes:@{@"entity" : _entity, @"pass" : pass, @"operation" : @"read"}];
+  [report addHistogram:saves withAttributes:@{@"entity" : _entity, @"pass" : pass, @"operation" : @"save"}];
+
+  if (reads.errorCount > 0 || saves.errorCount > 0) {
+    self.errorCount += reads.errorCount + saves.errorCount;
+    NSLog(@"%@ query cache %@: %lu reads and %lu saves failed: %@", _entity, pass, (unsigned long)reads.errorCount, (unsigned long)saves.errorCount,
+          [reads.errors lastObject] ?: [saves.errors lastObject]);
+  }
+
+  return [@{@"entity"         : _entity,
+            @"pass"           : pass,
+            @"operations"     : @(_operations),
+            @"reads"          : @(reads.count),
+            @"saves"          : @(saves.count),
+            @"read_p50_s"     : @([reads percentile:50]),
+            @"read_p95_s"     : @([reads percentile:95]),
+            @"save_p50_s"     : @([saves percentile:50]),
+            @"read_seconds"   : @(readSeconds),
+            @"wall_time_s"    : @(wallTime),
+            @"hits"           : @(hits),
+            @"hit_rate"       : @(reads.count > 0 ? (double)hits / reads.count : 0),
+            @"invalidations"  : @(cache.invalidationCount),
+            @"stale_reads"    : @(stale),
+            @"requests"       : wire[@"requests"],
+            @"bytes_received" : wire[@"bytes_received"],
+            @"errors"         : @(reads.errorCount + saves.errorCount)} mutableCopy];
+}
+
+- (void)deleteObjects:(NSArray *)objects {
+
+  if ([objects count] == 0) {
+    return;
+  }
+
+  id<KSProviderAdapter> adapter = _adapter;
+  NSString *entity              = _entity;
+  KSBulkDeleter *deleter        = [KSBulkDeleter deleterWithMaxConcurrentDeletes:_cleanupConcurrency];
+
+  [deleter deleteItems:objects withBlock:^(id object, KSBulkDeleteCompletion done) {
+    [adapter deleteObject:object inEntity:entity completion:^(id result, NSError *error) {
+      done(error);
+    }];
+  }];
+
+  if (![deleter waitWithTimeout:_timeout * MAX(1, [objects count] / MAX(_cleanupConcurrency, 1))] || deleter.failedCount > 0) {
+    NSLog(@"%@ query cache left %lu objects behind", _entity, (unsigned long)([objects count] - deleter.deletedCount));
+  }
+}
+
+@end
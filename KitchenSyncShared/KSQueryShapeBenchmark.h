@@ -0,0 +1,132 @@
+//
+//  KSQueryShapeBenchmark.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSCRUDBenchmark.h"
+
+@class KSBenchmarkReport;
+
+/*!
+ * The query shapes, each over the objects whose benchmark field equals the
+ * run's tag:
+ *
+ * - equality: categoryField == "category-3"
+ * - range: 100 <= valueField < 200
+ * - contained_in: categoryField in ("category-1", "category-5", "category-7")
+ * - regex: nameField matches ^3-
+ * - or: categoryField == "category-2" or valueField < 50
+ * - sort: every object, categoryField ascending, then valueField descending
+ */
+extern NSString * const KSQueryShapeEquality;
+extern NSString * const KSQueryShapeRange;
+extern NSString * const KSQueryShapeContainedIn;
+extern NSString * const KSQueryShapeRegex;
+extern NSString * const KSQueryShapeOr;
+extern NSString * const KSQueryShapeSort;
+
+/*!
+ * Saves one object per entry of fieldsList, through the SDK's bulk path, and
+ * calls done with the objects that were saved.
+ */
+typedef void (^KSQueryShapeSeedBlock)(NSArray *fieldsList, KSBenchmarkCompletion done);
+
+/*!
+ * Runs one shape over the objects tagged with tag, returning at most limit
+ * of them, and calls done with the objects found.
+ */
+typedef void (^KSQueryShapeBlock)(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done);
+
+/*!
+ * Reads field of an object a shape returned.
+ */
+typedef id (^KSQueryShapeValueBlock)(id object, NSString *field);
+
+/*!
+ * Runs the query shapes a list screen builds (see KSQueryShapeEquality and
+ * the rest) over a dataset that grows to each of rowCounts in turn, to find
+ * the shapes a backend answers by scanning every object.
+ *
+ * Object i is saved with the tagged benchmark field, categoryField
+ * "category-<i % 10>", valueField i % 1000 and nameField "<i % 7>-<i>". At
+ * each size every shape the suite added runs iterations times, all under one
+ * wire trace. The result row per shape and size has the p50 and p95, how many
+ * objects came back next to how many should have, and how many of them don't
+ * match the shape or, for sort, are out of order.
+ *
+ * growth_exponent is the slope of log p50 against log size from the size
+ * before: close to 0 when the backend finds the objects through an index,
+ * close to 1 or above when the work grows with the collection. A summary row
+ * per shape gives it from the smallest size to the largest, with
+ * scan_suspected set above 0.5.
+ */
+@interface KSQueryShapeBenchmark : NSObject
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field iterations:(NSUInteger)iterations;
+
+@property (nonatomic, readonly, copy) NSString *entity;
+@property (nonatomic, readonly, copy) NSString *field;
+@property (nonatomic, readonly) NSUInteger iterations;
+
+/*!
+ * Fields the shapes query. Default to fooCategory, fooValue and fooName.
+ */
+@property (nonatomic, copy) NSString *categoryField;
+@property (nonatomic, copy) NSString *valueField;
+@property (nonatomic, copy) NSString *nameField;
+
+/*!
+ * Seconds to wait for a single request. Defaults to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+/*!
+ * Dataset sizes, smallest first. Defaults to 1,000, 10,000 and 100,000.
+ */
+@property (nonatomic, copy) NSArray *rowCounts;
+
+/*!
+ * Objects per seed call. Defaults to 1,000.
+ */
+@property (nonatomic, assign) NSUInteger seedBatchSize;
+
+/*!
+ * Most objects a shape asks for, a page of a list. Defaults to 100.
+ */
+@property (nonatomic, assign) NSUInteger resultLimit;
+
+/*!
+ * Deletes run in parallel when tearing the dataset down. Defaults to 8.
+ */
+@property (nonatomic, assign) NSUInteger cleanupConcurrency;
+
+@property (nonatomic, copy) KSQueryShapeSeedBlock  seedBlock;
+@property (nonatomic, copy) KSQueryShapeValueBlock valueBlock;
+@property (nonatomic, copy) KSBenchmarkObjectBlock deleteBlock;
+
+/*!
+ * Adds a shape the SDK can express, in the order they should run.
+ */
+- (void)addShape:(NSString *)shape block:(KSQueryShapeBlock)block;
+
+/*!
+ * The shapes added so far.
+ */
+@property (nonatomic, readonly) NSArray *shapes;
+
+/*!
+ * Seeds up to each size, adds a histogram and a result row per shape and
+ * size, a wire trace per size and a summary row per shape to report, and
+ * deletes the dataset again.
+ */
+- (void)runWithReport:(KSBenchmarkReport *)report;
+
+/*!
+ * Failed seeds and queries, and queries that returned objects they
+ * shouldn't have, in the last run.
+ */
+@property (nonatomic, readonly) NSUInteger errorCount;
+
+@end
@@ -0,0 +1,352 @@
+//
+//  KSQueryShapeBenchmark.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSQueryShapeBenchmark.h"
+#import "KSBenchmarkReport.h"
+#import "KSBulkDeleter.h"
+#import "KSLatencyHistogram.h"
+#import "KSMonotonicClock.h"
+#import "KSRunNamespace.h"
+#import "KSWireTrace.h"
+
+NSString * const KSQueryShapeEquality    = @"equality";
+NSString * const KSQueryShapeRange       = @"range";
+NSString * const KSQueryShapeContainedIn = @"contained_in";
+NSString * const KSQueryShapeRegex       = @"regex";
+NSString * const KSQueryShapeOr          = @"or";
+NSString * const KSQueryShapeSort        = @"sort";
+
+static NSString *KSQueryShapeCategory(NSUInteger i) {
+  return [NSString stringWithFormat:@"category-%lu", (unsigned long)(i % 10)];
+}
+
+static NSString *KSQueryShapeName(NSUInteger i) {
+  return [NSString stringWithFormat:@"%lu-%lu", (unsigned long)(i % 7), (unsigned long)i];
+}
+
+/*!
+ * Whether an object with these values belongs in shape's results. Every
+ * object matches sort.
+ */
+static BOOL KSQueryShapeMatches(NSString *shape, NSString *category, NSInteger value, NSString *name) {
+
+  if ([shape isEqualToString:KSQueryShapeEquality]) {
+    return [category isEqualToString:@"category-3"];
+  }
+
+  if ([shape isEqualToString:KSQueryShapeRange]) {
+    return value >= 100 && value < 200;
+  }
+
+  if ([shape isEqualToString:KSQueryShapeContainedIn]) {
+    return [@[@"category-1", @"category-5", @"category-7"] containsObject:category];
+  }
+
+  if ([shape isEqualToString:KSQueryShapeRegex]) {
+    return [name hasPrefix:@"3-"];
+  }
+
+  if ([shape isEqualToString:KSQueryShapeOr]) {
+    return [category isEqualToString:@"category-2"] || value < 50;
+  }
+
+  return YES;
+}
+
+@interface KSQueryShapeBenchmark()
+
+@property (nonatomic, readwrite) NSUInteger errorCount;
+@property (nonatomic, strong) NSMutableArray *shapeNames;
+@property (nonatomic, strong) NSMutableDictionary *shapeBlocks;
+
+- (BOOL)seedUpTo:(NSUInteger)rows tag:(NSString *)tag objects:(NSMutableArray *)objects;
+- (void)timeShapesWithTag:(NSString *)tag rows:(NSUInteger)rows latencies:(NSMutableDictionary *)latencies report:(KSBenchmarkReport *)report;
+- (NSUInteger)mismatchesInResults:(NSArray *)results shape:(NSString *)shape;
+- (void)deleteObjects:(NSArray *)objects;
+
+@end
+
+@implementation KSQueryShapeBenchmark
+
+- (id)initWithEntity:(NSString *)entity field:(NSString *)field iterations:(NSUInteger)iterations {
+
+  self = [super init];
+
+  if (self) {
+    _entity             = [entity copy];
+    _field              = [field copy];
+    _iterations         = iterations;
+    _categoryField      = @"fooCategory";
+    _valueField         = @"fooValue";
+    _nameField          = @"fooName";
+    _timeout            = 30.0;
+    _rowCounts          = @[@1000, @10000, @100000];
+    _seedBatchSize      = 1000;
+    _resultLimit        = 100;
+    _cleanupConcurrency = 8;
+    _shapeNames         = [NSMutableArray array];
+    _shapeBlocks        = [NSMutableDictionary dictionary];
+  }
+
+  return self;
+}
+
+- (void)addShape:(NSString *)shape block:(KSQueryShapeBlock)block {
+
+  if (!_shapeBlocks[shape]) {
+    [_shapeNames addObject:shape];
+  }
+
+  _shapeBlocks[shape] = [block copy];
+}
+
+- (NSArray *)shapes {
+  return [_shapeNames copy];
+}
+
+- (void)runWithReport:(KSBenchmarkReport *)report {
+
+  NSString *tag                  = [[KSRunNamespace currentNamespace] tagValue:[NSString stringWithFormat:@"shapes-%@", [[NSProcessInfo processInfo] globallyUniqueString]]];
+  NSMutableArray *objects        = [NSMutableArray array];
+  NSMutableDictionary *latencies = [NSMutableDictionary dictionaryWithCapacity:[_shapeNames count]];
+
+  self.errorCount = 0;
+
+  for (NSNumber *rowCount in _rowCounts) {
+
+    if (![self seedUpTo:[rowCount unsignedIntegerValue] tag:tag objects:objects]) {
+      NSLog(@"%@ query shapes: stopping at %lu objects", _entity, (unsigned long)[objects count]);
+      break;
+    }
+
+    [self timeShapesWithTag:tag rows:[objects count] latencies:latencies report:report];
+  }
+
+  for (NSString *shape in _shapeNames) {
+
+    NSArray *points = latencies[shape];
+
+    if ([points count] < 2) {
+      continue;
+    }
+
+    NSArray *first  = points[0];
+    NSArray *last   = [points lastObject];
+    double exponent = 0;
+
+    if ([first[1] doubleValue] > 0 && [last[1] doubleValue] > 0) {
+      exponent = log([last[1] doubleValue] / [first[1] doubleValue]) / log([last[0] doubleValue] / [first[0] doubleValue]);
+    }
+
+    [report addResult:@{@"entity"          : _entity,
+                        @"shape"           : shape,
+                        @"summary"         : @YES,
+                        @"rows_from"       : first[0],
+                        @"rows_to"         : last[0],
+                        @"p50_from_s"      : first[1],
+                        @"p50_to_s"        : last[1],
+                        @"growth_exponent" : @(exponent),
+                        @"scan_suspected"  : @(exponent > 0.5)}];
+  }
+
+  [self deleteObjects:objects];
+}
+
+/*!
+ * Saves objects until there are rows of them. Returns NO when a batch
+ * failed.
+ */
+- (BOOL)seedUpTo:(NSUInteger)rows tag:(NSString *)tag objects:(NSMutableArray *)objects {
+
+  KSLatencyHistogram *seed   = [KSLatencyHistogram histogramWithName:[NSString stringWithFormat:@"%@.shapes.seed", _entity]];
+  KSQueryShapeSeedBlock save = _seedBlock;
+  NSUInteger batchSize       = MAX(_seedBatchSize, 1);
+  NSTimeInterval timeout     = _timeout * MAX(1, (batchSize + 9) / 10);
+  NSTimeInterval start       = KSMonotonicTime();
+  NSUInteger first           = [objects count];
+
+  while ([objects count] < rows) {
+
+    @autoreleasepool {
+
+      NSUInteger from            = [objects count];
+      NSUInteger count           = MIN(batchSize, rows - from);
+      NSMutableArray *fieldsList = [NSMutableArray arrayWithCapacity:count];
+
+      for (NSUInteger i = from; i < from + count; i++) {
+        [fieldsList addObject:@{_field         : tag,
+                                _categoryField : KSQueryShapeCategory(i),
+                                _valueField    : @(i % 1000),
+                                _nameField     : KSQueryShapeName(i)}];
+      }
+
+      NSArray *saved = [seed measure:^(KSBenchmarkCompletion done) {
+        save(fieldsList, done);
+      } timeout:timeout];
+
+      [objects addObjectsFromArray:saved];
+
+      if ([saved count] != count) {
+        self.errorCount += 1;
+        NSLog(@"%@ query shapes: seed batch saved %lu of %lu: %@", _entity, (unsigned long)[saved count], (unsigned long)count, [seed.errors lastObject]);
+        return NO;
+      }
+    }
+  }
+
+  NSLog(@"%@ query shapes: seeded %lu objects up to %lu in %.1fs", _entity, (unsigned long)([objects count] - first), (unsigned long)rows, KSMonotonicTime() - start);
+
+  return YES;
+}
+
+- (void)timeShapesWithTag:(NSString *)tag rows:(NSUInteger)rows latencies:(NSMutableDictionary *)latencies report:(KSBenchmarkReport *)report {
+
+  NSMutableArray *histograms = [NSMutableArray arrayWithCapacity:[_shapeNames count]];
+  NSMutableArray *results    = [NSMutableArray arrayWithCapacity:[_shapeNames count]];
+  NSUInteger limit           = _resultLimit;
+
+  [KSWireTrace start];
+
+  for (NSString *shape in _shapeNames) {
+
+    KSLatencyHistogram *histogram = [KSLatencyHistogram histogramWithName:[NSString stringWithFormat:@"%@.%@.%lu", _entity, shape, (unsigned long)rows]];
+    KSQueryShapeBlock block       = _shapeBlocks[shape];
+    NSArray *found                = nil;
+
+    for (NSUInteger i = 0; i < _iterations; i++) {
+
+      NSArray *iterationFound = [histogram measure:^(KSBenchmarkCompletion done) {
+        block(tag, limit, done);
+      } timeout:_timeout];
+
+      if (iterationFound) {
+        found = iterationFound;
+      }
+    }
+
+    NSUInteger matching = 0;
+
+    for (NSUInteger i = 0; i < rows; i++) {
+      if (KSQueryShapeMatches(shape, KSQueryShapeCategory(i), i % 1000, KSQueryShapeName(i))) {
+        matching++;
+      }
+    }
+
+    NSUInteger mismatched = found ? [self mismatchesInResults:found shape:shape] : 0;
+    NSTimeInterval p50    = [histogram percentile:50];
+    NSArray *previous     = [latencies[shape] lastObject];
+    id exponent           = [NSNull null];
+
+    if (previous && [previous[1] doubleValue] > 0 && p50 > 0) {
+      exponent = @(log(p50 / [previous[1] doubleValue]) / log((double)rows / [previous[0] doubleValue]));
+    }
+
+    if (!latencies[shape]) {
+      latencies[shape] = [NSMutableArray array];
+    }
+
+    if (histogram.errorCount < _iterations) {
+      [latencies[shape] addObject:@[@(rows), @(p50)]];
+    }
+
+    [histograms addObject:histogram];
+
+    [results addObject:@{@"entity"          : _entity,
+                         @"shape"           : shape,
+                         @"rows"            : @(rows),
+                         @"p50_s"           : @(p50),
+                         @"p95_s"           : @([histogram percentile:95]),
+                         @"results"         : @([found count]),
+                         @"expected"        : @(MIN(matching, limit)),
+                         @"matching"        : @(matching),
+                         @"mismatched"      : @(mismatched),
+                         @"growth_exponent" : exponent,
+                         @"errors"          : @(histogram.errorCount)}];
+
+    if (mismatched > 0) {
+      self.errorCount += mismatched;
+      NSLog(@"%@ %@ at %lu rows: %lu of %lu results don't belong", _entity, shape, (unsigned long)rows, (unsigned long)mismatched, (unsigned long)[found count]);
+    }
+
+    if (histogram.errorCount > 0) {
+      self.errorCount += histogram.errorCount;
+      NSLog(@"%@ %@ at %lu rows: %lu failed: %@", _entity, shape, (unsigned long)rows, (unsigned long)histogram.errorCount, [histogram.errors lastObject]);
+    }
+  }
+
+  [KSWireTrace stop];
+
+  NSDictionary *attributes = @{@"entity" : _entity, @"rows" : @(rows)};
+
+  for (KSLatencyHistogram *histogram in histograms) {
+    [report addHistogram:histogram withAttributes:attributes];
+  }
+
+  [KSWireTrace addToReport:report operations:histograms attributes:attributes];
+
+  for (NSDictionary *row in results) {
+    [report addResult:row];
+  }
+}
+
+/*!
+ * Results that don't match shape, or for sort, that come before an object
+ * they should follow.
+ */
+- (NSUInteger)mismatchesInResults:(NSArray *)results shape:(NSString *)shape {
+
+  KSQueryShapeValueBlock value = _valueBlock;
+  BOOL sort                    = [shape isEqualToString:KSQueryShapeSort];
+  NSString *previousCategory   = nil;
+  NSInteger previousValue      = 0;
+  NSUInteger mismatched        = 0;
+
+  for (id object in results) {
+
+    NSString *category = value(object, _categoryField);
+    NSInteger number   = [value(object, _valueField) integerValue];
+    NSString *name     = value(object, _nameField);
+
+    if (sort) {
+
+      NSComparisonResult order = previousCategory ? [previousCategory compare:category] : NSOrderedAscending;
+
+      if (order == NSOrderedDescending || (order == NSOrderedSame && previousValue < number)) {
+        mismatched++;
+      }
+
+      previousCategory = category;
+      previousValue    = number;
+
+    } else if (!KSQueryShapeMatches(shape, category, number, name)) {
+      mismatched++;
+    }
+  }
+
+  return mismatched;
+}
+
+- (void)deleteObjects:(NSArray *)objects {
+
+  if ([objects count] == 0 || !_deleteBlock) {
+    return;
+  }
+
+  KSBenchmarkObjectBlock block = _deleteBlock;
+  KSBulkDeleter *deleter       = [KSBulkDeleter deleterWithMaxConcurrentDeletes:_cleanupConcurrency];
+
+  [deleter deleteItems:objects withBlock:^(id object, KSBulkDeleteCompletion done) {
+    block(object, 0, ^(id result, NSError *error) {
+      done(error);
+    });
+  }];
+
+  if (![deleter waitWithTimeout:_timeout * MAX(1, [objects count] / MAX(_cleanupConcurrency, 1))] || deleter.failedCount > 0) {
+    NSLog(@"%@ query shapes left %lu objects behind", _entity, (unsigned long)([objects count] - deleter.deletedCount));
+  }
+}
+
+@end
@@ -0,0 +1,32 @@
+//
+//  KSRandomString.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+
+/*!
+ * Returns a string of length characters picked at random from characters,
+ * which must be ASCII. The buffer is on the heap, so megabyte strings are
+ * fine.
+ */
+static inline NSString *KSRandomStringFromCharacters(NSUInteger length, const char *characters) {
+
+  uint32_t count  = (uint32_t)strlen(characters);
+  unichar *buffer = malloc(MAX(length, 1) * sizeof(unichar));
+
+  for (NSUInteger i = 0; i < length; i++) {
+    buffer[i] = characters[arc4random_uniform(count)];
+  }
+
+  return [[NSString alloc] initWithCharactersNoCopy:buffer length:length freeWhenDone:YES];
+}
+
+/*!
+ * Returns a string of length random ASCII letters and digits, so every
+ * character is one byte in UTF-8.
+ */
+static inline NSString *KSRandomString(NSUInteger length) {
+  return KSRandomStringFromCharacters(length, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789");
+}
@@ -0,0 +1,69 @@
+//
+//  KSRunNamespace.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+
+/*!
+ * Marks the data one test run writes, so the run can clean up after itself
+ * with a single scoped delete instead of emptying whole collections, and so
+ * runs going at the same time never touch each other's objects.
+ *
+ * Test objects carry their run in the string field they already have
+ * (fooParameter, barParameter): tagged values start with the namespace's
+ * prefix. That works on the secure backends too, whose schemas are locked
+ * and would refuse a new tag field. Every backend can find a run's objects
+ * with one query on that field, either as a prefix match or as the range
+ * [valueLowerBound, valueUpperBound):
+ *
+ *   foo.fooParameter = [runNamespace tagValue:@"Testing public access"];
+ *   ...
+ *   [query whereKey:@"fooParameter" hasPrefix:runNamespace.valuePrefix];
+ */
+@interface KSRunNamespace : NSObject
+
+/*!
+ * The namespace for this process, named after +[KSParallelRunner
+ * runIdentifier], so every suite in a Scripts/runAllProviders.sh run shares
+ * it.
+ */
++ (KSRunNamespace *)currentNamespace;
+
+/*!
+ * identifier is reduced to letters, digits, '-' and '_' so the prefix can go
+ * into any query language unescaped.
+ */
+- (id)initWithIdentifier:(NSString *)identifier;
+
+@property (nonatomic, readonly, copy) NSString *identifier;
+
+/*!
+ * What every tagged value starts with: "ks-<identifier>:".
+ */
+@property (nonatomic, readonly, copy) NSString *valuePrefix;
+
+/*!
+ * Tagged values sort at or after valueLowerBound (the prefix) and strictly
+ * before valueUpperBound, and no other value does.
+ */
+@property (nonatomic, readonly, copy) NSString *valueLowerBound;
+@property (nonatomic, readonly, copy) NSString *valueUpperBound;
+
+/*!
+ * An anchored regular expression matching tagged values.
+ */
+@property (nonatomic, readonly, copy) NSString *valuePattern;
+
+/*!
+ * Returns value with the prefix in front.
+ */
+- (NSString *)tagValue:(NSString *)value;
+
+/*!
+ * YES when value is a string this namespace tagged.
+ */
+- (BOOL)isTaggedValue:(id)value;
+
+@end
@@ -0,0 +1,65 @@
+//
+//  KSRunNamespace.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSRunNamespace.h"
+#import "KSParallelRunner.h"
+
+@implementation KSRunNamespace
+
++ (KSRunNamespace *)currentNamespace {
+
+  static KSRunNamespace *currentNamespace = nil;
+  static dispatch_once_t onceToken;
+
+  dispatch_once(&onceToken, ^{
+    currentNamespace = [[KSRunNamespace alloc] initWithIdentifier:[KSParallelRunner runIdentifier]];
+  });
+
+  return currentNamespace;
+}
+
+- (id)initWithIdentifier:(NSString *)identifier {
+
+  self = [super init];
+
+  if (self) {
+
+    NSCharacterSet *allowed = [NSCharacterSet characterSetWithCharactersInString:@"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_"];
+    NSMutableString *clean  = [NSMutableString stringWithCapacity:[identifier length]];
+
+    for (NSUInteger i = 0; i < [identifier length]; i++) {
+
+      unichar c = [identifier characterAtIndex:i];
+
+      if ([allowed characterIsMember:c]) {
+        [clean appendFormat:@"%C", c];
+      }
+    }
+
+    _identifier      = [clean copy];
+    _valuePrefix     = [NSString stringWithFormat:@"ks-%@:", _identifier];
+    _valueLowerBound = _valuePrefix;
+    // ';' is the character after ':', so only tagged values sort below it.
+    _valueUpperBound = [NSString stringWithFormat:@"ks-%@;", _identifier];
+    _valuePattern    = [NSString stringWithFormat:@"^%@", _valuePrefix];
+  }
+
+  return self;
+}
+
+- (NSString *)tagValue:(NSString *)value {
+  return [_valuePrefix stringByAppendingString:value];
+}
+
+- (BOOL)isTaggedValue:(id)value {
+  return [value isKindOfClass:[NSString class]] && [value hasPrefix:_valuePrefix];
+}
+
+- (NSString *)description {
+  return _valuePrefix;
+}
+
+@end
@@ -0,0 +1,158 @@
+//
+//  KSStandIn.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+
+@class KSStandInServer;
+
+typedef NS_ENUM(NSInteger, KSStandInMode) {
+  KSStandInModeOff = 0,
+  KSStandInModeRecord,
+  KSStandInModeReplay
+};
+
+extern NSString * const KSStandInErrorDomain;
+
+/*!
+ * A local stand-in for the provider backends.
+ *
+ * In record mode every HTTP request the SDKs make goes to the real backend
+ * and the response is saved to disk. In replay mode nothing leaves the
+ * process: each request is answered from the recordings after an injected
+ * delay, so suites run without a network and timings only vary with the
+ * client.
+ *
+ * The stand-in is an NSURLProtocol registered in the test process, so every
+ * SDK is covered whether or not its host can be configured. Start it from a
+ * configurator with the provider's configuration dictionary:
+ *
+ *   StandInMode          Off (default), Record or Replay
+ *   StandInDirectory     where recordings live; defaults to
+ *                        $KS_STANDIN_DIR/<name>, or KitchenSyncStandIn/<name>
+ *                        in the temporary directory
+ *   StandInLatency       seconds to wait before answering a replayed request
+ *   StandInLatencyJitter extra random delay, up to this many seconds
+ *
+ * and, to inject faults from the start (see below):
+ *
+ *   StandInServiceUnavailableRate share of requests answered with a 503
+ *   StandInResetRate              share failed as if the connection reset
+ *   StandInLatencySpikeRate       share held back by StandInLatencySpike
+ *   StandInLatencySpike           seconds a spiked request is held back
+ *
+ * Requests are matched on method and URL, with anything that looks like a
+ * generated identifier replaced by a placeholder; repeated requests are
+ * answered in the order they were recorded. When no recording matches the
+ * URL, method and path alone are tried, so queries carrying random values
+ * still replay. Unmatched requests fail with KSStandInErrorDomain.
+ *
+ * Redirects are handed back to the SDK's loading system, so each hop is
+ * recorded and replayed as an exchange of its own, the way the SDK saw it.
+ * Authentication challenges met while recording are passed on to the SDK.
+ *
+ * +setOffline: takes the backends away altogether: every request fails the
+ * way it does with no network, whatever the mode, until it is turned off.
+ * +dropConnections cuts the requests already in flight instead, the way a
+ * connection lost mid-transfer would.
+ *
+ * While faults are injected, each request the stand-in handles may be
+ * answered with a 503 carrying Retry-After: 1, failed with
+ * NSURLErrorNetworkConnectionLost, or held back before being recorded or
+ * replayed, the way a backend browning out behaves. Faults are picked from a
+ * fixed seed, so runs with the same requests get the same faults, and
+ * faulted requests don't claim a recording. Faults need StandInMode Record
+ * or Replay.
+ *
+ * Replayed requests never open a socket, so connection reuse can't be seen.
+ * +startSocketTransport sends them through a KSStandInServer on the loopback
+ * interface instead, which answers them from the same recordings.
+ */
+@interface KSStandIn : NSURLProtocol
+
+/*!
+ * Registers the stand-in according to configuration. Later calls are
+ * ignored, so every configurator can call this when it loads.
+ */
++ (void)startWithConfiguration:(NSDictionary *)configuration name:(NSString *)name;
+
+/*!
+ * Unregisters the stand-in. Requests already in flight finish normally.
+ */
++ (void)stop;
+
++ (KSStandInMode)mode;
+
++ (NSString *)directory;
+
+/*!
+ * Number of requests answered from, or added to, the recordings.
+ */
++ (NSUInteger)handledRequestCount;
+
+/*!
+ * While offline every HTTP request fails at once with
+ * NSURLErrorNotConnectedToInternet and nothing is recorded or replayed.
+ * Registers the stand-in if no mode did, so it also works with StandInMode
+ * off.
+ */
++ (void)setOffline:(BOOL)offline;
+
++ (BOOL)isOffline;
+
+/*!
+ * Number of requests failed because the stand-in was offline.
+ */
++ (NSUInteger)refusedRequestCount;
+
+/*!
+ * Fails every request the stand-in is answering or recording with
+ * NSURLErrorNetworkConnectionLost and returns how many there were. Later
+ * requests go through as usual. Only requests the stand-in handles can be
+ * dropped, so this does nothing with StandInMode off.
+ */
++ (NSUInteger)dropConnections;
+
+/*!
+ * Starts injecting faults into the requests that follow, each rate a share
+ * of all requests, and zeroes +faultCounts. Calling it again restarts the
+ * fault sequence with the new rates.
+ */
++ (void)injectFaultsWithServiceUnavailableRate:(double)unavailableRate
+                                    resetRate:(double)resetRate
+                             latencySpikeRate:(double)spikeRate
+                                 latencySpike:(NSTimeInterval)spike;
+
++ (void)stopInjectingFaults;
+
++ (BOOL)isInjectingFaults;
+
+/*!
+ * Since faults were last injected: requests, service_unavailable, resets
+ * and latency_spikes. Every request the stand-in saw counts, retries
+ * included.
+ */
++ (NSDictionary *)faultCounts;
+
+/*!
+ * Starts answering replayed requests over loopback TCP connections and
+ * returns the server doing it, whose counts show how the SDK used its
+ * connections. Returns nil unless the stand-in is replaying. Later calls
+ * return the same server.
+ */
++ (KSStandInServer *)startSocketTransport;
+
+/*!
+ * Goes back to answering replayed requests in process and closes the
+ * server. +stop does this too.
+ */
++ (void)stopSocketTransport;
+
+/*!
+ * The server started by +startSocketTransport, or nil.
+ */
++ (KSStandInServer *)socketServer;
+
+@end
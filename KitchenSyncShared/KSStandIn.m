@@ -0,0 +1,1051 @@
+//
+//  KSStandIn.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSStandIn.h"
+#import "KSStandInServer.h"
+#import <CommonCrypto/CommonDigest.h>
+
+NSString * const KSStandInErrorDomain = @"KSStandInErrorDomain";
+
+// Set on requests the stand-in forwards while recording, so they go to the
+// network instead of coming back to it.
+static NSString * const KSStandInForwardedKey = @"KSStandInForwarded";
+
+// Marks the socket transport's answer to a request no recording matched, so
+// it fails the way an unmatched in-process replay does.
+static NSString * const KSStandInUnmatchedHeader = @"X-KitchenSync-StandIn";
+
+typedef NS_ENUM(NSInteger, KSStandInFault) {
+  KSStandInFaultNone = 0,
+  KSStandInFaultServiceUnavailable,
+  KSStandInFaultReset,
+  KSStandInFaultLatencySpike
+};
+
+static KSStandInMode        KSStandInCurrentMode = KSStandInModeOff;
+static NSString            *KSStandInDirectory;
+static NSTimeInterval       KSStandInLatency;
+static NSTimeInterval       KSStandInLatencyJitter;
+static NSMutableDictionary *KSStandInOccurrences;
+static NSUInteger           KSStandInHandledCount;
+static BOOL                 KSStandInOffline;
+static NSUInteger           KSStandInRefusedCount;
+static BOOL                 KSStandInRegistered;
+static NSHashTable         *KSStandInLoading;
+static KSStandInServer     *KSStandInSocketServer;
+static BOOL                 KSStandInInjectingFaults;
+static double               KSStandInUnavailableRate;
+static double               KSStandInResetRate;
+static double               KSStandInSpikeRate;
+static NSTimeInterval       KSStandInSpikeLatency;
+static unsigned short       KSStandInFaultSeed[3];
+static NSUInteger           KSStandInFaultRequests;
+static NSUInteger           KSStandInUnavailableCount;
+static NSUInteger           KSStandInResetCount;
+static NSUInteger           KSStandInSpikeCount;
+
+/*!
+ * Looks name up in headers regardless of case; recordings keep whatever
+ * case the backend sent.
+ */
+static NSString *KSStandInHeader(NSDictionary *headers, NSString *name) {
+
+  for (NSString *key in headers) {
+    if ([key caseInsensitiveCompare:name] == NSOrderedSame) {
+      return headers[key];
+    }
+  }
+
+  return nil;
+}
+
+static BOOL KSStandInIsRedirect(NSHTTPURLResponse *response) {
+
+  NSInteger status = [response statusCode];
+
+  return (status == 301 || status == 302 || status == 303 || status == 307 || status == 308) &&
+         KSStandInHeader([response allHeaderFields], @"Location") != nil;
+}
+
+@interface KSStandIn() <NSURLAuthenticationChallengeSender>
+
++ (void)registerIfNeeded;
++ (NSArray *)claimRecordingNamesForRequest:(NSURLRequest *)request;
++ (NSString *)pathForRecordingNamed:(NSString *)name extension:(NSString *)extension;
++ (NSString *)recordedNameFromNames:(NSArray *)names;
++ (NSDictionary *)recordingNamed:(NSString *)name body:(NSData **)body;
++ (NSTimeInterval)replayDelay;
++ (void)answerSocketRequest:(NSURLRequest *)request respond:(KSStandInServerResponse)respond;
++ (KSStandInFault)claimFault;
+
+- (void)startHandling;
+- (void)deliverServiceUnavailable;
+- (void)deliverReset;
+
+- (void)startRecording;
+- (void)startReplaying;
+- (void)startForwardingToServer:(KSStandInServer *)server;
+- (void)startConnectionWithRequest:(NSMutableURLRequest *)request;
+- (void)deliverRecordingNamed:(NSString *)name;
+- (void)deliverRedirectWithResponse:(NSHTTPURLResponse *)response;
+- (void)saveRecording;
+- (void)dropConnection;
+- (void)finishLoading;
+
+@end
+
+@implementation KSStandIn {
+
+  NSArray                      *_recordingNames;
+  NSURLConnection              *_connection;
+  NSHTTPURLResponse            *_response;
+  NSMutableData                *_data;
+  NSThread                     *_clientThread;
+  NSArray                      *_clientModes;
+  NSURLAuthenticationChallenge *_challenge;
+  BOOL                          _socketForwarding;
+  BOOL                          _stopped;
+}
+
+#pragma mark - Configuration
+
++ (void)startWithConfiguration:(NSDictionary *)configuration name:(NSString *)name {
+
+  NSString *modeName = configuration[@"StandInMode"];
+  KSStandInMode mode = KSStandInModeOff;
+
+  if ([modeName caseInsensitiveCompare:@"Record"] == NSOrderedSame) {
+    mode = KSStandInModeRecord;
+  } else if ([modeName caseInsensitiveCompare:@"Replay"] == NSOrderedSame) {
+    mode = KSStandInModeReplay;
+  }
+
+  if (mode == KSStandInModeOff) {
+    return;
+  }
+
+  @synchronized(self) {
+
+    if (KSStandInCurrentMode != KSStandInModeOff) {
+      return;
+    }
+
+    NSString *directory = configuration[@"StandInDirectory"];
+
+    if ([directory length] == 0) {
+
+      NSString *root = [[NSProcessInfo processInfo] environment][@"KS_STANDIN_DIR"];
+
+      if ([root length] == 0) {
+        root = [NSTemporaryDirectory() stringByAppendingPathComponent:@"KitchenSyncStandIn"];
+      }
+
+      directory = [root stringByAppendingPathComponent:name];
+    }
+
+    if (mode == KSStandInModeRecord) {
+      [[NSFileManager defaultManager] createDirectoryAtPath:directory
+                                withIntermediateDirectories:YES
+                                                 attributes:nil
+                                                      error:nil];
+    }
+
+    KSStandInCurrentMode   = mode;
+    KSStandInDirectory     = [directory copy];
+    KSStandInLatency       = MAX([configuration[@"StandInLatency"] doubleValue], 0);
+    KSStandInLatencyJitter = MAX([configuration[@"StandInLatencyJitter"] doubleValue], 0);
+    KSStandInOccurrences   = [NSMutableDictionary dictionary];
+    KSStandInHandledCount  = 0;
+  }
+
+  double unavailableRate = [configuration[@"StandInServiceUnavailableRate"] doubleValue];
+  double resetRate       = [configuration[@"StandInResetRate"] doubleValue];
+  double spikeRate       = [configuration[@"StandInLatencySpikeRate"] doubleValue];
+
+  if (unavailableRate > 0 || resetRate > 0 || spikeRate > 0) {
+    [self injectFaultsWithServiceUnavailableRate:unavailableRate
+                                       resetRate:resetRate
+                                latencySpikeRate:spikeRate
+                                    latencySpike:[configuration[@"StandInLatencySpike"] doubleValue]];
+  }
+
+  [self registerIfNeeded];
+
+  NSLog(@"%@ stand-in %@ %@", name, mode == KSStandInModeRecord ? @"recording to" : @"replaying from", KSStandInDirectory);
+}
+
++ (void)stop {
+
+  [self stopSocketTransport];
+
+  [NSURLProtocol unregisterClass:self];
+
+  @synchronized(self) {
+    KSStandInCurrentMode     = KSStandInModeOff;
+    KSStandInOffline         = NO;
+    KSStandInInjectingFaults = NO;
+    KSStandInRegistered      = NO;
+  }
+}
+
++ (void)registerIfNeeded {
+
+  @synchronized(self) {
+
+    if (KSStandInRegistered) {
+      return;
+    }
+
+    KSStandInRegistered = YES;
+  }
+
+  [NSURLProtocol registerClass:self];
+}
+
++ (KSStandInMode)mode {
+  @synchronized(self) {
+    return KSStandInCurrentMode;
+  }
+}
+
++ (NSString *)directory {
+  @synchronized(self) {
+    return KSStandInDirectory;
+  }
+}
+
++ (NSUInteger)handledRequestCount {
+  @synchronized(self) {
+    return KSStandInHandledCount;
+  }
+}
+
++ (void)setOffline:(BOOL)offline {
+
+  if (offline) {
+    [self registerIfNeeded];
+  }
+
+  @synchronized(self) {
+    KSStandInOffline = offline;
+  }
+}
+
++ (BOOL)isOffline {
+  @synchronized(self) {
+    return KSStandInOffline;
+  }
+}
+
++ (NSUInteger)refusedRequestCount {
+  @synchronized(self) {
+    return KSStandInRefusedCount;
+  }
+}
+
++ (void)injectFaultsWithServiceUnavailableRate:(double)unavailableRate
+                                    resetRate:(double)resetRate
+                             latencySpikeRate:(double)spikeRate
+                                 latencySpike:(NSTimeInterval)spike {
+
+  @synchronized(self) {
+
+    KSStandInInjectingFaults  = YES;
+    KSStandInUnavailableRate  = MIN(MAX(unavailableRate, 0), 1);
+    KSStandInResetRate        = MIN(MAX(resetRate, 0), 1);
+    KSStandInSpikeRate        = MIN(MAX(spikeRate, 0), 1);
+    KSStandInSpikeLatency     = MAX(spike, 0);
+    KSStandInFaultRequests    = 0;
+    KSStandInUnavailableCount = 0;
+    KSStandInResetCount       = 0;
+    KSStandInSpikeCount       = 0;
+
+    // The same faults hit the same requests every run, so a run recorded
+    // with faults on replays in step.
+    KSStandInFaultSeed[0] = 0x4b53;
+    KSStandInFaultSeed[1] = 0x6661;
+    KSStandInFaultSeed[2] = 0x756c;
+  }
+}
+
++ (void)stopInjectingFaults {
+  @synchronized(self) {
+    KSStandInInjectingFaults = NO;
+  }
+}
+
++ (BOOL)isInjectingFaults {
+  @synchronized(self) {
+    return KSStandInInjectingFaults;
+  }
+}
+
++ (NSDictionary *)faultCounts {
+  @synchronized(self) {
+    return @{@"requests"            : @(KSStandInFaultRequests),
+             @"service_unavailable" : @(KSStandInUnavailableCount),
+             @"resets"              : @(KSStandInResetCount),
+             @"latency_spikes"      : @(KSStandInSpikeCount)};
+  }
+}
+
+/*!
+ * Picks the fault, if any, for the next request and counts it.
+ */
++ (KSStandInFault)claimFault {
+
+  @synchronized(self) {
+
+    if (!KSStandInInjectingFaults) {
+      return KSStandInFaultNone;
+    }
+
+    KSStandInFaultRequests++;
+
+    double pick = erand48(KSStandInFaultSeed);
+
+    if (pick < KSStandInUnavailableRate) {
+      KSStandInUnavailableCount++;
+      return KSStandInFaultServiceUnavailable;
+    }
+
+    pick -= KSStandInUnavailableRate;
+
+    if (pick < KSStandInResetRate) {
+      KSStandInResetCount++;
+      return KSStandInFaultReset;
+    }
+
+    pick -= KSStandInResetRate;
+
+    if (pick < KSStandInSpikeRate) {
+      KSStandInSpikeCount++;
+      return KSStandInFaultLatencySpike;
+    }
+
+    return KSStandInFaultNone;
+  }
+}
+
++ (KSStandInServer *)startSocketTransport {
+
+  @synchronized(self) {
+
+    if (KSStandInCurrentMode != KSStandInModeReplay) {
+      return nil;
+    }
+
+    if (!KSStandInSocketServer) {
+      KSStandInSocketServer = [[KSStandInServer alloc] initWithResponder:^(NSURLRequest *request, KSStandInServerResponse respond) {
+        [KSStandIn answerSocketRequest:request respond:respond];
+      }];
+    }
+
+    return KSStandInSocketServer;
+  }
+}
+
++ (void)stopSocketTransport {
+
+  KSStandInServer *server = nil;
+
+  @synchronized(self) {
+    server                = KSStandInSocketServer;
+    KSStandInSocketServer = nil;
+  }
+
+  [server stop];
+}
+
++ (KSStandInServer *)socketServer {
+  @synchronized(self) {
+    return KSStandInSocketServer;
+  }
+}
+
++ (NSUInteger)dropConnections {
+
+  NSArray *loading = nil;
+
+  @synchronized(self) {
+    loading = [KSStandInLoading allObjects];
+  }
+
+  for (KSStandIn *protocol in loading) {
+    [protocol performSelector:@selector(dropConnection)
+                     onThread:protocol->_clientThread
+                   withObject:nil
+                waitUntilDone:NO
+                        modes:protocol->_clientModes];
+  }
+
+  return [loading count];
+}
+
+#pragma mark - Matching
+
+static NSString *KSStandInNormalizedString(NSString *string) {
+
+  static NSRegularExpression *identifiers;
+  static dispatch_once_t onceToken;
+
+  // UUIDs and -[NSProcessInfo globallyUniqueString] values.
+  dispatch_once(&onceToken, ^{
+    identifiers = [NSRegularExpression regularExpressionWithPattern:@"[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12}(-[0-9a-f]+)*"
+                                                            options:NSRegularExpressionCaseInsensitive
+                                                              error:nil];
+  });
+
+  return [identifiers stringByReplacingMatchesInString:string
+                                               options:0
+                                                 range:NSMakeRange(0, [string length])
+                                          withTemplate:@"{id}"];
+}
+
+static NSString *KSStandInDigest(NSString *string) {
+
+  NSData *data = [string dataUsingEncoding:NSUTF8StringEncoding];
+  unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+
+  CC_SHA1([data bytes], (CC_LONG)[data length], digest);
+
+  NSMutableString *hex = [NSMutableString stringWithCapacity:CC_SHA1_DIGEST_LENGTH * 2];
+
+  for (NSUInteger i = 0; i < CC_SHA1_DIGEST_LENGTH; i++) {
+    [hex appendFormat:@"%02x", digest[i]];
+  }
+
+  return hex;
+}
+
+/*!
+ * Returns the recording names for the next occurrence of the request: one
+ * keyed on the whole URL and a fallback keyed on the path only. Both counters
+ * advance for every request, in recording and in replay, so they stay in
+ * step between the two.
+ */
++ (NSArray *)claimRecordingNamesForRequest:(NSURLRequest *)request {
+
+  NSURL *url       = [request URL];
+  NSString *method = [request HTTPMethod] ? [request HTTPMethod] : @"GET";
+
+  NSString *exactKey = [NSString stringWithFormat:@"%@ %@", method, KSStandInNormalizedString([url absoluteString])];
+  NSString *pathKey  = [NSString stringWithFormat:@"%@ %@://%@%@", method, [url scheme], [url host], KSStandInNormalizedString([url path])];
+
+  NSArray *keys     = @[exactKey, pathKey];
+  NSArray *prefixes = @[@"", @"path-"];
+  NSMutableArray *names = [NSMutableArray arrayWithCapacity:[keys count]];
+
+  @synchronized(self) {
+
+    for (NSUInteger i = 0; i < [keys count]; i++) {
+
+      NSString *key         = keys[i];
+      NSUInteger occurrence = [KSStandInOccurrences[key] unsignedIntegerValue];
+
+      KSStandInOccurrences[key] = @(occurrence + 1);
+
+      [names addObject:[NSString stringWithFormat:@"%@%@-%lu", prefixes[i], KSStandInDigest(key), (unsigned long)occurrence]];
+    }
+
+    KSStandInHandledCount++;
+  }
+
+  return names;
+}
+
++ (NSString *)pathForRecordingNamed:(NSString *)name extension:(NSString *)extension {
+  return [[[self directory] stringByAppendingPathComponent:name] stringByAppendingPathExtension:extension];
+}
+
+/*!
+ * The first of names that has a recording, or nil.
+ */
++ (NSString *)recordedNameFromNames:(NSArray *)names {
+
+  for (NSString *name in names) {
+    if ([[NSFileManager defaultManager] fileExistsAtPath:[self pathForRecordingNamed:name extension:@"json"]]) {
+      return name;
+    }
+  }
+
+  return nil;
+}
+
+/*!
+ * The recording's method, url, status and headers, with its body in body.
+ * Returns nil if it can't be read.
+ */
++ (NSDictionary *)recordingNamed:(NSString *)name body:(NSData **)body {
+
+  if (!name) {
+    return nil;
+  }
+
+  NSData *json            = [NSData dataWithContentsOfFile:[self pathForRecordingNamed:name extension:@"json"]];
+  NSDictionary *recording = json ? [NSJSONSerialization JSONObjectWithData:json options:0 error:nil] : nil;
+  NSData *data            = [NSData dataWithContentsOfFile:[self pathForRecordingNamed:name extension:@"body"]];
+
+  if (body) {
+    *body = data ? data : [NSData data];
+  }
+
+  return recording;
+}
+
++ (NSTimeInterval)replayDelay {
+  return KSStandInLatency + KSStandInLatencyJitter * (arc4random_uniform(1001) / 1000.0);
+}
+
+#pragma mark - NSURLProtocol
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request {
+
+  BOOL offline = [self isOffline];
+
+  if ([self mode] == KSStandInModeOff && !offline) {
+    return NO;
+  }
+
+  NSString *scheme = [[[request URL] scheme] lowercaseString];
+
+  if (![scheme isEqualToString:@"http"] && ![scheme isEqualToString:@"https"]) {
+    return NO;
+  }
+
+  if (offline) {
+    return YES;
+  }
+
+  return [NSURLProtocol propertyForKey:KSStandInForwardedKey inRequest:request] == nil;
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request {
+  return request;
+}
+
+- (void)startLoading {
+
+  // Refused requests don't claim a recording, so replay stays in step.
+  if ([[self class] isOffline]) {
+
+    @synchronized([self class]) {
+      KSStandInRefusedCount++;
+    }
+
+    [[self client] URLProtocol:self didFailWithError:[NSError errorWithDomain:NSURLErrorDomain
+                                                                         code:NSURLErrorNotConnectedToInternet
+                                                                     userInfo:@{NSLocalizedDescriptionKey : @"The stand-in backend is offline."}]];
+    return;
+  }
+
+  // Client callbacks have to come from the thread and run loop mode the
+  // loading system started us on.
+  NSString *currentMode = [[NSRunLoop currentRunLoop] currentMode];
+
+  _clientThread = [NSThread currentThread];
+  _clientModes  = (currentMode && ![currentMode isEqualToString:NSDefaultRunLoopMode]) ? @[NSDefaultRunLoopMode, currentMode] : @[NSDefaultRunLoopMode];
+
+  // Like refused requests, faulted ones don't claim a recording.
+  KSStandInFault fault = [[self class] claimFault];
+  SEL delivery         = NULL;
+  NSTimeInterval delay = 0;
+
+  if (fault == KSStandInFaultServiceUnavailable) {
+    delivery = @selector(deliverServiceUnavailable);
+    delay    = [[self class] replayDelay];
+  } else if (fault == KSStandInFaultReset) {
+    delivery = @selector(deliverReset);
+    delay    = [[self class] replayDelay];
+  } else if (fault == KSStandInFaultLatencySpike) {
+    delivery = @selector(startHandling);
+    @synchronized([self class]) {
+      delay = KSStandInSpikeLatency;
+    }
+  }
+
+  if (!delivery) {
+    [self startHandling];
+    return;
+  }
+
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    [self performSelector:delivery
+                 onThread:_clientThread
+               withObject:nil
+            waitUntilDone:NO
+                    modes:_clientModes];
+  });
+}
+
+/*!
+ * Records, replays or forwards the request. Called on the client thread,
+ * after a latency spike if one was injected.
+ */
+- (void)startHandling {
+
+  if (_stopped) {
+    return;
+  }
+
+  KSStandInMode mode      = [[self class] mode];
+  KSStandInServer *server = mode == KSStandInModeReplay ? [[self class] socketServer] : nil;
+
+  // Over the socket transport the server claims the recording names, in the
+  // order the requests reach it.
+  if (!server) {
+    _recordingNames = [[self class] claimRecordingNamesForRequest:[self request]];
+  }
+
+  @synchronized([self class]) {
+
+    if (!KSStandInLoading) {
+      KSStandInLoading = [NSHashTable weakObjectsHashTable];
+    }
+
+    [KSStandInLoading addObject:self];
+  }
+
+  if (server) {
+    [self startForwardingToServer:server];
+  } else if (mode == KSStandInModeRecord) {
+    [self startRecording];
+  } else {
+    [self startReplaying];
+  }
+}
+
+- (void)stopLoading {
+
+  [_connection cancel];
+  _connection = nil;
+
+  [self finishLoading];
+}
+
+- (void)dropConnection {
+
+  if (_stopped) {
+    return;
+  }
+
+  [_connection cancel];
+  _connection = nil;
+
+  [self finishLoading];
+
+  [[self client] URLProtocol:self didFailWithError:[NSError errorWithDomain:NSURLErrorDomain
+                                                                       code:NSURLErrorNetworkConnectionLost
+                                                                   userInfo:@{NSLocalizedDescriptionKey : @"The stand-in dropped the connection."}]];
+}
+
+/*!
+ * Called on the client thread once the request is over, so a drop queued
+ * behind it leaves it alone.
+ */
+- (void)finishLoading {
+
+  _stopped = YES;
+
+  @synchronized([self class]) {
+    [KSStandInLoading removeObject:self];
+  }
+}
+
+#pragma mark - Faults
+
+/*!
+ * The answer of a backend browning out. Retry-After asks clients that honour
+ * it to wait a second.
+ */
+- (void)deliverServiceUnavailable {
+
+  if (_stopped) {
+    return;
+  }
+
+  [self finishLoading];
+
+  NSData *body = [@"{\"error\":\"The stand-in backend is unavailable.\"}" dataUsingEncoding:NSUTF8StringEncoding];
+
+  NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:[[self request] URL]
+                                                            statusCode:503
+                                                           HTTPVersion:@"HTTP/1.1"
+                                                          headerFields:@{@"Content-Type"   : @"application/json",
+                                                                         @"Content-Length" : [NSString stringWithFormat:@"%lu", (unsigned long)[body length]],
+                                                                         @"Retry-After"    : @"1"}];
+
+  [[self client] URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+  [[self client] URLProtocol:self didLoadData:body];
+  [[self client] URLProtocolDidFinishLoading:self];
+}
+
+- (void)deliverReset {
+
+  if (_stopped) {
+    return;
+  }
+
+  [self finishLoading];
+
+  [[self client] URLProtocol:self didFailWithError:[NSError errorWithDomain:NSURLErrorDomain
+                                                                       code:NSURLErrorNetworkConnectionLost
+                                                                   userInfo:@{NSLocalizedDescriptionKey : @"The stand-in reset the connection."}]];
+}
+
+#pragma mark - Replay
+
+- (void)startReplaying {
+
+  NSString *name       = [[self class] recordedNameFromNames:_recordingNames];
+  NSTimeInterval delay = [[self class] replayDelay];
+
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    [self performSelector:@selector(deliverRecordingNamed:)
+                 onThread:_clientThread
+               withObject:name
+            waitUntilDone:NO
+                    modes:_clientModes];
+  });
+}
+
+- (void)deliverRecordingNamed:(NSString *)name {
+
+  if (_stopped) {
+    return;
+  }
+
+  [self finishLoading];
+
+  NSData *body            = nil;
+  NSDictionary *recording = [[self class] recordingNamed:name body:&body];
+
+  if (!recording) {
+
+    NSString *description = [NSString stringWithFormat:@"no recording for %@ %@", [[self request] HTTPMethod], [[self request] URL]];
+
+    [[self client] URLProtocol:self didFailWithError:[NSError errorWithDomain:KSStandInErrorDomain
+                                                                         code:NSURLErrorResourceUnavailable
+                                                                     userInfo:@{NSLocalizedDescriptionKey : description}]];
+    return;
+  }
+
+  // The body was saved decoded, so drop the original encoding and length.
+  NSMutableDictionary *headers = [recording[@"headers"] mutableCopy];
+
+  [headers removeObjectForKey:@"Content-Encoding"];
+  headers[@"Content-Length"] = [NSString stringWithFormat:@"%lu", (unsigned long)[body length]];
+
+  NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:[[self request] URL]
+                                                            statusCode:[recording[@"status"] integerValue]
+                                                           HTTPVersion:@"HTTP/1.1"
+                                                          headerFields:headers];
+
+  if (KSStandInIsRedirect(response)) {
+    [self deliverRedirectWithResponse:response];
+    return;
+  }
+
+  [[self client] URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+  [[self client] URLProtocol:self didLoadData:body];
+  [[self client] URLProtocolDidFinishLoading:self];
+}
+
+/*!
+ * Tells the client the request was redirected, so the loading system starts
+ * a new request for the target that the stand-in handles separately. The
+ * new request is the SDK's own sent to Location, turned into a bodyless GET
+ * wherever the loading system would do that itself.
+ */
+- (void)deliverRedirectWithResponse:(NSHTTPURLResponse *)response {
+
+  [self finishLoading];
+
+  NSString *location            = KSStandInHeader([response allHeaderFields], @"Location");
+  NSMutableURLRequest *redirect = [[self request] mutableCopy];
+  NSInteger status              = [response statusCode];
+
+  redirect.URL = [[NSURL URLWithString:location relativeToURL:[[self request] URL]] absoluteURL];
+
+  if (status == 303 || ((status == 301 || status == 302) && [[redirect HTTPMethod] isEqualToString:@"POST"])) {
+    redirect.HTTPMethod     = @"GET";
+    redirect.HTTPBody       = nil;
+    redirect.HTTPBodyStream = nil;
+    [redirect setValue:nil forHTTPHeaderField:@"Content-Type"];
+    [redirect setValue:nil forHTTPHeaderField:@"Content-Length"];
+  }
+
+  [[self client] URLProtocol:self wasRedirectedToRequest:redirect redirectResponse:response];
+  [[self client] URLProtocol:self didFailWithError:[NSError errorWithDomain:NSCocoaErrorDomain code:NSUserCancelledError userInfo:nil]];
+}
+
+#pragma mark - Socket transport
+
+/*!
+ * Answers a request the socket server read: from its recording after the
+ * replay delay, or with a 404 the forwarding stand-in turns back into a
+ * KSStandInErrorDomain failure. Called on the server's queue.
+ */
++ (void)answerSocketRequest:(NSURLRequest *)request respond:(KSStandInServerResponse)respond {
+
+  NSString *name          = [self recordedNameFromNames:[self claimRecordingNamesForRequest:request]];
+  NSData *body            = nil;
+  NSDictionary *recording = [self recordingNamed:name body:&body];
+  NSTimeInterval delay    = [self replayDelay];
+
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+
+    if (recording) {
+      respond([recording[@"status"] integerValue], recording[@"headers"], body);
+      return;
+    }
+
+    NSString *description = [NSString stringWithFormat:@"no recording for %@ %@", [request HTTPMethod], [request URL]];
+
+    respond(404, @{KSStandInUnmatchedHeader : @"unmatched", @"Content-Type" : @"text/plain"}, [description dataUsingEncoding:NSUTF8StringEncoding]);
+  });
+}
+
+/*!
+ * Sends the request to the server's port for its origin, keeping the path,
+ * query, headers and pipelining flag the SDK set, so the URL loading system
+ * pools and reuses connections for it as it would against the backend.
+ */
+- (void)startForwardingToServer:(KSStandInServer *)server {
+
+  NSURL *url  = [[self request] URL];
+  NSURL *base = [server baseURLForOrigin:url];
+
+  if (!base) {
+
+    [self finishLoading];
+
+    [[self client] URLProtocol:self didFailWithError:[NSError errorWithDomain:NSURLErrorDomain
+                                                                         code:NSURLErrorCannotConnectToHost
+                                                                     userInfo:@{NSLocalizedDescriptionKey : @"The stand-in server could not listen for this host."}]];
+    return;
+  }
+
+  // Everything after the authority, as the SDK encoded it.
+  NSString *specifier = [url resourceSpecifier];
+  NSRange target      = [specifier rangeOfCharacterFromSet:[NSCharacterSet characterSetWithCharactersInString:@"/?"]
+                                                   options:0
+                                                     range:NSMakeRange(2, [specifier length] - 2)];
+  NSString *path      = target.location == NSNotFound ? @"/" : [specifier substringFromIndex:target.location];
+
+  if ([path hasPrefix:@"?"]) {
+    path = [@"/" stringByAppendingString:path];
+  }
+
+  NSMutableURLRequest *forwarded = [[self request] mutableCopy];
+
+  forwarded.URL = [NSURL URLWithString:[[base absoluteString] stringByAppendingString:path]];
+
+  // The server needs a Content-Length, so streamed bodies are read up front.
+  if ([forwarded HTTPBodyStream]) {
+
+    NSInputStream *stream = [forwarded HTTPBodyStream];
+    NSMutableData *body   = [NSMutableData data];
+    uint8_t buffer[16 * 1024];
+    NSInteger read;
+
+    [stream open];
+
+    while ((read = [stream read:buffer maxLength:sizeof(buffer)]) > 0) {
+      [body appendBytes:buffer length:(NSUInteger)read];
+    }
+
+    [stream close];
+
+    forwarded.HTTPBodyStream = nil;
+    forwarded.HTTPBody       = body;
+  }
+
+  _socketForwarding = YES;
+
+  [self startConnectionWithRequest:forwarded];
+}
+
+#pragma mark - Record
+
+- (void)startRecording {
+  [self startConnectionWithRequest:[[self request] mutableCopy]];
+}
+
+- (void)startConnectionWithRequest:(NSMutableURLRequest *)forwarded {
+
+  [NSURLProtocol setProperty:@YES forKey:KSStandInForwardedKey inRequest:forwarded];
+
+  _data       = [NSMutableData data];
+  _connection = [[NSURLConnection alloc] initWithRequest:forwarded delegate:self startImmediately:NO];
+
+  for (NSString *mode in _clientModes) {
+    [_connection scheduleInRunLoop:[NSRunLoop currentRunLoop] forMode:mode];
+  }
+
+  [_connection start];
+}
+
+- (void)saveRecording {
+
+  NSDictionary *recording = @{@"method"  : [[self request] HTTPMethod] ? [[self request] HTTPMethod] : @"GET",
+                              @"url"     : [[[self request] URL] absoluteString],
+                              @"status"  : @([_response statusCode]),
+                              @"headers" : [_response allHeaderFields] ? [_response allHeaderFields] : @{}};
+
+  NSData *json = [NSJSONSerialization dataWithJSONObject:recording options:NSJSONWritingPrettyPrinted error:nil];
+
+  for (NSString *name in _recordingNames) {
+    [_data writeToFile:[[self class] pathForRecordingNamed:name extension:@"body"] atomically:YES];
+    [json writeToFile:[[self class] pathForRecordingNamed:name extension:@"json"] atomically:YES];
+  }
+}
+
+/*!
+ * Stops the connection at a redirect instead of following it. While
+ * recording, the redirect is saved as this request's exchange; over the
+ * socket transport it is the recorded one coming back from the server.
+ */
+- (NSURLRequest *)connection:(NSURLConnection *)connection willSendRequest:(NSURLRequest *)request redirectResponse:(NSURLResponse *)redirectResponse {
+
+  if (![redirectResponse isKindOfClass:[NSHTTPURLResponse class]]) {
+    return request;
+  }
+
+  NSHTTPURLResponse *response = (NSHTTPURLResponse *)redirectResponse;
+
+  [_connection cancel];
+  _connection = nil;
+
+  if (_socketForwarding) {
+    response = [[NSHTTPURLResponse alloc] initWithURL:[[self request] URL]
+                                           statusCode:[response statusCode]
+                                          HTTPVersion:@"HTTP/1.1"
+                                         headerFields:[response allHeaderFields]];
+  } else {
+    _response = response;
+    [_data setLength:0];
+    [self saveRecording];
+  }
+
+  [self deliverRedirectWithResponse:response];
+
+  return nil;
+}
+
+/*!
+ * Passes the challenge on to the SDK, with the stand-in relaying its answer
+ * to the forwarded connection.
+ */
+- (void)connection:(NSURLConnection *)connection willSendRequestForAuthenticationChallenge:(NSURLAuthenticationChallenge *)challenge {
+
+  _challenge = challenge;
+
+  [[self client] URLProtocol:self didReceiveAuthenticationChallenge:[[NSURLAuthenticationChallenge alloc] initWithAuthenticationChallenge:challenge sender:self]];
+}
+
+- (void)connection:(NSURLConnection *)connection didReceiveResponse:(NSURLResponse *)response {
+
+  if ([response isKindOfClass:[NSHTTPURLResponse class]]) {
+    _response = (NSHTTPURLResponse *)response;
+  }
+
+  // The SDK asked for its backend, not the loopback port.
+  if (_socketForwarding && _response) {
+
+    if ([_response allHeaderFields][KSStandInUnmatchedHeader]) {
+
+      NSString *description = [NSString stringWithFormat:@"no recording for %@ %@", [[self request] HTTPMethod], [[self request] URL]];
+
+      [_connection cancel];
+      _connection = nil;
+
+      [self finishLoading];
+
+      [[self client] URLProtocol:self didFailWithError:[NSError errorWithDomain:KSStandInErrorDomain
+                                                                           code:NSURLErrorResourceUnavailable
+                                                                       userInfo:@{NSLocalizedDescriptionKey : description}]];
+      return;
+    }
+
+    response = [[NSHTTPURLResponse alloc] initWithURL:[[self request] URL]
+                                           statusCode:[_response statusCode]
+                                          HTTPVersion:@"HTTP/1.1"
+                                         headerFields:[_response allHeaderFields]];
+  }
+
+  [_data setLength:0];
+  [[self client] URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+}
+
+- (void)connection:(NSURLConnection *)connection didReceiveData:(NSData *)data {
+  [_data appendData:data];
+  [[self client] URLProtocol:self didLoadData:data];
+}
+
+- (void)connectionDidFinishLoading:(NSURLConnection *)connection {
+
+  if (_response && !_socketForwarding) {
+    [self saveRecording];
+  }
+
+  _connection = nil;
+
+  [self finishLoading];
+
+  [[self client] URLProtocolDidFinishLoading:self];
+}
+
+- (void)connection:(NSURLConnection *)connection didFailWithError:(NSError *)error {
+  _connection = nil;
+  [self finishLoading];
+  [[self client] URLProtocol:self didFailWithError:error];
+}
+
+- (NSCachedURLResponse *)connection:(NSURLConnection *)connection willCacheResponse:(NSCachedURLResponse *)cachedResponse {
+  return nil;
+}
+
+#pragma mark - NSURLAuthenticationChallengeSender
+
+- (void)useCredential:(NSURLCredential *)credential forAuthenticationChallenge:(NSURLAuthenticationChallenge *)challenge {
+  [[_challenge sender] useCredential:credential forAuthenticationChallenge:_challenge];
+  _challenge = nil;
+}
+
+- (void)continueWithoutCredentialForAuthenticationChallenge:(NSURLAuthenticationChallenge *)challenge {
+  [[_challenge sender] continueWithoutCredentialForAuthenticationChallenge:_challenge];
+  _challenge = nil;
+}
+
+- (void)cancelAuthenticationChallenge:(NSURLAuthenticationChallenge *)challenge {
+  [[_challenge sender] cancelAuthenticationChallenge:_challenge];
+  _challenge = nil;
+}
+
+- (void)performDefaultHandlingForAuthenticationChallenge:(NSURLAuthenticationChallenge *)challenge {
+
+  if ([[_challenge sender] respondsToSelector:@selector(performDefaultHandlingForAuthenticationChallenge:)]) {
+    [[_challenge sender] performDefaultHandlingForAuthenticationChallenge:_challenge];
+  } else {
+    [[_challenge sender] continueWithoutCredentialForAuthenticationChallenge:_challenge];
+  }
+
+  _challenge = nil;
+}
+
+- (void)rejectProtectionSpaceAndContinueWithChallenge:(NSURLAuthenticationChallenge *)challenge {
+
+  if ([[_challenge sender] respondsToSelector:@selector(rejectProtectionSpaceAndContinueWithChallenge:)]) {
+    [[_challenge sender] rejectProtectionSpaceAndContinueWithChallenge:_challenge];
+  } else {
+    [[_challenge sender] continueWithoutCredentialForAuthenticationChallenge:_challenge];
+  }
+
+  _challenge = nil;
+}
+
+@end
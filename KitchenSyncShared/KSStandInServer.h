@@ -0,0 +1,87 @@
+//
+//  KSStandInServer.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+
+/*!
+ * Writes the response to one request. Call it exactly once, from any thread.
+ */
+typedef void (^KSStandInServerResponse)(NSInteger status, NSDictionary *headers, NSData *body);
+
+/*!
+ * Answers a request the server read, with the URL rewritten back to the
+ * origin it was meant for.
+ */
+typedef void (^KSStandInServerResponder)(NSURLRequest *request, KSStandInServerResponse respond);
+
+/*!
+ * A plain HTTP/1.1 server on the loopback interface, so replayed requests
+ * still travel over real TCP connections and the URL loading system's
+ * connection reuse can be counted.
+ *
+ * Every origin (scheme, host and port of a backend) gets a listening port of
+ * its own, so connections are pooled per origin the way they would be
+ * against the real hosts. Connections stay open until the client closes
+ * them or sends Connection: close, and pipelined requests are answered in
+ * the order they arrived.
+ *
+ * Every accepted connection is a TCP handshake. Loopback traffic is never
+ * encrypted, so for an https origin the server counts the connection as the
+ * TLS handshake the real backend would have needed; it can't tell a full
+ * handshake from a resumed one.
+ */
+@interface KSStandInServer : NSObject
+
+- (id)initWithResponder:(KSStandInServerResponder)responder;
+
+/*!
+ * The http://127.0.0.1:<port> URL standing in for url's origin, starting a
+ * listener for it the first time. Returns nil if no port could be opened.
+ */
+- (NSURL *)baseURLForOrigin:(NSURL *)url;
+
+/*!
+ * Closes every open connection, so the next workload starts with an empty
+ * pool. Responses still owed are dropped.
+ */
+- (void)closeAllConnections;
+
+/*!
+ * Closes every connection and listener.
+ */
+- (void)stop;
+
+/*!
+ * Zeroes the counts below. Connections already open are not counted again.
+ */
+- (void)resetCounts;
+
+/*!
+ * Connections accepted, and those for https origins.
+ */
+@property (nonatomic, readonly) NSUInteger connectionCount;
+@property (nonatomic, readonly) NSUInteger tlsConnectionCount;
+
+/*!
+ * Requests read, those that arrived on a connection that had already carried
+ * one, and those that arrived before the response to the one before them had
+ * been written.
+ */
+@property (nonatomic, readonly) NSUInteger requestCount;
+@property (nonatomic, readonly) NSUInteger reusedRequestCount;
+@property (nonatomic, readonly) NSUInteger pipelinedRequestCount;
+
+/*!
+ * The most connections open at the same time.
+ */
+@property (nonatomic, readonly) NSUInteger maxOpenConnections;
+
+/*!
+ * Connections accepted per origin, keyed by scheme://host:port.
+ */
+@property (nonatomic, readonly) NSDictionary *connectionCountsByOrigin;
+
+@end
@@ -0,0 +1,503 @@
+//
+//  KSStandInServer.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSStandInServer.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Most bytes of request line and headers read before a connection is given
+// up on.
+static const NSUInteger KSStandInServerMaxHeadLength = 64 * 1024;
+
+/*!
+ * scheme://host[:port] exactly as url has it, so the URL rebuilt from a
+ * request matches the one the SDK asked for.
+ */
+static NSString *KSStandInServerOrigin(NSURL *url) {
+
+  NSString *origin = [NSString stringWithFormat:@"%@://%@", [[url scheme] lowercaseString], [url host]];
+
+  return [url port] ? [origin stringByAppendingFormat:@":%@", [url port]] : origin;
+}
+
+static NSString *KSStandInServerHeader(NSDictionary *headers, NSString *name) {
+
+  for (NSString *key in headers) {
+    if ([key caseInsensitiveCompare:name] == NSOrderedSame) {
+      return headers[key];
+    }
+  }
+
+  return nil;
+}
+
+/*!
+ * The response as it goes on the wire. The body is sent as is, so the
+ * headers that described the original encoding and framing are replaced.
+ */
+static NSData *KSStandInServerResponseData(NSInteger status, NSDictionary *headers, NSData *body, BOOL close) {
+
+  static NSSet *framingHeaders;
+  static dispatch_once_t onceToken;
+
+  dispatch_once(&onceToken, ^{
+    framingHeaders = [NSSet setWithObjects:@"content-length", @"content-encoding", @"transfer-encoding", @"connection", @"keep-alive", nil];
+  });
+
+  NSMutableString *head = [NSMutableString stringWithFormat:@"HTTP/1.1 %ld %@\r\n", (long)status, [NSHTTPURLResponse localizedStringForStatusCode:status]];
+
+  [headers enumerateKeysAndObjectsUsingBlock:^(NSString *name, id value, BOOL *stop) {
+    if (![framingHeaders containsObject:[name lowercaseString]]) {
+      [head appendFormat:@"%@: %@\r\n", name, value];
+    }
+  }];
+
+  [head appendFormat:@"Content-Length: %lu\r\n", (unsigned long)[body length]];
+
+  if (close) {
+    [head appendString:@"Connection: close\r\n"];
+  }
+
+  [head appendString:@"\r\n"];
+
+  NSMutableData *data = [[head dataUsingEncoding:NSUTF8StringEncoding] mutableCopy];
+
+  [data appendData:body];
+
+  return data;
+}
+
+/*!
+ * One accepted connection: the bytes read but not parsed yet, and a
+ * response per request read, empty until it has been answered, in the order
+ * the requests arrived.
+ */
+@interface KSStandInServerConnection : NSObject
+
+@property (nonatomic, strong) dispatch_io_t channel;
+@property (nonatomic, copy) NSString *origin;
+@property (nonatomic, strong) NSMutableData *buffer;
+@property (nonatomic, strong) NSMutableArray *responses;
+@property (nonatomic, assign) NSUInteger requests;
+
+// Set once no more requests will be read; the connection closes when the
+// responses owed have been written.
+@property (nonatomic, assign) BOOL closing;
+@property (nonatomic, assign) BOOL closed;
+
+@end
+
+@implementation KSStandInServerConnection
+@end
+
+@interface KSStandInServer()
+
+- (NSURL *)startListenerForOrigin:(NSString *)origin;
+- (void)acceptOnSocket:(int)listener origin:(NSString *)origin;
+- (void)connection:(KSStandInServerConnection *)connection read:(dispatch_data_t)data done:(BOOL)done error:(int)error;
+- (void)readRequestsFromConnection:(KSStandInServerConnection *)connection;
+- (void)writeResponsesToConnection:(KSStandInServerConnection *)connection;
+- (void)closeConnection:(KSStandInServerConnection *)connection;
+
+@end
+
+@implementation KSStandInServer {
+
+  KSStandInServerResponder _responder;
+
+  // Everything below is only touched on _queue.
+  dispatch_queue_t     _queue;
+  NSMutableDictionary *_listeners;
+  NSMutableDictionary *_baseURLs;
+  NSMutableSet        *_connections;
+  NSMutableDictionary *_originCounts;
+  NSUInteger           _connectionCount;
+  NSUInteger           _tlsConnectionCount;
+  NSUInteger           _requestCount;
+  NSUInteger           _reusedRequestCount;
+  NSUInteger           _pipelinedRequestCount;
+  NSUInteger           _maxOpenConnections;
+}
+
+- (id)initWithResponder:(KSStandInServerResponder)responder {
+
+  self = [super init];
+
+  if (self) {
+    _responder    = [responder copy];
+    _queue        = dispatch_queue_create("com.kitchensync.standin.server", DISPATCH_QUEUE_SERIAL);
+    _listeners    = [NSMutableDictionary dictionary];
+    _baseURLs     = [NSMutableDictionary dictionary];
+    _connections  = [NSMutableSet set];
+    _originCounts = [NSMutableDictionary dictionary];
+  }
+
+  return self;
+}
+
+#pragma mark - Listeners
+
+- (NSURL *)baseURLForOrigin:(NSURL *)url {
+
+  NSString *origin   = KSStandInServerOrigin(url);
+  __block NSURL *base = nil;
+
+  dispatch_sync(_queue, ^{
+    base = _baseURLs[origin] ? _baseURLs[origin] : [self startListenerForOrigin:origin];
+  });
+
+  return base;
+}
+
+- (NSURL *)startListenerForOrigin:(NSString *)origin {
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+  if (fd < 0) {
+    NSLog(@"stand-in server: no socket for %@: %s", origin, strerror(errno));
+    return nil;
+  }
+
+  int reuse = 1;
+  struct sockaddr_in address;
+  socklen_t length = sizeof(address);
+
+  memset(&address, 0, sizeof(address));
+
+  address.sin_len         = sizeof(address);
+  address.sin_family      = AF_INET;
+  address.sin_port        = 0;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+      listen(fd, 128) != 0 ||
+      getsockname(fd, (struct sockaddr *)&address, &length) != 0) {
+    NSLog(@"stand-in server: could not listen for %@: %s", origin, strerror(errno));
+    close(fd);
+    return nil;
+  }
+
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+  dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, fd, 0, _queue);
+
+  dispatch_source_set_event_handler(source, ^{
+    [self acceptOnSocket:fd origin:origin];
+  });
+
+  dispatch_source_set_cancel_handler(source, ^{
+    close(fd);
+  });
+
+  dispatch_resume(source);
+
+  NSURL *base = [NSURL URLWithString:[NSString stringWithFormat:@"http://127.0.0.1:%u", ntohs(address.sin_port)]];
+
+  _listeners[origin] = source;
+  _baseURLs[origin]  = base;
+
+  return base;
+}
+
+- (void)acceptOnSocket:(int)listener origin:(NSString *)origin {
+
+  int fd;
+
+  while ((fd = accept(listener, NULL, NULL)) >= 0) {
+
+    int noSignal = 1;
+
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSignal, sizeof(noSignal));
+
+    KSStandInServerConnection *connection = [[KSStandInServerConnection alloc] init];
+
+    connection.origin    = origin;
+    connection.buffer    = [NSMutableData data];
+    connection.responses = [NSMutableArray array];
+    connection.channel   = dispatch_io_create(DISPATCH_IO_STREAM, fd, _queue, ^(int error) {
+      close(fd);
+    });
+
+    dispatch_io_set_low_water(connection.channel, 1);
+
+    [_connections addObject:connection];
+
+    _connectionCount++;
+    _maxOpenConnections   = MAX(_maxOpenConnections, [_connections count]);
+    _originCounts[origin] = @([_originCounts[origin] unsignedIntegerValue] + 1);
+
+    if ([origin hasPrefix:@"https:"]) {
+      _tlsConnectionCount++;
+    }
+
+    dispatch_io_read(connection.channel, 0, SIZE_MAX, _queue, ^(bool done, dispatch_data_t data, int error) {
+      [self connection:connection read:data done:done error:error];
+    });
+  }
+}
+
+#pragma mark - Requests
+
+- (void)connection:(KSStandInServerConnection *)connection read:(dispatch_data_t)data done:(BOOL)done error:(int)error {
+
+  if (connection.closed) {
+    return;
+  }
+
+  if (data) {
+
+    dispatch_data_apply(data, ^bool(dispatch_data_t region, size_t offset, const void *bytes, size_t size) {
+      [connection.buffer appendBytes:bytes length:size];
+      return true;
+    });
+
+    [self readRequestsFromConnection:connection];
+  }
+
+  // The client closed its end: answer what it already sent, then close.
+  if (done && !connection.closed) {
+    if (error || [connection.responses count] == 0) {
+      [self closeConnection:connection];
+    } else {
+      connection.closing = YES;
+    }
+  }
+}
+
+/*!
+ * Hands every complete request in the buffer to the responder. Request
+ * bodies need a Content-Length; KSStandIn always forwards one.
+ */
+- (void)readRequestsFromConnection:(KSStandInServerConnection *)connection {
+
+  static NSData *headEnd;
+  static dispatch_once_t onceToken;
+
+  dispatch_once(&onceToken, ^{
+    headEnd = [NSData dataWithBytes:"\r\n\r\n" length:4];
+  });
+
+  while (!connection.closing && !connection.closed) {
+
+    NSMutableData *buffer = connection.buffer;
+    NSRange headRange     = [buffer rangeOfData:headEnd options:0 range:NSMakeRange(0, [buffer length])];
+
+    if (headRange.location == NSNotFound) {
+      if ([buffer length] > KSStandInServerMaxHeadLength) {
+        [self closeConnection:connection];
+      }
+      return;
+    }
+
+    NSString *head               = [[NSString alloc] initWithData:[buffer subdataWithRange:NSMakeRange(0, headRange.location)] encoding:NSISOLatin1StringEncoding];
+    NSArray *lines               = [head componentsSeparatedByString:@"\r\n"];
+    NSArray *requestLine         = [lines[0] componentsSeparatedByString:@" "];
+    NSMutableDictionary *headers = [NSMutableDictionary dictionary];
+
+    if ([requestLine count] != 3) {
+      [self closeConnection:connection];
+      return;
+    }
+
+    for (NSUInteger i = 1; i < [lines count]; i++) {
+
+      NSRange colon = [lines[i] rangeOfString:@":"];
+
+      if (colon.location != NSNotFound) {
+        headers[[lines[i] substringToIndex:colon.location]] = [[lines[i] substringFromIndex:colon.location + 1] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+      }
+    }
+
+    if (KSStandInServerHeader(headers, @"Transfer-Encoding")) {
+      NSLog(@"stand-in server: chunked request bodies aren't supported, closing %@ connection", connection.origin);
+      [self closeConnection:connection];
+      return;
+    }
+
+    NSUInteger bodyStart  = NSMaxRange(headRange);
+    NSUInteger bodyLength = (NSUInteger)MAX([KSStandInServerHeader(headers, @"Content-Length") longLongValue], 0);
+
+    if ([buffer length] < bodyStart + bodyLength) {
+      return;
+    }
+
+    NSData *body             = [buffer subdataWithRange:NSMakeRange(bodyStart, bodyLength)];
+    NSString *connectionMode = [KSStandInServerHeader(headers, @"Connection") lowercaseString];
+    BOOL close               = [connectionMode isEqualToString:@"close"] || ([requestLine[2] isEqualToString:@"HTTP/1.0"] && ![connectionMode isEqualToString:@"keep-alive"]);
+
+    [buffer replaceBytesInRange:NSMakeRange(0, bodyStart + bodyLength) withBytes:NULL length:0];
+
+    _requestCount++;
+
+    if (connection.requests > 0) {
+      _reusedRequestCount++;
+    }
+
+    if ([connection.responses count] > 0) {
+      _pipelinedRequestCount++;
+    }
+
+    connection.requests++;
+    connection.closing = close;
+
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:[connection.origin stringByAppendingString:requestLine[1]]]];
+    NSMutableData *response      = [NSMutableData data];
+    dispatch_queue_t queue       = _queue;
+
+    request.HTTPMethod          = requestLine[0];
+    request.allHTTPHeaderFields = headers;
+    request.HTTPBody            = body;
+
+    [connection.responses addObject:response];
+
+    _responder(request, ^(NSInteger status, NSDictionary *responseHeaders, NSData *responseBody) {
+
+      NSData *data = KSStandInServerResponseData(status, responseHeaders, responseBody ? responseBody : [NSData data], close);
+
+      dispatch_async(queue, ^{
+        [response setData:data];
+        [self writeResponsesToConnection:connection];
+      });
+    });
+  }
+}
+
+/*!
+ * Writes the answered responses at the head of the queue, stopping at the
+ * first one still owed so pipelined responses go out in order.
+ */
+- (void)writeResponsesToConnection:(KSStandInServerConnection *)connection {
+
+  if (connection.closed) {
+    return;
+  }
+
+  while ([connection.responses count] > 0 && [connection.responses[0] length] > 0) {
+
+    NSData *response     = connection.responses[0];
+    dispatch_data_t data = dispatch_data_create([response bytes], [response length], _queue, DISPATCH_DATA_DESTRUCTOR_DEFAULT);
+
+    [connection.responses removeObjectAtIndex:0];
+
+    dispatch_io_write(connection.channel, 0, data, _queue, ^(bool done, dispatch_data_t remaining, int error) {
+      if (done && error) {
+        [self closeConnection:connection];
+      }
+    });
+  }
+
+  if (connection.closing && [connection.responses count] == 0) {
+    [self closeConnection:connection];
+  } else if (!connection.closing) {
+    [self readRequestsFromConnection:connection];
+  }
+}
+
+/*!
+ * Closes once the writes already queued have gone out.
+ */
+- (void)closeConnection:(KSStandInServerConnection *)connection {
+
+  if (connection.closed) {
+    return;
+  }
+
+  connection.closed = YES;
+
+  dispatch_io_close(connection.channel, 0);
+
+  [_connections removeObject:connection];
+}
+
+- (void)closeAllConnections {
+  dispatch_sync(_queue, ^{
+
+    for (KSStandInServerConnection *connection in [_connections allObjects]) {
+      connection.closed = YES;
+      dispatch_io_close(connection.channel, DISPATCH_IO_STOP);
+    }
+
+    [_connections removeAllObjects];
+  });
+}
+
+- (void)stop {
+
+  [self closeAllConnections];
+
+  dispatch_sync(_queue, ^{
+
+    for (dispatch_source_t source in [_listeners allValues]) {
+      dispatch_source_cancel(source);
+    }
+
+    [_listeners removeAllObjects];
+    [_baseURLs removeAllObjects];
+  });
+}
+
+#pragma mark - Counts
+
+- (void)resetCounts {
+  dispatch_sync(_queue, ^{
+    _connectionCount       = 0;
+    _tlsConnectionCount    = 0;
+    _requestCount          = 0;
+    _reusedRequestCount    = 0;
+    _pipelinedRequestCount = 0;
+    _maxOpenConnections    = [_connections count];
+    [_originCounts removeAllObjects];
+  });
+}
+
+- (NSUInteger)connectionCount {
+  __block NSUInteger count = 0;
+  dispatch_sync(_queue, ^{ count = _connectionCount; });
+  return count;
+}
+
+- (NSUInteger)tlsConnectionCount {
+  __block NSUInteger count = 0;
+  dispatch_sync(_queue, ^{ count = _tlsConnectionCount; });
+  return count;
+}
+
+- (NSUInteger)requestCount {
+  __block NSUInteger count = 0;
+  dispatch_sync(_queue, ^{ count = _requestCount; });
+  return count;
+}
+
+- (NSUInteger)reusedRequestCount {
+  __block NSUInteger count = 0;
+  dispatch_sync(_queue, ^{ count = _reusedRequestCount; });
+  return count;
+}
+
+- (NSUInteger)pipelinedRequestCount {
+  __block NSUInteger count = 0;
+  dispatch_sync(_queue, ^{ count = _pipelinedRequestCount; });
+  return count;
+}
+
+- (NSUInteger)maxOpenConnections {
+  __block NSUInteger count = 0;
+  dispatch_sync(_queue, ^{ count = _maxOpenConnections; });
+  return count;
+}
+
+- (NSDictionary *)connectionCountsByOrigin {
+  __block NSDictionary *counts = nil;
+  dispatch_sync(_queue, ^{ counts = [_originCounts copy]; });
+  return counts;
+}
+
+@end
@@ -0,0 +1,72 @@
+//
+//  KSStartupBenchmark.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "KSLatencyHistogram.h"
+
+@class KSBenchmarkReport;
+
+/*!
+ * Runs one startup phase for the given pass. Call done when the phase has
+ * finished; synchronous phases call it before returning.
+ */
+typedef void (^KSStartupPhaseBlock)(NSUInteger pass, KSBenchmarkCompletion done);
+
+/*!
+ * Times what an SDK adds to app launch, one phase at a time: loading the
+ * configuration plist, constructing the client, setting up Core Data and
+ * making the first authenticated request.
+ *
+ * Phases run in the order they were added, each waiting for the previous one,
+ * and the whole sequence is repeated passes times. The first pass is reported
+ * as cold and the rest as warm, since most SDKs do their expensive one-off
+ * work (class loading, keychain reads, reachability) only once per process.
+ * Phases pass state to each other through the variables their blocks
+ * capture.
+ *
+ *   KSStartupBenchmark *startup = [[KSStartupBenchmark alloc] initWithProvider:@"Parse" passes:5];
+ *   [startup addPhase:@"client" block:^(NSUInteger pass, KSBenchmarkCompletion done) { ... }];
+ */
+@interface KSStartupBenchmark : NSObject
+
+- (id)initWithProvider:(NSString *)provider passes:(NSUInteger)passes;
+
+@property (nonatomic, readonly, copy) NSString *provider;
+@property (nonatomic, readonly) NSUInteger passes;
+
+/*!
+ * Seconds to wait for a single phase before counting it as failed. Defaults
+ * to 30.
+ */
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+- (void)addPhase:(NSString *)name block:(KSStartupPhaseBlock)block;
+
+/*!
+ * Called after every pass but the last, to drop the clients the phases built
+ * so the next pass starts from scratch.
+ */
+@property (nonatomic, copy) dispatch_block_t resetBlock;
+
+/*!
+ * Adds a histogram per phase and for the whole sequence, and a result row per
+ * phase with its cold time, warm p50/p95 and share of the warm total. A pass
+ * stops at the first phase that fails.
+ */
+- (void)runWithReport:(KSBenchmarkReport *)report;
+
+/*!
+ * Phases that failed or timed out in the last run.
+ */
+@property (nonatomic, readonly) NSUInteger errorCount;
+
+/*!
+ * Seconds since the test process was launched, so reports show how much of
+ * the process was already warm when a run started.
+ */
++ (NSTimeInterval)processUptime;
+
+@end
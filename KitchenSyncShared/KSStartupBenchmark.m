@@ -0,0 +1,211 @@
+//
+//  KSStartupBenchmark.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSStartupBenchmark.h"
+#import "KSBenchmarkReport.h"
+#import "KSCompletionWaiter.h"
+#import "KSMonotonicClock.h"
+#include <sys/sysctl.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static NSString * const KSStartupBenchmarkErrorDomain = @"KSStartupBenchmarkErrorDomain";
+
+@interface KSStartupBenchmark()
+
+@property (nonatomic, readwrite) NSUInteger errorCount;
+
+- (BOOL)runPhase:(NSUInteger)index pass:(NSUInteger)pass seconds:(NSTimeInterval *)seconds;
+
+@end
+
+@implementation KSStartupBenchmark {
+
+  NSMutableArray *_phaseNames;
+  NSMutableArray *_phaseBlocks;
+}
+
+- (id)initWithProvider:(NSString *)provider passes:(NSUInteger)passes {
+
+  self = [super init];
+
+  if (self) {
+    _provider    = [provider copy];
+    _passes      = MAX(passes, 1);
+    _timeout     = 30.0;
+    _phaseNames  = [NSMutableArray array];
+    _phaseBlocks = [NSMutableArray array];
+  }
+
+  return self;
+}
+
+- (void)addPhase:(NSString *)name block:(KSStartupPhaseBlock)block {
+  [_phaseNames addObject:name];
+  [_phaseBlocks addObject:[block copy]];
+}
+
+- (void)runWithReport:(KSBenchmarkReport *)report {
+
+  NSUInteger phaseCount = [_phaseNames count];
+  NSMutableArray *warm  = [NSMutableArray arrayWithCapacity:phaseCount];
+  NSMutableArray *cold  = [NSMutableArray arrayWithCapacity:phaseCount];
+
+  KSLatencyHistogram *warmTotal = [KSLatencyHistogram histogramWithName:[NSString stringWithFormat:@"%@.startup.total", _provider]];
+  NSTimeInterval coldTotal      = 0;
+  BOOL coldCompleted            = NO;
+
+  self.errorCount = 0;
+
+  for (NSString *name in _phaseNames) {
+    [warm addObject:[KSLatencyHistogram histogramWithName:[NSString stringWithFormat:@"%@.startup.%@", _provider, name]]];
+    [cold addObject:[NSNull null]];
+  }
+
+  for (NSUInteger pass = 0; pass < _passes; pass++) {
+
+    NSTimeInterval total = 0;
+    BOOL completed       = YES;
+
+    for (NSUInteger i = 0; i < phaseCount && completed; i++) {
+
+      NSTimeInterval seconds = 0;
+
+      completed = [self runPhase:i pass:pass seconds:&seconds];
+
+      if (!completed) {
+        break;
+      }
+
+      total += seconds;
+
+      if (pass == 0) {
+        cold[i] = @(seconds);
+      } else {
+        [warm[i] recordLatency:seconds];
+      }
+    }
+
+    if (pass == 0) {
+      coldTotal     = total;
+      coldCompleted = completed;
+    } else if (completed) {
+      [warmTotal recordLatency:total];
+    }
+
+    if (_resetBlock && pass + 1 < _passes) {
+      _resetBlock();
+    }
+  }
+
+  NSTimeInterval warmMedian = [warmTotal percentile:50];
+
+  for (NSUInteger i = 0; i < phaseCount; i++) {
+
+    KSLatencyHistogram *histogram = warm[i];
+    NSMutableDictionary *result   = [@{@"provider" : _provider, @"phase" : _phaseNames[i]} mutableCopy];
+
+    [report addHistogram:histogram withAttributes:@{@"phase" : _phaseNames[i], @"pass" : @"warm"}];
+
+    if (cold[i] != [NSNull null]) {
+      result[@"cold_s"] = cold[i];
+    }
+
+    if (histogram.count > 0) {
+      result[@"warm_p50_s"] = @([histogram percentile:50]);
+      result[@"warm_p95_s"] = @([histogram percentile:95]);
+    }
+
+    // Shares of the median pass; they don't add up to exactly 1 because each
+    // phase's median comes from a different pass.
+    if (histogram.count > 0 && warmMedian > 0) {
+      result[@"warm_share"] = @([histogram percentile:50] / warmMedian);
+    }
+
+    [report addResult:result];
+  }
+
+  [report addHistogram:warmTotal withAttributes:@{@"phase" : @"total", @"pass" : @"warm"}];
+
+  NSMutableDictionary *total = [@{@"provider" : _provider, @"phase" : @"total"} mutableCopy];
+
+  if (coldCompleted) {
+    total[@"cold_s"] = @(coldTotal);
+  }
+
+  if (warmTotal.count > 0) {
+    total[@"warm_p50_s"] = @(warmMedian);
+    total[@"warm_p95_s"] = @([warmTotal percentile:95]);
+  }
+
+  [report addResult:total];
+}
+
+/*!
+ * Runs one phase and returns YES if it called done without an error in time.
+ * The phase's time runs from the call to done, not to the end of the wait.
+ */
+- (BOOL)runPhase:(NSUInteger)index pass:(NSUInteger)pass seconds:(NSTimeInterval *)seconds {
+
+  KSStartupPhaseBlock phase  = _phaseBlocks[index];
+  NSString *name             = _phaseNames[index];
+  KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
+  __block NSTimeInterval end = 0;
+  __block NSError *failure   = nil;
+
+  NSTimeInterval start = KSMonotonicTime();
+
+  phase(pass, ^(id result, NSError *error) {
+
+    @synchronized(waiter) {
+      if (end == 0) {
+        end     = KSMonotonicTime();
+        failure = error;
+      }
+    }
+
+    [waiter signal];
+  });
+
+  if (![waiter waitWithTimeout:_timeout]) {
+    failure = [NSError errorWithDomain:KSStartupBenchmarkErrorDomain
+                                  code:1
+                              userInfo:@{NSLocalizedDescriptionKey : [NSString stringWithFormat:@"%@ %@ timed out after %.3fs", _provider, name, _timeout]}];
+  }
+
+  @synchronized(waiter) {
+
+    if (failure) {
+      self.errorCount++;
+      NSLog(@"%@ startup pass %lu: %@ failed: %@", _provider, (unsigned long)pass, name, [failure localizedDescription]);
+      return NO;
+    }
+
+    *seconds = end - start;
+  }
+
+  return YES;
+}
+
++ (NSTimeInterval)processUptime {
+
+  int mib[4]              = {CTL_KERN, KERN_PROC, KERN_PROC_PID, getpid()};
+  struct kinfo_proc info;
+  size_t size             = sizeof(info);
+  struct timeval now;
+
+  if (sysctl(mib, 4, &info, &size, NULL, 0) != 0) {
+    return 0;
+  }
+
+  gettimeofday(&now, NULL);
+
+  struct timeval started = info.kp_proc.p_starttime;
+
+  return (now.tv_sec - started.tv_sec) + (now.tv_usec - started.tv_usec) / (double)USEC_PER_SEC;
+}
+
+@end
@@ -0,0 +1,58 @@
+//
+//  KSWireMeter.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+
+/*!
+ * Counts the HTTP requests the SDKs send and the bytes that go over the
+ * wire for them.
+ *
+ * Installed as an NSURLProtocol in the test process: each request is passed
+ * through to the network (or to KSStandIn when it is replaying) unchanged,
+ * and its request line, headers and body are added to bytesSent, its status
+ * line, headers and body to bytesReceived. Body sizes use Content-Length
+ * when the server sent one, so compressed responses count at their
+ * compressed size. Header sizes only cover the headers the SDK set, not ones
+ * the URL loading system adds. Each request's timings are also handed to
+ * KSWireTrace. Redirects and authentication challenges are passed back to
+ * the SDK, so it sees them as it would without the meter; each redirect hop
+ * counts as a request.
+ *
+ *   [KSWireMeter install];
+ *   [KSWireMeter reset];
+ *   ... run a workload ...
+ *   NSLog(@"%llu bytes sent", [KSWireMeter bytesSent]);
+ */
+@interface KSWireMeter : NSURLProtocol
+
+/*!
+ * Registers the meter. Later calls do nothing.
+ */
++ (void)install;
+
+/*!
+ * Unregisters the meter, for workloads it would distort: it reads streamed
+ * request bodies into memory to count them. Requests already in flight
+ * finish normally.
+ */
++ (void)uninstall;
+
+/*!
+ * Zeroes the counters.
+ */
++ (void)reset;
+
++ (NSUInteger)requestCount;
++ (unsigned long long)bytesSent;
++ (unsigned long long)bytesReceived;
+
+/*!
+ * The counters as a JSON-ready dictionary: requests, bytes_sent and
+ * bytes_received.
+ */
++ (NSDictionary *)totals;
+
+@end
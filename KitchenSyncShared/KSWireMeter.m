@@ -0,0 +1,344 @@
+//
+//  KSWireMeter.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSWireMeter.h"
+#import "KSMonotonicClock.h"
+#import "KSWireTrace.h"
+
+// Set on requests the meter forwards, so they are not counted twice.
+static NSString * const KSWireMeterForwardedKey = @"KSWireMeterForwarded";
+
+static BOOL               KSWireMeterInstalled;
+static NSUInteger         KSWireMeterRequestCount;
+static unsigned long long KSWireMeterBytesSent;
+static unsigned long long KSWireMeterBytesReceived;
+
+@interface KSWireMeter() <NSURLAuthenticationChallengeSender>
+
++ (unsigned long long)addRequest:(NSURLRequest *)request;
++ (unsigned long long)addResponse:(NSHTTPURLResponse *)response bodyLength:(unsigned long long)bodyLength;
+- (void)traceWithError:(NSError *)error;
+
+@end
+
+@implementation KSWireMeter {
+
+  NSURLConnection              *_connection;
+  NSURLRequest                 *_forwarded;
+  NSHTTPURLResponse            *_response;
+  NSURLAuthenticationChallenge *_challenge;
+  unsigned long long            _sentLength;
+  unsigned long long            _receivedLength;
+  unsigned long long            _responseLength;
+  NSTimeInterval                _startedAt;
+  NSTimeInterval                _respondedAt;
+}
+
+#pragma mark - Counters
+
++ (void)install {
+
+  @synchronized(self) {
+
+    if (KSWireMeterInstalled) {
+      return;
+    }
+
+    KSWireMeterInstalled = YES;
+  }
+
+  [NSURLProtocol registerClass:self];
+}
+
++ (void)uninstall {
+
+  [NSURLProtocol unregisterClass:self];
+
+  @synchronized(self) {
+    KSWireMeterInstalled = NO;
+  }
+}
+
++ (void)reset {
+  @synchronized(self) {
+    KSWireMeterRequestCount  = 0;
+    KSWireMeterBytesSent     = 0;
+    KSWireMeterBytesReceived = 0;
+  }
+}
+
++ (NSUInteger)requestCount {
+  @synchronized(self) {
+    return KSWireMeterRequestCount;
+  }
+}
+
++ (unsigned long long)bytesSent {
+  @synchronized(self) {
+    return KSWireMeterBytesSent;
+  }
+}
+
++ (unsigned long long)bytesReceived {
+  @synchronized(self) {
+    return KSWireMeterBytesReceived;
+  }
+}
+
++ (NSDictionary *)totals {
+  @synchronized(self) {
+    return @{@"requests"       : @(KSWireMeterRequestCount),
+             @"bytes_sent"     : @(KSWireMeterBytesSent),
+             @"bytes_received" : @(KSWireMeterBytesReceived)};
+  }
+}
+
+static unsigned long long KSWireMeterHeaderLength(NSString *firstLine, NSDictionary *headers) {
+
+  __block unsigned long long length = [firstLine lengthOfBytesUsingEncoding:NSUTF8StringEncoding] + 2;
+
+  [headers enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSString *value, BOOL *stop) {
+    length += [name lengthOfBytesUsingEncoding:NSUTF8StringEncoding] + 2 + [[value description] lengthOfBytesUsingEncoding:NSUTF8StringEncoding] + 2;
+  }];
+
+  return length + 2;
+}
+
++ (unsigned long long)addRequest:(NSURLRequest *)request {
+
+  NSURL *url          = [request URL];
+  NSString *path      = [url query] ? [NSString stringWithFormat:@"%@?%@", [url path], [url query]] : [url path];
+  NSString *firstLine = [NSString stringWithFormat:@"%@ %@ HTTP/1.1", [request HTTPMethod], path];
+
+  unsigned long long length = KSWireMeterHeaderLength(firstLine, [request allHTTPHeaderFields]) + [[request HTTPBody] length];
+
+  @synchronized(self) {
+    KSWireMeterRequestCount++;
+    KSWireMeterBytesSent += length;
+  }
+
+  return length;
+}
+
++ (unsigned long long)addResponse:(NSHTTPURLResponse *)response bodyLength:(unsigned long long)bodyLength {
+
+  NSString *firstLine = [NSString stringWithFormat:@"HTTP/1.1 %ld", (long)[response statusCode]];
+  long long declared  = [response expectedContentLength];
+
+  unsigned long long length = KSWireMeterHeaderLength(firstLine, [response allHeaderFields]) + (declared >= 0 ? (unsigned long long)declared : bodyLength);
+
+  @synchronized(self) {
+    KSWireMeterBytesReceived += length;
+  }
+
+  return length;
+}
+
+#pragma mark - NSURLProtocol
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request {
+
+  NSString *scheme = [[[request URL] scheme] lowercaseString];
+
+  if (![scheme isEqualToString:@"http"] && ![scheme isEqualToString:@"https"]) {
+    return NO;
+  }
+
+  return [NSURLProtocol propertyForKey:KSWireMeterForwardedKey inRequest:request] == nil;
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request {
+  return request;
+}
+
+- (void)startLoading {
+
+  NSMutableURLRequest *forwarded = [[self request] mutableCopy];
+
+  // Streamed bodies can only be read once; read it here so it can be counted
+  // and still sent.
+  if (![forwarded HTTPBody] && [forwarded HTTPBodyStream]) {
+
+    NSInputStream *stream = [forwarded HTTPBodyStream];
+    NSMutableData *body   = [NSMutableData data];
+    uint8_t buffer[16384];
+    NSInteger read;
+
+    [stream open];
+
+    while ((read = [stream read:buffer maxLength:sizeof(buffer)]) > 0) {
+      [body appendBytes:buffer length:read];
+    }
+
+    [stream close];
+
+    [forwarded setHTTPBodyStream:nil];
+    [forwarded setHTTPBody:body];
+  }
+
+  [NSURLProtocol setProperty:@YES forKey:KSWireMeterForwardedKey inRequest:forwarded];
+
+  _forwarded  = forwarded;
+  _sentLength = [[self class] addRequest:forwarded];
+
+  // Schedule in the mode the loading system started us in as well, or the
+  // connection's callbacks may never be delivered.
+  NSString *currentMode = [[NSRunLoop currentRunLoop] currentMode];
+
+  _connection = [[NSURLConnection alloc] initWithRequest:forwarded delegate:self startImmediately:NO];
+
+  [_connection scheduleInRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+
+  if (currentMode && ![currentMode isEqualToString:NSDefaultRunLoopMode]) {
+    [_connection scheduleInRunLoop:[NSRunLoop currentRunLoop] forMode:currentMode];
+  }
+
+  _startedAt = KSMonotonicTime();
+
+  [_connection start];
+}
+
+- (void)stopLoading {
+  [_connection cancel];
+  _connection = nil;
+}
+
+/*!
+ * Hands the request's timings to KSWireTrace, which ignores them unless a
+ * trace is running.
+ */
+- (void)traceWithError:(NSError *)error {
+  [KSWireTrace recordRequest:_forwarded
+                   startedAt:_startedAt
+                 respondedAt:_respondedAt
+                  finishedAt:KSMonotonicTime()
+                   bytesSent:_sentLength
+               bytesReceived:_responseLength
+                       error:error];
+}
+
+#pragma mark - NSURLConnectionDataDelegate
+
+/*!
+ * Stops the connection at a redirect and hands it to the client, so the
+ * SDK follows it the way it would unmetered. The follow-up request is
+ * metered as a request of its own.
+ */
+- (NSURLRequest *)connection:(NSURLConnection *)connection willSendRequest:(NSURLRequest *)request redirectResponse:(NSURLResponse *)redirectResponse {
+
+  if (![redirectResponse isKindOfClass:[NSHTTPURLResponse class]]) {
+    return request;
+  }
+
+  NSMutableURLRequest *redirect = [request mutableCopy];
+
+  [NSURLProtocol removePropertyForKey:KSWireMeterForwardedKey inRequest:redirect];
+
+  _respondedAt    = KSMonotonicTime();
+  _responseLength = [[self class] addResponse:(NSHTTPURLResponse *)redirectResponse bodyLength:0];
+
+  [self traceWithError:nil];
+
+  [_connection cancel];
+  _connection = nil;
+
+  [[self client] URLProtocol:self wasRedirectedToRequest:redirect redirectResponse:redirectResponse];
+  [[self client] URLProtocol:self didFailWithError:[NSError errorWithDomain:NSCocoaErrorDomain code:NSUserCancelledError userInfo:nil]];
+
+  return nil;
+}
+
+/*!
+ * Passes the challenge on to the SDK, with the meter relaying its answer to
+ * the forwarded connection.
+ */
+- (void)connection:(NSURLConnection *)connection willSendRequestForAuthenticationChallenge:(NSURLAuthenticationChallenge *)challenge {
+
+  _challenge = challenge;
+
+  [[self client] URLProtocol:self didReceiveAuthenticationChallenge:[[NSURLAuthenticationChallenge alloc] initWithAuthenticationChallenge:challenge sender:self]];
+}
+
+- (void)connection:(NSURLConnection *)connection didReceiveResponse:(NSURLResponse *)response {
+
+  if ([response isKindOfClass:[NSHTTPURLResponse class]]) {
+    _response = (NSHTTPURLResponse *)response;
+  }
+
+  _receivedLength = 0;
+  _respondedAt    = KSMonotonicTime();
+
+  [[self client] URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+}
+
+- (void)connection:(NSURLConnection *)connection didReceiveData:(NSData *)data {
+  _receivedLength += [data length];
+  [[self client] URLProtocol:self didLoadData:data];
+}
+
+- (void)connectionDidFinishLoading:(NSURLConnection *)connection {
+
+  if (_response) {
+    _responseLength = [[self class] addResponse:_response bodyLength:_receivedLength];
+  }
+
+  [self traceWithError:nil];
+
+  _connection = nil;
+
+  [[self client] URLProtocolDidFinishLoading:self];
+}
+
+- (void)connection:(NSURLConnection *)connection didFailWithError:(NSError *)error {
+  [self traceWithError:error];
+  _connection = nil;
+  [[self client] URLProtocol:self didFailWithError:error];
+}
+
+- (NSCachedURLResponse *)connection:(NSURLConnection *)connection willCacheResponse:(NSCachedURLResponse *)cachedResponse {
+  return nil;
+}
+
+#pragma mark - NSURLAuthenticationChallengeSender
+
+- (void)useCredential:(NSURLCredential *)credential forAuthenticationChallenge:(NSURLAuthenticationChallenge *)challenge {
+  [[_challenge sender] useCredential:credential forAuthenticationChallenge:_challenge];
+  _challenge = nil;
+}
+
+- (void)continueWithoutCredentialForAuthenticationChallenge:(NSURLAuthenticationChallenge *)challenge {
+  [[_challenge sender] continueWithoutCredentialForAuthenticationChallenge:_challenge];
+  _challenge = nil;
+}
+
+- (void)cancelAuthenticationChallenge:(NSURLAuthenticationChallenge *)challenge {
+  [[_challenge sender] cancelAuthenticationChallenge:_challenge];
+  _challenge = nil;
+}
+
+- (void)performDefaultHandlingForAuthenticationChallenge:(NSURLAuthenticationChallenge *)challenge {
+
+  if ([[_challenge sender] respondsToSelector:@selector(performDefaultHandlingForAuthenticationChallenge:)]) {
+    [[_challenge sender] performDefaultHandlingForAuthenticationChallenge:_challenge];
+  } else {
+    [[_challenge sender] continueWithoutCredentialForAuthenticationChallenge:_challenge];
+  }
+
+  _challenge = nil;
+}
+
+- (void)rejectProtectionSpaceAndContinueWithChallenge:(NSURLAuthenticationChallenge *)challenge {
+
+  if ([[_challenge sender] respondsToSelector:@selector(rejectProtectionSpaceAndContinueWithChallenge:)]) {
+    [[_challenge sender] rejectProtectionSpaceAndContinueWithChallenge:_challenge];
+  } else {
+    [[_challenge sender] continueWithoutCredentialForAuthenticationChallenge:_challenge];
+  }
+
+  _challenge = nil;
+}
+
+@end
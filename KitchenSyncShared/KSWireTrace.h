@@ -0,0 +1,82 @@
+//
+//  KSWireTrace.h
+//  KitchenSyncShared
+//
+//
+
+#import <Foundation/Foundation.h>
+
+@class KSBenchmarkReport;
+
+/*!
+ * Per-request timings for the HTTP calls the SDKs make, to tell time spent
+ * inside an SDK from time spent on the wire.
+ *
+ * KSWireMeter reports every request it forwards: time to first byte (from
+ * handing the request to the URL loading system to the response headers),
+ * transfer (headers to last byte) and the bytes each way. NSURLConnection
+ * does not expose DNS or connect times, so the first request to each host
+ * while a trace is running also starts a probe that resolves the host and
+ * opens a TCP connection to it, timing each step. A request that had to open
+ * a connection carries that cost in its time to first byte. While KSStandIn
+ * is replaying or offline there is no probe: the DNS and connect phases
+ * stay empty and are reported with probe: skipped.
+ *
+ * SDKs with a hook around their own HTTP layer (an MSFilter on Azure,
+ * AFNetworking's operation notifications on StackMob) report the time from
+ * handing a request to that layer to getting its response back, so the
+ * report also shows what the SDK's HTTP stack adds on top of the wire.
+ *
+ *   [KSWireTrace start];
+ *   ... run a workload ...
+ *   [KSWireTrace addToReport:report operations:benchmark.histograms attributes:@{@"entity" : @"Foo"}];
+ *   [KSWireTrace stop];
+ */
+@interface KSWireTrace : NSObject
+
+/*!
+ * Installs KSWireMeter, throws away earlier samples and starts recording.
+ */
++ (void)start;
+
+/*!
+ * Stops recording. Samples are kept until the next start.
+ */
++ (void)stop;
+
++ (BOOL)isRecording;
+
+/*!
+ * Records one request seen on the wire. Times are KSMonotonicTime() values;
+ * respondedAt is 0 if no response arrived. Called by KSWireMeter.
+ */
++ (void)recordRequest:(NSURLRequest *)request
+            startedAt:(NSTimeInterval)startedAt
+          respondedAt:(NSTimeInterval)respondedAt
+           finishedAt:(NSTimeInterval)finishedAt
+            bytesSent:(unsigned long long)bytesSent
+        bytesReceived:(unsigned long long)bytesReceived
+                error:(NSError *)error;
+
+/*!
+ * Records one request as seen by an SDK's HTTP layer, e.g. "msfilter". Does
+ * nothing unless a trace is running.
+ */
++ (void)recordSDKRequestInLayer:(NSString *)layer
+                      startedAt:(NSTimeInterval)startedAt
+                     finishedAt:(NSTimeInterval)finishedAt
+                          error:(NSError *)error;
+
+/*!
+ * Adds a histogram per phase ("wire.dns", "wire.connect", "wire.ttfb",
+ * "wire.transfer", "wire.total" and one "sdk.<layer>" per hook) and a result
+ * row with request and byte counts to report.
+ *
+ * When operations is given, the row also compares the total time of those
+ * histograms with the time at least one request was on the wire: wire_share
+ * close to 1 means the operations were network bound, the rest
+ * (sdk_overhead_s) went to the SDK and the app.
+ */
++ (void)addToReport:(KSBenchmarkReport *)report operations:(NSArray *)operations attributes:(NSDictionary *)attributes;
+
+@end
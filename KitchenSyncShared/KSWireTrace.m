@@ -0,0 +1,381 @@
+//
+//  KSWireTrace.m
+//  KitchenSyncShared
+//
+//
+
+#import "KSWireTrace.h"
+#import "KSBenchmarkReport.h"
+#import "KSLatencyHistogram.h"
+#import "KSMonotonicClock.h"
+#import "KSStandIn.h"
+#import "KSWireMeter.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static NSString * const KSWireTraceErrorDomain = @"KSWireTraceErrorDomain";
+
+// Seconds a probe waits for its TCP connection.
+static const int KSWireTraceProbeTimeout = 10;
+
+static BOOL                 KSWireTraceRecording;
+static NSUInteger           KSWireTraceGeneration;
+static NSMutableDictionary *KSWireTraceHistograms;
+static NSMutableArray      *KSWireTraceSDKLayers;
+static NSMutableData       *KSWireTraceIntervals;
+static NSMutableSet        *KSWireTraceProbedHosts;
+static BOOL                 KSWireTraceProbeSkipped;
+static NSUInteger           KSWireTraceRequestCount;
+static NSUInteger           KSWireTraceFailedCount;
+static unsigned long long   KSWireTraceBytesSent;
+static unsigned long long   KSWireTraceBytesReceived;
+
+@interface KSWireTrace()
+
++ (KSLatencyHistogram *)histogramNamed:(NSString *)name;
++ (void)probeHost:(NSString *)host port:(NSNumber *)port generation:(NSUInteger)generation;
++ (void)recordProbePhase:(NSString *)name startedAt:(NSTimeInterval)startedAt succeeded:(BOOL)succeeded generation:(NSUInteger)generation;
+
+@end
+
+@implementation KSWireTrace
+
+#pragma mark - Recording
+
++ (void)start {
+
+  [KSWireMeter install];
+
+  @synchronized(self) {
+    KSWireTraceRecording     = YES;
+    KSWireTraceGeneration++;
+    KSWireTraceHistograms    = [NSMutableDictionary dictionary];
+    KSWireTraceSDKLayers     = [NSMutableArray array];
+    KSWireTraceIntervals     = [NSMutableData data];
+    KSWireTraceProbedHosts   = [NSMutableSet set];
+    KSWireTraceProbeSkipped  = NO;
+    KSWireTraceRequestCount  = 0;
+    KSWireTraceFailedCount   = 0;
+    KSWireTraceBytesSent     = 0;
+    KSWireTraceBytesReceived = 0;
+  }
+}
+
++ (void)stop {
+  @synchronized(self) {
+    KSWireTraceRecording = NO;
+  }
+}
+
++ (BOOL)isRecording {
+  @synchronized(self) {
+    return KSWireTraceRecording;
+  }
+}
+
+/*!
+ * Must be called while synchronized on the class.
+ */
++ (KSLatencyHistogram *)histogramNamed:(NSString *)name {
+
+  KSLatencyHistogram *histogram = KSWireTraceHistograms[name];
+
+  if (!histogram) {
+    histogram                   = [KSLatencyHistogram histogramWithName:name];
+    KSWireTraceHistograms[name] = histogram;
+  }
+
+  return histogram;
+}
+
++ (void)recordRequest:(NSURLRequest *)request
+            startedAt:(NSTimeInterval)startedAt
+          respondedAt:(NSTimeInterval)respondedAt
+           finishedAt:(NSTimeInterval)finishedAt
+            bytesSent:(unsigned long long)bytesSent
+        bytesReceived:(unsigned long long)bytesReceived
+                error:(NSError *)error {
+
+  NSURL *url         = [request URL];
+  NSString *host     = [[url host] lowercaseString];
+  NSNumber *port     = [url port] ?: ([[[url scheme] lowercaseString] isEqualToString:@"https"] ? @443 : @80);
+  NSString *endpoint = [NSString stringWithFormat:@"%@:%@", host, port];
+  BOOL probe         = NO;
+  NSUInteger generation;
+
+  // Replayed and offline runs must not reach the real backend, so their
+  // DNS and connect phases are left unmeasured.
+  BOOL skipProbe = [KSStandIn mode] == KSStandInModeReplay || [KSStandIn isOffline];
+
+  @synchronized(self) {
+
+    if (!KSWireTraceRecording) {
+      return;
+    }
+
+    generation = KSWireTraceGeneration;
+
+    KSWireTraceRequestCount++;
+    KSWireTraceBytesSent     += bytesSent;
+    KSWireTraceBytesReceived += bytesReceived;
+
+    NSTimeInterval interval[2] = {startedAt, finishedAt};
+
+    [KSWireTraceIntervals appendBytes:interval length:sizeof(interval)];
+
+    if (respondedAt > 0) {
+      [[self histogramNamed:@"wire.ttfb"] recordLatency:respondedAt - startedAt];
+    }
+
+    if (error) {
+      KSWireTraceFailedCount++;
+      [[self histogramNamed:@"wire.total"] recordError:error];
+    } else {
+      [[self histogramNamed:@"wire.transfer"] recordLatency:finishedAt - (respondedAt > 0 ? respondedAt : startedAt)];
+      [[self histogramNamed:@"wire.total"] recordLatency:finishedAt - startedAt];
+    }
+
+    if (host && skipProbe) {
+      KSWireTraceProbeSkipped = YES;
+    } else if (host && ![KSWireTraceProbedHosts containsObject:endpoint]) {
+      [KSWireTraceProbedHosts addObject:endpoint];
+      probe = YES;
+    }
+  }
+
+  if (probe) {
+
+    static dispatch_queue_t probeQueue;
+    static dispatch_once_t onceToken;
+
+    dispatch_once(&onceToken, ^{
+      probeQueue = dispatch_queue_create("com.kitchensync.wiretrace.probe", DISPATCH_QUEUE_SERIAL);
+    });
+
+    dispatch_async(probeQueue, ^{
+      [self probeHost:host port:port generation:generation];
+    });
+  }
+}
+
++ (void)recordSDKRequestInLayer:(NSString *)layer
+                      startedAt:(NSTimeInterval)startedAt
+                     finishedAt:(NSTimeInterval)finishedAt
+                          error:(NSError *)error {
+
+  @synchronized(self) {
+
+    if (!KSWireTraceRecording) {
+      return;
+    }
+
+    NSString *name = [@"sdk." stringByAppendingString:layer];
+
+    if (![KSWireTraceSDKLayers containsObject:name]) {
+      [KSWireTraceSDKLayers addObject:name];
+    }
+
+    if (error) {
+      [[self histogramNamed:name] recordError:error];
+    } else {
+      [[self histogramNamed:name] recordLatency:finishedAt - startedAt];
+    }
+  }
+}
+
+#pragma mark - DNS and connect probe
+
+/*!
+ * Resolves host and connects to the first address it resolves to. The
+ * system caches lookups, so once the SDK has resolved a host the DNS time
+ * is what a request pays on a warm device, not a cold one.
+ */
++ (void)probeHost:(NSString *)host port:(NSNumber *)port generation:(NSUInteger)generation {
+
+  struct addrinfo hints;
+  struct addrinfo *addresses = NULL;
+
+  memset(&hints, 0, sizeof(hints));
+
+  hints.ai_family   = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  NSTimeInterval resolvingAt = KSMonotonicTime();
+  int resolved               = getaddrinfo([host UTF8String], [[port stringValue] UTF8String], &hints, &addresses);
+
+  [self recordProbePhase:@"wire.dns" startedAt:resolvingAt succeeded:(resolved == 0 && addresses) generation:generation];
+
+  if (resolved != 0 || !addresses) {
+    return;
+  }
+
+  int fd = socket(addresses->ai_family, addresses->ai_socktype, addresses->ai_protocol);
+
+  if (fd >= 0) {
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    NSTimeInterval connectingAt = KSMonotonicTime();
+    BOOL connected              = connect(fd, addresses->ai_addr, addresses->ai_addrlen) == 0;
+
+    if (!connected && errno == EINPROGRESS) {
+
+      fd_set writable;
+      struct timeval timeout = {KSWireTraceProbeTimeout, 0};
+
+      FD_ZERO(&writable);
+      FD_SET(fd, &writable);
+
+      if (select(fd + 1, NULL, &writable, NULL, &timeout) == 1) {
+
+        int socketError  = 0;
+        socklen_t length = sizeof(socketError);
+
+        connected = getsockopt(fd, SOL_SOCKET, SO_ERROR, &socketError, &length) == 0 && socketError == 0;
+      }
+    }
+
+    [self recordProbePhase:@"wire.connect" startedAt:connectingAt succeeded:connected generation:generation];
+
+    close(fd);
+  }
+
+  freeaddrinfo(addresses);
+}
+
++ (void)recordProbePhase:(NSString *)name startedAt:(NSTimeInterval)startedAt succeeded:(BOOL)succeeded generation:(NSUInteger)generation {
+
+  NSTimeInterval finishedAt = KSMonotonicTime();
+
+  @synchronized(self) {
+
+    // A probe that outlived its trace must not leak into the next one.
+    if (generation != KSWireTraceGeneration) {
+      return;
+    }
+
+    if (succeeded) {
+      [[self histogramNamed:name] recordLatency:finishedAt - startedAt];
+    } else {
+      [[self histogramNamed:name] recordError:[NSError errorWithDomain:KSWireTraceErrorDomain
+                                                                  code:1
+                                                              userInfo:@{NSLocalizedDescriptionKey : [NSString stringWithFormat:@"%@ probe failed", name]}]];
+    }
+  }
+}
+
+#pragma mark - Reporting
+
++ (void)addToReport:(KSBenchmarkReport *)report operations:(NSArray *)operations attributes:(NSDictionary *)attributes {
+
+  NSMutableArray *histograms = [NSMutableArray array];
+  NSData *intervals          = nil;
+  NSUInteger requests, failed;
+  unsigned long long bytesSent, bytesReceived;
+  BOOL probeSkipped;
+
+  @synchronized(self) {
+
+    probeSkipped = KSWireTraceProbeSkipped;
+
+    if (probeSkipped) {
+      [self histogramNamed:@"wire.dns"];
+      [self histogramNamed:@"wire.connect"];
+    }
+
+    NSArray *names = [@[@"wire.dns", @"wire.connect", @"wire.ttfb", @"wire.transfer", @"wire.total"] arrayByAddingObjectsFromArray:KSWireTraceSDKLayers];
+
+    for (NSString *name in names) {
+      if (KSWireTraceHistograms[name]) {
+        [histograms addObject:KSWireTraceHistograms[name]];
+      }
+    }
+
+    intervals     = [KSWireTraceIntervals copy];
+    requests      = KSWireTraceRequestCount;
+    failed        = KSWireTraceFailedCount;
+    bytesSent     = KSWireTraceBytesSent;
+    bytesReceived = KSWireTraceBytesReceived;
+  }
+
+  NSMutableDictionary *probeAttributes = [NSMutableDictionary dictionaryWithDictionary:attributes ?: @{}];
+
+  if (probeSkipped) {
+    probeAttributes[@"probe"] = @"skipped";
+  }
+
+  for (KSLatencyHistogram *histogram in histograms) {
+    BOOL probed = [histogram.name isEqualToString:@"wire.dns"] || [histogram.name isEqualToString:@"wire.connect"];
+    [report addHistogram:histogram withAttributes:(probed ? probeAttributes : attributes)];
+  }
+
+  // Time at least one request was in flight: overlapping requests only
+  // count once.
+  NSUInteger intervalCount = [intervals length] / (2 * sizeof(NSTimeInterval));
+  NSTimeInterval *sorted   = malloc(MAX([intervals length], 1));
+  NSTimeInterval busy      = 0;
+
+  memcpy(sorted, [intervals bytes], [intervals length]);
+
+  qsort_b(sorted, intervalCount, 2 * sizeof(NSTimeInterval), ^int(const void *a, const void *b) {
+    NSTimeInterval left  = ((const NSTimeInterval *)a)[0];
+    NSTimeInterval right = ((const NSTimeInterval *)b)[0];
+    return left < right ? -1 : (left > right ? 1 : 0);
+  });
+
+  NSTimeInterval busyStart = 0;
+  NSTimeInterval busyEnd   = 0;
+
+  for (NSUInteger i = 0; i < intervalCount; i++) {
+
+    NSTimeInterval start = sorted[2 * i];
+    NSTimeInterval end   = sorted[2 * i + 1];
+
+    if (i == 0 || start > busyEnd) {
+      busy      += busyEnd - busyStart;
+      busyStart  = start;
+      busyEnd    = end;
+    } else {
+      busyEnd = MAX(busyEnd, end);
+    }
+  }
+
+  busy += busyEnd - busyStart;
+
+  free(sorted);
+
+  NSMutableDictionary *result = [NSMutableDictionary dictionaryWithDictionary:attributes ?: @{}];
+
+  result[@"requests"]                   = @(requests);
+  result[@"failed_requests"]            = @(failed);
+  result[@"bytes_sent"]                 = @(bytesSent);
+  result[@"bytes_received"]             = @(bytesReceived);
+  result[@"bytes_sent_per_request"]     = @(requests > 0 ? (double)bytesSent / requests : 0);
+  result[@"bytes_received_per_request"] = @(requests > 0 ? (double)bytesReceived / requests : 0);
+  result[@"wire_busy_s"]                = @(busy);
+
+  if (probeSkipped) {
+    result[@"probe"] = @"skipped";
+  }
+
+  if (operations) {
+
+    NSTimeInterval operationTime = 0;
+
+    for (KSLatencyHistogram *histogram in operations) {
+      operationTime += histogram.mean * histogram.count;
+    }
+
+    result[@"operation_s"]    = @(operationTime);
+    result[@"wire_share"]     = @(operationTime > 0 ? MIN(busy / operationTime, 1.0) : 0);
+    result[@"sdk_overhead_s"] = @(MAX(operationTime - busy, 0));
+  }
+
+  [report addResult:result];
+}
+
+@end
@@ -0,0 +1,19 @@
+//
+//  KitchenSyncStackmobBenchmarks.h
+//  KitchenSyncStackmobTests
+//
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+#import "StackMob.h"
+
+/*!
+ * Performance benchmarks for the StackMob SDK. They only run when
+ * RunBenchmarks is set in StackMobConfiguration.plist, and write a JSON
+ * report per run.
+ */
+@interface KitchenSyncStackmobBenchmarks : SenTestCase
+
+@property (nonatomic, strong) SMClient *client;
+
+@end
@@ -0,0 +1,1543 @@
+//
+//  KitchenSyncStackmobBenchmarks.m
+//  KitchenSyncStackmobTests
+//
+//
+
+#import "KitchenSyncStackmobBenchmarks.h"
+#import "StackMobConfigurator.h"
+#import "StackMobAdapter.h"
+#import "KSBenchmarkReport.h"
+#import "KSBenchmarkSettings.h"
+#import "KSAdapterWorkloads.h"
+#import "KSCRUDBenchmark.h"
+#import "KSWireTrace.h"
+#import "KSMonotonicClock.h"
+#import "KSLoadGenerator.h"
+#import "KSBulkDeleter.h"
+#import "KSBatchWriteBenchmark.h"
+#import "KSPayloadScalingBenchmark.h"
+#import "KSStartupBenchmark.h"
+#import "KSCoreDataBenchmark.h"
+#import "KSCachePolicyBenchmark.h"
+#import "KSCompletionWaiter.h"
+#import "KSLatencyHistogram.h"
+#import "KSMemoryFootprint.h"
+#import "KSAggregationBenchmark.h"
+#import "KSGeoQueryBenchmark.h"
+#import "KSQueryShapeBenchmark.h"
+#import "KSQueryCacheBenchmark.h"
+#import "KSConnectionReuseBenchmark.h"
+#import "KSFaultInjectionBenchmark.h"
+#import "KSRunNamespace.h"
+#import "KSProjectionBenchmark.h"
+
+static NSUInteger const KSIncrementalStoreSaveBatchSize = 100;
+
+@interface KitchenSyncStackmobBenchmarks()
+
+@property (nonatomic, strong) KSBenchmarkSettings *settings;
+@property (nonatomic, copy) NSArray *incrementalStoreRowCounts;
+@property (nonatomic, assign) NSUInteger incrementalStoreFetches;
+@property (nonatomic, strong) KSAdapterWorkloads *workloads;
+@property (nonatomic, copy) NSArray *operationObservers;
+
+- (void)configureBackend;
+- (void)configureWorkloadsWithAdapter:(id<KSProviderAdapter>)adapter;
+- (void)observeHTTPOperations;
+- (void)stopObservingHTTPOperations;
+- (KSLoadGenerator *)runCreateLoadWithBenchmark:(KSCRUDBenchmark *)benchmark workers:(NSUInteger)workers;
+- (SMCoreDataStore *)cachingCoreDataStore;
+- (KSCachePolicyBenchmark *)cachePolicyBenchmarkForEntity:(NSString *)entityName field:(NSString *)field;
+- (KSProjectionBenchmark *)projectionBenchmarkForEntity:(NSString *)entityName field:(NSString *)field;
+- (BOOL)saveBarsInContext:(NSManagedObjectContext *)context upTo:(NSUInteger)rows barIds:(NSMutableArray *)barIds save:(KSLatencyHistogram *)save;
+- (NSArray *)executeFetchRequest:(NSFetchRequest *)fetchRequest inContext:(NSManagedObjectContext *)context returnManagedObjectIDs:(BOOL)returnIDs seconds:(NSTimeInterval *)seconds error:(NSError **)error;
+- (NSUInteger)timeIncrementalStoreFetchesInStore:(SMCoreDataStore *)coreDataStore context:(NSManagedObjectContext *)context rows:(NSUInteger)rows report:(KSBenchmarkReport *)report;
+- (KSAggregationBenchmark *)aggregationBenchmarkForEntity:(NSString *)entityName field:(NSString *)field;
+- (KSGeoQueryBenchmark *)geoQueryBenchmarkForEntity:(NSString *)entityName field:(NSString *)field;
+- (KSQueryShapeBenchmark *)queryShapeBenchmarkForEntity:(NSString *)entityName field:(NSString *)field;
+- (KSQueryCacheBenchmark *)queryCacheBenchmarkForEntity:(NSString *)entityName field:(NSString *)field;
+- (KSConnectionReuseBenchmark *)connectionReuseBenchmarkForEntity:(NSString *)entityName field:(NSString *)field;
+- (KSFaultInjectionBenchmark *)faultInjectionBenchmarkForEntity:(NSString *)entityName field:(NSString *)field;
+- (KSStartupBenchmark *)startupBenchmark;
+- (void)runBenchmark:(NSString *)benchmark test:(SEL)test block:(KSBenchmarkBlock)block;
+
+@end
+
+@implementation KitchenSyncStackmobBenchmarks
+
+#pragma mark - Setup and Init
+
+- (void)setUp {
+
+  [super setUp];
+
+  NSDictionary *stackmobAppConfiguration = [[StackMobConfigurator sharedInstance] applicationConfiguration];
+
+  _settings = [KSBenchmarkSettings settingsWithConfiguration:stackmobAppConfiguration];
+
+  _incrementalStoreRowCounts = stackmobAppConfiguration[@"IncrementalStoreRowCounts"];
+  _incrementalStoreFetches   = [stackmobAppConfiguration[@"IncrementalStoreFetches"] unsignedIntegerValue];
+
+  if ([_incrementalStoreRowCounts count] == 0) {
+    _incrementalStoreRowCounts = @[@1000, @5000];
+  }
+
+  if (_incrementalStoreFetches == 0) {
+    _incrementalStoreFetches = 3;
+  }
+}
+
+/*!
+ * Uses the secure or open application depending on UseSecure, with the same
+ * production/development key selection as the functional tests.
+ */
+- (void)configureBackend {
+
+  NSDictionary *stackmobAppConfiguration = [[StackMobConfigurator sharedInstance] applicationConfiguration];
+
+  NSString *prefix      = [stackmobAppConfiguration[@"UseSecure"] boolValue] ? @"Secure" : @"Open";
+  NSString *environment = [stackmobAppConfiguration[@"UseProduction"] boolValue] ? @"Production" : @"Development";
+
+  NSString *apiVersion = stackmobAppConfiguration[[NSString stringWithFormat:@"%@%@APIVersion", prefix, environment]];
+  NSString *publicKey  = stackmobAppConfiguration[[NSString stringWithFormat:@"%@%@PublicKey", prefix, environment]];
+
+  _client = [[SMClient alloc] initWithAPIVersion:apiVersion publicKey:publicKey];
+
+  [self observeHTTPOperations];
+  [self configureWorkloadsWithAdapter:[[StackMobAdapter alloc] initWithClient:_client]];
+}
+
+/*!
+ * The shared workloads, run through the adapter with this suite's settings.
+ */
+- (void)configureWorkloadsWithAdapter:(id<KSProviderAdapter>)adapter {
+
+  _workloads = [[KSAdapterWorkloads alloc] initWithAdapter:adapter];
+
+  _workloads.iterations         = _settings.iterations;
+  _workloads.timeout            = _settings.testTimeout;
+  _workloads.batchSizes         = _settings.batchSizes;
+  _workloads.cleanupConcurrency = _settings.teardownConcurrency;
+  _workloads.payloadIterations  = _settings.payloadIterations;
+  _workloads.payloadSizes       = _settings.payloadSizes;
+  _workloads.payloadFieldCounts = _settings.payloadFieldCounts;
+}
+
+/*!
+ * Times every AFNetworking operation the SDK runs, from its start to its
+ * finish notification, so wire traces show what the SDK's HTTP layer adds to
+ * the wire time. AFNetworking posts both on the main queue, which the
+ * benchmarks keep servicing while they wait.
+ */
+- (void)observeHTTPOperations {
+
+  NSNotificationCenter *center = [NSNotificationCenter defaultCenter];
+  NSMapTable *startedAt        = [NSMapTable weakToStrongObjectsMapTable];
+
+  [self stopObservingHTTPOperations];
+
+  id started = [center addObserverForName:AFNetworkingOperationDidStartNotification object:nil queue:nil usingBlock:^(NSNotification *notification) {
+    @synchronized(startedAt) {
+      [startedAt setObject:@(KSMonotonicTime()) forKey:[notification object]];
+    }
+  }];
+
+  id finished = [center addObserverForName:AFNetworkingOperationDidFinishNotification object:nil queue:nil usingBlock:^(NSNotification *notification) {
+
+    AFURLConnectionOperation *operation = [notification object];
+    NSNumber *operationStartedAt        = nil;
+
+    @synchronized(startedAt) {
+      operationStartedAt = [startedAt objectForKey:operation];
+      [startedAt removeObjectForKey:operation];
+    }
+
+    if (operationStartedAt) {
+      [KSWireTrace recordSDKRequestInLayer:@"afnetworking"
+                                 startedAt:[operationStartedAt doubleValue]
+                                finishedAt:KSMonotonicTime()
+                                     error:operation.error];
+    }
+  }];
+
+  _operationObservers = @[started, finished];
+}
+
+- (void)stopObservingHTTPOperations {
+
+  for (id observer in _operationObservers) {
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+  }
+
+  _operationObservers = nil;
+}
+
+#pragma mark - Teardown
+
+- (void)tearDown {
+  [self stopObservingHTTPOperations];
+  [super tearDown];
+}
+
+#pragma mark - Benchmark utilities
+
+/*!
+ * Runs the benchmark's create block with the given number of concurrent
+ * workers for LoadDuration seconds, then deletes what it created.
+ */
+- (KSLoadGenerator *)runCreateLoadWithBenchmark:(KSCRUDBenchmark *)benchmark workers:(NSUInteger)workers {
+
+  KSLoadGenerator *generator        = [KSLoadGenerator generatorWithName:[NSString stringWithFormat:@"%@.create", benchmark.entity] workers:workers];
+  KSBenchmarkIterationBlock create  = benchmark.createBlock;
+  KSBenchmarkObjectBlock remove     = benchmark.deleteBlock;
+  NSMutableArray *created           = [NSMutableArray array];
+
+  generator.targetRate       = _settings.loadTargetRate;
+  generator.duration         = _settings.loadDuration;
+  generator.operationTimeout = _settings.testTimeout;
+
+  BOOL drained = [generator runWithBlock:^(NSUInteger sequence, KSBenchmarkCompletion done) {
+    create(sequence, ^(id result, NSError *error) {
+
+      if (result && !error) {
+        @synchronized(created) {
+          [created addObject:result];
+        }
+      }
+
+      done(result, error);
+    });
+  }];
+
+  STAssertTrue(drained, @"%@ still had operations outstanding", generator.name);
+
+  NSArray *createdObjects = nil;
+
+  @synchronized(created) {
+    createdObjects = [created copy];
+  }
+
+  KSBulkDeleter *deleter = [KSBulkDeleter deleterWithConfiguration:[[StackMobConfigurator sharedInstance] applicationConfiguration]];
+
+  [deleter deleteItems:createdObjects withBlock:^(id object, KSBulkDeleteCompletion done) {
+    remove(object, 0, ^(id result, NSError *error) {
+      done(error);
+    });
+  }];
+
+  // Everything the run created goes at once, so allow a timeout per round
+  // of deletes.
+  NSTimeInterval timeout = _settings.testTimeout * MAX(1, [createdObjects count] / deleter.maxConcurrentDeletes);
+  NSString *failure      = [deleter waitAndReportNamed:generator.name timeout:timeout];
+
+  if (failure) {
+    NSLog(@"%@; %lu objects left behind", failure, (unsigned long)(createdObjects.count - deleter.deletedCount));
+  }
+
+  return generator;
+}
+
+/*!
+ * A Core Data store on the client with the SDK's cache turned on, whatever
+ * CachePolicy the functional tests run with.
+ */
+- (SMCoreDataStore *)cachingCoreDataStore {
+
+  BOOL cacheEnabled = SM_CACHE_ENABLED;
+
+  // The flag is read when the store is created; leave it as the tests had it.
+  SM_CACHE_ENABLED = YES;
+
+  SMCoreDataStore *coreDataStore = [_client coreDataStoreWithManagedObjectModel:[NSManagedObjectModel mergedModelFromBundles:nil]];
+
+  SM_CACHE_ENABLED = cacheEnabled;
+
+  return coreDataStore;
+}
+
+/*!
+ * Fetches one managed object through SMCoreDataStore under each
+ * SMCachePolicy. Objects are created and written through SMDataStore, so
+ * writes bypass the incremental store's cache, and the context is reset
+ * before every fetch so values come from the store rather than from objects
+ * the context already holds. The entity's primary key attribute is
+ * <entity>Id.
+ */
+- (KSCachePolicyBenchmark *)cachePolicyBenchmarkForEntity:(NSString *)entityName field:(NSString *)field {
+
+  NSString *schema                  = [entityName lowercaseString];
+  NSString *schemaField             = [field lowercaseString];
+  NSString *primaryKey              = [NSString stringWithFormat:@"%@_id", schema];
+  NSString *primaryKeyAttribute     = [NSString stringWithFormat:@"%@Id", schema];
+  KSCachePolicyBenchmark *benchmark = [[KSCachePolicyBenchmark alloc] initWithEntity:entityName iterations:_settings.iterations];
+  KSCRUDBenchmark *crud             = [_workloads crudBenchmarkForEntity:entityName field:field];
+  SMDataStore *dataStore            = [_client dataStore];
+  SMCoreDataStore *coreDataStore    = [self cachingCoreDataStore];
+  NSManagedObjectContext *context   = [coreDataStore contextForCurrentThread];
+
+  benchmark.timeout     = _settings.testTimeout;
+  benchmark.createBlock = crud.createBlock;
+  benchmark.deleteBlock = crud.deleteBlock;
+
+  [benchmark addPolicy:SMCachePolicyTryNetworkOnly named:@"TryNetworkOnly"];
+  [benchmark addPolicy:SMCachePolicyTryCacheOnly named:@"TryCacheOnly"];
+  [benchmark addPolicy:SMCachePolicyTryNetworkElseCache named:@"TryNetworkElseCache"];
+  [benchmark addPolicy:SMCachePolicyTryCacheElseNetwork named:@"TryCacheElseNetwork"];
+
+  benchmark.readBlock = ^(NSInteger policy, NSDictionary *object, KSBenchmarkCompletion done) {
+
+    NSFetchRequest *fetchRequest = [NSFetchRequest fetchRequestWithEntityName:entityName];
+
+    [fetchRequest setPredicate:[NSPredicate predicateWithFormat:@"%K == %@", primaryKeyAttribute, object[primaryKey]]];
+
+    coreDataStore.cachePolicy = (SMCachePolicy)policy;
+
+    [context reset];
+    [context executeFetchRequest:fetchRequest onSuccess:^(NSArray *results) {
+      done([[results lastObject] valueForKey:field], nil);
+    } onFailure:^(NSError *error) {
+      done(nil, error);
+    }];
+  };
+
+  benchmark.writeBlock = ^(NSDictionary *object, NSString *value, KSBenchmarkCompletion done) {
+    [dataStore updateObjectWithId:object[primaryKey] inSchema:schema update:@{schemaField : value} onSuccess:^(NSDictionary *theObject, NSString *schema) {
+      done(theObject, nil);
+    } onFailure:^(NSError *theError, NSDictionary *theObject, NSString *schema) {
+      done(nil, theError);
+    }];
+  };
+
+  benchmark.clearCacheBlock = ^(NSInteger policy) {
+    [coreDataStore resetCache];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Inserts Bars through the incremental store until barIds holds rows of them,
+ * saving every 100 and resetting the context after each save. Values are
+ * tagged with the run and numbered after "incremental-", so the fetches find
+ * exactly these Bars with a range on barParameter. Returns NO if a save
+ * failed; its ids are kept anyway so the cleanup tries them.
+ */
+- (BOOL)saveBarsInContext:(NSManagedObjectContext *)context upTo:(NSUInteger)rows barIds:(NSMutableArray *)barIds save:(KSLatencyHistogram *)save {
+
+  KSRunNamespace *runNamespace = [KSRunNamespace currentNamespace];
+
+  while ([barIds count] < rows) {
+
+    @autoreleasepool {
+
+      NSUInteger count         = MIN(KSIncrementalStoreSaveBatchSize, rows - [barIds count]);
+      NSMutableArray *batchIds = [NSMutableArray arrayWithCapacity:count];
+
+      for (NSUInteger i = 0; i < count; i++) {
+
+        NSManagedObject *bar = [NSEntityDescription insertNewObjectForEntityForName:@"Bar" inManagedObjectContext:context];
+        NSString *barId      = [bar assignObjectId];
+        NSString *value      = [NSString stringWithFormat:@"incremental-%08lu", (unsigned long)([barIds count] + i)];
+
+        [bar setValue:[runNamespace tagValue:value] forKey:@"barParameter"];
+        [bar setValue:barId forKey:[bar primaryKeyField]];
+
+        [batchIds addObject:barId];
+      }
+
+      KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
+      __block NSTimeInterval end = 0;
+      __block NSError *failure   = nil;
+      NSTimeInterval start       = KSMonotonicTime();
+
+      [context saveOnSuccess:^{
+        end = KSMonotonicTime();
+        [waiter signal];
+      } onFailure:^(NSError *error) {
+        failure = error;
+        [waiter signal];
+      }];
+
+      BOOL completed = [waiter waitWithTimeout:_settings.testTimeout];
+
+      [barIds addObjectsFromArray:batchIds];
+
+      if (!completed || failure) {
+        [save recordError:failure];
+        NSLog(@"StackMob Bar save failed at %lu rows: %@", (unsigned long)[barIds count], completed ? [failure localizedDescription] : @"timed out");
+        return NO;
+      }
+
+      [save recordLatency:end - start];
+
+      // The Bars live on StackMob now; only the fetches should bring them back.
+      [context reset];
+    }
+  }
+
+  return YES;
+}
+
+/*!
+ * Runs fetchRequest on context and waits for it. Returns the results, or nil
+ * with error set if the fetch failed (left nil if it timed out); seconds is
+ * the time until the SDK called back.
+ */
+- (NSArray *)executeFetchRequest:(NSFetchRequest *)fetchRequest inContext:(NSManagedObjectContext *)context returnManagedObjectIDs:(BOOL)returnIDs seconds:(NSTimeInterval *)seconds error:(NSError **)error {
+
+  KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
+  __block NSTimeInterval end = 0;
+  __block NSArray *fetched   = nil;
+  __block NSError *failure   = nil;
+  NSTimeInterval start       = KSMonotonicTime();
+
+  [context executeFetchRequest:fetchRequest returnManagedObjectIDs:returnIDs onSuccess:^(NSArray *results) {
+    end     = KSMonotonicTime();
+    fetched = results;
+    [waiter signal];
+  } onFailure:^(NSError *theError) {
+    failure = theError;
+    [waiter signal];
+  }];
+
+  if (![waiter waitWithTimeout:_settings.testTimeout] || !fetched) {
+    if (error) {
+      *error = failure;
+    }
+    return nil;
+  }
+
+  *seconds = end - start;
+
+  return fetched;
+}
+
+/*!
+ * Fetches every Bar the benchmark saved, IncrementalStoreFetches times each
+ * way, starting from an empty context:
+ *
+ * - fetch_objects and fetch_object_ids go to the network
+ *   (SMCachePolicyTryNetworkOnly) and return managed objects or only their
+ *   ids.
+ * - cache_fill runs under SMCachePolicyTryCacheElseNetwork after the cache
+ *   was reset, so it misses, fetches and writes the results to the cache;
+ *   cache_hit then reads them back from it.
+ *
+ * A last fetch measures the heap its results hold on to: as returned
+ * (faulted_bytes), after barParameter was read on each of them
+ * (materialized_bytes), and as object ids. Returns the number of failed
+ * fetches.
+ */
+- (NSUInteger)timeIncrementalStoreFetchesInStore:(SMCoreDataStore *)coreDataStore context:(NSManagedObjectContext *)context rows:(NSUInteger)rows report:(KSBenchmarkReport *)report {
+
+  KSRunNamespace *runNamespace = [KSRunNamespace currentNamespace];
+  NSFetchRequest *fetchRequest = [NSFetchRequest fetchRequestWithEntityName:@"Bar"];
+  NSDictionary *attributes     = @{@"rows" : @(rows)};
+  __block NSUInteger fetched   = 0;
+  __block NSUInteger errors    = 0;
+
+  // '.' sorts right after '-', so this covers every "incremental-" value.
+  [fetchRequest setPredicate:[NSPredicate predicateWithFormat:@"barParameter >= %@ AND barParameter < %@",
+                              [runNamespace tagValue:@"incremental-"], [runNamespace tagValue:@"incremental."]]];
+
+  KSLatencyHistogram *objects   = [KSLatencyHistogram histogramWithName:@"Bar.fetch_objects"];
+  KSLatencyHistogram *objectIDs = [KSLatencyHistogram histogramWithName:@"Bar.fetch_object_ids"];
+  KSLatencyHistogram *fill      = [KSLatencyHistogram histogramWithName:@"Bar.cache_fill"];
+  KSLatencyHistogram *hit       = [KSLatencyHistogram histogramWithName:@"Bar.cache_hit"];
+
+  void (^timeFetch)(KSLatencyHistogram *, SMCachePolicy, BOOL) = ^(KSLatencyHistogram *histogram, SMCachePolicy policy, BOOL returnIDs) {
+
+    @autoreleasepool {
+
+      NSTimeInterval seconds = 0;
+      NSError *error         = nil;
+
+      coreDataStore.cachePolicy = policy;
+
+      [context reset];
+
+      NSArray *results = [self executeFetchRequest:fetchRequest inContext:context returnManagedObjectIDs:returnIDs seconds:&seconds error:&error];
+
+      if (results) {
+        [histogram recordLatency:seconds];
+        fetched = [results count];
+      } else {
+        [histogram recordError:error];
+        errors++;
+        NSLog(@"%@ at %lu rows failed: %@", histogram.name, (unsigned long)rows, error ? [error localizedDescription] : @"timed out");
+      }
+    }
+  };
+
+  for (NSUInteger i = 0; i < _incrementalStoreFetches; i++) {
+
+    timeFetch(objects, SMCachePolicyTryNetworkOnly, NO);
+    timeFetch(objectIDs, SMCachePolicyTryNetworkOnly, YES);
+
+    [coreDataStore resetCache];
+
+    timeFetch(fill, SMCachePolicyTryCacheElseNetwork, NO);
+    timeFetch(hit, SMCachePolicyTryCacheElseNetwork, NO);
+  }
+
+  for (KSLatencyHistogram *histogram in @[objects, objectIDs, fill, hit]) {
+    [report addHistogram:histogram withAttributes:attributes];
+  }
+
+  NSMutableDictionary *result = [@{@"rows"                   : @(rows),
+                                   @"objects_fetched"        : @(fetched),
+                                   @"fetch_objects_p50_s"    : @([objects percentile:50]),
+                                   @"fetch_object_ids_p50_s" : @([objectIDs percentile:50]),
+                                   @"cache_fill_p50_s"       : @([fill percentile:50]),
+                                   @"cache_hit_p50_s"        : @([hit percentile:50]),
+                                   @"cache_fill_overhead_s"  : @([fill percentile:50] - [objects percentile:50])} mutableCopy];
+
+  NSTimeInterval seconds = 0;
+  NSError *error         = nil;
+  NSArray *results       = nil;
+  NSUInteger faults      = 0;
+
+  coreDataStore.cachePolicy = SMCachePolicyTryNetworkOnly;
+
+  [context reset];
+
+  unsigned long long before = KSHeapBytesInUse();
+
+  @autoreleasepool {
+    results = [self executeFetchRequest:fetchRequest inContext:context returnManagedObjectIDs:NO seconds:&seconds error:&error];
+  }
+
+  unsigned long long faulted = KSHeapBytesInUse();
+
+  for (NSManagedObject *object in results) {
+    if ([object isFault]) {
+      faults++;
+    }
+  }
+
+  @autoreleasepool {
+    for (NSManagedObject *object in results) {
+      [object valueForKey:@"barParameter"];
+    }
+  }
+
+  unsigned long long materialized = KSHeapBytesInUse();
+
+  if (results) {
+    result[@"faults"]             = @(faults);
+    result[@"faulted_bytes"]      = @((long long)(faulted - before));
+    result[@"materialized_bytes"] = @((long long)(materialized - before));
+  } else {
+    errors++;
+  }
+
+  results = nil;
+
+  [context reset];
+
+  before = KSHeapBytesInUse();
+
+  @autoreleasepool {
+    results = [self executeFetchRequest:fetchRequest inContext:context returnManagedObjectIDs:YES seconds:&seconds error:&error];
+  }
+
+  if (results) {
+    result[@"object_ids_bytes"] = @((long long)(KSHeapBytesInUse() - before));
+  } else {
+    errors++;
+  }
+
+  results = nil;
+
+  [context reset];
+  [report addResult:result];
+
+  NSLog(@"StackMob incremental store: %lu Bars fetched in %.3fs as objects, %.3fs as ids, %.3fs filling the cache, %.3fs from it",
+        (unsigned long)fetched, [objects percentile:50], [objectIDs percentile:50], [fill percentile:50], [hit percentile:50]);
+
+  return errors;
+}
+
+/*!
+ * Projects with -restrictReturnedFieldsTo: and expands with -setExpandDepth:
+ * on a datastore read by id. Each foo keeps the id of a bar of its own in
+ * bar; StackMob only expands it where the foo schema declares bar as a
+ * relationship to bar, and returns the plain id otherwise.
+ */
+- (KSProjectionBenchmark *)projectionBenchmarkForEntity:(NSString *)entityName field:(NSString *)field {
+
+  NSString *schema                 = [entityName lowercaseString];
+  NSString *primaryKey             = [NSString stringWithFormat:@"%@_id", schema];
+  KSProjectionBenchmark *benchmark = [[KSProjectionBenchmark alloc] initWithEntity:entityName field:field iterations:_settings.iterations];
+  KSCRUDBenchmark *crud            = [_workloads crudBenchmarkForEntity:entityName field:field];
+  id<KSProviderAdapter> adapter    = _workloads.adapter;
+  SMDataStore *dataStore           = [_client dataStore];
+  NSString *runTag                 = [[KSRunNamespace currentNamespace] tagValue:[[NSProcessInfo processInfo] globallyUniqueString]];
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.fieldCount         = _settings.projectionFieldCount;
+  benchmark.linkField          = @"bar";
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  benchmark.createBlock = ^(NSDictionary *fields, KSBenchmarkCompletion done) {
+    [adapter createObjectInEntity:entityName fields:fields completion:done];
+  };
+
+  benchmark.linkBlock = ^(NSUInteger iteration, KSBenchmarkCompletion done) {
+    [adapter createObjectInEntity:@"Bar"
+                           fields:@{@"barParameter" : [NSString stringWithFormat:@"%@-%lu", runTag, (unsigned long)iteration]}
+                       completion:^(NSDictionary *bar, NSError *error) {
+                         done(bar[@"bar_id"], error);
+                       }];
+  };
+
+  benchmark.linkDeleteBlock = ^(NSString *barId, NSUInteger iteration, KSBenchmarkCompletion done) {
+    [dataStore deleteObjectId:barId inSchema:@"bar" onSuccess:^(NSString *theObjectId, NSString *schema) {
+      done(theObjectId, nil);
+    } onFailure:^(NSError *theError, NSString *theObjectId, NSString *schema) {
+      done(nil, theError);
+    }];
+  };
+
+  benchmark.readBlock = ^(NSDictionary *object, NSArray *fields, NSUInteger depth, KSBenchmarkCompletion done) {
+
+    SMRequestOptions *options = [SMRequestOptions options];
+
+    if (fields) {
+      [options restrictReturnedFieldsTo:[fields valueForKey:@"lowercaseString"]];
+    }
+
+    // StackMob expands at most three levels.
+    if (depth > 0) {
+      [options setExpandDepth:MIN(depth, 3)];
+    }
+
+    [dataStore readObjectWithId:object[primaryKey] inSchema:schema options:options onSuccess:^(NSDictionary *theObject, NSString *schema) {
+      done(theObject, nil);
+    } onFailure:^(NSError *theError, NSString *theObjectId, NSString *schema) {
+      done(nil, theError);
+    }];
+  };
+
+  benchmark.fieldCountBlock = ^NSUInteger(NSDictionary *object) {
+    return [object count];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * StackMob counts on the server with -performCount: and has no sum, min, max
+ * or average, so those only run as the client fold. Pages restrict the
+ * returned fields to the value field and go by -fromIndex:toIndex:, ordered
+ * by the primary key. The foo schema needs a foovalue integer field.
+ */
+- (KSAggregationBenchmark *)aggregationBenchmarkForEntity:(NSString *)entityName field:(NSString *)field {
+
+  NSString *schema                  = [entityName lowercaseString];
+  KSAggregationBenchmark *benchmark = [[KSAggregationBenchmark alloc] initWithEntity:entityName field:field valueField:@"fooValue" iterations:_settings.aggregationIterations];
+  KSCRUDBenchmark *crud             = [_workloads crudBenchmarkForEntity:entityName field:field];
+  id<KSProviderAdapter> adapter     = _workloads.adapter;
+  SMDataStore *dataStore            = [_client dataStore];
+  NSString *queryField              = [field lowercaseString];
+  NSString *valueField              = [benchmark.valueField lowercaseString];
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.rowCount           = _settings.aggregationRowCount;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.serverFunctions    = @[KSAggregateCount];
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  benchmark.seedBlock = ^(NSArray *fieldsList, KSBenchmarkCompletion done) {
+    [adapter createObjectsInEntity:entityName fieldsList:fieldsList completion:done];
+  };
+
+  benchmark.valueBlock = ^NSNumber *(NSDictionary *object) {
+    return object[valueField];
+  };
+
+  benchmark.pageBlock = ^(NSString *tag, NSDictionary *lastObject, NSUInteger offset, NSUInteger limit, KSPageCompletion done) {
+
+    SMQuery *query            = [[SMQuery alloc] initWithSchema:schema];
+    SMRequestOptions *options = [SMRequestOptions options];
+
+    [query where:queryField isEqualTo:tag];
+    [query orderByField:[NSString stringWithFormat:@"%@_id", schema] ascending:YES];
+    [query fromIndex:offset toIndex:offset + limit - 1];
+
+    [options restrictReturnedFieldsTo:@[valueField]];
+
+    [dataStore performQuery:query options:options onSuccess:^(NSArray *results) {
+      done(results, nil);
+    } onFailure:^(NSError *error) {
+      done(nil, error);
+    }];
+  };
+
+  benchmark.serverBlock = ^(NSString *tag, NSString *function, KSBenchmarkCompletion done) {
+
+    SMQuery *query = [[SMQuery alloc] initWithSchema:schema];
+
+    [query where:queryField isEqualTo:tag];
+
+    [dataStore performCount:query onSuccess:^(NSNumber *count) {
+      done(count, nil);
+    } onFailure:^(NSError *error) {
+      done(nil, error);
+    }];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Foo objects keep an SMGeoPoint in location, which the foo schema needs to
+ * declare as a geopoint field. Radius queries use
+ * -where:isWithin:kilometersOf:, box queries
+ * -where:isWithinBoundsWithSWCorner:andNECorner:, both limited with
+ * -fromIndex:toIndex:.
+ */
+- (KSGeoQueryBenchmark *)geoQueryBenchmarkForEntity:(NSString *)entityName field:(NSString *)field {
+
+  NSString *schema               = [entityName lowercaseString];
+  KSGeoQueryBenchmark *benchmark = [[KSGeoQueryBenchmark alloc] initWithEntity:entityName field:field locationField:@"location" iterations:_settings.geoIterations];
+  KSCRUDBenchmark *crud          = [_workloads crudBenchmarkForEntity:entityName field:field];
+  id<KSProviderAdapter> adapter  = _workloads.adapter;
+  SMDataStore *dataStore         = [_client dataStore];
+  NSString *queryField           = [field lowercaseString];
+  NSString *locationField        = benchmark.locationField;
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  if ([_settings.geoRowCounts count] > 0) {
+    benchmark.rowCounts = _settings.geoRowCounts;
+  }
+
+  benchmark.pointBlock = ^id(double latitude, double longitude) {
+    return [SMGeoPoint geoPointWithLatitude:@(latitude) longitude:@(longitude)];
+  };
+
+  benchmark.seedBlock = ^(NSArray *fieldsList, KSBenchmarkCompletion done) {
+    [adapter createObjectsInEntity:entityName fieldsList:fieldsList completion:done];
+  };
+
+  void (^find)(SMQuery *, NSString *, NSUInteger, KSBenchmarkCompletion) = ^(SMQuery *query, NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    [query where:queryField isEqualTo:tag];
+    [query fromIndex:0 toIndex:limit - 1];
+
+    [dataStore performQuery:query onSuccess:^(NSArray *results) {
+      done(results, nil);
+    } onFailure:^(NSError *error) {
+      done(nil, error);
+    }];
+  };
+
+  benchmark.radiusBlock = ^(NSString *tag, double latitude, double longitude, double kilometers, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    SMQuery *query = [[SMQuery alloc] initWithSchema:schema];
+
+    [query where:locationField isWithin:kilometers kilometersOf:CLLocationCoordinate2DMake(latitude, longitude)];
+
+    find(query, tag, limit, done);
+  };
+
+  benchmark.boxBlock = ^(NSString *tag, double southLatitude, double westLongitude, double northLatitude, double eastLongitude, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    SMQuery *query = [[SMQuery alloc] initWithSchema:schema];
+
+    [query where:locationField
+        isWithinBoundsWithSWCorner:CLLocationCoordinate2DMake(southLatitude, westLongitude)
+                       andNECorner:CLLocationCoordinate2DMake(northLatitude, eastLongitude)];
+
+    find(query, tag, limit, done);
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Every shape is an SMQuery on the run's tag: -where:isEqualTo:, an
+ * isGreaterThanOrEqualTo:/isLessThan: pair, -where:isIn:, -or: over two
+ * tagged queries, and two -orderByField:ascending: calls. The Datastore API
+ * has no regex operator, so the regex shape is left out.
+ */
+- (KSQueryShapeBenchmark *)queryShapeBenchmarkForEntity:(NSString *)entityName field:(NSString *)field {
+
+  NSString *schema                 = [entityName lowercaseString];
+  KSQueryShapeBenchmark *benchmark = [[KSQueryShapeBenchmark alloc] initWithEntity:entityName field:field iterations:_settings.queryIterations];
+  KSCRUDBenchmark *crud            = [_workloads crudBenchmarkForEntity:entityName field:field];
+  id<KSProviderAdapter> adapter    = _workloads.adapter;
+  SMDataStore *dataStore           = [_client dataStore];
+  NSString *queryField             = [field lowercaseString];
+  NSString *categoryField          = [benchmark.categoryField lowercaseString];
+  NSString *valueField             = [benchmark.valueField lowercaseString];
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+  benchmark.deleteBlock        = crud.deleteBlock;
+
+  if ([_settings.queryRowCounts count] > 0) {
+    benchmark.rowCounts = _settings.queryRowCounts;
+  }
+
+  benchmark.seedBlock = ^(NSArray *fieldsList, KSBenchmarkCompletion done) {
+    [adapter createObjectsInEntity:entityName fieldsList:fieldsList completion:done];
+  };
+
+  // Results come back as dictionaries keyed by the lowercased schema fields.
+  benchmark.valueBlock = ^id(NSDictionary *object, NSString *valueName) {
+    return object[[valueName lowercaseString]];
+  };
+
+  SMQuery *(^tagged)(NSString *) = ^SMQuery *(NSString *tag) {
+
+    SMQuery *query = [[SMQuery alloc] initWithSchema:schema];
+
+    [query where:queryField isEqualTo:tag];
+
+    return query;
+  };
+
+  void (^find)(SMQuery *, NSUInteger, KSBenchmarkCompletion) = ^(SMQuery *query, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    [query fromIndex:0 toIndex:limit - 1];
+
+    [dataStore performQuery:query onSuccess:^(NSArray *results) {
+      done(results, nil);
+    } onFailure:^(NSError *error) {
+      done(nil, error);
+    }];
+  };
+
+  [benchmark addShape:KSQueryShapeEquality block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    SMQuery *query = tagged(tag);
+
+    [query where:categoryField isEqualTo:@"category-3"];
+
+    find(query, limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeRange block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    SMQuery *query = tagged(tag);
+
+    [query where:valueField isGreaterThanOrEqualTo:@100];
+    [query where:valueField isLessThan:@200];
+
+    find(query, limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeContainedIn block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    SMQuery *query = tagged(tag);
+
+    [query where:categoryField isIn:@[@"category-1", @"category-5", @"category-7"]];
+
+    find(query, limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeOr block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    SMQuery *category = tagged(tag);
+    SMQuery *value    = tagged(tag);
+
+    [category where:categoryField isEqualTo:@"category-2"];
+    [value where:valueField isLessThan:@50];
+
+    find([category or:value], limit, done);
+  }];
+
+  [benchmark addShape:KSQueryShapeSort block:^(NSString *tag, NSUInteger limit, KSBenchmarkCompletion done) {
+
+    SMQuery *query = tagged(tag);
+
+    [query orderByField:categoryField ascending:YES];
+    [query orderByField:valueField ascending:NO];
+
+    find(query, limit, done);
+  }];
+
+  return benchmark;
+}
+
+/*!
+ * Reads are an SMQuery on the benchmark field through -performQuery:, which
+ * always goes to the network. The cache key is the query's request
+ * parameters and headers, where SMQuery keeps its conditions and range.
+ */
+- (KSQueryCacheBenchmark *)queryCacheBenchmarkForEntity:(NSString *)entityName field:(NSString *)field {
+
+  NSString *schema                 = [entityName lowercaseString];
+  KSQueryCacheBenchmark *benchmark = [[KSQueryCacheBenchmark alloc] initWithAdapter:_workloads.adapter entity:entityName field:field operations:_settings.queryCacheOperations];
+  SMDataStore *dataStore           = [_client dataStore];
+  NSString *queryField             = [field lowercaseString];
+
+  benchmark.timeout            = _settings.testTimeout;
+  benchmark.readRatio          = _settings.queryCacheReadRatio;
+  benchmark.cleanupConcurrency = _settings.teardownConcurrency;
+
+  benchmark.readBlock = ^(NSString *value, KSQueryCache *cache, KSBenchmarkCompletion done) {
+
+    SMQuery *query = [[SMQuery alloc] initWithSchema:schema];
+
+    [query where:queryField isEqualTo:value];
+
+    KSQueryCacheFetchBlock fetch = ^(KSBenchmarkCompletion fetched) {
+      [dataStore performQuery:query onSuccess:^(NSArray *results) {
+        fetched(results, nil);
+      } onFailure:^(NSError *error) {
+        fetched(nil, error);
+      }];
+    };
+
+    if (!cache) {
+      fetch(done);
+      return;
+    }
+
+    NSString *key = [NSString stringWithFormat:@"%@ %@ %@", schema, query.requestParameters, query.requestHeaders];
+
+    [cache readEntity:entityName key:key fetch:fetch completion:done];
+  };
+
+  return benchmark;
+}
+
+/*!
+ * The functional tests keep an SMClient per key pair, so the benchmark
+ * client is joined by a second SMClient for the same API version and
+ * public key.
+ */
+- (KSConnectionReuseBenchmark *)connectionReuseBenchmarkForEntity:(NSString *)entityName field:(NSString *)field {
+
+  KSConnectionReuseBenchmark *benchmark = [[KSConnectionReuseBenchmark alloc] initWithEntity:entityName field:field operations:_settings.connectionReuseOperations];
+
+  benchmark.timeout = _settings.testTimeout;
+  benchmark.idleGap = _settings.connectionReuseIdleGap;
+
+  SMClient *second = [[SMClient alloc] initWithAPIVersion:_client.appAPIVersion publicKey:_client.publicKey];
+
+  [benchmark addClient:@"client_1" adapter:_workloads.adapter];
+  [benchmark addClient:@"client_2" adapter:[[StackMobAdapter alloc] initWithClient:second]];
+
+  return benchmark;
+}
+
+/*!
+ * SMRequestOptions retries 503s on its own, numberOfRetries times (3 by
+ * default), or hands them to a retry block. Three variants run: the
+ * default, numberOfRetries set to 0, and a retry block added with
+ * -addSMErrorServiceUnavailableRetryBlock: that waits 0.25, 0.5 and 1
+ * seconds before resending through -retryCustomCodeRequest:.... Only 503s
+ * are retried; a reset connection fails the query.
+ *
+ * Fault rates missing from the configuration keep the benchmark's defaults.
+ */
+- (KSFaultInjectionBenchmark *)faultInjectionBenchmarkForEntity:(NSString *)entityName field:(NSString *)field {
+
+  KSFaultInjectionBenchmark *benchmark = [[KSFaultInjectionBenchmark alloc] initWithEntity:entityName field:field operations:_settings.faultInjectionOperations];
+
+  benchmark.timeout = _settings.testTimeout;
+
+  if (_settings.faultServiceUnavailableRate) {
+    benchmark.serviceUnavailableRate = [_settings.faultServiceUnavailableRate doubleValue];
+  }
+
+  if (_settings.faultResetRate) {
+    benchmark.resetRate = [_settings.faultResetRate doubleValue];
+  }
+
+  if (_settings.faultLatencySpikeRate) {
+    benchmark.latencySpikeRate = [_settings.faultLatencySpikeRate doubleValue];
+  }
+
+  if (_settings.faultLatencySpike) {
+    benchmark.latencySpike = [_settings.faultLatencySpike doubleValue];
+  }
+
+  SMDataStore *dataStore = [_client dataStore];
+  NSString *schema       = [entityName lowercaseString];
+  NSString *queryField   = [field lowercaseString];
+
+  void (^query)(NSString *, SMRequestOptions *, KSBenchmarkCompletion) = ^(NSString *value, SMRequestOptions *options, KSBenchmarkCompletion done) {
+
+    SMQuery *smQuery = [[SMQuery alloc] initWithSchema:schema];
+
+    [smQuery where:queryField isEqualTo:value];
+
+    [dataStore performQuery:smQuery options:options onSuccess:^(NSArray *results) {
+      done(results, nil);
+    } onFailure:^(NSError *error) {
+      done(nil, error);
+    }];
+  };
+
+  [benchmark addVariant:@"default" block:^(NSString *value, KSBenchmarkCompletion done) {
+    query(value, [SMRequestOptions options], done);
+  }];
+
+  [benchmark addVariant:@"no_retries" block:^(NSString *value, KSBenchmarkCompletion done) {
+
+    SMRequestOptions *options = [SMRequestOptions options];
+
+    options.numberOfRetries = 0;
+
+    query(value, options, done);
+  }];
+
+  [benchmark addVariant:@"backoff_block" block:^(NSString *value, KSBenchmarkCompletion done) {
+
+    SMRequestOptions *options = [SMRequestOptions options];
+
+    options.numberOfRetries = 3;
+
+    [options addSMErrorServiceUnavailableRetryBlock:^(NSURLRequest *request, NSHTTPURLResponse *response, NSError *error, id JSON, SMRequestOptions *retryOptions, SMFullResponseSuccessBlock successBlock, SMFullResponseFailureBlock failureBlock) {
+
+      // retryOptions comes with numberOfRetries already decremented: 2, 1, 0.
+      NSTimeInterval delay = 0.25 * pow(2, 2 - MAX(retryOptions.numberOfRetries, 0));
+
+      dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [dataStore retryCustomCodeRequest:request options:retryOptions onSuccess:successBlock onFailure:failureBlock];
+      });
+    }];
+
+    query(value, options, done);
+  }];
+
+  return benchmark;
+}
+
+/*!
+ * Loads StackMobConfiguration.plist the way StackMobConfigurator does,
+ * builds an SMClient with the same key selection as -configureBackend, sets
+ * up its Core Data store and a context, and finds one foo. Every pass builds
+ * a new client and store.
+ */
+- (KSStartupBenchmark *)startupBenchmark {
+
+  KSStartupBenchmark *benchmark       = [[KSStartupBenchmark alloc] initWithProvider:@"StackMob" passes:_settings.startupPasses];
+  __block NSDictionary *configuration = nil;
+  __block SMClient *client            = nil;
+  __block SMCoreDataStore *store      = nil;
+
+  benchmark.timeout = _settings.testTimeout;
+
+  [benchmark addPhase:@"configuration" block:^(NSUInteger pass, KSBenchmarkCompletion done) {
+
+    NSString *path = [[NSBundle bundleForClass:[StackMobConfigurator class]] pathForResource:@"StackMobConfiguration" ofType:@"plist"];
+
+    configuration = [NSDictionary dictionaryWithContentsOfFile:path];
+
+    done(configuration, nil);
+  }];
+
+  [benchmark addPhase:@"client" block:^(NSUInteger pass, KSBenchmarkCompletion done) {
+
+    NSString *prefix      = [configuration[@"UseSecure"] boolValue] ? @"Secure" : @"Open";
+    NSString *environment = [configuration[@"UseProduction"] boolValue] ? @"Production" : @"Development";
+
+    client = [[SMClient alloc] initWithAPIVersion:configuration[[NSString stringWithFormat:@"%@%@APIVersion", prefix, environment]]
+                                        publicKey:configuration[[NSString stringWithFormat:@"%@%@PublicKey", prefix, environment]]];
+
+    done(client, nil);
+  }];
+
+  [benchmark addPhase:@"core_data" block:^(NSUInteger pass, KSBenchmarkCompletion done) {
+
+    store = [client coreDataStoreWithManagedObjectModel:[NSManagedObjectModel mergedModelFromBundles:nil]];
+
+    done([store contextForCurrentThread], nil);
+  }];
+
+  [benchmark addPhase:@"first_request" block:^(NSUInteger pass, KSBenchmarkCompletion done) {
+
+    SMQuery *query = [[SMQuery alloc] initWithSchema:@"foo"];
+
+    [query limit:1];
+
+    [[client dataStore] performQuery:query onSuccess:^(NSArray *results) {
+      done(results, nil);
+    } onFailure:^(NSError *error) {
+      done(nil, error);
+    }];
+  }];
+
+  benchmark.resetBlock = ^{
+    store  = nil;
+    client = nil;
+  };
+
+  return benchmark;
+}
+
+/*!
+ * Runs one test's benchmark through the shared settings, which write the
+ * report where BenchmarkReportDirectory points, and fails the test if it
+ * raised or the report could not be written.
+ */
+- (void)runBenchmark:(NSString *)benchmark test:(SEL)test block:(KSBenchmarkBlock)block {
+
+  NSString *failure = [_settings runBenchmark:benchmark provider:@"StackMob" test:test block:block];
+
+  STAssertNil(failure, @"%@", failure);
+}
+
+#pragma mark - Startup benchmarks
+
+/*!
+ * Times loading the configuration, building the client and its Core Data
+ * store and the first request to foo, StartupPasses times. The first pass is
+ * reported as cold, and the report records how long the test process had been
+ * up, since earlier tests may already have warmed the SDK.
+ */
+- (void)test_050_Cold_Start {
+
+  [self runBenchmark:@"startup" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    KSStartupBenchmark *benchmark = [self startupBenchmark];
+
+    [report setParameter:@(benchmark.passes) forKey:@"passes"];
+    [report setParameter:@([KSStartupBenchmark processUptime]) forKey:@"process_uptime_s"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu StackMob startup phases failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Latency benchmarks
+
+/*!
+ * Measures p50/p95/p99 latency and throughput of create, read by id, query,
+ * update and delete for the Foo and Bar schemas.
+ *
+ * Each entity also gets a wire trace: DNS, connect, time to first byte and
+ * transfer per request, and how much of the operation time was spent on the
+ * wire rather than in the SDK.
+ */
+- (void)test_100_CRUD_Latency {
+
+  [self runBenchmark:@"crud_latency" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    [report setParameter:@(_settings.iterations) forKey:@"iterations"];
+
+    NSArray *benchmarks = @[[_workloads crudBenchmarkForEntity:@"Foo" field:@"fooParameter"],
+                            [_workloads crudBenchmarkForEntity:@"Bar" field:@"barParameter"]];
+
+    for (KSCRUDBenchmark *benchmark in benchmarks) {
+
+      [KSWireTrace start];
+      [benchmark runWithReport:report];
+      [KSWireTrace stop];
+
+      [KSWireTrace addToReport:report operations:benchmark.histograms attributes:@{@"entity" : benchmark.entity}];
+
+      STAssertTrue(benchmark.errorCount == 0, @"%lu %@ operations failed", (unsigned long)benchmark.errorCount, benchmark.entity);
+    }
+  }];
+}
+
+#pragma mark - Load benchmarks
+
+/*!
+ * Creates Foo objects as fast as LoadWorkers concurrent workers allow (or at
+ * LoadTargetRate) and reports achieved throughput, error rate and latency
+ * at each worker count.
+ */
+- (void)test_110_Create_Throughput_Under_Load {
+
+  [self runBenchmark:@"load" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    [report setParameter:_settings.loadWorkers forKey:@"workers"];
+    [report setParameter:@(_settings.loadTargetRate) forKey:@"target_rate"];
+    [report setParameter:@(_settings.loadDuration) forKey:@"duration_s"];
+
+    KSCRUDBenchmark *benchmark = [_workloads crudBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    for (NSNumber *workers in _settings.loadWorkers) {
+
+      KSLoadGenerator *generator = [self runCreateLoadWithBenchmark:benchmark workers:[workers unsignedIntegerValue]];
+
+      if(_settings.showLogs) NSLog(@"%@", generator);
+
+      [generator addToReport:report];
+    }
+  }];
+}
+
+#pragma mark - Batch write benchmarks
+
+/*!
+ * Saves BatchSizes Foo objects one at a time, then again as one AFHTTPClient
+ * operation batch.
+ * Reports objects/sec and bytes on the wire for both paths.
+ */
+- (void)test_120_Batch_Write {
+
+  [self runBenchmark:@"batch_write" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    [report setParameter:_settings.batchSizes forKey:@"batch_sizes"];
+
+    KSBatchWriteBenchmark *benchmark = [_workloads batchWriteBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo saves failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Cache policy benchmarks
+
+/*!
+ * Reads a Bar under every SMCachePolicy, reporting cold and warm latency, hit
+ * ratio and how stale the answers were after a write.
+ */
+- (void)test_130_Cache_Policy_Matrix {
+
+  [self runBenchmark:@"cache_policy" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    [report setParameter:@(_settings.iterations) forKey:@"iterations"];
+
+    KSCachePolicyBenchmark *benchmark = [self cachePolicyBenchmarkForEntity:@"Bar" field:@"barParameter"];
+
+    BOOL completed = [benchmark runWithReport:report];
+
+    STAssertTrue(completed, @"%lu Bar creates or writes failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Payload scaling benchmarks
+
+/*!
+ * Creates and reads Foo objects as the field grows from 100 B to 1 MB and as
+ * the field count grows from 1 to 500, and reports latency, JSON
+ * serialisation cost and wire time at each step.
+ */
+- (void)test_140_Payload_Scaling {
+
+  [self runBenchmark:@"payload_scaling" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSPayloadScalingBenchmark *benchmark = [_workloads payloadScalingBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.payloadIterations) forKey:@"iterations"];
+    [report setParameter:benchmark.payloadSizes forKey:@"payload_sizes"];
+    [report setParameter:benchmark.fieldCounts forKey:@"field_counts"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo payload operations failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Core Data store benchmarks
+
+/*!
+ * Fills in-memory, SQLite and binary stores with 1,000 to 1,000,000 Bar rows
+ * and reports insert and save throughput, how long the store takes to open
+ * again and fetch latency at each size. Nothing goes to StackMob.
+ */
+- (void)test_160_Core_Data_Store {
+
+  [self runBenchmark:@"core_data_store" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    KSCoreDataBenchmark *benchmark = [[KSCoreDataBenchmark alloc] initWithEntity:@"Bar" field:@"barParameter"];
+
+    benchmark.fetchIterations = _settings.iterations;
+
+    if ([_settings.coreDataRowCounts count] > 0) {
+      benchmark.rowCounts = _settings.coreDataRowCounts;
+    }
+
+    if ([_settings.coreDataStoreTypes count] > 0) {
+      benchmark.storeTypes = _settings.coreDataStoreTypes;
+    }
+
+    [report setParameter:benchmark.storeTypes forKey:@"store_types"];
+    [report setParameter:benchmark.rowCounts forKey:@"row_counts"];
+    [report setParameter:@(benchmark.saveBatchSize) forKey:@"save_batch_size"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Core Data store steps failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Incremental store benchmarks
+
+/*!
+ * Saves IncrementalStoreRowCounts Bars through SMIncrementalStore, then times
+ * fetching all of them the way a list screen does: as managed objects, as
+ * object ids, while filling the cache under SMCachePolicyTryCacheElseNetwork
+ * and from the filled cache. Also reports the heap the fetched objects take
+ * as faults and once materialized. The Bars are deleted afterwards.
+ */
+- (void)test_170_Incremental_Store_Fetch {
+
+  [self runBenchmark:@"incremental_store_fetch" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    SMCoreDataStore *coreDataStore  = [self cachingCoreDataStore];
+    NSManagedObjectContext *context = [coreDataStore contextForCurrentThread];
+    KSLatencyHistogram *save        = [KSLatencyHistogram histogramWithName:@"Bar.save"];
+    NSArray *rowCounts              = [_incrementalStoreRowCounts sortedArrayUsingSelector:@selector(compare:)];
+    NSMutableArray *barIds          = [NSMutableArray array];
+    NSUInteger errors               = 0;
+
+    [report setParameter:rowCounts forKey:@"row_counts"];
+    [report setParameter:@(_incrementalStoreFetches) forKey:@"fetches"];
+    [report setParameter:@(KSIncrementalStoreSaveBatchSize) forKey:@"save_batch_size"];
+
+    // Each step only saves the Bars the one before it didn't.
+    for (NSNumber *rows in rowCounts) {
+
+      if (![self saveBarsInContext:context upTo:[rows unsignedIntegerValue] barIds:barIds save:save]) {
+        errors++;
+        break;
+      }
+
+      errors += [self timeIncrementalStoreFetchesInStore:coreDataStore context:context rows:[rows unsignedIntegerValue] report:report];
+    }
+
+    [report addHistogram:save];
+
+    SMDataStore *dataStore = [_client dataStore];
+    KSBulkDeleter *deleter = [KSBulkDeleter deleterWithMaxConcurrentDeletes:_settings.teardownConcurrency];
+
+    [deleter deleteItems:barIds withBlock:^(id barId, KSBulkDeleteCompletion done) {
+      [dataStore deleteObjectId:barId inSchema:@"bar" onSuccess:^(NSString *theObjectId, NSString *schema) {
+        done(nil);
+      } onFailure:^(NSError *theError, NSString *theObjectId, NSString *schema) {
+        done(theError);
+      }];
+    }];
+
+    // One timeout per save batch; thousands of deletes take a while.
+    if (![deleter waitWithTimeout:_settings.testTimeout * ([barIds count] / KSIncrementalStoreSaveBatchSize + 1)] || deleter.failedCount > 0) {
+      NSLog(@"StackMob incremental store benchmark left %lu Bars behind", (unsigned long)([barIds count] - deleter.deletedCount));
+    }
+
+    [coreDataStore resetCache];
+
+    STAssertTrue(errors == 0, @"%lu StackMob incremental store saves or fetches failed", (unsigned long)errors);
+  }];
+}
+
+#pragma mark - Projection benchmarks
+
+/*!
+ * Reads 200-field foo objects whole, restricted to fooparameter and with the
+ * bar they point at expanded, and reports latency, bytes received and decode
+ * time for each.
+ */
+- (void)test_180_Field_Projection {
+
+  [self runBenchmark:@"projection" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSProjectionBenchmark *benchmark = [self projectionBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.iterations) forKey:@"iterations"];
+    [report setParameter:@(benchmark.fieldCount) forKey:@"fields"];
+    [report setParameter:benchmark.projectedFields forKey:@"projected_fields"];
+    [report setParameter:@(benchmark.expandDepth) forKey:@"expand_depth"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo projection saves or reads failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Aggregation benchmarks
+
+/*!
+ * Counts a 100,000-object foo dataset with -performCount: and by downloading
+ * every row, and folds sum, min, max and average on the client, reporting
+ * how much faster the server count is and what each way downloads.
+ */
+- (void)test_200_Aggregation {
+
+  [self runBenchmark:@"aggregation" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSAggregationBenchmark *benchmark = [self aggregationBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.aggregationIterations) forKey:@"iterations"];
+    [report setParameter:@(benchmark.rowCount) forKey:@"rows"];
+    [report setParameter:@(benchmark.pageSize) forKey:@"page_size"];
+    [report setParameter:benchmark.serverFunctions forKey:@"server_functions"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu foo aggregation saves or reads failed or came back wrong", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Geo query benchmarks
+
+/*!
+ * Seeds 10,000 to 1,000,000 located foo objects around San Francisco and
+ * reports radius and bounding-box query latency and result sizes at each
+ * density.
+ */
+- (void)test_210_Geo_Query {
+
+  [self runBenchmark:@"geo_query" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSGeoQueryBenchmark *benchmark = [self geoQueryBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.geoIterations) forKey:@"iterations"];
+    [report setParameter:benchmark.rowCounts forKey:@"row_counts"];
+    [report setParameter:benchmark.radii forKey:@"radii_km"];
+    [report setParameter:@(benchmark.regionSpan) forKey:@"region_span_degrees"];
+    [report setParameter:@(benchmark.resultLimit) forKey:@"result_limit"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu foo geo saves or queries failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Query shape benchmarks
+
+/*!
+ * Runs equality, range, isIn, OR and two-key sort queries over 1,000 to
+ * 100,000 Foo objects and reports how each one's latency grows with the
+ * schema, to find the shapes StackMob answers with a full scan.
+ */
+- (void)test_220_Query_Shapes {
+
+  [self runBenchmark:@"query_shapes" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSQueryShapeBenchmark *benchmark = [self queryShapeBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(_settings.queryIterations) forKey:@"iterations"];
+    [report setParameter:benchmark.rowCounts forKey:@"row_counts"];
+    [report setParameter:benchmark.shapes forKey:@"shapes"];
+    [report setParameter:@(benchmark.resultLimit) forKey:@"result_limit"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo query shape saves or queries failed or returned the wrong objects", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Query cache benchmarks
+
+/*!
+ * Replays a read-heavy mix of Foo list queries and saves straight against
+ * StackMob and again through KSQueryCache, and reports the hit rate and the
+ * requests and read time the cache saved next to reading every list from
+ * the backend.
+ */
+- (void)test_230_Query_Cache {
+
+  [self runBenchmark:@"query_cache" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSQueryCacheBenchmark *benchmark = [self queryCacheBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(benchmark.operations) forKey:@"operations"];
+    [report setParameter:@(benchmark.readRatio) forKey:@"read_ratio"];
+    [report setParameter:@(benchmark.keyCount) forKey:@"key_count"];
+    [report setParameter:@(benchmark.objectsPerKey) forKey:@"objects_per_key"];
+
+    [benchmark runWithReport:report];
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo query cache operations failed or read stale lists", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Connection reuse benchmarks
+
+/*!
+ * Counts the TCP and TLS handshakes the StackMob SDK makes per 1000 Foo
+ * queries, sequentially, concurrently and in bursts with idle gaps between
+ * them, through one SMClient and through two. Needs StandInMode Replay.
+ */
+- (void)test_240_Connection_Reuse {
+
+  [self runBenchmark:@"connection_reuse" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSConnectionReuseBenchmark *benchmark = [self connectionReuseBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(benchmark.operations) forKey:@"operations"];
+    [report setParameter:@(benchmark.concurrency) forKey:@"concurrency"];
+    [report setParameter:@(benchmark.burstSize) forKey:@"burst_size"];
+    [report setParameter:@(benchmark.idleBursts) forKey:@"idle_bursts"];
+    [report setParameter:@(benchmark.idleGap) forKey:@"idle_gap_s"];
+
+    [benchmark runWithReport:report];
+
+    if (benchmark.skipped) {
+      if(_settings.showLogs) NSLog(@"StandInMode isn't Replay, skipping %@", NSStringFromSelector(_cmd));
+      *discard = YES;
+      return;
+    }
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo queries failed", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+#pragma mark - Fault injection benchmarks
+
+/*!
+ * Runs Foo queries through the StackMob SDK with its default retries, with
+ * none and with a backoff retry block, while the stand-in answers some
+ * requests with 503s, resets others and holds others back, and reports
+ * tail latency, success rate and the requests the retries add.
+ * Needs StandInMode Record or Replay.
+ */
+- (void)test_250_Fault_Injection {
+
+  [self runBenchmark:@"fault_injection" test:_cmd block:^(KSBenchmarkReport *report, BOOL *discard) {
+
+    [self configureBackend];
+
+    KSFaultInjectionBenchmark *benchmark = [self faultInjectionBenchmarkForEntity:@"Foo" field:@"fooParameter"];
+
+    [report setParameter:@(benchmark.operations) forKey:@"operations"];
+    [report setParameter:@(benchmark.concurrency) forKey:@"concurrency"];
+    [report setParameter:@(benchmark.serviceUnavailableRate) forKey:@"service_unavailable_rate"];
+    [report setParameter:@(benchmark.resetRate) forKey:@"reset_rate"];
+    [report setParameter:@(benchmark.latencySpikeRate) forKey:@"latency_spike_rate"];
+    [report setParameter:@(benchmark.latencySpike) forKey:@"latency_spike_s"];
+
+    [benchmark runWithReport:report];
+
+    if (benchmark.skipped) {
+      if(_settings.showLogs) NSLog(@"StandInMode is Off, skipping %@", NSStringFromSelector(_cmd));
+      *discard = YES;
+      return;
+    }
+
+    STAssertTrue(benchmark.errorCount == 0, @"%lu Foo queries failed without faults", (unsigned long)benchmark.errorCount);
+  }];
+}
+
+@end
@@ -6,6 +6,13 @@
 
 #import "KitchenSyncStackmobTests.h"
 #import "StackMobConfigurator.h"
+#import "KSCompletionWaiter.h"
+#import "KSBulkDeleter.h"
+#import "KSPagedQuery.h"
+#import "KSRandomString.h"
+#import "KSRunNamespace.h"
+#import "KSCoreDataStack.h"
+#import "SMDataStore+Protected.h"
 #import "StackMob.h"
 #import "Foo.h"
 #import "Bar.h"
@@ -14,12 +21,22 @@
 
 @property (nonatomic, assign) BOOL showLogs;
 @property (nonatomic, assign) BOOL usingSecureBackend;
-@property (nonatomic, copy) void (^testForCompletionBlock)(BOOL *testCompleted);
+@property (nonatomic, assign) NSTimeInterval testTimeout;
+@property (nonatomic, strong) NSDictionary *configuration;
+@property (nonatomic, assign) SMCachePolicy cachePolicy;
+@property (nonatomic, assign) BOOL deleteAllTestDataEnabled;
+@property (nonatomic, strong) KSRunNamespace *runNamespace;
+@property (nonatomic, copy) NSString *coreDataStoreType;
 
 - (void)setupCoreDataEnvironment;
 - (void)deleteAllOpenBar;
 - (void)deleteAllSecureBar;
+- (void)deleteRunTestData;
+- (void)deleteAllBarUsingClient:(SMClient *)client context:(NSManagedObjectContext *)context;
+- (void)deleteAllBarUsingClient:(SMClient *)client context:(NSManagedObjectContext *)context taggedOnly:(BOOL)taggedOnly;
+- (void)deleteRunFooUsingClient:(SMClient *)client;
 - (NSString *)randomString:(int)numCharacters;
+- (void)waitForCompletion:(KSCompletionWaiter *)waiter;
 - (void)configureSecureBackend;
 
 @end
@@ -32,46 +49,59 @@
 
     [super setUp];
   
-    _testForCompletionBlock = ^(BOOL *testCompleted) {
-
-      while (!*testCompleted) {
-        
-        NSDate *cycle = [NSDate dateWithTimeIntervalSinceNow:0.01];
-        
-        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode
-                                 beforeDate:cycle];
-      }
-    };
-  
     NSDictionary *stackmobAppConfiguration = [[StackMobConfigurator sharedInstance] applicationConfiguration];
     
     _showLogs           = [stackmobAppConfiguration[@"ShowLogs"] boolValue];
     _usingSecureBackend = [stackmobAppConfiguration[@"UseSecure"] boolValue];
 
+    _testTimeout         = [stackmobAppConfiguration[@"TestTimeout"] doubleValue];
+    _configuration       = stackmobAppConfiguration;
+
+    _deleteAllTestDataEnabled = [stackmobAppConfiguration[@"DeleteAllTestData"] boolValue];
+    _runNamespace             = [KSRunNamespace currentNamespace];
+    _coreDataStoreType        = [KSCoreDataStack storeTypeForName:stackmobAppConfiguration[@"CoreDataStoreType"]];
+
+    if (_testTimeout <= 0) {
+      _testTimeout = 30.0;
+    }
+
+    STAssertNotNil(_coreDataStoreType, @"unknown CoreDataStoreType %@, expected InMemory, SQLite or Binary", stackmobAppConfiguration[@"CoreDataStoreType"]);
+
+    // CachePolicy runs the suite's Core Data fetches under another policy;
+    // the cache policy benchmark compares them all. The cache itself has to
+    // be on before the stores are created.
+    NSDictionary *cachePolicies = @{@"TryNetworkOnly"      : @(SMCachePolicyTryNetworkOnly),
+                                    @"TryCacheOnly"        : @(SMCachePolicyTryCacheOnly),
+                                    @"TryNetworkElseCache" : @(SMCachePolicyTryNetworkElseCache),
+                                    @"TryCacheElseNetwork" : @(SMCachePolicyTryCacheElseNetwork)};
+
+    NSNumber *cachePolicy = cachePolicies[stackmobAppConfiguration[@"CachePolicy"]];
+
+    _cachePolicy = cachePolicy ? (SMCachePolicy)[cachePolicy intValue] : SMCachePolicyTryNetworkOnly;
+
+    if (_cachePolicy != SMCachePolicyTryNetworkOnly) {
+      SM_CACHE_ENABLED = YES;
+    }
+
     [self setupCoreDataEnvironment];
     [self configureBackend];
 }
 
+/*!
+ * Uses the model and coordinator of the run's Core Data stack, which is
+ * built once, on first use, with the store CoreDataStoreType names.
+ */
 - (void)setupCoreDataEnvironment {
 
-  // Destroy objects
-  _persistentStoreCoordinator = nil;
-  _managedObjectModel         = nil;
-  
-  // Setup Core Data
-  _managedObjectModel         = [NSManagedObjectModel mergedModelFromBundles:nil];
-  _persistentStoreCoordinator = [[NSPersistentStoreCoordinator alloc] initWithManagedObjectModel:_managedObjectModel];
-  
-  NSError *error;
-  
-  // Setup an in memory store
-  if(![_persistentStoreCoordinator addPersistentStoreWithType:NSInMemoryStoreType
-                                                configuration:nil
-                                                          URL:nil
-                                                      options:nil
-                                                        error:&error]) {
+  NSError *error         = nil;
+  KSCoreDataStack *stack = [KSCoreDataStack sharedStackWithStoreType:_coreDataStoreType error:&error];
+
+  if (!stack) {
     STFail(@"Could not create store coordinator: %@", [error localizedDescription]);
   }
+
+  _managedObjectModel         = stack.managedObjectModel;
+  _persistentStoreCoordinator = stack.persistentStoreCoordinator;
 }
 
 - (void)configureBackend {
@@ -99,6 +129,8 @@
 
         SMCoreDataStore *coreDataStore = [_sm_open coreDataStoreWithManagedObjectModel:_managedObjectModel];
 
+        coreDataStore.cachePolicy = _cachePolicy;
+
         _sm_open_Context = [coreDataStore contextForCurrentThread];
     }
     if (!_sm_secure) {
@@ -120,6 +152,8 @@
 
         SMCoreDataStore *coreDataStore = [_sm_secure coreDataStoreWithManagedObjectModel:_managedObjectModel];
 
+        coreDataStore.cachePolicy = _cachePolicy;
+
       _sm_secure_Context = [coreDataStore contextForCurrentThread];
     }
     if (!_sm_local) {
@@ -152,6 +186,8 @@
     
     SMCoreDataStore *coreDataStore = [_sm_secure coreDataStoreWithManagedObjectModel:_managedObjectModel];
 
+    coreDataStore.cachePolicy = _cachePolicy;
+
     _sm_secure_Context = [coreDataStore contextForCurrentThread];
   }  
 }
@@ -165,27 +201,7 @@
 
 - (void)deleteAllOpenBar {
     @try {
-      
-      __block BOOL testCompleted = NO;
-
-        NSFetchRequest *fetchRequest = [[NSFetchRequest alloc] init];
-        NSEntityDescription *entity = [NSEntityDescription entityForName:@"Bar" inManagedObjectContext:_sm_open_Context];
-        [fetchRequest setEntity:entity];
-        [_sm_open_Context executeFetchRequest:fetchRequest onSuccess:^(NSArray *results) {
-            for (id obj in results) {
-                [_sm_open_Context deleteObject:obj];
-                [_sm_open_Context saveOnSuccess:^{
-                } onFailure:^(NSError *error) {
-                    STAssertNil(error, @"There was an error! %@", error);
-                }];
-            }
-          testCompleted = YES;
-        } onFailure:^(NSError *error) {
-          testCompleted = YES;
-          STAssertNil(error, @"Error fetching! %@", error);
-        }];
-      
-      _testForCompletionBlock(&testCompleted);
+        [self deleteAllBarUsingClient:_sm_open context:_sm_open_Context];
     } @catch (NSException * e) {
         NSLog(@"deleteAllOpenBar failed: %@", [e description]);
     }
@@ -193,37 +209,214 @@
 
 - (void)deleteAllSecureBar {
     @try {
-      
-      __block BOOL testCompleted = NO;
-        NSFetchRequest *fetchRequest = [[NSFetchRequest alloc] init];
-        NSEntityDescription *entity = [NSEntityDescription entityForName:@"Bar" inManagedObjectContext:_sm_secure_Context];
-        [fetchRequest setEntity:entity];
-        [_sm_secure_Context executeFetchRequest:fetchRequest onSuccess:^(NSArray *results) {
-            for (id obj in results) {
-                [_sm_secure_Context deleteObject:obj];
-                [_sm_secure_Context saveOnSuccess:^{
-                } onFailure:^(NSError *error) {
-                    STAssertNil(error, @"There was an error! %@", error);
-                }];
-            }
-          testCompleted = YES;
-        } onFailure:^(NSError *error) {
-          testCompleted = YES;
-            STAssertNil(error, @"Error fetching! %@", error);
-        }];
-      
-      _testForCompletionBlock(&testCompleted);
+        [self deleteAllBarUsingClient:_sm_secure context:_sm_secure_Context];
     } @catch (NSException * e) {
         NSLog(@"deleteAllSecureBar failed: %@", [e description]);
     }
 }
 
+/*!
+ * Deletes the Foo and Bar objects this run tagged, on both backends.
+ */
+- (void)deleteRunTestData {
+    @try {
+        [self deleteRunFooUsingClient:_sm_open];
+        [self deleteRunFooUsingClient:_sm_secure];
+        [self deleteAllBarUsingClient:_sm_open context:_sm_open_Context taggedOnly:YES];
+        [self deleteAllBarUsingClient:_sm_secure context:_sm_secure_Context taggedOnly:YES];
+    } @catch (NSException * e) {
+        NSLog(@"deleteRunTestData failed: %@", [e description]);
+    }
+}
+
+- (void)deleteAllBarUsingClient:(SMClient *)client context:(NSManagedObjectContext *)context {
+  [self deleteAllBarUsingClient:client context:context taggedOnly:NO];
+}
+
+/*!
+ * Fetches Bar through Core Data a page at a time (fetchLimit/fetchOffset),
+ * and deletes each page with batches of DELETE operations enqueued on the
+ * client's AFHTTPClient, keeping TeardownConcurrency batches in flight.
+ * Saving the context once per object serialised the deletes, which is where
+ * most of the teardown time went. The context is reset after every page so
+ * only one page of objects is held at a time.
+ *
+ * With taggedOnly the fetch is limited to this run's objects. StackMob
+ * queries have no prefix match, so the tag is matched as a range on
+ * barParameter.
+ */
+- (void)deleteAllBarUsingClient:(SMClient *)client context:(NSManagedObjectContext *)context taggedOnly:(BOOL)taggedOnly {
+
+  NSEntityDescription *entity = [NSEntityDescription entityForName:@"Bar" inManagedObjectContext:context];
+  NSString *schema            = [entity SMSchema];
+  SMDataStore *dataStore      = [client dataStore];
+  AFHTTPClient *httpClient    = [client.session oauthClientWithHTTPS:NO];
+  NSPredicate *predicate      = nil;
+
+  if (taggedOnly) {
+    predicate = [NSPredicate predicateWithFormat:@"barParameter >= %@ AND barParameter < %@",
+                 _runNamespace.valueLowerBound, _runNamespace.valueUpperBound];
+  }
+
+  KSPagedQuery *pages = [KSPagedQuery queryWithPageSize:500 fetchBlock:^(NSUInteger offset, NSUInteger limit, KSPageCompletion done) {
+
+    NSFetchRequest *fetchRequest = [[NSFetchRequest alloc] init];
+
+    [fetchRequest setEntity:entity];
+    [fetchRequest setPredicate:predicate];
+    [fetchRequest setFetchLimit:limit];
+    [fetchRequest setFetchOffset:offset];
+
+    [context executeFetchRequest:fetchRequest onSuccess:^(NSArray *fetched) {
+      done(fetched, nil);
+    } onFailure:^(NSError *error) {
+      done(nil, error);
+    }];
+  }];
+
+  pages.timeout       = _testTimeout;
+  pages.consumesPages = YES;
+
+  BOOL completed = [pages enumeratePagesUsingBlock:^(NSArray *page, NSUInteger offset, BOOL *stop) {
+
+    NSMutableArray *objectIds = [NSMutableArray arrayWithCapacity:[page count]];
+
+    for (NSManagedObject *obj in page) {
+      [objectIds addObject:[obj valueForKey:[obj primaryKeyField]]];
+    }
+
+    KSBulkDeleter *deleter = [KSBulkDeleter deleterWithConfiguration:_configuration];
+
+    [deleter deleteItems:objectIds inBatchesWithBlock:^(NSArray *batch, KSBulkDeleteCompletion done) {
+
+      NSMutableArray *operations = [NSMutableArray arrayWithCapacity:[batch count]];
+
+      for (NSString *objectId in batch) {
+        [operations addObject:[dataStore deleteOperationForObjectID:objectId
+                                                            inSchema:schema
+                                                             options:[SMRequestOptions options]
+                                                successCallbackQueue:dispatch_get_main_queue()
+                                                failureCallbackQueue:dispatch_get_main_queue()
+                                                           onSuccess:^(NSDictionary *result) {}
+                                                           onFailure:^(NSURLRequest *theRequest, NSError *theError, NSDictionary *theObject, SMRequestOptions *theOptions, SMResultSuccessBlock originalSuccessBlock) {}]];
+      }
+
+      [httpClient enqueueBatchOfHTTPRequestOperations:operations progressBlock:nil completionBlock:^(NSArray *finished) {
+
+        NSError *error = nil;
+
+        for (AFHTTPRequestOperation *operation in finished) {
+          if (operation.error) {
+            error = operation.error;
+            break;
+          }
+        }
+
+        done(error);
+      }];
+    }];
+
+    NSString *failure = [deleter waitAndReportNamed:schema timeout:_testTimeout];
+    STAssertNil(failure, @"%@", failure);
+
+    // The objects are gone on the server; drop the stale copies from the context.
+    [context reset];
+
+    // Don't keep re-reading a page that can't be deleted.
+    if (deleter.failedCount > 0 || deleter.deletedCount < [objectIds count]) {
+      *stop = YES;
+    }
+  }];
+
+  STAssertTrue(completed, @"Error fetching! %@", pages.error);
+}
+
+/*!
+ * Foo is written through the data store rather than Core Data, so this
+ * run's Foo objects are found with an SMQuery range on fooparameter and
+ * deleted by id, TeardownConcurrency at a time.
+ */
+- (void)deleteRunFooUsingClient:(SMClient *)client {
+
+  SMDataStore *dataStore = [client dataStore];
+  NSString *lowerBound   = _runNamespace.valueLowerBound;
+  NSString *upperBound   = _runNamespace.valueUpperBound;
+
+  KSPagedQuery *pages = [KSPagedQuery queryWithPageSize:500 fetchBlock:^(NSUInteger offset, NSUInteger limit, KSPageCompletion done) {
+
+    SMQuery *query = [[SMQuery alloc] initWithSchema:@"foo"];
+
+    [query where:@"fooparameter" isGreaterThanOrEqualTo:lowerBound];
+    [query where:@"fooparameter" isLessThan:upperBound];
+    [query fromIndex:offset toIndex:offset + limit - 1];
+
+    [dataStore performQuery:query onSuccess:^(NSArray *results) {
+      done(results, nil);
+    } onFailure:^(NSError *error) {
+      done(nil, error);
+    }];
+  }];
+
+  pages.timeout       = _testTimeout;
+  pages.consumesPages = YES;
+
+  BOOL completed = [pages enumeratePagesUsingBlock:^(NSArray *page, NSUInteger offset, BOOL *stop) {
+
+    KSBulkDeleter *deleter = [KSBulkDeleter deleterWithConfiguration:_configuration];
+
+    [deleter deleteItems:page withBlock:^(NSDictionary *object, KSBulkDeleteCompletion done) {
+      [dataStore deleteObjectId:object[@"foo_id"] inSchema:@"foo" onSuccess:^(NSString *theObjectId, NSString *schema) {
+        done(nil);
+      } onFailure:^(NSError *theError, NSString *theObjectId, NSString *schema) {
+        done(theError);
+      }];
+    }];
+
+    NSString *failure = [deleter waitAndReportNamed:@"foo" timeout:_testTimeout];
+    STAssertNil(failure, @"%@", failure);
+
+    // Don't keep re-reading a page that can't be deleted.
+    if (deleter.failedCount > 0 || deleter.deletedCount < [page count]) {
+      *stop = YES;
+    }
+  }];
+
+  // A schema that was never created comes back as an error; nothing to delete.
+  if (!completed && _showLogs) {
+    NSLog(@"reading foo failed: %@", pages.error);
+  }
+}
+
+#pragma mark - Async helpers
+
+/*!
+ * Waits for the waiter to be signalled by an SDK completion block, failing
+ * the test if it does not happen within the configured TestTimeout.
+ */
+- (void)waitForCompletion:(KSCompletionWaiter *)waiter {
+
+  BOOL completed = [waiter waitWithTimeout:_testTimeout];
+
+  STAssertTrue(completed, @"timed out after %.3fs waiting for completion", waiter.elapsed);
+
+  if(_showLogs) {
+    NSLog(@"completion wait took %.3f ms", waiter.elapsed * 1000.0);
+  }
+}
+
 #pragma mark - Setup and configuration tests
 
 /*!
- This method deletes all Test data from the backend.
+ * Empties Bar of every run's objects, including ones other runs are still
+ * using, so it only runs with DeleteAllTestData set.
  */
 - (void)test_000_Delete_All_Test_Data {
+
+  if (!_deleteAllTestDataEnabled) {
+    NSLog(@"DeleteAllTestData is off, leaving other runs' data alone");
+    return;
+  }
+
   @try {
     [self deleteAllOpenBar];
     [self deleteAllSecureBar];
@@ -240,22 +433,22 @@
         Bar * b1 = [NSEntityDescription
                     insertNewObjectForEntityForName:@"Bar"
                     inManagedObjectContext:_sm_open_Context];
-        [b1 setBarParameter:@"Testing public access"];
+        [b1 setBarParameter:[_runNamespace tagValue:@"Testing public access"]];
         [b1 setValue:[b1 assignObjectId] forKey:[b1 primaryKeyField]];
         if(_showLogs) NSLog(@"test_100_Public_Access Bar:b1 before save = %@",
                            [b1 description]);
 
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
       
         [_sm_open_Context saveOnSuccess:^{
-          testCompleted = YES;
+          [waiter signal];
           if(_showLogs) NSLog(@"You created a new object!");
         } onFailure:^(NSError *error) {
-          testCompleted = YES;
+          [waiter signal];
           STAssertNil(error, @"test failed: %@", [error localizedDescription]);
         }];
       
-        _testForCompletionBlock(&testCompleted);
+        [self waitForCompletion:waiter];
 
         if(_showLogs) NSLog(@"test_100_Public_Access Bar:b1 after save = %@",
                            [b1 description]);
@@ -280,22 +473,22 @@
         Bar * b1 = [NSEntityDescription
                     insertNewObjectForEntityForName:@"Bar"
                     inManagedObjectContext:_sm_secure_Context];
-        [b1 setBarParameter:@"Testing secure access"];
+        [b1 setBarParameter:[_runNamespace tagValue:@"Testing secure access"]];
         [b1 setValue:[b1 assignObjectId] forKey:[b1 primaryKeyField]];
         if(_showLogs) NSLog(@"test_101_Secure_Access Bar:b1 before save = %@",
                            [b1 description]);
 
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
       
         [_sm_secure_Context saveOnSuccess:^{
-          testCompleted = YES;
+          [waiter signal];
           if(_showLogs) NSLog(@"You created a new object!");
         } onFailure:^(NSError *error) {
-          testCompleted = YES;
+          [waiter signal];
           STAssertNil(error, @"test failed: %@", [error localizedDescription]);
         }];
       
-        _testForCompletionBlock(&testCompleted);
+        [self waitForCompletion:waiter];
         // verify that the object can be accessed
         NSError *crudError;
         Bar *b2 = (Bar *)[_sm_secure_Context
@@ -342,21 +535,21 @@
                                inManagedObjectContext:_sm_open_Context];
         STAssertNotNil(b1, @"test_104_New_Class_Allowed random entity can't be nil");
         if (_showLogs) NSLog(@"b1: %@", b1);
-        [b1 setValue:@"NSManagedObject for Entity named Bar" forKey:@"barParameter"];
+        [b1 setValue:[_runNamespace tagValue:@"NSManagedObject for Entity named Bar"] forKey:@"barParameter"];
         if(_showLogs) NSLog(@"test_104_New_Class_Allowed Bar : bar before save = %@",
                            [b1 description]);
 
-      __block BOOL testCompleted = NO;
+      KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
           // create the object
         [_sm_open_Context saveOnSuccess:^{
           if(_showLogs) NSLog(@"You created a new object via new runtime class!");
-          testCompleted = YES;
+          [waiter signal];
         } onFailure:^(NSError *error) {
-          testCompleted = YES;
+          [waiter signal];
           STAssertNil(error, @"test failed: %@", [error localizedDescription]);
         }];
       
-        _testForCompletionBlock(&testCompleted);
+        [self waitForCompletion:waiter];
         // verify that the object can be accessed
         NSError *crudError;
         Bar *b2 = (Bar *)[_sm_open_Context
@@ -379,7 +572,7 @@
 - (void)test_105_New_Collection_Disallowed {
     @try {
       
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
       
         NSString * clazz = [self randomString:5];
         NSManagedObject *b1 = [NSEntityDescription
@@ -392,14 +585,14 @@
 
         // create the object
         [_sm_secure_Context saveOnSuccess:^{
-          testCompleted = YES;
+          [waiter signal];
           STFail(@"You created a new object via new runtime class and shouldn't have");
         } onFailure:^(NSError *error) {
-          testCompleted = YES;
+          [waiter signal];
           STAssertNotNil(error, @"test failed: %@", [error localizedDescription]);
         }];
       
-        _testForCompletionBlock(&testCompleted);
+        [self waitForCompletion:waiter];
 
         if(_showLogs) NSLog(@"test_105_New_Class_Disallowed Bar : bar after save = %@",
                            [b1 description]);
@@ -424,24 +617,24 @@
 
         if(_sm_open) {
           
-            __block BOOL testCompleted = NO;
+            KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
           
             Bar * bar = [NSEntityDescription
                          insertNewObjectForEntityForName:@"Bar"
                          inManagedObjectContext:_sm_open_Context];
-            [bar setValue:@"NSManagedObject Bar:bar" forKey:@"barParameter"];
+            [bar setValue:[_runNamespace tagValue:@"NSManagedObject Bar:bar"] forKey:@"barParameter"];
             [bar setValue:[bar assignObjectId] forKey:[bar primaryKeyField]];
             if(_showLogs) NSLog(@"test_107_Multiple_Backends Bar : bar before save = %@",
                                [bar description]);
             // create the object
             [_sm_open_Context saveOnSuccess:^{
-                                    testCompleted = YES;
+                                    [waiter signal];
                                   }
                                   onFailure:^(NSError *error) {
-                                    testCompleted = YES;
+                                    [waiter signal];
                                     STAssertNil(error, @"test failed: %@", [error localizedDescription]);
                                   }];
-            _testForCompletionBlock(&testCompleted);
+            [self waitForCompletion:waiter];
           
             if(_showLogs) NSLog(@"test_105_New_Class_Disallowed Bar : bar after save = %@",
                                [bar description]);
@@ -449,23 +642,23 @@
 
         if(_sm_secure) {
           
-            __block BOOL testCompleted = NO;          
+            KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];          
             Bar * bar = [NSEntityDescription
                          insertNewObjectForEntityForName:@"Bar"
                          inManagedObjectContext:_sm_secure_Context];
-            [bar setValue:@"NSManagedObject Bar:bar" forKey:@"barParameter"];
+            [bar setValue:[_runNamespace tagValue:@"NSManagedObject Bar:bar"] forKey:@"barParameter"];
             [bar setValue:[bar assignObjectId] forKey:[bar primaryKeyField]];
             if(_showLogs) NSLog(@"test_107_Multiple_Backends Foo : f2 before save = %@",[bar description]);
             // create the object
             [_sm_secure_Context saveOnSuccess:^{
-                                    testCompleted = YES;
+                                    [waiter signal];
                                   }
                                   onFailure:^(NSError *error) {
-                                    testCompleted = YES;
+                                    [waiter signal];
                                     STAssertNil(error, @"test failed: %@", [error localizedDescription]);
                                   }];
 
-            _testForCompletionBlock(&testCompleted);          
+            [self waitForCompletion:waiter];          
           
             if(_showLogs) NSLog(@"test_105_New_Class_Disallowed Bar : bar after save = %@",
                                [bar description]);
@@ -489,24 +682,24 @@
  */
 - (void)test_200_Foo_ObjCClass {
     @try {
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
         Foo * f1 = [[Foo alloc] init];
-        f1.fooParameter = @"Foo : NSObject object";
+        f1.fooParameter = [_runNamespace tagValue:@"Foo : NSObject object"];
         [[_sm_secure dataStore] createObject:f1 inSchema:@"Foo" onSuccess:
          ^(NSDictionary *theObject,
            NSString *schema) {
-            testCompleted = YES;
+            [waiter signal];
              Foo * f2 = (Foo *)theObject;
              NSLog(@"Created foo %@ in schema %@", f2, schema);
          } onFailure:^(NSError *theError,
                        NSDictionary *theObject,
                        NSString *schema) {
-           testCompleted = YES;
+           [waiter signal];
             STAssertNil(theError, @"test failed: %@",
                          [theError localizedDescription]);
              NSLog(@"Error creating object: %@", theError);
          }];
-      _testForCompletionBlock(&testCompleted);
+      [self waitForCompletion:waiter];
     } @catch (NSException * e) {
         STAssertNil(e, @"test failed: %@", [e description]);
     }
@@ -517,24 +710,24 @@
  */
 - (void)test_201_Foo_Schemaless {
     @try {
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
         NSDictionary * f1 = [NSDictionary dictionaryWithObjectsAndKeys:
-                             @"NSDictionary Foo",@"fooParameter",
+                             [_runNamespace tagValue:@"NSDictionary Foo"],@"fooParameter",
                              nil];
         if(_showLogs) NSLog(@"test_201_Foo_Schemaless NSDictionary : foo before save = %@",
                            [f1 description]);
         [[_sm_secure dataStore]
          createObject:f1 inSchema:@"Foo"
          onSuccess:^(NSDictionary *theObject, NSString *schema) {
-            testCompleted = YES;
+            [waiter signal];
              NSLog(@"Created foo %@ in schema %@", theObject, schema);
          } onFailure:^(NSError *theError, NSDictionary *theObject, NSString *schema) {
-            testCompleted = YES;
+            [waiter signal];
             STAssertNil(theError, @"test failed: %@",
                          [theError localizedDescription]);
              NSLog(@"Error creating object: %@", theError);
          }];
-      _testForCompletionBlock(&testCompleted);
+      [self waitForCompletion:waiter];
     } @catch (NSException * e) {
         STAssertNil(e, @"test failed: %@", [e description]);
     }
@@ -545,27 +738,27 @@
  */
 - (void)test_202_Bar_NSManagedObject_SubClass {
     @try {
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
         Bar * b1 = [NSEntityDescription
                     insertNewObjectForEntityForName:@"Bar"
                     inManagedObjectContext:_sm_secure_Context];
-        b1.barParameter = @"Bar : NSManagedObject object";
+        b1.barParameter = [_runNamespace tagValue:@"Bar : NSManagedObject object"];
         // or, if you prefer
-        [b1 setBarParameter:@"Bar : NSManagedObject object"];
+        [b1 setBarParameter:[_runNamespace tagValue:@"Bar : NSManagedObject object"]];
         [b1 setValue:[b1 assignObjectId] forKey:[b1 primaryKeyField]];
         if(_showLogs) NSLog(@"test_202_Bar_NSManagedObject Bar : bar before save = %@",
                            [b1 description]);
 
         [_sm_secure_Context saveOnSuccess:^{
-                                testCompleted = YES;
+                                [waiter signal];
                                   if(_showLogs) NSLog(@"test_202_Bar_NSManagedObject Bar : bar saved to remote");
                                 }
                                 onFailure:^(NSError *error) {
-                                  testCompleted = YES;
+                                  [waiter signal];
                                   STAssertNil(error, @"test failed: %@", [error localizedDescription]);
                                 }];
       
-      _testForCompletionBlock(&testCompleted);
+      [self waitForCompletion:waiter];
 
     } @catch (NSException * e) {
         STAssertNil(e, @"test failed: %@", [e description]);
@@ -577,24 +770,24 @@
  */
 - (void)test_203_NSManagedObject_Called_Bar {
     @try {
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
         NSManagedObject *b1 = [NSEntityDescription
                                insertNewObjectForEntityForName:@"Bar"
                                inManagedObjectContext:_sm_secure_Context];
-        [b1 setValue:@"NSManagedObject : Bar" forKey:@"barParameter"];
+        [b1 setValue:[_runNamespace tagValue:@"NSManagedObject : Bar"] forKey:@"barParameter"];
         [b1 setValue:[b1 assignObjectId] forKey:[b1 primaryKeyField]];
         if(_showLogs) NSLog(@"test_203_NSManagedObject_Called_Bar NSManagedObject : b1 before save = %@",
                            [b1 description]);
 
         [_sm_secure_Context saveOnSuccess:^{
-                                  testCompleted = YES;
+                                  [waiter signal];
                                   if(_showLogs) NSLog(@"test_203_NSManagedObject_Called_Bar NSManagedObject : b1 saved to remote");
                                 }
                                 onFailure:^(NSError *error) {
-                                  testCompleted = YES;
+                                  [waiter signal];
                                   STAssertNil(error, @"test failed: %@", [error localizedDescription]);
                                 }];
-      _testForCompletionBlock(&testCompleted);
+      [self waitForCompletion:waiter];
     } @catch (NSException * e) {
         STAssertNil(e, @"test failed: %@", [e description]);
     }
@@ -609,7 +802,7 @@
  */
 - (void)test_204_New_Member_Allowed {
     @try {
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
         NSString * memberName = [self randomString:5];
         NSManagedObject *b1 = [NSEntityDescription
                                insertNewObjectForEntityForName:@"Bar"
@@ -619,14 +812,14 @@
         if(_showLogs) NSLog(@"test_204_New_Member_Allowed NSManagedObject : b1 before save = %@",
                            [b1 description]);
         [_sm_secure_Context saveOnSuccess:^{
-                                testCompleted = YES;
+                                [waiter signal];
                                 if(_showLogs) NSLog(@"test_204_New_Member_Allowed NSManagedObject : b1 saved to remote");
                               }
                               onFailure:^(NSError *error) {
-                                testCompleted = YES;
+                                [waiter signal];
                                 STAssertNil(error, @"test failed: %@", [error localizedDescription]);
                               }];
-      _testForCompletionBlock(&testCompleted);
+      [self waitForCompletion:waiter];
     } @catch (NSException * e) {
         STAssertNil(e, @"test failed: %@", [e description]);
     }
@@ -640,7 +833,7 @@
  */
 - (void)test_205_New_Member_Disallowed {
     @try {
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
         NSString * memberName = [self randomString:5];
         NSManagedObject *b1 = [NSEntityDescription
                                insertNewObjectForEntityForName:@"Bar"
@@ -651,14 +844,14 @@
                            [b1 description]);
 
         [_sm_secure_Context saveOnSuccess:^{
-                              testCompleted = YES;
+                              [waiter signal];
                               if(_showLogs) NSLog(@"test_205_New_Member_Disallowed NSManagedObject : b1 saved to remote");
                             }
                             onFailure:^(NSError *error) {
-                              testCompleted = YES;
+                              [waiter signal];
                               STAssertNil(error, @"test failed: %@", [error localizedDescription]);
                             }];
-      _testForCompletionBlock(&testCompleted);
+      [self waitForCompletion:waiter];
     } @catch (NSException * e) {
         STAssertNil(e, @"test failed: %@", [e description]);
     }
@@ -669,27 +862,27 @@
  */
 - (void)test_206_Metadata_Provided {
     @try {
-        __block BOOL testCompleted = NO;
+        KSCompletionWaiter *waiter = [KSCompletionWaiter waiter];
         Bar * b1 = [NSEntityDescription
                     insertNewObjectForEntityForName:@"Bar"
                     inManagedObjectContext:_sm_secure_Context];
-        b1.barParameter = @"Some string in a Bar : NSObject object";
+        b1.barParameter = [_runNamespace tagValue:@"Some string in a Bar : NSObject object"];
         // or, if you prefer
-        [b1 setBarParameter:@"Bar : NSManagedObject object"];
+        [b1 setBarParameter:[_runNamespace tagValue:@"Bar : NSManagedObject object"]];
         [b1 setValue:[b1 assignObjectId] forKey:[b1 primaryKeyField]];
         if(_showLogs) NSLog(@"test_206_Metadata_Provided Bar : bar before save = %@",
                            [b1 description]);
 
       [_sm_secure_Context saveOnSuccess:^{
-                            testCompleted = YES;
+                            [waiter signal];
                             if(_showLogs) NSLog(@"test_206_Metadata_Provided NSManagedObject : b1 saved to remote");
                           }
                           onFailure:^(NSError *error) {
-                            testCompleted = YES;
+                            [waiter signal];
                             STAssertNil(error, @"test failed: %@", [error localizedDescription]);
                           }];
       
-        _testForCompletionBlock(&testCompleted);
+        [self waitForCompletion:waiter];
       
         STAssertNotNil(b1.sm_owner, @"no sm_owner: %@",b1.sm_owner);
         NSLog(@"metadata: sm_owner %@",b1.sm_owner);
@@ -704,21 +897,24 @@
     }
 }
 
+#pragma mark - Run cleanup
+
+/*!
+ * Runs last and removes what this run wrote, in one scoped query per
+ * schema and backend.
+ */
+- (void)test_999_Delete_Run_Data {
+  [self deleteRunTestData];
+}
+
 #pragma mark - Sample data utilities
 
 /*!
- Generates a random string of up to 1000 characters in length. Generates a random length up to 1000 if numCharacters is set to 0.
+ Generates a random string of numCharacters characters. Generates a random length up to 1000 if numCharacters is set to 0.
  */
 - (NSString *)randomString:(int)numCharacters {
-    static char const possibleChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
-    int len;
-    if(numCharacters > 1000 || numCharacters == 0) len = (int)rand() % (1000);
-    else len = numCharacters;
-    unichar characters[len];
-    for( int i=0; i < len; ++i ) {
-        characters[i] = possibleChars[arc4random_uniform(sizeof(possibleChars)-1)];
-    }
-    return [NSString stringWithCharacters:characters length:len] ;
+    int len = numCharacters > 0 ? numCharacters : (int)rand() % (1000);
+    return KSRandomString(len);
 }
 
 @end
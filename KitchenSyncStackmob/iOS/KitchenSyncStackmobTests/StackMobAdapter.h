@@ -0,0 +1,23 @@
+//
+//  StackMobAdapter.h
+//  KitchenSyncStackmobTests
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "StackMob.h"
+#import "KSProviderAdapter.h"
+
+/*!
+ * KSProviderAdapter over SMDataStore, which talks to the REST API directly
+ * rather than through the incremental store's cache. StackMob lowercases
+ * schema and field names, so entities and fields are lowercased here and
+ * callers can use the data model's names. The primary key is <schema>_id.
+ */
+@interface StackMobAdapter : NSObject <KSProviderAdapter>
+
+- (id)initWithClient:(SMClient *)client;
+
+@property (nonatomic, readonly, strong) SMClient *client;
+
+@end
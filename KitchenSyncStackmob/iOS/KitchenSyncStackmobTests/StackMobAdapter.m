@@ -0,0 +1,140 @@
+//
+//  StackMobAdapter.m
+//  KitchenSyncStackmobTests
+//
+//
+
+#import "StackMobAdapter.h"
+#import "SMDataStore+Protected.h"
+
+@interface StackMobAdapter()
+
+- (NSDictionary *)schemaFieldsForFields:(NSDictionary *)fields;
+- (id)primaryKeyOfObject:(NSDictionary *)object inSchema:(NSString *)schema;
+
+@end
+
+@implementation StackMobAdapter
+
+- (id)initWithClient:(SMClient *)client {
+
+  self = [super init];
+
+  if (self) {
+    _client = client;
+  }
+
+  return self;
+}
+
+- (NSString *)providerName {
+  return @"StackMob";
+}
+
+- (void)createObjectInEntity:(NSString *)entity fields:(NSDictionary *)fields completion:(KSBenchmarkCompletion)done {
+  [[_client dataStore] createObject:[self schemaFieldsForFields:fields] inSchema:[entity lowercaseString] onSuccess:^(NSDictionary *theObject, NSString *schema) {
+    done(theObject, nil);
+  } onFailure:^(NSError *theError, NSDictionary *theObject, NSString *schema) {
+    done(nil, theError);
+  }];
+}
+
+/*!
+ * Builds the same POST operations -createObject:inSchema:... would and hands
+ * them to AFHTTPClient as one batch.
+ */
+- (void)createObjectsInEntity:(NSString *)entity fieldsList:(NSArray *)fieldsList completion:(KSBenchmarkCompletion)done {
+
+  NSString *schema           = [entity lowercaseString];
+  SMDataStore *dataStore     = [_client dataStore];
+  AFHTTPClient *httpClient   = [_client.session oauthClientWithHTTPS:NO];
+  NSMutableArray *saved      = [NSMutableArray arrayWithCapacity:[fieldsList count]];
+  NSMutableArray *operations = [NSMutableArray arrayWithCapacity:[fieldsList count]];
+
+  for (NSDictionary *fields in fieldsList) {
+    [operations addObject:[dataStore postOperationForObject:[self schemaFieldsForFields:fields]
+                                                   inSchema:schema
+                                                    options:[SMRequestOptions options]
+                                       successCallbackQueue:dispatch_get_main_queue()
+                                       failureCallbackQueue:dispatch_get_main_queue()
+                                                  onSuccess:^(NSDictionary *result) {
+                                                    [saved addObject:result];
+                                                  }
+                                                  onFailure:^(NSURLRequest *theRequest, NSError *theError, NSDictionary *theObject, SMRequestOptions *theOptions, SMResultSuccessBlock originalSuccessBlock) {}]];
+  }
+
+  // Failed objects are simply missing from saved.
+  [httpClient enqueueBatchOfHTTPRequestOperations:operations progressBlock:nil completionBlock:^(NSArray *finished) {
+    done(saved, nil);
+  }];
+}
+
+- (void)getObject:(NSDictionary *)object inEntity:(NSString *)entity completion:(KSBenchmarkCompletion)done {
+
+  NSString *schema = [entity lowercaseString];
+
+  [[_client dataStore] readObjectWithId:[self primaryKeyOfObject:object inSchema:schema] inSchema:schema onSuccess:^(NSDictionary *theObject, NSString *schema) {
+    done(theObject, nil);
+  } onFailure:^(NSError *theError, NSString *theObjectId, NSString *schema) {
+    done(nil, theError);
+  }];
+}
+
+- (void)queryEntity:(NSString *)entity whereField:(NSString *)field equals:(id)value completion:(KSBenchmarkCompletion)done {
+
+  SMQuery *query = [[SMQuery alloc] initWithSchema:[entity lowercaseString]];
+
+  [query where:[field lowercaseString] isEqualTo:value];
+
+  [[_client dataStore] performQuery:query onSuccess:^(NSArray *results) {
+    done(results, nil);
+  } onFailure:^(NSError *error) {
+    done(nil, error);
+  }];
+}
+
+- (void)updateObject:(NSDictionary *)object inEntity:(NSString *)entity fields:(NSDictionary *)fields completion:(KSBenchmarkCompletion)done {
+
+  NSString *schema = [entity lowercaseString];
+
+  [[_client dataStore] updateObjectWithId:[self primaryKeyOfObject:object inSchema:schema]
+                                 inSchema:schema
+                                   update:[self schemaFieldsForFields:fields]
+                                onSuccess:^(NSDictionary *theObject, NSString *schema) {
+                                  done(theObject, nil);
+                                } onFailure:^(NSError *theError, NSDictionary *theObject, NSString *schema) {
+                                  done(nil, theError);
+                                }];
+}
+
+- (void)deleteObject:(NSDictionary *)object inEntity:(NSString *)entity completion:(KSBenchmarkCompletion)done {
+
+  NSString *schema = [entity lowercaseString];
+
+  [[_client dataStore] deleteObjectId:[self primaryKeyOfObject:object inSchema:schema] inSchema:schema onSuccess:^(NSString *theObjectId, NSString *schema) {
+    done(theObjectId, nil);
+  } onFailure:^(NSError *theError, NSString *theObjectId, NSString *schema) {
+    done(nil, theError);
+  }];
+}
+
+- (id)valueForField:(NSString *)field ofObject:(NSDictionary *)object {
+  return object[[field lowercaseString]];
+}
+
+- (NSDictionary *)schemaFieldsForFields:(NSDictionary *)fields {
+
+  NSMutableDictionary *schemaFields = [NSMutableDictionary dictionaryWithCapacity:[fields count]];
+
+  [fields enumerateKeysAndObjectsUsingBlock:^(NSString *field, id value, BOOL *stop) {
+    schemaFields[[field lowercaseString]] = value;
+  }];
+
+  return schemaFields;
+}
+
+- (id)primaryKeyOfObject:(NSDictionary *)object inSchema:(NSString *)schema {
+  return object[[NSString stringWithFormat:@"%@_id", schema]];
+}
+
+@end
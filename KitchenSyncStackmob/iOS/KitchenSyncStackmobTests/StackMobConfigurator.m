@@ -6,6 +6,7 @@
 //
 
 #import "StackMobConfigurator.h"
+#import "KSStandIn.h"
 
 @implementation StackMobConfigurator
 
@@ -32,6 +33,8 @@
                                                                           ofType:@"plist"];
     
     configurationDict = [NSDictionary dictionaryWithContentsOfFile:dataPath];
+
+    [KSStandIn startWithConfiguration:configurationDict name:@"StackMob"];
   });
   
   return configurationDict;
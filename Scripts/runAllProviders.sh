@@ -0,0 +1,122 @@
+#!/bin/sh
+#
+# Runs every provider's test target, all at the same time by default, and
+# reports how long each took. A full run takes about as long as the slowest
+# provider instead of the sum of all of them.
+#
+# usage: Scripts/runAllProviders.sh [-j jobs] [-o directory] [provider ...]
+#
+#   -j jobs       providers run at once (default: all of them; use 1 where
+#                 the simulator can only run one test session at a time)
+#   -o directory  where logs, derived data and benchmark reports go
+#                 (default: $TMPDIR/KitchenSyncRuns/<run id>)
+#   provider      any of Parse Kinvey Azure Stackmob Fatfractal (default: all)
+#
+# Every provider gets its own derived data, log and report directory, and
+# the same KS_RUN_ID, which the suites use to namespace the data they write.
+# The shared schemes hand KS_RUN_ID and KS_BENCHMARK_REPORT_DIR to the test
+# bundle from the build settings passed below; the TEST_RUNNER_ and
+# SIMCTL_CHILD_ copies cover newer Xcodes. Each suite logs the run id it
+# resolved, so grep a test.log for "run id" to check it arrived.
+# Set KS_DESTINATION to pick the simulator.
+
+JOBS=0
+OUTPUT=""
+
+while getopts "j:o:" option; do
+  case $option in
+    j) JOBS=$OPTARG ;;
+    o) OUTPUT=$OPTARG ;;
+    *) sed -n '3,22p' "$0"; exit 2 ;;
+  esac
+done
+
+shift $((OPTIND - 1))
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+PROVIDERS=${*:-"Parse Kinvey Azure Stackmob Fatfractal"}
+DESTINATION=${KS_DESTINATION:-"platform=iOS Simulator,name=iPhone"}
+
+KS_RUN_ID=${KS_RUN_ID:-$(date +%Y%m%d%H%M%S)-$$}
+OUTPUT=${OUTPUT:-"${TMPDIR:-/tmp}/KitchenSyncRuns/$KS_RUN_ID"}
+
+TEST_RUNNER_KS_RUN_ID=$KS_RUN_ID
+SIMCTL_CHILD_KS_RUN_ID=$KS_RUN_ID
+
+export KS_RUN_ID TEST_RUNNER_KS_RUN_ID SIMCTL_CHILD_KS_RUN_ID
+
+mkdir -p "$OUTPUT"
+
+project_for() {
+  case $1 in
+    Azure) echo "$ROOT/KitchenSyncAzure/iOS/KitchenSyncAzure/KitchenSyncAzure.xcodeproj" ;;
+    *)     echo "$ROOT/KitchenSync$1/iOS/KitchenSync$1.xcodeproj" ;;
+  esac
+}
+
+run_provider() {
+
+  provider=$1
+  started=$(date +%s)
+  reports="$OUTPUT/$provider/reports"
+
+  KS_BENCHMARK_REPORT_DIR="$reports" \
+  TEST_RUNNER_KS_BENCHMARK_REPORT_DIR="$reports" \
+  SIMCTL_CHILD_KS_BENCHMARK_REPORT_DIR="$reports" \
+  xcodebuild test \
+    -project "$(project_for "$provider")" \
+    -scheme "KitchenSync$provider" \
+    -destination "$DESTINATION" \
+    -derivedDataPath "$OUTPUT/$provider/DerivedData" \
+    KS_RUN_ID="$KS_RUN_ID" \
+    KS_BENCHMARK_REPORT_DIR="$reports" \
+    > "$OUTPUT/$provider/test.log" 2>&1
+
+  status=$?
+
+  echo "$status $(( $(date +%s) - started ))" > "$OUTPUT/$provider/result"
+}
+
+echo "run $KS_RUN_ID, output in $OUTPUT"
+
+STARTED=$(date +%s)
+RUNNING=0
+
+for provider in $PROVIDERS; do
+
+  if [ ! -d "$(project_for "$provider")" ]; then
+    echo "unknown provider $provider"
+    exit 2
+  fi
+
+  mkdir -p "$OUTPUT/$provider/reports"
+
+  run_provider "$provider" &
+
+  RUNNING=$((RUNNING + 1))
+
+  if [ "$JOBS" -gt 0 ] && [ "$RUNNING" -ge "$JOBS" ]; then
+    wait
+    RUNNING=0
+  fi
+done
+
+wait
+
+FAILED=0
+
+for provider in $PROVIDERS; do
+
+  read -r status seconds < "$OUTPUT/$provider/result"
+
+  if [ "$status" -eq 0 ]; then
+    echo "$provider passed in ${seconds}s"
+  else
+    echo "$provider FAILED in ${seconds}s, see $OUTPUT/$provider/test.log"
+    FAILED=1
+  fi
+done
+
+echo "all providers finished in $(( $(date +%s) - STARTED ))s"
+
+exit $FAILED